@@ -2,85 +2,140 @@
 
 #include "byte_stream.hh"
 #include "eventloop.hh"
+#include "pipe.hh"
+#include "util.hh"
 
 #include <algorithm>
+#include <cerrno>
+#include <functional>
 #include <iostream>
+#include <optional>
 #include <unistd.h>
+#include <utility>
 
 using namespace std;
 
-void bidirectional_stream_copy(Socket &socket) {
-    constexpr size_t max_copy_length = 65536;
-    constexpr size_t buffer_size = 1048576;
+namespace {
+
+constexpr size_t max_copy_length = 65536;
+constexpr size_t buffer_size = 1048576;
+
+//! \brief Copies bytes one way, from `in` to `out`
+//! \details While both fds allow it, the bytes are spliced through a Pipe, so they never leave the
+//! kernel. The first time either fd refuses to splice (e.g. a terminal), the copy falls back to
+//! reading the bytes into a ByteStream and writing them out from there.
+class OneWayCopy {
+  private:
+    FileDescriptor &_in;
+    FileDescriptor &_out;
+    function<void()> _finish_output;  //!< Called once everything has been copied (e.g. to shut down `out`)
+    optional<Pipe> _pipe{in_place, buffer_size};  //!< While splicing
+    ByteStream _buffer{buffer_size};                //!< Once not splicing
+    bool _input_ended{false};
+    bool _output_finished{false};
+
+    //! Did splicing fail because one of the fds doesn't support it?
+    static bool cannot_splice(const unix_error &e) { return e.code().value() == EINVAL; }
+
+    //! Stop splicing, taking any bytes still in the pipe into the ByteStream
+    void _stop_splicing() {
+        while (_pipe->buffered() > 0) {
+            _buffer.write(_pipe->read(_pipe->buffered()));
+        }
+        _pipe.reset();
+    }
+
+    size_t _remaining_capacity() const { return _pipe ? _pipe->remaining_capacity() : _buffer.remaining_capacity(); }
+    bool _empty() const { return _pipe ? _pipe->buffered() == 0 : _buffer.buffer_empty(); }
+
+    void _read() {
+        if (_pipe) {
+            try {
+                _pipe->fill_from(_in);
+            } catch (const unix_error &e) {
+                if (not cannot_splice(e)) {
+                    throw;
+                }
+                _stop_splicing();
+            }
+        }
+        if (not _pipe) {
+            _buffer.write(_in.read(_buffer.remaining_capacity()));
+        }
+        if (_in.eof()) {
+            _input_ended = true;
+        }
+    }
+
+    void _write() {
+        if (_pipe) {
+            try {
+                _pipe->drain_to(_out);
+            } catch (const unix_error &e) {
+                if (not cannot_splice(e)) {
+                    throw;
+                }
+                _stop_splicing();
+            }
+        }
+        if (not _pipe) {
+            const size_t bytes_to_write = min(max_copy_length, _buffer.buffer_size());
+            const size_t bytes_written = _out.write(_buffer.peek_output(bytes_to_write), false);
+            _buffer.pop_output(bytes_written);
+        }
+        if (_input_ended and _empty()) {
+            _finish_output();
+            _output_finished = true;
+        }
+    }
+
+  public:
+    OneWayCopy(FileDescriptor &in, FileDescriptor &out, function<void()> finish_output)
+        : _in(in), _out(out), _finish_output(move(finish_output)) {}
 
+    //! Add the rules that read from `in` and write to `out`
+    void add_rules(EventLoop &eventloop) {
+        eventloop.add_rule(
+            _in,
+            Direction::In,
+            [&] { _read(); },
+            [&] { return (not _input_ended) and _remaining_capacity() > 0; },
+            [&] { _input_ended = true; });
+
+        eventloop.add_rule(
+            _out,
+            Direction::Out,
+            [&] { _write(); },
+            [&] { return (not _empty()) or (_input_ended and not _output_finished); },
+            [&] { _input_ended = true; });
+    }
+
+    //! \name
+    //! The rules refer to the OneWayCopy, so it can't be moved or copied
+    //!@{
+    OneWayCopy(const OneWayCopy &) = delete;
+    OneWayCopy &operator=(const OneWayCopy &) = delete;
+    //!@}
+};
+
+}  // namespace
+
+void bidirectional_stream_copy(Socket &socket) {
     EventLoop _eventloop{};
     FileDescriptor _input{STDIN_FILENO};
     FileDescriptor _output{STDOUT_FILENO};
-    ByteStream _outbound{buffer_size};
-    ByteStream _inbound{buffer_size};
-    bool _outbound_shutdown{false};
-    bool _inbound_shutdown{false};
 
     socket.set_blocking(false);
     _input.set_blocking(false);
     _output.set_blocking(false);
 
-    // rule 1: read from stdin into outbound byte stream
-    _eventloop.add_rule(
-        _input,
-        Direction::In,
-        [&] {
-            _outbound.write(_input.read(_outbound.remaining_capacity()));
-            if (_input.eof()) {
-                _outbound.end_input();
-            }
-        },
-        [&] { return (not _outbound.error()) and (_outbound.remaining_capacity() > 0) and (not _inbound.error()); },
-        [&] { _outbound.end_input(); });
-
-    // rule 2: read from outbound byte stream into socket
-    _eventloop.add_rule(socket,
-                        Direction::Out,
-                        [&] {
-                            const size_t bytes_to_write = min(max_copy_length, _outbound.buffer_size());
-                            const size_t bytes_written = socket.write(_outbound.peek_output(bytes_to_write), false);
-                            _outbound.pop_output(bytes_written);
-                            if (_outbound.eof()) {
-                                socket.shutdown(SHUT_WR);
-                                _outbound_shutdown = true;
-                            }
-                        },
-                        [&] { return (not _outbound.buffer_empty()) or (_outbound.eof() and not _outbound_shutdown); },
-                        [&] { _outbound.end_input(); });
-
-    // rule 3: read from socket into inbound byte stream
-    _eventloop.add_rule(
-        socket,
-        Direction::In,
-        [&] {
-            _inbound.write(socket.read(_inbound.remaining_capacity()));
-            if (socket.eof()) {
-                _inbound.end_input();
-            }
-        },
-        [&] { return (not _inbound.error()) and (_inbound.remaining_capacity() > 0) and (not _outbound.error()); },
-        [&] { _inbound.end_input(); });
-
-    // rule 4: read from inbound byte stream into stdout
-    _eventloop.add_rule(_output,
-                        Direction::Out,
-                        [&] {
-                            const size_t bytes_to_write = min(max_copy_length, _inbound.buffer_size());
-                            const size_t bytes_written = _output.write(_inbound.peek_output(bytes_to_write), false);
-                            _inbound.pop_output(bytes_written);
-
-                            if (_inbound.eof()) {
-                                _output.close();
-                                _inbound_shutdown = true;
-                            }
-                        },
-                        [&] { return (not _inbound.buffer_empty()) or (_inbound.eof() and not _inbound_shutdown); },
-                        [&] { _inbound.end_input(); });
+    // rules 1 and 2: from stdin to the socket
+    OneWayCopy _outbound{_input, socket, [&] { socket.shutdown(SHUT_WR); }};
+    _outbound.add_rules(_eventloop);
+
+    // rules 3 and 4: from the socket to stdout
+    OneWayCopy _inbound{socket, _output, [&] { _output.close(); }};
+    _inbound.add_rules(_eventloop);
 
     // loop until completion
     while (true) {
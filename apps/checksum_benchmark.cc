@@ -0,0 +1,61 @@
+#include "util.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t len = 1024 * 1024 * 1024;
+
+//! Checksums `len` bytes, in `chunk_size` pieces, with `kernel`, and prints how fast it went
+void benchmark(const string &data, const size_t chunk_size, const InternetChecksum::Kernel kernel, const char *name) {
+    if (not InternetChecksum::supported(kernel)) {
+        cout << setw(9) << name << ", " << setw(5) << chunk_size << "-byte chunks: not supported by this CPU\n";
+        return;
+    }
+
+    uint16_t total = 0;  // (so that the work can't be optimized away)
+    const auto first_time = high_resolution_clock::now();
+    for (size_t done = 0; done < len; done += data.size()) {
+        for (size_t offset = 0; offset < data.size(); offset += chunk_size) {
+            InternetChecksum check;
+            check.add(string_view{data}.substr(offset, chunk_size), kernel);
+            total += check.value();
+        }
+    }
+    const auto final_time = high_resolution_clock::now();
+
+    const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
+    const auto gigabits_per_second = len * 8.0 / double(duration);
+
+    cout << fixed << setprecision(2);
+    cout << setw(9) << name << ", " << setw(5) << chunk_size << "-byte chunks: " << setw(7) << gigabits_per_second
+         << " Gbit/s (" << hex << total << dec << ")\n";
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        string data(1024 * 1024, 0);
+        for (auto &ch : data) {
+            ch = static_cast<char>(rd());
+        }
+
+        // segment-sized chunks, and headers
+        for (const size_t chunk_size : {1452, 20}) {
+            benchmark(data, chunk_size, InternetChecksum::Kernel::Bytewise, "bytewise");
+            benchmark(data, chunk_size, InternetChecksum::Kernel::Word64, "word64");
+            benchmark(data, chunk_size, InternetChecksum::Kernel::SSE2, "sse2");
+            benchmark(data, chunk_size, InternetChecksum::Kernel::AVX2, "avx2");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -43,12 +43,11 @@ string summary(const EthernetFrame &frame) {
     switch (frame.header().type) {
         case EthernetHeader::TYPE_IPv4: {
             InternetDatagram dgram;
-            if (dgram.parse(frame.payload().concatenate()) == ParseResult::NoError) {
+            if (dgram.parse(frame.payload()) == ParseResult::NoError) {
                 ret += " " + dgram.header().summary();
                 if (dgram.header().proto == IPv4Header::PROTO_TCP) {
                     TCPSegment tcp_seg;
-                    if (tcp_seg.parse(dgram.payload().concatenate(), dgram.header().pseudo_cksum()) ==
-                        ParseResult::NoError) {
+                    if (tcp_seg.parse(dgram.payload(), dgram.header().pseudo_cksum()) == ParseResult::NoError) {
                         ret += " " + tcp_seg.header().summary();
                     }
                 }
@@ -196,7 +196,6 @@ class Network {
                  AsyncNetworkInterface &dst) {
         queue<EthernetFrame> to_send = src;
         while (not to_send.empty()) {
-            to_send.front().payload() = to_send.front().payload().concatenate();
             cerr << "Transferring frame from " << src_name << " to " << dst_name << ": " << summary(to_send.front())
                  << "\n";
             dst.recv_frame(move(to_send.front()));
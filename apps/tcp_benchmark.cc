@@ -12,10 +12,7 @@ using namespace std::chrono;
 constexpr size_t len = 100 * 1024 * 1024;
 
 void move_segments(TCPConnection &x, TCPConnection &y, vector<TCPSegment> &segments, const bool reorder) {
-    while (not x.segments_out().empty()) {
-        segments.emplace_back(move(x.segments_out().front()));
-        x.segments_out().pop();
-    }
+    segments.swap(x.segments_out());
     if (reorder) {
         for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
             y.segment_received(move(*it));
@@ -31,6 +31,9 @@ static void show_usage(const char *argv0, const char *msg) {
          << "   -Lu <loss>      Set uplink loss to <rate> (float in 0..1)       (no loss)\n"
          << "   -Ld <loss>      Set downlink loss to <rate> (float in 0..1)     (no loss)\n\n"
 
+         << "   -u              Do the TCP thread's I/O through io_uring        (poll)\n"
+         << "                   (or epoll, where io_uring isn't available).\n\n"
+
          << "   -h              Show this message and quit.\n\n";
 
     if (msg != nullptr) {
@@ -84,6 +87,10 @@ static tuple<TCPConfig, FdAdapterConfig, bool> get_config(int argc, char **argv)
                 static_cast<LossRateDnT>(static_cast<float>(numeric_limits<LossRateDnT>::max()) * lossrate);
             curr += 2;
 
+        } else if (strncmp("-u", argv[curr], 3) == 0) {
+            c_filt.loop_backend = FdAdapterConfig::LoopBackend::IoUring;
+            curr += 1;
+
         } else if (strncmp("-h", argv[curr], 3) == 0) {
             show_usage(argv[0], nullptr);
             exit(0);
@@ -0,0 +1,28 @@
+const uint16_t portnum = ((std::random_device()()) % 50000) + 1025;
+
+// create a UDP socket and bind it to a local address
+UDPSocket sock1;
+sock1.bind(Address("127.0.0.1", portnum));
+
+// send three datagrams to it with one system call
+UDPSocket sock2;
+const std::vector<BufferViewList> payloads{"one", "two", "three"};
+if (sock2.send_batch(Address("127.0.0.1", portnum), payloads) != 3) {
+    throw std::runtime_error("wrong number of datagrams sent");
+}
+
+// receive them (into Slabs from a pool, reused for the next batch) with one system call;
+// this waits for the first datagram, so it may return before the others have arrived
+BufferPool pool{65536};
+std::vector<UDPSocket::received_buffer> batch(8, {{nullptr, 0}, {}, 0});
+std::vector<std::string> recvd;
+while (recvd.size() < 3) {
+    const size_t count = sock1.recv_batch(pool, batch);
+    for (size_t i = 0; i < count; i++) {
+        recvd.push_back(batch[i].payload.copy());
+    }
+}
+
+if (recvd != std::vector<std::string>{"one", "two", "three"}) {
+    throw std::runtime_error("wrong data received");
+}
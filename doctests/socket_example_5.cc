@@ -0,0 +1,31 @@
+const uint16_t portnum = ((std::random_device()()) % 50000) + 1025;
+
+// create a UDP socket that accepts coalesced datagrams, and bind it to a local address
+UDPSocket sock1;
+sock1.set_gro(true);
+sock1.bind(Address("127.0.0.1", portnum));
+
+// send three datagrams to it as one buffer, split every 4 bytes (if the kernel can)
+UDPSocket sock2;
+if (sock2.gso_supported()) {
+    const std::vector<UDPSocket::segmented_payload> runs{{"aaaabbbbcc", 4}};
+    sock2.send_batch(Address("127.0.0.1", portnum), runs);
+
+    // each received payload is either one datagram or several coalesced ones
+    BufferPool pool{65536};
+    std::vector<UDPSocket::received_buffer> batch(8, {{nullptr, 0}, {}, 0});
+    std::string recvd;
+    size_t datagrams = 0;
+    while (recvd.size() < 10) {
+        const size_t count = sock1.recv_batch(pool, batch);
+        for (size_t i = 0; i < count; i++) {
+            const size_t segment_size = batch[i].segment_size == 0 ? batch[i].payload.size() : batch[i].segment_size;
+            datagrams += (batch[i].payload.size() + segment_size - 1) / segment_size;
+            recvd += batch[i].payload.str();
+        }
+    }
+
+    if (recvd != "aaaabbbbcc" || datagrams != 3) {
+        throw std::runtime_error("wrong data received");
+    }
+}
@@ -14,6 +14,15 @@ if (${IS_CLANG_COMPILER})
     set (CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -Wloop-analysis")
 endif ()
 
+# the coroutine layer (libsponge/async) is built as C++20, where the compiler supports coroutines
+set (CXX_VERSION_LT_11 ("${CMAKE_CXX_COMPILER_VERSION}" VERSION_LESS 11))
+set (CXX_VERSION_LT_14 ("${CMAKE_CXX_COMPILER_VERSION}" VERSION_LESS 14))
+if ((${IS_GNU_COMPILER} AND NOT ${CXX_VERSION_LT_11}) OR (${IS_CLANG_COMPILER} AND NOT ${CXX_VERSION_LT_14}))
+    set (HAVE_COROUTINES ON)
+else ()
+    message (STATUS "Not building libsponge/async: it needs C++20 coroutines (g++ >= 11 or clang >= 14).")
+endif ()
+
 # add some flags for the Release, Debug, and DebugSan modes
 set (CMAKE_CXX_FLAGS_DEBUG "${CMAKE_CXX_FLAGS_DEBUG} -ggdb3 -Og")
 set (CMAKE_CXX_FLAGS_DEBUGASAN "${CMAKE_CXX_FLAGS_DEBUG} -fsanitize=undefined -fsanitize=address")
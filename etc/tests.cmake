@@ -7,6 +7,8 @@ add_test(NAME t_wrapping_ints_unwrap      COMMAND wrapping_integers_unwrap)
 add_test(NAME t_wrapping_ints_wrap        COMMAND wrapping_integers_wrap)
 add_test(NAME t_wrapping_ints_roundtrip   COMMAND wrapping_integers_roundtrip)
 
+add_test(NAME t_timer_wheel               COMMAND timer_wheel)
+
 add_test(NAME t_recv_connect         COMMAND recv_connect)
 add_test(NAME t_recv_transmit        COMMAND recv_transmit)
 add_test(NAME t_recv_window          COMMAND recv_window)
@@ -21,6 +23,8 @@ add_test(NAME t_send_window          COMMAND send_window)
 add_test(NAME t_send_ack             COMMAND send_ack)
 add_test(NAME t_send_close           COMMAND send_close)
 add_test(NAME t_send_extra           COMMAND send_extra)
+add_test(NAME t_send_policy          COMMAND send_policy)
+add_test(NAME t_send_rack_tlp        COMMAND send_rack_tlp)
 
 add_test(NAME t_strm_reassem_single      COMMAND fsm_stream_reassembler_single)
 add_test(NAME t_strm_reassem_seq         COMMAND fsm_stream_reassembler_seq)
@@ -62,6 +66,24 @@ add_test(NAME t_retx_win             COMMAND fsm_retx_win)
 add_test(NAME t_loopback             COMMAND fsm_loopback)
 add_test(NAME t_loopback_win         COMMAND fsm_loopback_win)
 add_test(NAME t_reorder              COMMAND fsm_reorder)
+add_test(NAME t_multiplexer          COMMAND tcp_multiplexer)
+add_test(NAME t_sponge_listener      COMMAND tcp_sponge_listener)
+add_test(NAME t_checkpoint           COMMAND tcp_checkpoint)
+add_test(NAME t_info                 COMMAND tcp_info)
+add_test(NAME t_epoll_eventloop      COMMAND epoll_eventloop)
+add_test(NAME t_io_uring_eventloop   COMMAND io_uring_eventloop)
+add_test(NAME t_eventloop_timers     COMMAND eventloop_timers)
+add_test(NAME t_eventloop_group      COMMAND eventloop_group)
+add_test(NAME t_segment_offload      COMMAND segment_offload)
+add_test(NAME t_buffer_pool          COMMAND buffer_pool)
+add_test(NAME t_pipe_splice          COMMAND pipe_splice)
+add_test(NAME t_packet_buffer        COMMAND packet_buffer)
+add_test(NAME t_buffer_list          COMMAND buffer_list)
+add_test(NAME t_internet_checksum    COMMAND internet_checksum)
+add_test(NAME t_header_errors        COMMAND header_errors)
+if (HAVE_COROUTINES)
+    add_test(NAME t_async_sessions   COMMAND async_sessions)
+endif ()
 
 add_test(NAME t_address_dt           COMMAND address_dt)
 add_test(NAME t_parser_dt            COMMAND parser_dt)
@@ -0,0 +1,44 @@
+#include "async_fd.hh"
+
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+using namespace std;
+
+AsyncFd::AsyncFd(CoroutineLoop &loop, FileDescriptor &&fd) : _loop(loop), _fd(move(fd)) { _fd.set_blocking(false); }
+
+AsyncFd::~AsyncFd() {
+    try {
+        if (not _fd.closed()) {
+            _fd.close();
+        }
+    } catch (const exception &e) {
+        // don't throw an exception from the destructor
+        cerr << "Exception destructing AsyncFd: " << e.what() << endl;
+    }
+}
+
+//! \param[out] buffer receives the bytes read
+//! \param[in] limit is the maximum number of bytes to read; fewer bytes may be read
+Task<> AsyncFd::read_some(string &buffer, const size_t limit) {
+    co_await readable();
+    if (_fd.closed() or _fd.eof()) {
+        buffer.clear();
+        co_return;
+    }
+    _fd.read(buffer, limit);
+}
+
+//! \param[in] data is the bytes to write (kept in the coroutine until they are all written)
+Task<> AsyncFd::write_all(string data) {
+    string_view remaining{data};
+    while (not remaining.empty()) {
+        co_await writable();
+        if (_fd.closed()) {
+            throw runtime_error("AsyncFd: fd closed while writing");
+        }
+        remaining.remove_prefix(_fd.write(BufferViewList{remaining}, false));
+    }
+}
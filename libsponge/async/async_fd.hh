@@ -0,0 +1,83 @@
+#ifndef SPONGE_LIBSPONGE_ASYNC_FD_HH
+#define SPONGE_LIBSPONGE_ASYNC_FD_HH
+
+#include "coroutine_loop.hh"
+#include "file_descriptor.hh"
+#include "task.hh"
+
+#include <cstddef>
+#include <string>
+
+template <typename AdaptT>
+class TCPSpongeSocket;
+
+//! \brief A non-blocking fd (e.g. a TCPSocket or a LocalStreamSocket) read and written by coroutines
+//!
+//! ~~~{.cc}
+//! Task<> echo(CoroutineLoop &loop, TCPSocket &&socket) {
+//!     AsyncFd conn{loop, std::move(socket)};
+//!     std::string buffer;
+//!     while (true) {
+//!         co_await conn.read_some(buffer);
+//!         if (conn.eof()) {
+//!             break;
+//!         }
+//!         co_await conn.write_all(std::move(buffer));
+//!     }
+//! }
+//! ~~~
+//!
+//! The AsyncFd owns the fd and closes it when destroyed, which also retires the CoroutineLoop's
+//! rules for it. The caller hands over an fd it owns outright: a TCPSpongeSocket can't be taken
+//! over, since its own thread keeps using the other end of its socketpair (and moving it into a
+//! FileDescriptor would slice that state off), so wait on it with CoroutineLoop::readable() and
+//! CoroutineLoop::writable() instead.
+class AsyncFd {
+  private:
+    CoroutineLoop &_loop;
+    FileDescriptor _fd;
+
+  public:
+    //! \brief Take over `fd` (making it non-blocking), to be waited on with `loop`
+    AsyncFd(CoroutineLoop &loop, FileDescriptor &&fd);
+
+    //! \brief A TCPSpongeSocket can't be taken over (see the class description)
+    template <typename AdaptT>
+    AsyncFd(CoroutineLoop &loop, TCPSpongeSocket<AdaptT> &&fd) = delete;
+
+    //! \brief Close the fd, unless it has been closed already
+    ~AsyncFd();
+
+    //! \brief `co_await` to wait until the fd is readable
+    CoroutineLoop::FdAwaiter readable() const { return _loop.readable(_fd); }
+
+    //! \brief `co_await` to wait until the fd is writable
+    CoroutineLoop::FdAwaiter writable() const { return _loop.writable(_fd); }
+
+    //! \brief Wait until the fd is readable, then read up to `limit` bytes into `buffer`
+    //! \details `buffer` is left empty (and eof() is `true`) at EOF.
+    Task<> read_some(std::string &buffer, const size_t limit = 65536);
+
+    //! \brief Write all of `data`, waiting whenever the fd can take no more
+    Task<> write_all(std::string data);
+
+    //! \brief Has the fd reached EOF?
+    bool eof() const { return _fd.eof(); }
+
+    //! \brief Close the fd
+    void close() { _fd.close(); }
+
+    //! \brief The underlying fd
+    FileDescriptor &fd() { return _fd; }
+
+    //! \name
+    //! Awaiters refer to the fd, so an AsyncFd can't be moved or copied
+    //!@{
+    AsyncFd(const AsyncFd &) = delete;
+    AsyncFd &operator=(const AsyncFd &) = delete;
+    AsyncFd(AsyncFd &&) = delete;
+    AsyncFd &operator=(AsyncFd &&) = delete;
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_ASYNC_FD_HH
@@ -0,0 +1,89 @@
+#include "coroutine_loop.hh"
+
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+bool CoroutineLoop::_wait_done(const FileDescriptor &fd, const EventLoop::Direction direction) const {
+    if (fd.closed()) {
+        return true;
+    }
+    const auto it = _watches.find(fd.fd_num());
+    return it != _watches.end() and not it->second->fd.closed() and it->second->side(direction).canceled;
+}
+
+//! \details The rule's interest is "a coroutine is waiting", and its callback takes the waiter
+//! off the Side, so the rule is uninterested again by the time the EventLoop checks for a busy wait.
+void CoroutineLoop::_wait(const FileDescriptor &fd, const EventLoop::Direction direction, const coroutine_handle<> waiter) {
+    auto &watch = _watches[fd.fd_num()];
+    // an entry for a closed fd is stale (its number has been reused); its rules go away on their own
+    if (not watch or watch->fd.closed()) {
+        watch = make_shared<Watch>(Watch{fd.duplicate()});
+    }
+    Side &side = watch->side(direction);
+    if (side.waiter) {
+        throw runtime_error("CoroutineLoop: another coroutine is already waiting on this fd in this direction");
+    }
+    side.waiter = waiter;
+    if (side.rule) {
+        return;
+    }
+
+    side.rule = true;
+    _loop.add_rule(
+        watch->fd,
+        direction,
+        [this, &side] { _ready.push_back(exchange(side.waiter, {})); },
+        [&side] { return static_cast<bool>(side.waiter); },
+        [this, direction, owner = watch] {
+            Side &canceled = owner->side(direction);
+            canceled.canceled = true;
+            if (canceled.waiter) {
+                _ready.push_back(exchange(canceled.waiter, {}));
+            }
+            // forget the fd once none of its rules is left
+            const auto it = _watches.find(owner->fd.fd_num());
+            const bool done = (not owner->in.rule or owner->in.canceled) and (not owner->out.rule or owner->out.canceled);
+            if (done and it != _watches.end() and it->second == owner) {
+                _watches.erase(it);
+            }
+        });
+}
+
+void CoroutineLoop::SleepAwaiter::await_suspend(const coroutine_handle<> waiter) {
+    _owner._loop.add_timer(_delay_ms, [&owner = _owner, waiter] { owner._ready.push_back(waiter); });
+}
+
+void CoroutineLoop::spawn(Task<> task) {
+    _running++;
+    move(task).detach([this](const exception_ptr failure) {
+        _running--;
+        if (failure and not _failure) {
+            _failure = failure;
+        }
+    });
+}
+
+void CoroutineLoop::run() {
+    while (true) {
+        // resume the coroutines made ready by the last wait (and any they make ready in turn)
+        while (not _ready.empty()) {
+            vector<coroutine_handle<>> ready;
+            swap(ready, _ready);
+            for (const auto handle : ready) {
+                handle.resume();
+            }
+        }
+        if (_failure) {
+            rethrow_exception(exchange(_failure, nullptr));
+        }
+        if (_running == 0) {
+            return;
+        }
+        // (a rule canceled before the EventLoop found nothing to wait for may have made a coroutine ready)
+        if (_loop.wait_next_event(-1) == EventLoop::Result::Exit and _ready.empty()) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef SPONGE_LIBSPONGE_COROUTINE_LOOP_HH
+#define SPONGE_LIBSPONGE_COROUTINE_LOOP_HH
+
+#include "eventloop.hh"
+#include "file_descriptor.hh"
+#include "task.hh"
+
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+//! \brief Runs coroutines (Task<void>s) on an EventLoop, suspending them while they wait for fds and timers
+//!
+//! A coroutine waits for an fd with `co_await loop.readable(fd)` (or writable()), and for time to pass
+//! with `co_await loop.sleep_for(ms)`. Underneath, the first wait on each fd in each Direction adds an
+//! EventLoop rule that stays interested only while a coroutine is waiting, and whose callback marks
+//! that coroutine ready. Ready coroutines are resumed by run() after EventLoop::wait_next_event
+//! returns, so they are free to start new waits (which may add rules).
+//!
+//! Each fd may have one coroutine waiting on it per Direction. When the EventLoop cancels a rule
+//! (the fd reached EOF, hung up or was closed), the waiting coroutine is resumed, and later waits on
+//! that fd in that Direction complete at once.
+class CoroutineLoop {
+  private:
+    //! The coroutine waiting on one Direction of an fd
+    struct Side {
+        std::coroutine_handle<> waiter{};
+        bool rule{false};      //!< has an EventLoop rule been added?
+        bool canceled{false};  //!< has the EventLoop canceled it?
+    };
+
+    //! An fd with (or about to get) EventLoop rules
+    struct Watch {
+        FileDescriptor fd;
+        Side in{};
+        Side out{};
+
+        Side &side(const EventLoop::Direction direction) { return direction == Direction::In ? in : out; }
+    };
+
+    EventLoop &_loop;
+    std::unordered_map<int, std::shared_ptr<Watch>> _watches{};  //!< by fd number
+    std::vector<std::coroutine_handle<>> _ready{};                //!< coroutines to resume
+    size_t _running{0};                                          //!< spawned tasks that haven't finished
+    std::exception_ptr _failure{};                               //!< the first exception a spawned task exited with
+
+    void _wait(const FileDescriptor &fd, const EventLoop::Direction direction, const std::coroutine_handle<> waiter);
+    bool _wait_done(const FileDescriptor &fd, const EventLoop::Direction direction) const;
+
+  public:
+    //! Suspends a coroutine until an fd is ready in one Direction
+    class FdAwaiter {
+        CoroutineLoop &_owner;
+        const FileDescriptor &_fd;
+        EventLoop::Direction _direction;
+
+      public:
+        FdAwaiter(CoroutineLoop &owner, const FileDescriptor &fd, const EventLoop::Direction direction)
+            : _owner(owner), _fd(fd), _direction(direction) {}
+        bool await_ready() const { return _owner._wait_done(_fd, _direction); }
+        void await_suspend(const std::coroutine_handle<> waiter) { _owner._wait(_fd, _direction, waiter); }
+        void await_resume() const {}
+    };
+
+    //! Suspends a coroutine until a timer fires
+    class SleepAwaiter {
+        CoroutineLoop &_owner;
+        uint64_t _delay_ms;
+
+      public:
+        SleepAwaiter(CoroutineLoop &owner, const uint64_t delay_ms) : _owner(owner), _delay_ms(delay_ms) {}
+        bool await_ready() const { return false; }
+        void await_suspend(const std::coroutine_handle<> waiter);
+        void await_resume() const {}
+    };
+
+    //! \brief Drive coroutines with `loop` (which may have other rules and timers of its own)
+    explicit CoroutineLoop(EventLoop &loop) : _loop(loop) {}
+
+    //! \brief `co_await` to wait until `fd` is readable (or at EOF, hung up or closed)
+    FdAwaiter readable(const FileDescriptor &fd) { return {*this, fd, Direction::In}; }
+
+    //! \brief `co_await` to wait until `fd` is writable (or hung up or closed)
+    FdAwaiter writable(const FileDescriptor &fd) { return {*this, fd, Direction::Out}; }
+
+    //! \brief `co_await` to wait for `delay_ms` milliseconds (0 lets other ready coroutines run first)
+    SleepAwaiter sleep_for(const uint64_t delay_ms) { return {*this, delay_ms}; }
+
+    //! \brief Start a task that runs on its own (until its first wait, right away)
+    void spawn(Task<> task);
+
+    //! \brief Spawned tasks that haven't finished
+    size_t running() const { return _running; }
+
+    //! \brief Run the EventLoop until every spawned task has finished
+    //! \details Also returns if the EventLoop has nothing left to wait for (see EventLoop::Result::Exit).
+    //! \throws the first exception a spawned task exited with (the other tasks are left suspended)
+    void run();
+
+    //! \name
+    //! Rules refer to the CoroutineLoop, so it can't be moved or copied
+    //!@{
+    CoroutineLoop(const CoroutineLoop &) = delete;
+    CoroutineLoop &operator=(const CoroutineLoop &) = delete;
+    CoroutineLoop(CoroutineLoop &&) = delete;
+    CoroutineLoop &operator=(CoroutineLoop &&) = delete;
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_COROUTINE_LOOP_HH
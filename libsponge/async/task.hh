@@ -0,0 +1,166 @@
+#ifndef SPONGE_LIBSPONGE_TASK_HH
+#define SPONGE_LIBSPONGE_TASK_HH
+
+#if __cplusplus < 202002L
+#error "the coroutine layer (libsponge/async) needs C++20"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <utility>
+
+template <typename T>
+class Task;
+
+//! \brief What the promises of every Task<T> share: how a finished task hands control back
+class TaskPromiseBase {
+  public:
+    //! Resumes whoever is waiting for the task (or, for a detached task, destroys it)
+    class FinalAwaiter {
+      public:
+        bool await_ready() const noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            TaskPromiseBase &promise = handle.promise();
+            if (promise.on_detached_exit) {
+                const auto on_exit = std::move(promise.on_detached_exit);
+                const std::exception_ptr failure = promise.failure;
+                handle.destroy();
+                on_exit(failure);
+                return std::noop_coroutine();
+            }
+            return promise.continuation ? promise.continuation : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    std::coroutine_handle<> continuation{};  //!< the coroutine awaiting this task, if any
+    std::exception_ptr failure{};            //!< the exception the task exited with, if any
+
+    //! Set on a detached task: called with `failure` once the task has finished and been destroyed
+    std::function<void(std::exception_ptr)> on_detached_exit{};
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() { failure = std::current_exception(); }
+
+    //! Rethrow the exception the task exited with, if any
+    void rethrow_failure() const {
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+    }
+};
+
+//! \brief The promise of a Task<T> that produces a value
+template <typename T>
+class TaskPromise : public TaskPromiseBase {
+    std::optional<T> _value{};
+
+  public:
+    Task<T> get_return_object() { return Task<T>{std::coroutine_handle<TaskPromise>::from_promise(*this)}; }
+
+    template <typename U>
+    void return_value(U &&value) {
+        _value.emplace(std::forward<U>(value));
+    }
+
+    //! The task's value (or the exception it exited with, rethrown)
+    T result() {
+        rethrow_failure();
+        return std::move(_value.value());
+    }
+};
+
+//! \brief The promise of a Task<void>
+template <>
+class TaskPromise<void> : public TaskPromiseBase {
+  public:
+    Task<void> get_return_object();
+
+    void return_void() const {}
+
+    //! Rethrows the exception the task exited with, if any
+    void result() const { rethrow_failure(); }
+};
+
+//! \brief A coroutine that produces a `T` (or nothing, for Task<void>) and can be `co_await`ed
+//!
+//! A Task does nothing until it is awaited (or detached); awaiting it runs it until it finishes,
+//! suspending the awaiting coroutine whenever the task itself waits for something, and then
+//! yields its value or rethrows the exception it exited with. Control passes between the two
+//! coroutines by symmetric transfer, so chains of awaited tasks don't grow the stack.
+//!
+//! ~~~{.cc}
+//! Task<size_t> count_bytes(AsyncFd &in) {
+//!     size_t total = 0;
+//!     std::string buffer;
+//!     do {
+//!         co_await in.read_some(buffer);
+//!         total += buffer.size();
+//!     } while (not in.eof());
+//!     co_return total;
+//! }
+//! ~~~
+template <typename T = void>
+class Task {
+  public:
+    using promise_type = TaskPromise<T>;
+
+  private:
+    std::coroutine_handle<promise_type> _handle;
+
+  public:
+    //! \brief Take ownership of a coroutine (called by the promise)
+    explicit Task(const std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+
+    //! \brief Destroy the coroutine, if it is still owned
+    ~Task() {
+        if (_handle) {
+            _handle.destroy();
+        }
+    }
+
+    Task(Task &&other) noexcept : _handle(std::exchange(other._handle, {})) {}
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            if (_handle) {
+                _handle.destroy();
+            }
+            _handle = std::exchange(other._handle, {});
+        }
+        return *this;
+    }
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    //! \name
+    //! Awaiting a Task runs it, and resumes the awaiting coroutine with its result when it finishes
+    //!@{
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(const std::coroutine_handle<> awaiting) noexcept {
+        _handle.promise().continuation = awaiting;
+        return _handle;
+    }
+    T await_resume() { return _handle.promise().result(); }
+    //!@}
+
+    //! \brief Start the task without anyone awaiting it
+    //! \details The task destroys itself when it finishes, and then calls `on_exit` with the exception
+    //! it exited with (or a null std::exception_ptr).
+    void detach(std::function<void(std::exception_ptr)> on_exit) && {
+        const auto handle = std::exchange(_handle, {});
+        handle.promise().on_detached_exit = std::move(on_exit);
+        handle.resume();
+    }
+};
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>{std::coroutine_handle<TaskPromise>::from_promise(*this)};
+}
+
+#endif  // SPONGE_LIBSPONGE_TASK_HH
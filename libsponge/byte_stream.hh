@@ -1,6 +1,9 @@
 #ifndef SPONGE_LIBSPONGE_BYTE_STREAM_HH
 #define SPONGE_LIBSPONGE_BYTE_STREAM_HH
 
+#include "checkpoint.hh"
+#include "packet_buffer.hh"
+
 #include <string>
 
 //! \brief An in-order byte stream.
@@ -57,6 +60,10 @@ class ByteStream {
     //! \returns a string
     std::string read(const size_t len);
 
+    //! Read the next "len" bytes of the stream (or as many as there are), appending them to a PacketBuffer
+    //! \returns the number of bytes read
+    size_t read(PacketBuffer &out, const size_t len);
+
     //! \returns `true` if the stream input has ended
     bool input_ended() const;
 
@@ -82,6 +89,16 @@ class ByteStream {
     //! Total number of bytes popped
     size_t bytes_read() const;
     //!@}
+
+    //! \name Checkpointing
+    //!@{
+
+    //! Append the stream's buffered bytes, counters and flags to a checkpoint
+    void checkpoint(CheckpointWriter &out) const;
+
+    //! Replace the stream's state with one read from a checkpoint
+    void restore(CheckpointReader &in);
+    //!@}
 };
 
 #endif  // SPONGE_LIBSPONGE_BYTE_STREAM_HH
@@ -4,6 +4,7 @@
 #include "ethernet_frame.hh"
 
 #include <iostream>
+#include <vector>
 
 // Dummy implementation of a network interface
 // Translates from {IP datagram, next hop address} to link-layer frame, and from link-layer frame to IP datagram
@@ -38,20 +39,7 @@ void NetworkInterface::send_datagram(const InternetDatagram &dgram, const Addres
     if (arp_iter == _arp_table.end()) {
         // broadcast an ARPMessage to get the address for the next hop if no same ARPMessage has been sent in the last 5 seconds
         if (_arp_msg_list.find(next_hop_ip) == _arp_msg_list.end()) {
-            ARPMessage arp_request;
-            arp_request.opcode = ARPMessage::OPCODE_REQUEST;
-            arp_request.sender_ethernet_address = _ethernet_address;
-            arp_request.sender_ip_address = _ip_address.ipv4_numeric();
-            arp_request.target_ip_address = next_hop_ip;
-            EthernetFrame eth_frame;
-            eth_frame.header() = {
-                ETHERNET_BROADCAST,
-                _ethernet_address,
-                EthernetHeader::TYPE_ARP
-            };
-            eth_frame.payload() = arp_request.serialize();
-            _frames_out.push(eth_frame);
-            _arp_msg_list[next_hop_ip] = ARP_MESSAGE_DEFAULT_TTL;
+            _send_arp_request(next_hop_ip);
         }
         // IPv4 datagram begins waiting for ARP request
         _dgram_waiting_list.emplace_back(next_hop, dgram);
@@ -114,8 +102,14 @@ optional<InternetDatagram> NetworkInterface::recv_frame(const EthernetFrame &fra
 
         // only REQUEST with UNFIT TARGET IP ADDRESS is rejected by this if
         if (is_valid_arp_request || arp_msg.opcode == ARPMessage::OPCODE_REPLY) {
-            // learn a mapping, add it to ARP table for 30 seconds
-            _arp_table[arp_msg.sender_ip_address] = {arp_msg.sender_ethernet_address, ARP_TABLE_DEFAULT_TTL};
+            // learn a mapping, add it to ARP table for 30 seconds (replacing the timer of an older mapping)
+            const auto old_entry = _arp_table.find(arp_msg.sender_ip_address);
+            if (old_entry != _arp_table.end()) {
+                _timers.cancel(old_entry->second.expiry);
+            }
+            const TimerId expiry =
+                _timers.arm(ARP_TABLE_DEFAULT_TTL, {ARP_Timer::Kind::EntryExpiry, arp_msg.sender_ip_address});
+            _arp_table[arp_msg.sender_ip_address] = {arp_msg.sender_ethernet_address, expiry};
             // remove corresponding IPv4 datagram from the waiting list and send it
             for (auto iter = _dgram_waiting_list.begin(); iter != _dgram_waiting_list.end(); ) {
                 if (iter->first.ipv4_numeric() == arp_msg.sender_ip_address) {
@@ -127,46 +121,50 @@ optional<InternetDatagram> NetworkInterface::recv_frame(const EthernetFrame &fra
                 }
             }
             // got the reply, erase corresponding ARPMessage in the list if exists
-            _arp_msg_list.erase(arp_msg.sender_ip_address);
+            const auto request = _arp_msg_list.find(arp_msg.sender_ip_address);
+            if (request != _arp_msg_list.end()) {
+                _timers.cancel(request->second);
+                _arp_msg_list.erase(request);
+            }
         }
     }
     return nullopt;
 }
 
 //! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
+//! \details Only the timers that come due are visited. Requests are resent once the clock has reached the
+//! end of the tick, so a long tick resends each of them once.
 void NetworkInterface::tick(const size_t ms_since_last_tick) {
-    // erase outdated tuples from ARP table
-    for (auto iter = _arp_table.begin(); iter != _arp_table.end(); ) {
-        if (iter->second.ttl <= ms_since_last_tick)
-            iter = _arp_table.erase(iter);
-        else {
-            iter->second.ttl -= ms_since_last_tick;
-            ++iter;
-        }
-    }
-    for (auto iter = _arp_msg_list.begin(); iter != _arp_msg_list.end(); ) {
-        // case ARPMessage outdated
-        if (iter->second <= ms_since_last_tick) {
-            // resend ARPMessage
-            ARPMessage arp_request;
-            arp_request.opcode = ARPMessage::OPCODE_REQUEST;
-            arp_request.sender_ethernet_address = _ethernet_address;
-            arp_request.sender_ip_address = _ip_address.ipv4_numeric();
-            arp_request.target_ip_address = iter->first;
-            EthernetFrame eth_frame;
-            eth_frame.header() = {
-                ETHERNET_BROADCAST,
-                _ethernet_address,
-                EthernetHeader::TYPE_ARP
-            };
-            eth_frame.payload() = arp_request.serialize();
-            _frames_out.push(eth_frame);
-            // reset timer
-            iter->second = ARP_MESSAGE_DEFAULT_TTL;
-        }
-        else {
-            iter->second -= ms_since_last_tick;
-            iter++;
+    std::vector<uint32_t> requests_to_resend{};
+    _timers.advance(ms_since_last_tick, [&](const ARP_Timer &timer) {
+        if (timer.kind == ARP_Timer::Kind::EntryExpiry) {
+            // erase outdated tuple from ARP table
+            _arp_table.erase(timer.ip);
+        } else {
+            // case ARPMessage outdated
+            requests_to_resend.push_back(timer.ip);
         }
+    });
+    for (const uint32_t target_ip : requests_to_resend) {
+        _send_arp_request(target_ip);
     }
 }
+
+//! \param[in] target_ip the raw 32-bit IP address to look up
+void NetworkInterface::_send_arp_request(const uint32_t target_ip) {
+    ARPMessage arp_request;
+    arp_request.opcode = ARPMessage::OPCODE_REQUEST;
+    arp_request.sender_ethernet_address = _ethernet_address;
+    arp_request.sender_ip_address = _ip_address.ipv4_numeric();
+    arp_request.target_ip_address = target_ip;
+    EthernetFrame eth_frame;
+    eth_frame.header() = {
+        ETHERNET_BROADCAST,
+        _ethernet_address,
+        EthernetHeader::TYPE_ARP
+    };
+    eth_frame.payload() = arp_request.serialize();
+    _frames_out.push(eth_frame);
+    // (re)start the timer, the request is resent if no reply arrives within 5 seconds
+    _arp_msg_list[target_ip] = _timers.arm(ARP_MESSAGE_DEFAULT_TTL, {ARP_Timer::Kind::RequestRetry, target_ip});
+}
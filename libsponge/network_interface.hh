@@ -3,6 +3,7 @@
 
 #include "ethernet_frame.hh"
 #include "tcp_over_ip.hh"
+#include "timer_wheel.hh"
 #include "tun.hh"
 
 #include <optional>
@@ -33,10 +34,20 @@
 //! and learns or replies as necessary.
 class NetworkInterface {
   private:
+    //! ARP timers, each naming the IP address it is about
+    struct ARP_Timer {
+        enum class Kind { EntryExpiry, RequestRetry };
+        Kind kind{Kind::EntryExpiry};
+        uint32_t ip{0};
+    };
+
+    //! ARP table entries and outstanding ARP requests expire on this wheel
+    TimerWheel<ARP_Timer> _timers{};
+
     //! ARP
     struct ARP_Entry {
-        EthernetAddress eth_addr;
-        size_t ttl;
+        EthernetAddress eth_addr{};
+        TimerId expiry{};
     };
 
     //! ARP table
@@ -48,8 +59,8 @@ class NetworkInterface {
     //! IPv4 datagram waiting list
     std::list<std::pair<Address, InternetDatagram>> _dgram_waiting_list{};
 
-    //! ARPMessages already sent, each symbolized by its identical target ip address
-    std::map<uint32_t, size_t> _arp_msg_list{};
+    //! ARPMessages already sent, each symbolized by its identical target ip address (and the timer to resend it)
+    std::map<uint32_t, TimerId> _arp_msg_list{};
 
     // ARPMessage default ttl is 5 seconds
     static constexpr size_t ARP_MESSAGE_DEFAULT_TTL = 5 * 1000;
@@ -63,12 +74,16 @@ class NetworkInterface {
     //! outbound queue of Ethernet frames that the NetworkInterface wants sent
     std::queue<EthernetFrame> _frames_out{};
 
+    //! Broadcast an ARP request for `target_ip` and (re)start its retry timer
+    void _send_arp_request(const uint32_t target_ip);
+
   public:
     //! \brief Construct a network interface with given Ethernet (network-access-layer) and IP (internet-layer) addresses
     NetworkInterface(const EthernetAddress &ethernet_address, const Address &ip_address);
 
     //! \brief Access queue of Ethernet frames awaiting transmission
     std::queue<EthernetFrame> &frames_out() { return _frames_out; }
+    const std::queue<EthernetFrame> &frames_out() const { return _frames_out; }
 
     //! \brief Sends an IPv4 datagram, encapsulated in an Ethernet frame (if it knows the Ethernet destination address).
 
@@ -85,6 +100,9 @@ class NetworkInterface {
 
     //! \brief Called periodically when time elapses
     void tick(const size_t ms_since_last_tick);
+
+    //! \brief Milliseconds until tick() next has something to do, or empty if no timer is armed
+    std::optional<uint64_t> time_until_next_timer() const { return _timers.time_until_next(); }
 };
 
 #endif  // SPONGE_LIBSPONGE_NETWORK_INTERFACE_HH
@@ -195,3 +195,30 @@ void StreamReassembler::push_substring(const string &data, const size_t index, c
 size_t StreamReassembler::unassembled_bytes() const { return _unassembled_bytes_num; }
 
 bool StreamReassembler::empty() const { return _unassembled_bytes_num == 0; }
+
+void StreamReassembler::checkpoint(CheckpointWriter &out) const {
+    out.put(_next_assembled_idx);
+    out.put(_unassembled_bytes_num);
+    out.put(_eof_idx);
+    out.put(_capacity);
+    out.put<uint64_t>(_unassemble_strs.size());
+    for (const auto &[index, data] : _unassemble_strs) {
+        out.put(index);
+        out.put_bytes(data);
+    }
+    _output.checkpoint(out);
+}
+
+void StreamReassembler::restore(CheckpointReader &in) {
+    _next_assembled_idx = in.get<size_t>();
+    _unassembled_bytes_num = in.get<size_t>();
+    _eof_idx = in.get<size_t>();
+    _capacity = in.get<size_t>();
+    _unassemble_strs.clear();
+    // 按顺序写出的，所以每次都插入到末尾
+    for (uint64_t count = in.get<uint64_t>(); count > 0; count--) {
+        const size_t index = in.get<size_t>();
+        _unassemble_strs.emplace_hint(_unassemble_strs.end(), index, in.get_bytes());
+    }
+    _output.restore(in);
+}
@@ -48,9 +48,18 @@ class StreamReassembler {
     //! should only be counted once for the purpose of this function.
     size_t unassembled_bytes() const;
 
+    //! The number of separate substrings stored but not yet reassembled
+    size_t unassembled_fragments() const { return _unassemble_strs.size(); }
+
     //! \brief Is the internal state empty (other than the output stream)?
     //! \returns `true` if no substrings are waiting to be assembled
     bool empty() const;
+
+    //! \brief Append the stored substrings, indices and output stream to a checkpoint
+    void checkpoint(CheckpointWriter &out) const;
+
+    //! \brief Replace the reassembler's state with one read from a checkpoint
+    void restore(CheckpointReader &in);
 };
 
 #endif  // SPONGE_LIBSPONGE_STREAM_REASSEMBLER_HH
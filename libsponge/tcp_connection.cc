@@ -1,6 +1,8 @@
 #include "tcp_connection.hh"
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 
 // Dummy implementation of a TCP connection
 
@@ -22,6 +24,7 @@ size_t TCPConnection::time_since_last_segment_received() const { return _time_si
 
 void TCPConnection::segment_received(const TCPSegment &seg) {
     _time_since_last_segment_received = 0;
+    _segments_received++;
     bool need_send_ack = seg.length_in_sequence_space();
 
     // RST
@@ -37,7 +40,7 @@ void TCPConnection::segment_received(const TCPSegment &seg) {
 
     // ACK
     if (seg.header().ack) {
-        _sender.ack_received(seg.header().ackno, seg.header().win);
+        _sender.ack_received(seg.header().ackno, seg.header().win, seg.length_in_sequence_space() > 0);
         if (need_send_ack && !_sender.segments_out().empty())
             need_send_ack = false;
     }
@@ -64,20 +67,18 @@ void TCPConnection::segment_received(const TCPSegment &seg) {
         return;
     }
 
+    // TIME_WAIT：每收到一个数据包都重新开始等待
+    if (TCPState::state_summary(_receiver) == TCPReceiverStateSummary::FIN_RECV &&
+        TCPState::state_summary(_sender) == TCPSenderStateSummary::FIN_ACKED && _linger_after_streams_finish) {
+        _timers.cancel(_linger_timer);
+        _linger_timer = _timers.arm(10 * _cfg.rt_timeout, Timer::Linger);
+    }
+
     // 如果收到的数据包里没有任何数据，则这个数据包可能只是为了 keep-alive
     if (need_send_ack)
         _sender.send_empty_segment();
 
-    while (!_sender.segments_out().empty()) {
-        TCPSegment segment = _sender.segments_out().front();
-        _sender.segments_out().pop();
-        if (_receiver.ackno().has_value()) {
-            segment.header().ack = true;
-            segment.header().ackno = _receiver.ackno().value();
-            segment.header().win = _receiver.window_size();
-        }
-        _segments_out.push(segment);
-    }
+    _flush_sender_segments();
 }
 
 bool TCPConnection::active() const { return _is_active || _linger_after_streams_finish; }
@@ -85,21 +86,15 @@ bool TCPConnection::active() const { return _is_active || _linger_after_streams_
 size_t TCPConnection::write(const string &data) {
     size_t write_num = _sender.stream_in().write(data);
     _sender.fill_window();
-    while (!_sender.segments_out().empty()) {
-        TCPSegment segment = _sender.segments_out().front();
-        _sender.segments_out().pop();
-        if (_receiver.ackno().has_value()) {
-            segment.header().ack = true;
-            segment.header().ackno = _receiver.ackno().value();
-            segment.header().win = _receiver.window_size();
-        }
-        _segments_out.push(segment);
-    }
+    _flush_sender_segments();
     return write_num;
 }
 
 //! \param[in] ms_since_last_tick number of milliseconds since the last call to this method
 void TCPConnection::tick(const size_t ms_since_last_tick) {
+    bool linger_done = false;
+    _timers.advance(ms_since_last_tick, [&](const Timer) { linger_done = true; });
+
     _sender.tick(ms_since_last_tick);
     if (_sender.consecutive_retransmissions() > TCPConfig::MAX_RETX_ATTEMPTS) {
         // abort the connection
@@ -111,58 +106,119 @@ void TCPConnection::tick(const size_t ms_since_last_tick) {
         // send a RST segment
         TCPSegment rst_seg;
         rst_seg.header().rst = true;
-        _segments_out.push(rst_seg);
+        _segments_out.push_back(move(rst_seg));
+        _segments_sent++;
         return;
     }
 
-    while (!_sender.segments_out().empty()) {
-        TCPSegment segment = _sender.segments_out().front();
-        _sender.segments_out().pop();
-        if (_receiver.ackno().has_value()) {
-            segment.header().ack = true;
-            segment.header().ackno = _receiver.ackno().value();
-            segment.header().win = _receiver.window_size();
-        }
-        _segments_out.push(segment);
-    }
+    _flush_sender_segments();
 
     _time_since_last_segment_received += ms_since_last_tick;
 
-    if (TCPState::state_summary(_receiver) == TCPReceiverStateSummary::FIN_RECV &&
-        TCPState::state_summary(_sender) == TCPSenderStateSummary::FIN_ACKED && _linger_after_streams_finish &&
-        _time_since_last_segment_received >= 10 * _cfg.rt_timeout) {
+    // 等待期间没有再收到对方的数据包，可以关闭连接了
+    if (linger_done) {
         _is_active = false;
         _linger_after_streams_finish = false;
     }
 }
 
+optional<uint64_t> TCPConnection::time_until_next_timer() const {
+    const auto sender_timer = _sender.time_until_next_timer();
+    const auto own_timer = _timers.time_until_next();
+    if (!sender_timer.has_value())
+        return own_timer;
+    if (!own_timer.has_value())
+        return sender_timer;
+    return min(sender_timer.value(), own_timer.value());
+}
+
+TCPInfo TCPConnection::info() const {
+    TCPInfo info;
+    info.state = TCPState::official_state(_sender, _receiver, active(), _linger_after_streams_finish);
+    info.active = active();
+
+    info.srtt = _sender.smoothed_rtt().value_or(0);
+    info.rttvar = _sender.rtt_variation();
+    info.min_rtt = _sender.min_rtt();
+    info.rto = _sender.retransmission_timeout();
+
+    info.send_window = _sender.window_size();
+    info.receive_window = _receiver.window_size();
+    info.bytes_in_flight = _sender.bytes_in_flight();
+    info.zero_window_time = _sender.zero_window_time();
+
+    info.retransmissions = _sender.retransmissions();
+    info.consecutive_retransmissions = _sender.consecutive_retransmissions();
+    info.duplicate_acks = _sender.duplicate_acks();
+    info.bytes_sent = _sender.stream_in().bytes_read();
+    info.bytes_acked = _sender.bytes_acked();
+    info.bytes_received = _receiver.stream_out().bytes_written();
+    info.segments_received = _segments_received;
+    info.segments_sent = _segments_sent;
+
+    info.unassembled_fragments = _receiver.unassembled_fragments();
+    info.unassembled_bytes = _receiver.unassembled_bytes();
+    info.time_since_last_segment_received = _time_since_last_segment_received;
+    return info;
+}
+
 void TCPConnection::end_input_stream() {
     _sender.stream_in().end_input();
     _sender.fill_window();
-    while (!_sender.segments_out().empty()) {
-        TCPSegment segment = _sender.segments_out().front();
-        _sender.segments_out().pop();
-        if (_receiver.ackno().has_value()) {
-            segment.header().ack = true;
-            segment.header().ackno = _receiver.ackno().value();
-            segment.header().win = _receiver.window_size();
-        }
-        _segments_out.push(segment);
-    }
+    _flush_sender_segments();
+}
+
+void TCPConnection::flush() {
+    // 尚未建立连接时不能 flush，否则会提前发出 SYN
+    if (_sender.next_seqno_absolute() == 0 || !active())
+        return;
+    _sender.flush();
+    _flush_sender_segments();
+}
+
+//! \param[in] policy the new send policy
+void TCPConnection::set_send_policy(const TCPConfig::SendPolicy policy) {
+    _cfg.send_policy = policy;
+    _sender.set_send_policy(policy);
+    // 切换策略后，之前被暂缓的数据可能已经可以发送了
+    flush();
+}
+
+//! \param[in] enabled whether to detect losses with RACK-TLP, as well as the RTO
+void TCPConnection::set_rack_tlp(const bool enabled) {
+    _cfg.rack_tlp = enabled;
+    _sender.set_rack_tlp(enabled);
 }
 
 void TCPConnection::connect() {
     _sender.fill_window();
     _is_active = true;
-    while (!_sender.segments_out().empty()) {
-        TCPSegment segment = _sender.segments_out().front();
-        _sender.segments_out().pop();
-        if (_receiver.ackno().has_value()) {
+    _flush_sender_segments();
+}
+
+//! \details The sender's segments are stamped with the receiver's ackno and window here, once each, and
+//! then moved (not copied) onto the end of the outbound batch. When the batch is empty the two
+//! vectors are simply swapped, so both keep their capacity and steady-state sending allocates nothing.
+void TCPConnection::_flush_sender_segments() {
+    vector<TCPSegment> &batch = _sender.segments_out();
+    if (batch.empty())
+        return;
+    // 统一填入 ackno 和窗口大小
+    if (_receiver.ackno().has_value()) {
+        const WrappingInt32 ackno = _receiver.ackno().value();
+        const size_t window_size = _receiver.window_size();
+        for (TCPSegment &segment : batch) {
             segment.header().ack = true;
-            segment.header().ackno = _receiver.ackno().value();
-            segment.header().win = _receiver.window_size();
+            segment.header().ackno = ackno;
+            segment.header().win = window_size;
         }
-        _segments_out.push(segment);
+    }
+    _segments_sent += batch.size();
+    if (_segments_out.empty()) {
+        _segments_out.swap(batch);
+    } else {
+        move(batch.begin(), batch.end(), back_inserter(_segments_out));
+        batch.clear();
     }
 }
 
@@ -173,7 +229,7 @@ TCPConnection::~TCPConnection() {
             // Your code here: need to send a RST segment to the peer
             TCPSegment rst_seg;
             rst_seg.header().rst = true;
-            _segments_out.push(rst_seg);
+            _segments_out.push_back(move(rst_seg));
 
             _receiver.stream_out().set_error();
             _sender.stream_in().set_error();
@@ -183,4 +239,75 @@ TCPConnection::~TCPConnection() {
     } catch (const exception &e) {
         std::cerr << "Exception destructing TCP FSM: " << e.what() << std::endl;
     }
-}
\ No newline at end of file
+}
+
+string TCPConnection::checkpoint() const {
+    // 大部分空间是各个缓冲区，预留出来避免反复扩容
+    CheckpointWriter out{256 + _sender.stream_in().buffer_size() + _sender.bytes_in_flight() +
+                         _receiver.stream_out().buffer_size() + _receiver.unassembled_bytes()};
+    out.put(CHECKPOINT_MAGIC);
+    out.put(CHECKPOINT_VERSION);
+
+    out.put(_cfg.rt_timeout);
+    out.put(_cfg.recv_capacity);
+    out.put(_cfg.send_capacity);
+    out.put(_cfg.fixed_isn.has_value());
+    if (_cfg.fixed_isn.has_value())
+        out.put(_cfg.fixed_isn.value().raw_value());
+    out.put(_cfg.send_policy);
+    out.put(_cfg.rack_tlp);
+
+    _receiver.checkpoint(out);
+    _sender.checkpoint(out);
+
+    out.put<uint64_t>(_segments_out.size());
+    for (const TCPSegment &segment : _segments_out)
+        segment.checkpoint(out);
+    out.put(_linger_after_streams_finish);
+    out.put(_is_active);
+    out.put(_time_since_last_segment_received);
+    out.put(_segments_received);
+    out.put(_segments_sent);
+    out.put(_timers.now());
+    out.put(_timers.time_until(_linger_timer));
+    return out.release();
+}
+
+TCPConfig TCPConnection::_restore_config(CheckpointReader &in) {
+    if (in.get<uint32_t>() != CHECKPOINT_MAGIC)
+        throw runtime_error("not a TCPConnection checkpoint (or written with a different byte order)");
+    if (in.get<uint16_t>() != CHECKPOINT_VERSION)
+        throw runtime_error("unsupported TCPConnection checkpoint version");
+
+    TCPConfig cfg;
+    cfg.rt_timeout = in.get<uint16_t>();
+    cfg.recv_capacity = in.get<size_t>();
+    cfg.send_capacity = in.get<size_t>();
+    if (in.get<bool>())
+        cfg.fixed_isn = WrappingInt32{in.get<uint32_t>()};
+    cfg.send_policy = in.get_enum(TCPConfig::SendPolicy::Cork);
+    cfg.rack_tlp = in.get<bool>();
+    return cfg;
+}
+
+TCPConnection::TCPConnection(CheckpointReader &&in) : _cfg{_restore_config(in)} {
+    _receiver.restore(in);
+    _sender.restore(in);
+
+    for (uint64_t count = in.get<uint64_t>(); count > 0; count--) {
+        _segments_out.emplace_back();
+        _segments_out.back().restore(in);
+    }
+    _linger_after_streams_finish = in.get<bool>();
+    _is_active = in.get<bool>();
+    _time_since_last_segment_received = in.get<size_t>();
+    _segments_received = in.get<uint64_t>();
+    _segments_sent = in.get<uint64_t>();
+    _timers.advance(in.get<uint64_t>(), [](const Timer) {});
+    const auto linger_remaining = in.get_optional<uint64_t>();
+    if (linger_remaining.has_value())
+        _linger_timer = _timers.arm(linger_remaining.value(), Timer::Linger);
+
+    if (in.remaining() != 0)
+        throw runtime_error("TCPConnection checkpoint has trailing bytes");
+}
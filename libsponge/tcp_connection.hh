@@ -1,10 +1,17 @@
 #ifndef SPONGE_LIBSPONGE_TCP_FACTORED_HH
 #define SPONGE_LIBSPONGE_TCP_FACTORED_HH
 
+#include "checkpoint.hh"
 #include "tcp_config.hh"
+#include "tcp_info.hh"
 #include "tcp_receiver.hh"
 #include "tcp_sender.hh"
 #include "tcp_state.hh"
+#include "timer_wheel.hh"
+
+#include <string>
+#include <string_view>
+#include <vector>
 
 //! \brief A complete endpoint of a TCP connection
 class TCPConnection {
@@ -13,8 +20,11 @@ private:
     TCPReceiver _receiver{_cfg.recv_capacity};
     TCPSender _sender{_cfg.send_capacity, _cfg.rt_timeout, _cfg.fixed_isn};
 
-    //! outbound queue of segments that the TCPConnection wants sent
-    std::queue<TCPSegment> _segments_out{};
+    //! outbound batch of segments that the TCPConnection wants sent
+    std::vector<TCPSegment> _segments_out{};
+
+    //! Stamp the sender's new segments with our ackno and window, and move them to the outbound batch
+    void _flush_sender_segments();
 
     //! Should the TCPConnection stay active (and keep ACKing)
     //! for 10 * _cfg.rt_timeout milliseconds after both streams have ended,
@@ -25,6 +35,27 @@ private:
 
     size_t _time_since_last_segment_received{0};
 
+    uint64_t _segments_received{0};  //!< segments passed to segment_received()
+    uint64_t _segments_sent{0};      //!< segments put into _segments_out
+
+    //! The connection's own timers (the sender keeps its retransmission timers)
+    enum class Timer { Linger };
+
+    TimerWheel<Timer> _timers{};
+
+    //! ends the connection once it has lingered for 10 * _cfg.rt_timeout without hearing from the peer
+    TimerId _linger_timer{};
+
+    //! Identifies a connection checkpoint (and the byte order it was written in)
+    static constexpr uint32_t CHECKPOINT_MAGIC = 0x53504e47;
+    static constexpr uint16_t CHECKPOINT_VERSION = 2;
+
+    //! Check a checkpoint's preamble and read the configuration that follows it
+    static TCPConfig _restore_config(CheckpointReader &in);
+
+    //! Construct from a checkpoint whose configuration is read first
+    explicit TCPConnection(CheckpointReader &&in);
+
 public:
     //! \name "Input" interface for the writer
     //!@{
@@ -41,6 +72,25 @@ public:
 
     //! \brief Shut down the outbound byte stream (still allows reading incoming data)
     void end_input_stream();
+
+    //! \brief Send any outbound data held back by the send policy
+    void flush();
+
+    //! \brief Change how small writes are coalesced; relaxing the policy flushes held data
+    void set_send_policy(const TCPConfig::SendPolicy policy);
+
+    //! \brief The current send policy
+    TCPConfig::SendPolicy send_policy() const { return _sender.send_policy(); }
+
+    //! \brief Enable or disable RACK-TLP loss detection (see TCPConfig::rack_tlp)
+    void set_rack_tlp(const bool enabled);
+
+    //! \brief Is RACK-TLP loss detection enabled?
+    bool rack_tlp() const { return _sender.rack_tlp(); }
+
+    //! \brief Take no RTT sample from the segments sent so far (e.g. a SYN-ACK that was really sent
+    //! earlier, from a SYN cookie; see TCPSender::mark_in_flight_retransmitted())
+    void mark_in_flight_retransmitted() { _sender.mark_in_flight_retransmitted(); }
     //!@}
 
     //! \name "Output" interface for the reader
@@ -48,6 +98,7 @@ public:
 
     //! \brief The inbound byte stream received from the peer
     ByteStream &inbound_stream() { return _receiver.stream_out(); }
+    const ByteStream &inbound_stream() const { return _receiver.stream_out(); }
     //!@}
 
     //! \name Accessors used for testing
@@ -63,6 +114,11 @@ public:
     TCPState state() const { return {_sender, _receiver, active(), _linger_after_streams_finish}; };
     //!@}
 
+    //! \brief Snapshot the connection's state, RTT estimates, windows and counters
+    //! \details The counters behind it are kept up to date as segments flow, so taking a
+    //! snapshot costs about as much as state() and can be done as often as needed.
+    TCPInfo info() const;
+
     //! \name Methods for the owner or operating system to call
     //!@{
 
@@ -72,11 +128,16 @@ public:
     //! Called periodically when time elapses
     void tick(const size_t ms_since_last_tick);
 
-    //! \brief TCPSegments that the TCPConnection has enqueued for transmission.
-    //! \note The owner or operating system will dequeue these and
-    //! put each one into the payload of a lower-layer datagram (usually Internet datagrams (IP),
-    //! but could also be user datagrams (UDP) or any other kind).
-    std::queue<TCPSegment> &segments_out() { return _segments_out; }
+    //! \brief Milliseconds until tick() next has something to do, or empty if no timer is armed
+    //! \details The owner may sleep this long before calling tick() without delaying a retransmission
+    //! or the end of the linger period.
+    std::optional<uint64_t> time_until_next_timer() const;
+
+    //! \brief TCPSegments that the TCPConnection has enqueued for transmission, oldest first.
+    //! \note The owner or operating system will put each one into the payload of a lower-layer
+    //! datagram (usually Internet datagrams (IP), but could also be user datagrams (UDP) or any
+    //! other kind), and then clear() the batch. The segments may be modified or moved from.
+    std::vector<TCPSegment> &segments_out() { return _segments_out; }
 
     //! \brief Is the connection still alive in any way?
     //! \returns `true` if either stream is still running or if the TCPConnection is lingering
@@ -84,8 +145,27 @@ public:
     bool active() const;
     //!@}
 
+    //! \name Checkpointing, e.g. to move a live connection to another process
+    //!@{
+
+    //! \brief Serialize the whole connection to a compact binary blob
+    //! \details The blob holds the configuration, the sender (its outgoing stream, segments in flight,
+    //! RTT estimates and timers), the receiver (its reassembled stream and unassembled substrings),
+    //! segments not yet taken from segments_out(), and the connection's own flags and timers,
+    //! from which state() follows. Buffers are copied in one piece, so this is cheap.
+    std::string checkpoint() const;
+
+    //! \brief Construct a connection that continues from a checkpoint() of another
+    //! \throws std::runtime_error if the blob isn't a complete checkpoint of this version
+    //! \note The connection the checkpoint was taken from should be dropped without being used again.
+    explicit TCPConnection(const std::string_view checkpoint) : TCPConnection(CheckpointReader{checkpoint}) {}
+    //!@}
+
     //! Construct a new connection from a configuration
-    explicit TCPConnection(const TCPConfig &cfg) : _cfg{cfg} {}
+    explicit TCPConnection(const TCPConfig &cfg) : _cfg{cfg} {
+        _sender.set_send_policy(_cfg.send_policy);
+        _sender.set_rack_tlp(_cfg.rack_tlp);
+    }
 
     //! \name construction and destruction
     //! moving is allowed; copying is disallowed; default construction not possible
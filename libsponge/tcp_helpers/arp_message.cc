@@ -1,41 +1,40 @@
 #include "arp_message.hh"
 
 #include <arpa/inet.h>
+#include <array>
 #include <iomanip>
 #include <sstream>
 
 using namespace std;
 
-ParseResult ARPMessage::parse(const Buffer buffer) {
+ParseResult ARPMessage::parse(const BufferList &buffer) {
     NetParser p{buffer};
 
-    if (p.buffer().size() < ARPMessage::LENGTH) {
-        return ParseResult::PacketTooShort;
+    array<char, LENGTH> scratch{};
+    const char *const bytes = p.peek(scratch);
+    if (not bytes) {
+        return p.get_error();
     }
 
-    hardware_type = p.u16();
-    protocol_type = p.u16();
-    hardware_address_size = p.u8();
-    protocol_address_size = p.u8();
-    opcode = p.u16();
+    hardware_type = Wire::HardwareType::load(bytes);
+    protocol_type = Wire::ProtocolType::load(bytes);
+    hardware_address_size = Wire::HardwareAddressSize::load(bytes);
+    protocol_address_size = Wire::ProtocolAddressSize::load(bytes);
+    opcode = Wire::Opcode::load(bytes);
 
     if (not supported()) {
         return ParseResult::Unsupported;
     }
 
     // read sender addresses (Ethernet and IP)
-    for (auto &byte : sender_ethernet_address) {
-        byte = p.u8();
-    }
-    sender_ip_address = p.u32();
+    sender_ethernet_address = Wire::SenderEthernetAddress::load(bytes);
+    sender_ip_address = Wire::SenderIPAddress::load(bytes);
 
     // read target addresses (Ethernet and IP)
-    for (auto &byte : target_ethernet_address) {
-        byte = p.u8();
-    }
-    target_ip_address = p.u32();
+    target_ethernet_address = Wire::TargetEthernetAddress::load(bytes);
+    target_ip_address = Wire::TargetIPAddress::load(bytes);
 
-    return p.get_error();
+    return ParseResult::NoError;
 }
 
 bool ARPMessage::supported() const {
@@ -50,24 +49,20 @@ string ARPMessage::serialize() const {
             "ARPMessage::serialize(): unsupported field combination (must be Ethernet/IP, and request or reply)");
     }
 
-    string ret;
-    NetUnparser::u16(ret, hardware_type);
-    NetUnparser::u16(ret, protocol_type);
-    NetUnparser::u8(ret, hardware_address_size);
-    NetUnparser::u8(ret, protocol_address_size);
-    NetUnparser::u16(ret, opcode);
+    string ret(LENGTH, 0);
+    Wire::HardwareType::store(ret.data(), hardware_type);
+    Wire::ProtocolType::store(ret.data(), protocol_type);
+    Wire::HardwareAddressSize::store(ret.data(), hardware_address_size);
+    Wire::ProtocolAddressSize::store(ret.data(), protocol_address_size);
+    Wire::Opcode::store(ret.data(), opcode);
 
     /* write sender addresses */
-    for (auto &byte : sender_ethernet_address) {
-        NetUnparser::u8(ret, byte);
-    }
-    NetUnparser::u32(ret, sender_ip_address);
+    Wire::SenderEthernetAddress::store(ret.data(), sender_ethernet_address);
+    Wire::SenderIPAddress::store(ret.data(), sender_ip_address);
 
     /* write target addresses */
-    for (auto &byte : target_ethernet_address) {
-        NetUnparser::u8(ret, byte);
-    }
-    NetUnparser::u32(ret, target_ip_address);
+    Wire::TargetEthernetAddress::store(ret.data(), target_ethernet_address);
+    Wire::TargetIPAddress::store(ret.data(), target_ip_address);
 
     return ret;
 }
@@ -13,6 +13,29 @@ struct ARPMessage {
     static constexpr uint16_t OPCODE_REQUEST = 1;
     static constexpr uint16_t OPCODE_REPLY = 2;
 
+    //! Where the fields are in the message (see WireLayout)
+    struct Wire {
+        using HardwareType = WireField<uint16_t, 0>;
+        using ProtocolType = WireField<uint16_t, 2>;
+        using HardwareAddressSize = WireField<uint8_t, 4>;
+        using ProtocolAddressSize = WireField<uint8_t, 5>;
+        using Opcode = WireField<uint16_t, 6>;
+        using SenderEthernetAddress = WireBytes<6, 8>;
+        using SenderIPAddress = WireField<uint32_t, 14>;
+        using TargetEthernetAddress = WireBytes<6, 18>;
+        using TargetIPAddress = WireField<uint32_t, 24>;
+        using Layout = WireLayout<HardwareType,
+                                  ProtocolType,
+                                  HardwareAddressSize,
+                                  ProtocolAddressSize,
+                                  Opcode,
+                                  SenderEthernetAddress,
+                                  SenderIPAddress,
+                                  TargetEthernetAddress,
+                                  TargetIPAddress>;
+    };
+    static_assert(Wire::Layout::LENGTH == LENGTH);
+
     //! \name ARPheader fields
     //!@{
     uint16_t hardware_type = TYPE_ETHERNET;              //!< Type of the link-layer protocol (generally Ethernet/Wi-Fi)
@@ -29,7 +52,7 @@ struct ARPMessage {
     //!@}
 
     //! Parse the ARP message from a string
-    ParseResult parse(const Buffer buffer);
+    ParseResult parse(const BufferList &buffer);
 
     //! Serialize the ARP message to a string
     std::string serialize() const;
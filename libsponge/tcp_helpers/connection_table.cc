@@ -0,0 +1,105 @@
+#include "connection_table.hh"
+
+#include "address.hh"
+#include "util.hh"
+
+#include <utility>
+
+using namespace std;
+
+//! Tables start with this many buckets, and double whenever they become half full
+static constexpr size_t INITIAL_BUCKETS = 16;
+
+string FourTuple::to_string() const {
+    return Address::from_ipv4_numeric(local_address).ip() + ":" + std::to_string(local_port) + " -> " +
+           Address::from_ipv4_numeric(remote_address).ip() + ":" + std::to_string(remote_port);
+}
+
+ConnectionTable::ConnectionTable() : _buckets(INITIAL_BUCKETS), _seed(0) {
+    auto rd = get_random_generator();
+    _seed = (uint64_t{rd()} << 32) | rd();
+}
+
+//! \details Both addresses and both ports are folded into two 64-bit words, which are mixed with
+//! the seed by a multiply-xorshift finalizer (as in splitmix64).
+size_t ConnectionTable::_home(const FourTuple &key) const {
+    uint64_t h = _seed;
+    for (const uint64_t word : {(uint64_t{key.local_address} << 32) | key.remote_address,
+                                (uint64_t{key.local_port} << 16) | key.remote_port}) {
+        h ^= word;
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ull;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebull;
+        h ^= h >> 31;
+    }
+    return h & (_buckets.size() - 1);
+}
+
+size_t ConnectionTable::_probe(const FourTuple &key) const {
+    const size_t mask = _buckets.size() - 1;
+    size_t i = _home(key);
+    while (_buckets[i].used and _buckets[i].key != key) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+void ConnectionTable::_grow() {
+    vector<Bucket> old(_buckets.size() * 2);
+    swap(old, _buckets);
+    for (const Bucket &bucket : old) {
+        if (bucket.used) {
+            _buckets[_probe(bucket.key)] = bucket;
+        }
+    }
+}
+
+//! \param[in] key the connection's addresses and ports
+//! \returns the value stored with `key`, or an empty optional if it isn't present
+optional<size_t> ConnectionTable::find(const FourTuple &key) const {
+    const Bucket &bucket = _buckets[_probe(key)];
+    if (not bucket.used) {
+        return {};
+    }
+    return bucket.value;
+}
+
+//! \param[in] key the connection's addresses and ports
+//! \param[in] value what find() should return for `key`
+bool ConnectionTable::insert(const FourTuple &key, const size_t value) {
+    if (2 * (_size + 1) > _buckets.size()) {
+        _grow();
+    }
+    Bucket &bucket = _buckets[_probe(key)];
+    if (bucket.used) {
+        return false;
+    }
+    bucket = {key, value, true};
+    _size++;
+    return true;
+}
+
+//! \param[in] key the connection's addresses and ports
+//! \details Removes the entry, then walks the rest of its cluster and moves back each entry
+//! whose home bucket lies at or before the hole, so that every probe sequence stays unbroken.
+bool ConnectionTable::erase(const FourTuple &key) {
+    const size_t mask = _buckets.size() - 1;
+    size_t hole = _probe(key);
+    if (not _buckets[hole].used) {
+        return false;
+    }
+    _buckets[hole].used = false;
+    _size--;
+
+    for (size_t i = (hole + 1) & mask; _buckets[i].used; i = (i + 1) & mask) {
+        const size_t home = _home(_buckets[i].key);
+        // distance travelled from home to i, and from home to the hole (both cyclic)
+        if (((i - home) & mask) >= ((hole - home) & mask)) {
+            _buckets[hole] = _buckets[i];
+            _buckets[i].used = false;
+            hole = i;
+        }
+    }
+    return true;
+}
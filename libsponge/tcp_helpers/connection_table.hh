@@ -0,0 +1,71 @@
+#ifndef SPONGE_LIBSPONGE_CONNECTION_TABLE_HH
+#define SPONGE_LIBSPONGE_CONNECTION_TABLE_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+//! \brief The addresses and ports that identify a TCP connection, seen from the local end
+struct FourTuple {
+    uint32_t local_address{0};   //!< local IPv4 address, as returned by Address::ipv4_numeric()
+    uint16_t local_port{0};      //!< local TCP port
+    uint32_t remote_address{0};  //!< remote IPv4 address
+    uint16_t remote_port{0};     //!< remote TCP port
+
+    bool operator==(const FourTuple &other) const {
+        return local_address == other.local_address and local_port == other.local_port and
+               remote_address == other.remote_address and remote_port == other.remote_port;
+    }
+    bool operator!=(const FourTuple &other) const { return not(*this == other); }
+
+    //! \brief The same connection, seen from the remote end
+    FourTuple reversed() const { return {remote_address, remote_port, local_address, local_port}; }
+
+    //! \brief Render as "local:port -> remote:port"
+    std::string to_string() const;
+};
+
+//! \brief Maps the FourTuple of each connection to an index chosen by the owner
+//! \details An open-addressing hash table with linear probing. Lookups touch one or two
+//! contiguous buckets in the common case, and erasing shifts later entries of the probe
+//! sequence back instead of leaving tombstones, so a table with heavy connection churn
+//! doesn't slow down. The hash is keyed with a random seed chosen at construction, so
+//! a peer can't pick ports that all land in the same probe sequence.
+class ConnectionTable {
+  private:
+    struct Bucket {
+        FourTuple key{};
+        size_t value{0};
+        bool used{false};
+    };
+
+    std::vector<Bucket> _buckets;
+    size_t _size{0};
+    uint64_t _seed;
+
+    size_t _home(const FourTuple &key) const;
+    size_t _probe(const FourTuple &key) const;  //!< bucket holding `key`, or the empty bucket ending its probe
+    void _grow();
+
+  public:
+    //! \brief Construct an empty table
+    ConnectionTable();
+
+    //! \brief Look up a connection
+    std::optional<size_t> find(const FourTuple &key) const;
+
+    //! \brief Add a connection
+    //! \returns `false` (and changes nothing) if the key is already present
+    bool insert(const FourTuple &key, const size_t value);
+
+    //! \brief Remove a connection
+    //! \returns `false` if the key wasn't present
+    bool erase(const FourTuple &key);
+
+    //! \brief Number of connections in the table
+    size_t size() const { return _size; }
+};
+
+#endif  // SPONGE_LIBSPONGE_CONNECTION_TABLE_HH
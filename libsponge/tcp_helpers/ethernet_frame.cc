@@ -8,17 +8,21 @@
 
 using namespace std;
 
-ParseResult EthernetFrame::parse(const Buffer buffer) {
+ParseResult EthernetFrame::parse(const BufferList &buffer) {
     NetParser p{buffer};
-    _header.parse(p);
+    if (const ParseResult header_result = _header.parse(p); header_result != ParseResult::NoError) {
+        return header_result;
+    }
     _payload = p.buffer();
 
     return p.get_error();
 }
 
+//! \details The header goes in front of the payload, in the headroom of its first Buffer if it has
+//! any free (see BufferList::prepend).
 BufferList EthernetFrame::serialize() const {
-    BufferList ret;
-    ret.append(_header.serialize());
-    ret.append(_payload);
+    BufferList ret{_payload};
+    ByteSpan header_span{ret.prepend(EthernetHeader::LENGTH), EthernetHeader::LENGTH};
+    _header.serialize(header_span);
     return ret;
 }
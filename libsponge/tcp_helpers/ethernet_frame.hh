@@ -12,7 +12,7 @@ class EthernetFrame {
 
   public:
     //! \brief Parse the frame from a string
-    ParseResult parse(const Buffer buffer);
+    ParseResult parse(const BufferList &buffer);
 
     //! \brief Serialize the frame to a string
     BufferList serialize() const;
@@ -2,52 +2,43 @@
 
 #include "util.hh"
 
+#include <array>
 #include <iomanip>
 #include <sstream>
 
 using namespace std;
 
 ParseResult EthernetHeader::parse(NetParser &p) {
-    if (p.buffer().size() < EthernetHeader::LENGTH) {
-        return ParseResult::PacketTooShort;
+    array<char, LENGTH> scratch{};
+    const char *const bytes = p.peek(scratch);
+    if (not bytes) {
+        return p.get_error();
     }
 
-    /* read destination address */
-    for (auto &byte : dst) {
-        byte = p.u8();
-    }
-
-    /* read source address */
-    for (auto &byte : src) {
-        byte = p.u8();
-    }
+    dst = Wire::Destination::load(bytes);  // destination address
+    src = Wire::Source::load(bytes);       // source address
+    type = Wire::Type::load(bytes);        // the frame's type (e.g. IPv4, ARP, or something else)
 
-    /* read the frame's type (e.g. IPv4, ARP, or something else) */
-    type = p.u16();
+    p.remove_prefix(LENGTH);
 
     return p.get_error();
 }
 
-string EthernetHeader::serialize() const {
-    string ret;
-    ret.reserve(LENGTH);
-
-    /* write destination address */
-    for (auto &byte : dst) {
-        NetUnparser::u8(ret, byte);
-    }
-
-    /* write source address */
-    for (auto &byte : src) {
-        NetUnparser::u8(ret, byte);
-    }
-
-    /* write the frame's type (e.g. IPv4, ARP or something else) */
-    NetUnparser::u16(ret, type);
+//! Write `header` into the first EthernetHeader::LENGTH of `bytes`
+static void store_fields(const EthernetHeader &header, char *const bytes) {
+    EthernetHeader::Wire::Destination::store(bytes, header.dst);  // destination address
+    EthernetHeader::Wire::Source::store(bytes, header.src);       // source address
+    EthernetHeader::Wire::Type::store(bytes, header.type);        // the frame's type (e.g. IPv4, ARP or something else)
+}
 
+string EthernetHeader::serialize() const {
+    string ret(LENGTH, 0);
+    store_fields(*this, ret.data());
     return ret;
 }
 
+void EthernetHeader::serialize(ByteSpan &out) const { store_fields(*this, out.append(LENGTH)); }
+
 //! \returns A string with a textual representation of an Ethernet address
 string to_string(const EthernetAddress address) {
     stringstream ss{};
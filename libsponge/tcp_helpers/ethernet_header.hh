@@ -2,6 +2,7 @@
 #define SPONGE_LIBSPONGE_ETHERNET_HEADER_HH
 
 #include "parser.hh"
+#include "wire_layout.hh"
 
 #include <array>
 
@@ -20,6 +21,15 @@ struct EthernetHeader {
     static constexpr uint16_t TYPE_IPv4 = 0x800;  //!< Type number for [IPv4](\ref rfc::rfc791)
     static constexpr uint16_t TYPE_ARP = 0x806;   //!< Type number for [ARP](\ref rfc::rfc826)
 
+    //! Where the fields are in the header (see WireLayout)
+    struct Wire {
+        using Destination = WireBytes<6, 0>;
+        using Source = WireBytes<6, 6>;
+        using Type = WireField<uint16_t, 12>;
+        using Layout = WireLayout<Destination, Source, Type>;
+    };
+    static_assert(Wire::Layout::LENGTH == LENGTH);
+
     //! \name Ethernet header fields
     //!@{
     EthernetAddress dst;
@@ -33,6 +43,9 @@ struct EthernetHeader {
     //! Serialize the Ethernet fields to a string
     std::string serialize() const;
 
+    //! Serialize the Ethernet fields into a ByteSpan (e.g. room claimed with BufferList::prepend)
+    void serialize(ByteSpan &out) const;
+
     //! Return a string containing a header in human-readable format
     std::string to_string() const;
 };
@@ -1,41 +1,80 @@
 #include "fd_adapter.hh"
 
+#include "packet_views.hh"
+
+#include <algorithm>
+#include <cerrno>
 #include <iostream>
 #include <stdexcept>
 #include <utility>
 
 using namespace std;
 
-//! \details This function first attempts to parse a TCP segment from the next UDP
-//! payload recv()d from the socket.
-//!
-//! If this succeeds, it then checks that the received segment is related to the
-//! current connection. When a TCP connection has been established, this means
-//! checking that the source and destination ports in the TCP header are correct.
+//! \details Turns on segmentation offload if the kernel supports it (receive offload is
+//! best-effort: without it, the kernel hands over runs of datagrams one by one).
+TCPOverUDPSocketAdapter::TCPOverUDPSocketAdapter(UDPSocket &&sock) : _sock(move(sock)), _gso(_sock.gso_supported()) {
+    try {
+        _sock.set_gro(true);
+    } catch (const unix_error &) {
+    }
+}
+
+//! \param[out] source_address is set to the Address the payload came from
+//! \returns a Buffer viewing the Slab the datagram was received into (no bytes are copied)
+Buffer TCPOverUDPSocketAdapter::_next_payload(Address &source_address) {
+    if (_next_received == _received_count) {
+        _received_count = _sock.recv_batch(_pool, _received);
+        _next_received = 0;
+    }
+    auto &datagram = _received[_next_received];
+    source_address = datagram.source_address;
+
+    // a coalesced payload holds several segments' worth, all segment_size long but the last
+    const size_t remaining = datagram.payload.size();
+    const size_t length = datagram.segment_size == 0 ? remaining : min(datagram.segment_size, remaining);
+    Buffer payload = datagram.payload;
+    payload.remove_suffix(remaining - length);
+    datagram.payload.remove_prefix(length);  // (letting go of the Slab once it is all handed out)
+    if (datagram.payload.size() == 0) {
+        _next_received++;
+    }
+    return payload;
+}
+
+//! \details This function attempts to parse a TCP segment from a UDP payload, and
+//! checks that the received segment is related to the current connection. When a
+//! TCP connection has been established, this means checking that the source and
+//! destination ports in the TCP header are correct.
 //!
 //! If the TCP FSM is listening (i.e., TCPOverUDPSocketAdapter::_listen is `true`)
 //! and the TCP segment read from the wire includes a SYN, this function clears the
 //! `_listen` flag and calls calls connect() on the underlying UDP socket, with
 //! the result that future outgoing segments go to the sender of the SYN segment.
+//! \param[in] payload is the UDP payload
+//! \param[in] source_address is the Address it came from
 //! \returns a std::optional<TCPSegment> that is empty if the segment was invalid or unrelated
-optional<TCPSegment> TCPOverUDPSocketAdapter::read() {
-    auto datagram = _sock.recv();
-
+optional<TCPSegment> TCPOverUDPSocketAdapter::_accept(Buffer payload, const Address &source_address) {
     // is it for us?
-    if (not listening() and (datagram.source_address != config().destination)) {
+    if (not listening() and (source_address != config().destination)) {
+        return {};
+    }
+
+    // while listening, only a SYN will do: look before parsing (and checksumming) anything else
+    if (const TCPSegmentView seg_view{payload.str()};
+        listening() and seg_view.complete() and (not seg_view.syn() or seg_view.rst())) {
         return {};
     }
 
     // is the payload a valid TCP segment?
     TCPSegment seg;
-    if (ParseResult::NoError != seg.parse(move(datagram.payload), 0)) {
+    if (ParseResult::NoError != seg.parse(move(payload), 0)) {
         return {};
     }
 
     // should we target this source in all future replies?
     if (listening()) {
         if (seg.header().syn and not seg.header().rst) {
-            config_mutable().destination = datagram.source_address;
+            config_mutable().destination = source_address;
             set_listening(false);
         } else {
             return {};
@@ -45,6 +84,35 @@ optional<TCPSegment> TCPOverUDPSocketAdapter::read() {
     return seg;
 }
 
+//! \details Takes the next UDP payload received from the socket (receiving a new batch
+//! if the last one is used up); see _accept() for what is accepted.
+//! \returns a std::optional<TCPSegment> that is empty if the segment was invalid or unrelated
+optional<TCPSegment> TCPOverUDPSocketAdapter::read() {
+    Address source_address{nullptr, 0};
+    Buffer payload = _next_payload(source_address);
+    return _accept(move(payload), source_address);
+}
+
+//! \details The loop's receive buffers each take one datagram, so receive offload is turned off
+//! (the kernel would otherwise hand over runs of coalesced datagrams with no way to split them).
+//! Each datagram is copied out of the loop's buffer, since it goes back to the kernel once
+//! `on_segment` returns.
+//! \param[in] loop is the IoUringEventLoop the TCPConnection thread runs on
+//! \param[in] on_segment is called with each TCP segment read() would have returned
+//! \returns the id of the loop's receiver (see IoUringEventLoop::set_enabled())
+EventRuleId TCPOverUDPSocketAdapter::add_receiver(IoUringEventLoop &loop,
+                                                  const function<void(TCPSegment &&)> &on_segment) {
+    try {
+        _sock.set_gro(false);
+    } catch (const unix_error &) {
+    }
+    return loop.add_receiver_from(_sock, [this, on_segment](const string_view payload, const Address &source) {
+        if (auto seg = _accept(_pool.copy(payload), source)) {
+            on_segment(move(seg.value()));
+        }
+    });
+}
+
 //! Serialize a TCP segment and send it as the payload of a UDP datagram.
 //! \param[in] seg is the TCP segment to write
 void TCPOverUDPSocketAdapter::write(TCPSegment &seg) {
@@ -53,5 +121,96 @@ void TCPOverUDPSocketAdapter::write(TCPSegment &seg) {
     _sock.sendto(config().destination, seg.serialize(0));
 }
 
+//! \details The loop sends the datagram along with the others queued before its next wait.
+//! \param[in] loop is the IoUringEventLoop the TCPConnection thread runs on
+//! \param[in] seg is the TCP segment to send
+void TCPOverUDPSocketAdapter::queue_write(IoUringEventLoop &loop, TCPSegment &seg) {
+    seg.header().sport = config().source.port();
+    seg.header().dport = config().destination.port();
+    loop.queue_sendto(_sock, config().destination, seg.serialize(0));
+}
+
+//! \details With segmentation offload, segments are grouped into runs as write() groups them, and
+//! each run is queued as one buffer for the kernel to split (until the loop finds that the route
+//! can't take runs; see IoUringEventLoop::sends_runs()).
+//! \param[in] loop is the IoUringEventLoop the TCPConnection thread runs on
+//! \param[in] segments are the TCP segments to send, in order
+void TCPOverUDPSocketAdapter::queue_write(IoUringEventLoop &loop, vector<TCPSegment> &segments) {
+    _gso = _gso and loop.sends_runs();
+    for (auto &seg : segments) {
+        seg.header().sport = config().source.port();
+        seg.header().dport = config().destination.port();
+    }
+    _group_runs(segments);
+    for (size_t i = 0; i < _runs.size(); i++) {
+        loop.queue_sendto(_sock, config().destination, move(_runs[i]), _run_lengths[i] == 1 ? 0 : _segment_sizes[i]);
+    }
+}
+
+//! \details With segmentation offload, consecutive segments of the same size go out as one run
+//! (which may end with one shorter segment), and the kernel splits each run into datagrams.
+//! \param[in] segments are the TCP segments to write, in order
+//! \returns the number written (from the front of `segments`), which may be fewer than all of them
+//! if the socket is non-blocking and runs out of room
+size_t TCPOverUDPSocketAdapter::write(vector<TCPSegment> &segments) {
+    for (auto &seg : segments) {
+        seg.header().sport = config().source.port();
+        seg.header().dport = config().destination.port();
+    }
+
+    size_t runs_sent = 0;
+    while (true) {
+        _group_runs(segments);
+        _payloads.clear();
+        for (size_t i = 0; i < _runs.size(); i++) {
+            // (a run of one is an ordinary datagram)
+            _payloads.push_back({_runs[i], _run_lengths[i] == 1 ? 0 : _segment_sizes[i]});
+        }
+        try {
+            runs_sent = _sock.send_batch(config().destination, _payloads);
+            break;
+        } catch (const unix_error &e) {
+            // the route's device can't take runs after all (EIO), so go back to one datagram per segment
+            if (not _gso or e.code().value() != EIO) {
+                throw;
+            }
+            _gso = false;
+        }
+    }
+
+    size_t written = 0;
+    for (size_t i = 0; i < runs_sent; i++) {
+        written += _run_lengths[i];
+    }
+    return written;
+}
+
+//! \details Fills _runs, _segment_sizes and _run_lengths (with one run per segment if segmentation
+//! offload is off).
+//! \param[in] segments are the TCP segments to write, in order
+void TCPOverUDPSocketAdapter::_group_runs(vector<TCPSegment> &segments) {
+    _runs.clear();
+    _segment_sizes.clear();
+    _run_lengths.clear();
+
+    bool run_open = false;  // can the last run take another segment?
+    for (auto &seg : segments) {
+        BufferList datagram = seg.serialize(0);
+        const size_t size = datagram.size();
+
+        if (_gso and run_open and size <= _segment_sizes.back() and _run_lengths.back() < GSO_MAX_SEGMENTS and
+            _runs.back().size() + size <= GSO_MAX_BYTES) {
+            _runs.back().append(datagram);
+            _run_lengths.back()++;
+            run_open = size == _segment_sizes.back();
+        } else {
+            _runs.push_back(move(datagram));
+            _segment_sizes.push_back(size);
+            _run_lengths.push_back(1);
+            run_open = size > 0;
+        }
+    }
+}
+
 //! Specialize LossyFdAdapter to TCPOverUDPSocketAdapter
 template class LossyFdAdapter<TCPOverUDPSocketAdapter>;
@@ -1,15 +1,19 @@
 #ifndef SPONGE_LIBSPONGE_FD_ADAPTER_HH
 #define SPONGE_LIBSPONGE_FD_ADAPTER_HH
 
+#include "buffer_pool.hh"
 #include "file_descriptor.hh"
+#include "io_uring_eventloop.hh"
 #include "lossy_fd_adapter.hh"
 #include "socket.hh"
 #include "tcp_config.hh"
 #include "tcp_header.hh"
 #include "tcp_segment.hh"
 
+#include <functional>
 #include <optional>
 #include <utility>
+#include <vector>
 
 //! \brief Basic functionality for file descriptor adaptors
 //! \details See TCPOverUDPSocketAdapter and TCPOverIPv4OverTunFdAdapter for more information.
@@ -40,23 +44,83 @@ class FdAdapterBase {
 
     //! Called periodically when time elapses
     void tick(const size_t) {}
+
+    //! Milliseconds until tick() next has something to do (never, for adapters without timers)
+    std::optional<uint64_t> time_until_next_timer() const { return std::nullopt; }
+
+    //! Datagrams already taken from the fd that read() hasn't returned yet (none, for adapters that don't batch)
+    size_t datagrams_buffered() const { return 0; }
 };
 
 //! \brief A FD adaptor that reads and writes TCP segments in UDP payloads
+//! \details Datagrams are received in batches of up to RECV_BATCH, with one system call per batch
+//! (see UDPSocket::recv_batch), and handed out one at a time by read().
+//!
+//! Where the kernel supports it, the adapter also offloads segmentation: write() sends runs of
+//! equal-sized segments as one buffer that the kernel splits into datagrams (UDP GSO), and the
+//! socket accepts runs of datagrams coalesced into one payload (UDP GRO), which read() splits up.
 class TCPOverUDPSocketAdapter : public FdAdapterBase {
   private:
+    static constexpr size_t RECV_BATCH = 32;          //!< Most datagrams received with one system call
+    static constexpr size_t GSO_MAX_SEGMENTS = 64;    //!< Most datagrams in one run handed to the kernel
+    static constexpr size_t GSO_MAX_BYTES = 65507;    //!< Most bytes in one run (the largest UDP payload)
+
     UDPSocket _sock;
 
+    bool _gso;  //!< Send runs of segments for the kernel to split?
+
+    //! Slabs to receive datagrams into, each big enough for the largest (or a GRO-coalesced) UDP payload
+    BufferPool _pool{65536, 2 * RECV_BATCH};
+
+    //! The last batch of datagrams received
+    std::vector<UDPSocket::received_buffer> _received{RECV_BATCH, {{nullptr, 0}, {}, 0}};
+    size_t _received_count{0};  //!< Datagrams in the last batch
+    size_t _next_received{0};   //!< Index of the next datagram of the last batch for read() to take from
+
+    //! \name
+    //! write()'s (and queue_write()'s) runs of segments, kept from call to call so that their arrays are
+    //! allocated once
+    //!@{
+    std::vector<BufferList> _runs{};
+    std::vector<size_t> _segment_sizes{};  //!< Size of each run's segments (all but the last, which may be shorter)
+    std::vector<size_t> _run_lengths{};    //!< Segments in each run
+    std::vector<UDPSocket::segmented_payload> _payloads{};
+    //!@}
+
+    //! The next segment's worth of payload from the last batch (receiving a new batch if it is used up)
+    Buffer _next_payload(Address &source_address);
+
+    //! A TCP segment related to the current connection, if `payload` (from `source_address`) holds one
+    std::optional<TCPSegment> _accept(Buffer payload, const Address &source_address);
+
+    //! Group segments into runs for the kernel to split (or one run per segment, without offload)
+    void _group_runs(std::vector<TCPSegment> &segments);
+
   public:
     //! Construct from a UDPSocket sliced into a FileDescriptor
-    explicit TCPOverUDPSocketAdapter(UDPSocket &&sock) : _sock(std::move(sock)) {}
+    explicit TCPOverUDPSocketAdapter(UDPSocket &&sock);
 
     //! Attempts to read and return a TCP segment related to the current connection from a UDP payload
     std::optional<TCPSegment> read();
 
+    //! Has `loop` receive UDP payloads, calling `on_segment` with each TCP segment related to the current connection
+    EventRuleId add_receiver(IoUringEventLoop &loop, const std::function<void(TCPSegment &&)> &on_segment);
+
     //! Writes a TCP segment into a UDP payload
     void write(TCPSegment &seg);
 
+    //! Writes TCP segments into UDP payloads, with one system call
+    size_t write(std::vector<TCPSegment> &segments);
+
+    //! Queues a TCP segment, in a UDP payload, for `loop` to send
+    void queue_write(IoUringEventLoop &loop, TCPSegment &seg);
+
+    //! Queues TCP segments, in UDP payloads, for `loop` to send (in runs, with segmentation offload)
+    void queue_write(IoUringEventLoop &loop, std::vector<TCPSegment> &segments);
+
+    //! Datagrams received in the last batch that read() hasn't finished with
+    size_t datagrams_buffered() const { return _received_count - _next_received; }
+
     //! Access the underlying UDP socket
     operator UDPSocket &() { return _sock; }
 
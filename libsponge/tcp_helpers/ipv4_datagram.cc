@@ -8,9 +8,11 @@
 
 using namespace std;
 
-ParseResult IPv4Datagram::parse(const Buffer buffer) {
+ParseResult IPv4Datagram::parse(const BufferList &buffer) {
     NetParser p{buffer};
-    _header.parse(p);
+    if (const ParseResult header_result = _header.parse(p); header_result != ParseResult::NoError) {
+        return header_result;
+    }
     _payload = p.buffer();
 
     if (_payload.size() != _header.payload_length()) {
@@ -20,6 +22,8 @@ ParseResult IPv4Datagram::parse(const Buffer buffer) {
     return p.get_error();
 }
 
+//! \details The header goes in front of the payload, in the headroom of its first Buffer if it has
+//! any free (see BufferList::prepend).
 BufferList IPv4Datagram::serialize() const {
     if (_payload.size() != _header.payload_length()) {
         throw runtime_error("IPv4Datagram::serialize: payload is wrong size");
@@ -27,15 +31,17 @@ BufferList IPv4Datagram::serialize() const {
 
     IPv4Header header_out = _header;
     header_out.cksum = 0;
-    const string header_zero_checksum = header_out.serialize();
 
-    // calculate checksum -- taken over header only
+    BufferList ret{_payload};
+    const size_t header_length = 4 * size_t{header_out.hlen};
+    char *const header_bytes = ret.prepend(header_length);
+    ByteSpan header_span{header_bytes, header_length};
+    header_out.serialize(header_span);
+
+    // calculate checksum -- taken over header only -- and fill it in
     InternetChecksum check;
-    check.add(header_zero_checksum);
-    header_out.cksum = check.value();
+    check.add({header_bytes, header_length});
+    IPv4Header::Wire::Checksum::store(header_bytes, check.value());
 
-    BufferList ret;
-    ret.append(header_out.serialize());
-    ret.append(_payload);
     return ret;
 }
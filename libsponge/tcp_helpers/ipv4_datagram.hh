@@ -12,7 +12,7 @@ class IPv4Datagram {
 
   public:
     //! \brief Parse the segment from a string
-    ParseResult parse(const Buffer buffer);
+    ParseResult parse(const BufferList &buffer);
 
     //! \brief Serialize the segment to a string
     BufferList serialize() const;
@@ -3,6 +3,8 @@
 #include "util.hh"
 
 #include <arpa/inet.h>
+#include <array>
+#include <cstring>
 #include <iomanip>
 #include <sstream>
 
@@ -21,30 +23,31 @@ using namespace std;
 //! - there is less data in the full datagram than the `len` field claims
 //! - the checksum is bad
 ParseResult IPv4Header::parse(NetParser &p) {
-    Buffer original_serialized_version = p.buffer();
-
     const size_t data_size = p.buffer().size();
-    if (data_size < IPv4Header::LENGTH) {
-        return ParseResult::PacketTooShort;
+
+    array<char, LENGTH> scratch{};
+    const char *const bytes = p.peek(scratch);
+    if (not bytes) {
+        return p.get_error();
     }
 
-    const uint8_t first_byte = p.u8();
-    ver = first_byte >> 4;     // version
-    hlen = first_byte & 0x0f;  // header length
-    tos = p.u8();              // type of service
-    len = p.u16();             // length
-    id = p.u16();              // id
+    const uint8_t first_byte = Wire::VersionAndLength::load(bytes);
+    ver = first_byte >> 4;                   // version
+    hlen = first_byte & 0x0f;                // header length
+    tos = Wire::TypeOfService::load(bytes);  // type of service
+    len = Wire::TotalLength::load(bytes);    // length
+    id = Wire::Identification::load(bytes);  // id
 
-    const uint16_t fo_val = p.u16();
+    const uint16_t fo_val = Wire::FlagsAndOffset::load(bytes);
     df = static_cast<bool>(fo_val & 0x4000);  // don't fragment
     mf = static_cast<bool>(fo_val & 0x2000);  // more fragments
     offset = fo_val & 0x1fff;                 // offset
 
-    ttl = p.u8();     // ttl
-    proto = p.u8();   // proto
-    cksum = p.u16();  // checksum
-    src = p.u32();    // source address
-    dst = p.u32();    // destination address
+    ttl = Wire::TimeToLive::load(bytes);   // ttl
+    proto = Wire::Protocol::load(bytes);   // proto
+    cksum = Wire::Checksum::load(bytes);   // checksum
+    src = Wire::Source::load(bytes);       // source address
+    dst = Wire::Destination::load(bytes);  // destination address
 
     if (data_size < 4 * hlen) {
         return ParseResult::PacketTooShort;
@@ -59,56 +62,68 @@ ParseResult IPv4Header::parse(NetParser &p) {
         return ParseResult::TruncatedPacket;
     }
 
-    p.remove_prefix(hlen * 4 - IPv4Header::LENGTH);
-
-    if (p.error()) {
-        return p.get_error();
-    }
-
+    // (the header may be split across Buffers)
     InternetChecksum check;
-    check.add({original_serialized_version.str().data(), size_t(4 * hlen)});
+    size_t header_left = 4 * hlen;
+    for (const auto &buf : p.buffer().buffers()) {
+        const string_view header_bytes = buf.str().substr(0, header_left);
+        check.add(header_bytes);
+        header_left -= header_bytes.size();
+    }
     if (check.value()) {
         return ParseResult::BadChecksum;
     }
 
-    return ParseResult::NoError;
+    p.remove_prefix(4 * hlen);
+
+    return p.get_error();
 }
 
-//! Serialize the IPv4Header to a string (does not recompute the checksum)
-string IPv4Header::serialize() const {
+//! \returns the length of the serialized header (after checking that it can be serialized)
+static size_t serialized_length(const IPv4Header &header) {
     // sanity checks
-    if (ver != 4) {
+    if (header.ver != 4) {
         throw runtime_error("wrong IP version");
     }
-    if (4 * hlen < IPv4Header::LENGTH) {
+    if (4 * header.hlen < IPv4Header::LENGTH) {
         throw runtime_error("IP header too short");
     }
+    return 4 * header.hlen;
+}
 
-    string ret;
-    ret.reserve(4 * hlen);
-
-    const uint8_t first_byte = (ver << 4) | (hlen & 0xf);
-    NetUnparser::u8(ret, first_byte);  // version and header length
-    NetUnparser::u8(ret, tos);         // type of service
-    NetUnparser::u16(ret, len);        // length
-    NetUnparser::u16(ret, id);         // id
-
-    const uint16_t fo_val = (df ? 0x4000 : 0) | (mf ? 0x2000 : 0) | (offset & 0x1fff);
-    NetUnparser::u16(ret, fo_val);  // flags and offset
-
-    NetUnparser::u8(ret, ttl);    // time to live
-    NetUnparser::u8(ret, proto);  // protocol number
-
-    NetUnparser::u16(ret, cksum);  // checksum
-
-    NetUnparser::u32(ret, src);  // src address
-    NetUnparser::u32(ret, dst);  // dst address
-
-    ret.resize(4 * hlen);  // expand header to advertised size
+//! Write the fixed part of `header` into the first IPv4Header::LENGTH of `bytes`
+static void store_fields(const IPv4Header &header, char *const bytes) {
+    const uint8_t first_byte = (header.ver << 4) | (header.hlen & 0xf);
+    IPv4Header::Wire::VersionAndLength::store(bytes, first_byte);  // version and header length
+    IPv4Header::Wire::TypeOfService::store(bytes, header.tos);     // type of service
+    IPv4Header::Wire::TotalLength::store(bytes, header.len);       // length
+    IPv4Header::Wire::Identification::store(bytes, header.id);     // id
+
+    const uint16_t fo_val = (header.df ? 0x4000 : 0) | (header.mf ? 0x2000 : 0) | (header.offset & 0x1fff);
+    IPv4Header::Wire::FlagsAndOffset::store(bytes, fo_val);  // flags and offset
+
+    IPv4Header::Wire::TimeToLive::store(bytes, header.ttl);   // time to live
+    IPv4Header::Wire::Protocol::store(bytes, header.proto);   // protocol number
+    IPv4Header::Wire::Checksum::store(bytes, header.cksum);   // checksum
+    IPv4Header::Wire::Source::store(bytes, header.src);       // src address
+    IPv4Header::Wire::Destination::store(bytes, header.dst);  // dst address
+}
 
+//! Serialize the IPv4Header to a string (does not recompute the checksum)
+string IPv4Header::serialize() const {
+    string ret(serialized_length(*this), 0);  // (any options are left zero)
+    store_fields(*this, ret.data());
     return ret;
 }
 
+//! Serialize the IPv4Header into a ByteSpan (does not recompute the checksum)
+void IPv4Header::serialize(ByteSpan &out) const {
+    const size_t length = serialized_length(*this);
+    char *const bytes = out.append(length);
+    memset(bytes + LENGTH, 0, length - LENGTH);
+    store_fields(*this, bytes);
+}
+
 uint16_t IPv4Header::payload_length() const { return len - 4 * hlen; }
 
 //! \details This value is needed when computing the checksum of an encapsulated TCP segment.
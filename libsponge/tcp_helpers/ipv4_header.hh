@@ -2,6 +2,7 @@
 #define SPONGE_LIBSPONGE_IPV4_HEADER_HH
 
 #include "parser.hh"
+#include "wire_layout.hh"
 
 //! \brief [IPv4](\ref rfc::rfc791) Internet datagram header
 //! \note IP options are not supported
@@ -29,6 +30,31 @@ struct IPv4Header {
     //!  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
     //! ~~~
 
+    //! Where the fields are in the header's first LENGTH bytes (see WireLayout)
+    struct Wire {
+        using VersionAndLength = WireField<uint8_t, 0>;  //!< (version in the top four bits)
+        using TypeOfService = WireField<uint8_t, 1>;
+        using TotalLength = WireField<uint16_t, 2>;
+        using Identification = WireField<uint16_t, 4>;
+        using FlagsAndOffset = WireField<uint16_t, 6>;  //!< (flags in the top three bits)
+        using TimeToLive = WireField<uint8_t, 8>;
+        using Protocol = WireField<uint8_t, 9>;
+        using Checksum = WireField<uint16_t, 10>;
+        using Source = WireField<uint32_t, 12>;
+        using Destination = WireField<uint32_t, 16>;
+        using Layout = WireLayout<VersionAndLength,
+                                  TypeOfService,
+                                  TotalLength,
+                                  Identification,
+                                  FlagsAndOffset,
+                                  TimeToLive,
+                                  Protocol,
+                                  Checksum,
+                                  Source,
+                                  Destination>;
+    };
+    static_assert(Wire::Layout::LENGTH == LENGTH);
+
     //! \name IPv4 Header fields
     //!@{
     uint8_t ver = 4;            //!< IP version
@@ -52,6 +78,9 @@ struct IPv4Header {
     //! Serialize the IP fields
     std::string serialize() const;
 
+    //! Serialize the IP fields into a ByteSpan (e.g. room claimed with BufferList::prepend)
+    void serialize(ByteSpan &out) const;
+
     //! Length of the payload
     uint16_t payload_length() const;
 
@@ -2,13 +2,16 @@
 #define SPONGE_LIBSPONGE_LOSSY_FD_ADAPTER_HH
 
 #include "file_descriptor.hh"
+#include "io_uring_eventloop.hh"
 #include "tcp_config.hh"
 #include "tcp_segment.hh"
 #include "util.hh"
 
+#include <functional>
 #include <optional>
 #include <random>
 #include <utility>
+#include <vector>
 
 //! An adapter class that adds random dropping behavior to an FD adapter
 template <typename AdapterT>
@@ -47,6 +50,20 @@ class LossyFdAdapter {
         return ret;
     }
 
+    //! \brief Have `loop` receive through the underlying AdapterT instance (if it can), potentially
+    //! dropping the received datagrams
+    //! \param[in] loop is the IoUringEventLoop to receive on
+    //! \param[in] on_segment is called with each segment that isn't dropped
+    template <typename A = AdapterT>
+    auto add_receiver(IoUringEventLoop &loop, const std::function<void(TCPSegment &&)> &on_segment)
+        -> decltype(std::declval<A &>().add_receiver(loop, on_segment)) {
+        return _adapter.add_receiver(loop, [this, on_segment](TCPSegment &&seg) {
+            if (not _should_drop(false)) {
+                on_segment(std::move(seg));
+            }
+        });
+    }
+
     //! \brief Write to the underlying AdapterT instance, potentially dropping the datagram to be written
     //! \param[in] seg is the packet to either write or drop
     void write(TCPSegment &seg) {
@@ -56,6 +73,50 @@ class LossyFdAdapter {
         return _adapter.write(seg);
     }
 
+    //! \brief Write to the underlying AdapterT instance all at once (if it can), potentially dropping some segments
+    //! \param[in] segments are the packets to either write or drop, in order
+    //! \returns the number written or dropped (from the front of `segments`)
+    template <typename A = AdapterT>
+    auto write(std::vector<TCPSegment> &segments)
+        -> decltype(std::declval<A &>().write(std::declval<std::vector<TCPSegment> &>())) {
+        std::vector<TCPSegment> kept{};
+        std::vector<size_t> kept_index{};
+        for (size_t i = 0; i < segments.size(); i++) {
+            if (not _should_drop(true)) {
+                kept.push_back(segments[i]);
+                kept_index.push_back(i);
+            }
+        }
+        const size_t written = kept.empty() ? 0 : _adapter.write(kept);
+        return written == kept.size() ? segments.size() : kept_index[written];
+    }
+
+    //! \brief Queue a write on `loop` through the underlying AdapterT instance, potentially dropping it instead
+    //! \param[in] loop is the IoUringEventLoop to queue the write on
+    //! \param[in] seg is the packet to either queue or drop
+    void queue_write(IoUringEventLoop &loop, TCPSegment &seg) {
+        if (_should_drop(true)) {
+            return;
+        }
+        _adapter.queue_write(loop, seg);
+    }
+
+    //! \brief Queue writes on `loop` through the underlying AdapterT instance all at once (if it can),
+    //! potentially dropping some segments
+    //! \param[in] loop is the IoUringEventLoop to queue the writes on
+    //! \param[in] segments are the packets to either queue or drop, in order
+    template <typename A = AdapterT>
+    auto queue_write(IoUringEventLoop &loop, std::vector<TCPSegment> &segments)
+        -> decltype(std::declval<A &>().queue_write(loop, std::declval<std::vector<TCPSegment> &>())) {
+        std::vector<TCPSegment> kept{};
+        for (auto &seg : segments) {
+            if (not _should_drop(true)) {
+                kept.push_back(seg);
+            }
+        }
+        _adapter.queue_write(loop, kept);
+    }
+
     //! \name
     //! Passthrough functions to the underlying AdapterT instance
 
@@ -66,6 +127,12 @@ class LossyFdAdapter {
     void tick(const size_t ms_since_last_tick) {
         _adapter.tick(ms_since_last_tick);
     }  //!< FdAdapterBase::tick passthrough
+    std::optional<uint64_t> time_until_next_timer() const {
+        return _adapter.time_until_next_timer();
+    }  //!< FdAdapterBase::time_until_next_timer passthrough
+    size_t datagrams_buffered() const {
+        return _adapter.datagrams_buffered();
+    }  //!< FdAdapterBase::datagrams_buffered passthrough
     //!@}
 };
 
@@ -0,0 +1,105 @@
+#ifndef SPONGE_LIBSPONGE_PACKET_VIEWS_HH
+#define SPONGE_LIBSPONGE_PACKET_VIEWS_HH
+
+#include "buffer.hh"
+#include "ethernet_header.hh"
+#include "ipv4_header.hh"
+#include "tcp_header.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+
+//! \file
+//! \brief Read-only views of the headers at the front of a packet, for looking at a field or two
+//! (e.g. to decide whether to drop the packet) without parsing the whole thing.
+//!
+//! A view reads each field from the raw bytes when it is asked for it, and checks nothing: not the
+//! checksum, the version or the lengths. It only looks at the first Buffer of a BufferList, so a
+//! header split across Buffers makes an incomplete view. Callers that use a view to drop packets
+//! should keep any they can't decide about, and leave them to the full parse.
+
+//! The bytes a view of `buffer` sees (those in its first Buffer)
+inline std::string_view view_bytes(const BufferList &buffer) {
+    return buffer.buffers().empty() ? std::string_view{} : buffer.buffers().front().str();
+}
+
+//! \brief A view of an Ethernet frame (see EthernetHeader)
+class EthernetFrameView {
+  private:
+    std::string_view _bytes;
+
+  public:
+    explicit EthernetFrameView(const std::string_view bytes) : _bytes(bytes) {}
+    explicit EthernetFrameView(const BufferList &buffer) : _bytes(view_bytes(buffer)) {}
+
+    //! \brief Is the whole header there? (If not, none of the fields may be read.)
+    bool complete() const { return _bytes.size() >= EthernetHeader::LENGTH; }
+
+    //! \name Fields
+    //!@{
+    EthernetAddress dst() const { return EthernetHeader::Wire::Destination::load(_bytes.data()); }
+    EthernetAddress src() const { return EthernetHeader::Wire::Source::load(_bytes.data()); }
+    uint16_t type() const { return EthernetHeader::Wire::Type::load(_bytes.data()); }
+    //!@}
+
+    //! \brief The bytes after the header
+    std::string_view payload() const { return _bytes.substr(std::min(EthernetHeader::LENGTH, _bytes.size())); }
+};
+
+//! \brief A view of an IPv4 datagram (see IPv4Header)
+class IPv4View {
+  private:
+    std::string_view _bytes;
+
+  public:
+    explicit IPv4View(const std::string_view bytes) : _bytes(bytes) {}
+    explicit IPv4View(const BufferList &buffer) : _bytes(view_bytes(buffer)) {}
+
+    //! \brief Is the fixed part of the header there? (If not, none of the fields may be read.)
+    bool complete() const { return _bytes.size() >= IPv4Header::LENGTH; }
+
+    //! \name Fields
+    //!@{
+    uint8_t ver() const { return IPv4Header::Wire::VersionAndLength::load(_bytes.data()) >> 4; }
+    uint8_t hlen() const { return IPv4Header::Wire::VersionAndLength::load(_bytes.data()) & 0x0f; }
+    uint16_t len() const { return IPv4Header::Wire::TotalLength::load(_bytes.data()); }
+    uint8_t proto() const { return IPv4Header::Wire::Protocol::load(_bytes.data()); }
+    uint32_t src() const { return IPv4Header::Wire::Source::load(_bytes.data()); }
+    uint32_t dst() const { return IPv4Header::Wire::Destination::load(_bytes.data()); }
+    //!@}
+
+    //! \brief The bytes after the header (including its options), as `hlen` has it
+    std::string_view payload() const { return _bytes.substr(std::min(size_t{4} * hlen(), _bytes.size())); }
+};
+
+//! \brief A view of a TCP segment (see TCPHeader)
+class TCPSegmentView {
+  private:
+    std::string_view _bytes;
+
+    bool _flag(const uint8_t mask) const { return TCPHeader::Wire::Flags::load(_bytes.data()) & mask; }
+
+  public:
+    explicit TCPSegmentView(const std::string_view bytes) : _bytes(bytes) {}
+    explicit TCPSegmentView(const BufferList &buffer) : _bytes(view_bytes(buffer)) {}
+
+    //! \brief Is the fixed part of the header there? (If not, none of the fields may be read.)
+    bool complete() const { return _bytes.size() >= TCPHeader::LENGTH; }
+
+    //! \name Fields
+    //!@{
+    uint16_t sport() const { return TCPHeader::Wire::SourcePort::load(_bytes.data()); }
+    uint16_t dport() const { return TCPHeader::Wire::DestinationPort::load(_bytes.data()); }
+    WrappingInt32 seqno() const { return WrappingInt32{TCPHeader::Wire::SequenceNumber::load(_bytes.data())}; }
+    WrappingInt32 ackno() const { return WrappingInt32{TCPHeader::Wire::AcknowledgmentNumber::load(_bytes.data())}; }
+    uint8_t doff() const { return TCPHeader::Wire::DataOffset::load(_bytes.data()) >> 4; }
+    bool ack() const { return _flag(0b0001'0000); }
+    bool rst() const { return _flag(0b0000'0100); }
+    bool syn() const { return _flag(0b0000'0010); }
+    bool fin() const { return _flag(0b0000'0001); }
+    uint16_t win() const { return TCPHeader::Wire::Window::load(_bytes.data()); }
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_PACKET_VIEWS_HH
@@ -16,20 +16,37 @@ class TCPConfig {
     static constexpr uint16_t TIMEOUT_DFLT = 1000;     //!< Default re-transmit timeout is 1 second
     static constexpr unsigned MAX_RETX_ATTEMPTS = 8;   //!< Maximum re-transmit attempts before giving up
 
+    //! How the sender coalesces small writes into segments
+    enum class SendPolicy {
+        NoDelay,  //!< Send a segment as soon as any byte is available
+        Nagle,    //!< Hold a less-than-full segment while unacknowledged data is in flight
+        Cork      //!< Hold a less-than-full segment until the sender is explicitly flushed
+    };
+
     uint16_t rt_timeout = TIMEOUT_DFLT;       //!< Initial value of the retransmission timeout, in milliseconds
     size_t recv_capacity = DEFAULT_CAPACITY;  //!< Receive capacity, in bytes
     size_t send_capacity = DEFAULT_CAPACITY;  //!< Sender capacity, in bytes
     std::optional<WrappingInt32> fixed_isn{};
+    SendPolicy send_policy = SendPolicy::NoDelay;  //!< Coalescing policy for small writes
+    bool rack_tlp = false;  //!< Use RACK time-based loss detection and Tail Loss Probes (RFC 8985)
 };
 
 //! Config for classes derived from FdAdapter
 class FdAdapterConfig {
   public:
+    //! The event loop a TCPSpongeSocket's thread does the adapter's I/O with
+    enum class LoopBackend {
+        Poll,    //!< An EventLoop: a poll per wakeup, and a system call per read and write
+        IoUring  //!< An IoUringEventLoop: writes go out in batches, with the system call that waits
+    };
+
     Address source{"0", 0};       //!< Source address and port
     Address destination{"0", 0};  //!< Destination address and port
 
     uint16_t loss_rate_dn = 0;  //!< Downlink loss rate (for LossyFdAdapter)
     uint16_t loss_rate_up = 0;  //!< Uplink loss rate (for LossyFdAdapter)
+
+    LoopBackend loop_backend = LoopBackend::Poll;  //!< (IoUring falls back to epoll where io_uring isn't available)
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_CONFIG_HH
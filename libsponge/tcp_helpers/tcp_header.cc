@@ -1,5 +1,7 @@
 #include "tcp_header.hh"
 
+#include <array>
+#include <cstring>
 #include <sstream>
 
 using namespace std;
@@ -15,68 +17,81 @@ using namespace std;
 //! - there is less data in the header than the `doff` field claims
 //! - the checksum is bad
 ParseResult TCPHeader::parse(NetParser &p) {
-    sport = p.u16();                 // source port
-    dport = p.u16();                 // destination port
-    seqno = WrappingInt32{p.u32()};  // sequence number
-    ackno = WrappingInt32{p.u32()};  // ack number
-    doff = p.u8() >> 4;              // data offset
-
-    const uint8_t fl_b = p.u8();                  // byte including flags
-    urg = static_cast<bool>(fl_b & 0b0010'0000);  // binary literals and ' digit separator since C++14!!!
+    array<char, LENGTH> scratch{};
+    const char *const bytes = p.peek(scratch);
+    if (not bytes) {
+        return p.get_error();
+    }
+
+    sport = Wire::SourcePort::load(bytes);                           // source port
+    dport = Wire::DestinationPort::load(bytes);                      // destination port
+    seqno = WrappingInt32{Wire::SequenceNumber::load(bytes)};        // sequence number
+    ackno = WrappingInt32{Wire::AcknowledgmentNumber::load(bytes)};  // ack number
+    doff = Wire::DataOffset::load(bytes) >> 4;                       // data offset
+
+    const uint8_t fl_b = Wire::Flags::load(bytes);  // byte including flags
+    urg = static_cast<bool>(fl_b & 0b0010'0000);    // binary literals and ' digit separator since C++14!!!
     ack = static_cast<bool>(fl_b & 0b0001'0000);
     psh = static_cast<bool>(fl_b & 0b0000'1000);
     rst = static_cast<bool>(fl_b & 0b0000'0100);
     syn = static_cast<bool>(fl_b & 0b0000'0010);
     fin = static_cast<bool>(fl_b & 0b0000'0001);
 
-    win = p.u16();    // window size
-    cksum = p.u16();  // checksum
-    uptr = p.u16();   // urgent pointer
+    win = Wire::Window::load(bytes);          // window size
+    cksum = Wire::Checksum::load(bytes);      // checksum
+    uptr = Wire::UrgentPointer::load(bytes);  // urgent pointer
 
     if (doff < 5) {
         return ParseResult::HeaderTooShort;
     }
 
-    // skip any options or anything extra in the header
-    p.remove_prefix(doff * 4 - TCPHeader::LENGTH);
+    // skip the header, with any options or anything extra in it
+    p.remove_prefix(4 * doff);
 
-    if (p.error()) {
-        return p.get_error();
-    }
-
-    return ParseResult::NoError;
+    return p.get_error();
 }
 
-//! Serialize the TCPHeader to a string (does not recompute the checksum)
-string TCPHeader::serialize() const {
+//! \returns the length of the serialized header (after checking that it can be serialized)
+static size_t serialized_length(const TCPHeader &header) {
     // sanity check
-    if (doff < 5) {
+    if (header.doff < 5) {
         throw runtime_error("TCP header too short");
     }
+    return 4 * header.doff;
+}
 
-    string ret;
-    ret.reserve(4 * doff);
-
-    NetUnparser::u16(ret, sport);              // source port
-    NetUnparser::u16(ret, dport);              // destination port
-    NetUnparser::u32(ret, seqno.raw_value());  // sequence number
-    NetUnparser::u32(ret, ackno.raw_value());  // ack number
-    NetUnparser::u8(ret, doff << 4);           // data offset
-
-    const uint8_t fl_b = (urg ? 0b0010'0000 : 0) | (ack ? 0b0001'0000 : 0) | (psh ? 0b0000'1000 : 0) |
-                         (rst ? 0b0000'0100 : 0) | (syn ? 0b0000'0010 : 0) | (fin ? 0b0000'0001 : 0);
-    NetUnparser::u8(ret, fl_b);  // flags
-    NetUnparser::u16(ret, win);  // window size
-
-    NetUnparser::u16(ret, cksum);  // checksum
-
-    NetUnparser::u16(ret, uptr);  // urgent pointer
-
-    ret.resize(4 * doff);  // expand header to advertised size
+//! Write the fixed part of `header` into the first TCPHeader::LENGTH of `bytes`
+static void store_fields(const TCPHeader &header, char *const bytes) {
+    TCPHeader::Wire::SourcePort::store(bytes, header.sport);                        // source port
+    TCPHeader::Wire::DestinationPort::store(bytes, header.dport);                   // destination port
+    TCPHeader::Wire::SequenceNumber::store(bytes, header.seqno.raw_value());        // sequence number
+    TCPHeader::Wire::AcknowledgmentNumber::store(bytes, header.ackno.raw_value());  // ack number
+    TCPHeader::Wire::DataOffset::store(bytes, header.doff << 4);                    // data offset
+
+    const uint8_t fl_b = (header.urg ? 0b0010'0000 : 0) | (header.ack ? 0b0001'0000 : 0) |
+                         (header.psh ? 0b0000'1000 : 0) | (header.rst ? 0b0000'0100 : 0) |
+                         (header.syn ? 0b0000'0010 : 0) | (header.fin ? 0b0000'0001 : 0);
+    TCPHeader::Wire::Flags::store(bytes, fl_b);                 // flags
+    TCPHeader::Wire::Window::store(bytes, header.win);          // window size
+    TCPHeader::Wire::Checksum::store(bytes, header.cksum);      // checksum
+    TCPHeader::Wire::UrgentPointer::store(bytes, header.uptr);  // urgent pointer
+}
 
+//! Serialize the TCPHeader to a string (does not recompute the checksum)
+string TCPHeader::serialize() const {
+    string ret(serialized_length(*this), 0);  // (any options are left zero)
+    store_fields(*this, ret.data());
     return ret;
 }
 
+//! Serialize the TCPHeader into a ByteSpan (does not recompute the checksum)
+void TCPHeader::serialize(ByteSpan &out) const {
+    const size_t length = serialized_length(*this);
+    char *const bytes = out.append(length);
+    memset(bytes + LENGTH, 0, length - LENGTH);
+    store_fields(*this, bytes);
+}
+
 //! \returns A string with the header's contents
 string TCPHeader::to_string() const {
     stringstream ss{};
@@ -2,6 +2,7 @@
 #define SPONGE_LIBSPONGE_TCP_HEADER_HH
 
 #include "parser.hh"
+#include "wire_layout.hh"
 #include "wrapping_integers.hh"
 
 //! \brief [TCP](\ref rfc::rfc793) segment header
@@ -32,6 +33,29 @@ struct TCPHeader {
     //!  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
     //! ~~~
 
+    //! Where the fields are in the header's first LENGTH bytes (see WireLayout)
+    struct Wire {
+        using SourcePort = WireField<uint16_t, 0>;
+        using DestinationPort = WireField<uint16_t, 2>;
+        using SequenceNumber = WireField<uint32_t, 4>;
+        using AcknowledgmentNumber = WireField<uint32_t, 8>;
+        using DataOffset = WireField<uint8_t, 12>;  //!< (in the top four bits)
+        using Flags = WireField<uint8_t, 13>;
+        using Window = WireField<uint16_t, 14>;
+        using Checksum = WireField<uint16_t, 16>;
+        using UrgentPointer = WireField<uint16_t, 18>;
+        using Layout = WireLayout<SourcePort,
+                                  DestinationPort,
+                                  SequenceNumber,
+                                  AcknowledgmentNumber,
+                                  DataOffset,
+                                  Flags,
+                                  Window,
+                                  Checksum,
+                                  UrgentPointer>;
+    };
+    static_assert(Wire::Layout::LENGTH == LENGTH);
+
     //! \name TCP Header fields
     //!@{
     uint16_t sport = 0;         //!< source port
@@ -56,6 +80,9 @@ struct TCPHeader {
     //! Serialize the TCP fields
     std::string serialize() const;
 
+    //! Serialize the TCP fields into a ByteSpan (e.g. room claimed with BufferList::prepend)
+    void serialize(ByteSpan &out) const;
+
     //! Return a string containing a header in human-readable format
     std::string to_string() const;
 
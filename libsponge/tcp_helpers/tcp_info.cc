@@ -0,0 +1,36 @@
+#include "tcp_info.hh"
+
+#include <sstream>
+
+using namespace std;
+
+//! Names of the TCPState::State values, in order
+static constexpr const char *STATE_NAMES[] = {"LISTEN",
+                                              "SYN_RCVD",
+                                              "SYN_SENT",
+                                              "ESTABLISHED",
+                                              "CLOSE_WAIT",
+                                              "LAST_ACK",
+                                              "FIN_WAIT_1",
+                                              "FIN_WAIT_2",
+                                              "CLOSING",
+                                              "TIME_WAIT",
+                                              "CLOSED",
+                                              "RESET"};
+
+string TCPInfo::to_string() const {
+    ostringstream ss;
+    ss << "state=" << (state.has_value() ? STATE_NAMES[static_cast<size_t>(state.value())] : "(none)")
+       << " active=" << active << "\n"
+       << "srtt=" << srtt << "ms rttvar=" << rttvar << "ms min_rtt=" << min_rtt << "ms rto=" << rto << "ms\n"
+       << "send_window=" << send_window << " receive_window=" << receive_window
+       << " bytes_in_flight=" << bytes_in_flight << " zero_window_time=" << zero_window_time << "ms\n"
+       << "retransmissions=" << retransmissions << " (consecutive " << consecutive_retransmissions << ")"
+       << " duplicate_acks=" << duplicate_acks << "\n"
+       << "bytes_sent=" << bytes_sent << " bytes_acked=" << bytes_acked << " bytes_received=" << bytes_received
+       << "\n"
+       << "segments_received=" << segments_received << " segments_sent=" << segments_sent << "\n"
+       << "unassembled_fragments=" << unassembled_fragments << " unassembled_bytes=" << unassembled_bytes
+       << " time_since_last_segment_received=" << time_since_last_segment_received << "ms";
+    return ss.str();
+}
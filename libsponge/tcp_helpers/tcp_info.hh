@@ -0,0 +1,61 @@
+#ifndef SPONGE_LIBSPONGE_TCP_INFO_HH
+#define SPONGE_LIBSPONGE_TCP_INFO_HH
+
+#include "tcp_state.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+//! \brief A snapshot of a TCPConnection's state and counters, in the spirit of Linux's `TCP_INFO`
+//! \details Returned by TCPConnection::info(). It is a plain trivially copyable struct, so it can be
+//! copied between threads (see TCPSpongeSocket::info()) and logged or compared freely.
+//! Times are in milliseconds; byte counts cover stream bytes only (not SYN or FIN).
+struct TCPInfo {
+    //! \name State
+    //!@{
+    std::optional<TCPState::State> state{};  //!< official TCP state, if the connection is in one
+    bool active{false};                      //!< TCPConnection::active()
+    //!@}
+
+    //! \name Round-trip time and retransmission timeout
+    //!@{
+    uint64_t srtt{0};     //!< smoothed round-trip time (0 before the first sample)
+    uint64_t rttvar{0};   //!< round-trip time variation
+    uint64_t min_rtt{0};  //!< smallest round-trip time seen
+    uint64_t rto{0};      //!< current retransmission timeout
+    //!@}
+
+    //! \name Windows
+    //!@{
+    size_t send_window{0};         //!< window most recently advertised by the peer
+    size_t receive_window{0};      //!< window we advertise to the peer
+    size_t bytes_in_flight{0};     //!< sequence numbers sent but not yet acknowledged (SYN and FIN count)
+    uint64_t zero_window_time{0};  //!< time spent with a zero send window
+    //!@}
+
+    //! \name Counters
+    //!@{
+    uint64_t retransmissions{0};                  //!< segments retransmitted (by timeout, RACK, or as a loss probe)
+    unsigned int consecutive_retransmissions{0};  //!< timeouts since data was last acknowledged
+    uint64_t duplicate_acks{0};                   //!< ACKs that acknowledged nothing new while data was in flight
+    uint64_t bytes_sent{0};                       //!< bytes of the outbound stream sent at least once
+    uint64_t bytes_acked{0};                      //!< bytes of the outbound stream acknowledged by the peer
+    uint64_t bytes_received{0};                   //!< bytes of the inbound stream reassembled
+    uint64_t segments_received{0};                //!< segments handed to TCPConnection::segment_received()
+    uint64_t segments_sent{0};                    //!< segments put into TCPConnection::segments_out()
+    //!@}
+
+    //! \name Receiver
+    //!@{
+    size_t unassembled_fragments{0};             //!< substrings held by the reassembler
+    size_t unassembled_bytes{0};                 //!< bytes held by the reassembler
+    size_t time_since_last_segment_received{0};  //!< time since the peer was last heard from
+    //!@}
+
+    //! \brief Render as a multi-line, human-readable string
+    std::string to_string() const;
+};
+
+#endif  // SPONGE_LIBSPONGE_TCP_INFO_HH
@@ -0,0 +1,415 @@
+#include "tcp_multiplexer.hh"
+
+#include "util.hh"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+//! \param[in] cfg the configuration for every connection (each gets its own ISN, unless `cfg` fixes one)
+TCPMultiplexer::TCPMultiplexer(const TCPConfig &cfg) : _cfg(cfg) {
+    auto rd = get_random_generator();
+    for (uint64_t &word : _cookie_key) {
+        word = (uint64_t{rd()} << 32) | rd();
+    }
+}
+
+//! \param[in] port the local port to accept connections on
+//! \param[in] backlog most connections that may be handshaking or waiting for accept() at once;
+//!                    further SYNs are dropped (the peer will retransmit them)
+void TCPMultiplexer::listen(const uint16_t port, const size_t backlog) {
+    const auto it = _listeners.find(port);
+    if (it != _listeners.end()) {
+        it->second.backlog = backlog;
+    } else {
+        _listeners.emplace(port, Listener{backlog, 0});
+    }
+}
+
+optional<ConnectionId> TCPMultiplexer::accept() {
+    while (not _accept_queue.empty()) {
+        const ConnectionId id = _accept_queue.front();
+        _accept_queue.pop_front();
+        if (not alive(id)) {
+            continue;
+        }
+        Slot &slot = _slots[id.index];
+        slot.in_accept_queue = false;
+        slot.spawned = false;
+        slot.handed_out = true;
+        const auto listener = _listeners.find(slot.tuple.local_port);
+        if (listener != _listeners.end() and listener->second.queued > 0) {
+            listener->second.queued--;
+        }
+        return id;
+    }
+    return {};
+}
+
+//! \param[in] tuple the local and remote addresses and ports to connect
+ConnectionId TCPMultiplexer::connect(const FourTuple &tuple) {
+    if (_table.find(tuple).has_value()) {
+        throw runtime_error("TCPMultiplexer::connect(): " + tuple.to_string() + " is already in use");
+    }
+    const ConnectionId id = _create(tuple, _cfg);
+    Slot &slot = _slots[id.index];
+    slot.handed_out = true;
+    slot.connection->connect();
+    _mark_dirty(id.index);
+    return id;
+}
+
+bool TCPMultiplexer::alive(const ConnectionId id) const {
+    return id.index < _slots.size() and _slots[id.index].generation == id.generation and
+           _slots[id.index].connection;
+}
+
+TCPConnection &TCPMultiplexer::connection(const ConnectionId id) {
+    Slot &slot = _slot(id);
+    _catch_up(id.index);
+    _mark_dirty(id.index);
+    return *slot.connection;
+}
+
+void TCPMultiplexer::release(const ConnectionId id) {
+    if (not alive(id)) {
+        return;
+    }
+    _slots[id.index].released = true;
+    if (not _slots[id.index].connection->active()) {
+        _collect(id.index);
+        _reap(id.index);
+    }
+}
+
+//! \details Looks the connection up in the ConnectionTable. A SYN (without ACK or RST) that
+//! matches nothing spawns a connection if its destination port is listening and both the
+//! listener's backlog and the half-open limit have room; otherwise it is answered with a
+//! SYN cookie or dropped, depending on set_syn_cookies(). While SYN cookies are enabled, an ACK
+//! to a listening port that matches nothing either completes a SYN cookie handshake or is
+//! dropped. Anything else that matches nothing is answered with a RST.
+void TCPMultiplexer::segment_received(const FourTuple &tuple, const TCPSegment &seg) {
+    const auto index = _table.find(tuple);
+    if (index.has_value()) {
+        const uint32_t i = index.value();
+        _catch_up(i);
+        _slots[i].connection->segment_received(seg);
+        _mark_dirty(i);
+        if (_slots[i].spawned and not _slots[i].in_accept_queue) {
+            _promote_if_established(i);
+        }
+        return;
+    }
+
+    const TCPHeader &header = seg.header();
+    const auto listener = _listeners.find(tuple.local_port);
+    if (listener != _listeners.end() and header.syn and not header.ack and not header.rst) {
+        const bool full = _half_open >= _half_open_limit or listener->second.queued >= listener->second.backlog;
+        if (_syn_cookies == SynCookies::Always or (full and _syn_cookies == SynCookies::WhenFull)) {
+            _send_cookie(tuple, seg);
+            return;
+        }
+        if (full) {
+            return;
+        }
+        listener->second.queued++;
+        _half_open++;
+        const ConnectionId id = _create(tuple, _cfg);
+        _slots[id.index].spawned = true;
+        _slots[id.index].connection->segment_received(seg);
+        _mark_dirty(id.index);
+        return;
+    }
+
+    // an ACK that doesn't carry a valid cookie may still belong to one whose first ACK was lost
+    // or reordered, so it is dropped rather than reset
+    if (listener != _listeners.end() and header.ack and not header.syn and not header.rst and
+        _syn_cookies != SynCookies::Never) {
+        _accept_cookie(tuple, seg);
+        return;
+    }
+
+    _send_reset(tuple, seg);
+}
+
+void TCPMultiplexer::tick(const size_t ms_since_last_tick) {
+    _refresh_timers();
+    _time_ms += ms_since_last_tick;
+    _timers.advance(ms_since_last_tick, [&](const ConnectionId id) { _due.push_back(id); });
+    for (const ConnectionId id : _due) {
+        if (alive(id)) {
+            _catch_up(id.index);
+            _mark_dirty(id.index);
+        }
+    }
+    _due.clear();
+}
+
+optional<uint64_t> TCPMultiplexer::time_until_next_timer() const {
+    _refresh_timers();
+    return _timers.time_until_next();
+}
+
+//! \details Collects the segments of every connection touched since the last call, and drops
+//! those connections that are no longer active and that the owner doesn't hold (because it
+//! never accepted them, or release()d them).
+vector<OutboundSegment> &TCPMultiplexer::segments_out() {
+    for (const uint32_t index : _dirty) {
+        Slot &slot = _slots[index];
+        slot.dirty = false;
+        if (not slot.connection) {
+            continue;
+        }
+        _collect(index);
+        if (not slot.connection->active() and (slot.released or not slot.handed_out)) {
+            _reap(index);
+        }
+    }
+    _dirty.clear();
+    return _segments_out;
+}
+
+ConnectionId TCPMultiplexer::_create(const FourTuple &tuple, const TCPConfig &cfg) {
+    uint32_t index = 0;
+    if (not _free_slots.empty()) {
+        index = _free_slots.back();
+        _free_slots.pop_back();
+    } else {
+        index = _slots.size();
+        _slots.emplace_back();
+    }
+    Slot &slot = _slots[index];
+    slot.connection = make_unique<TCPConnection>(cfg);
+    slot.tuple = tuple;
+    slot.spawned = slot.in_accept_queue = slot.handed_out = slot.released = false;
+    slot.last_tick = _time_ms;
+    _table.insert(tuple, index);
+    return {index, slot.generation};
+}
+
+void TCPMultiplexer::_mark_dirty(const uint32_t index) {
+    Slot &slot = _slots[index];
+    if (not slot.dirty) {
+        slot.dirty = true;
+        _dirty.push_back(index);
+    }
+    if (not slot.retime) {
+        slot.retime = true;
+        _retime.push_back(index);
+    }
+}
+
+//! \details Ticks the connection by the time that has passed since it was last ticked, so that it
+//! sees the time (and any deadline) it would have seen had it been ticked along with every tick().
+void TCPMultiplexer::_catch_up(const uint32_t index) {
+    Slot &slot = _slots[index];
+    if (slot.last_tick != _time_ms) {
+        slot.connection->tick(_time_ms - slot.last_tick);
+        slot.last_tick = _time_ms;
+    }
+}
+
+//! \details Moves the timer of each connection touched since its timer was last set to the
+//! connection's next deadline (its own timers count from when it was last ticked).
+void TCPMultiplexer::_refresh_timers() const {
+    for (const uint32_t index : _retime) {
+        const Slot &slot = _slots[index];
+        slot.retime = false;
+        if (not slot.connection) {
+            continue;
+        }
+        const auto deadline = slot.connection->time_until_next_timer();
+        if (not deadline.has_value()) {
+            _timers.cancel(slot.timer);
+            continue;
+        }
+        const uint64_t since_tick = _time_ms - slot.last_tick;
+        const uint64_t remaining = deadline.value() > since_tick ? deadline.value() - since_tick : 0;
+        if (_timers.time_until(slot.timer) != max<uint64_t>(remaining, 1)) {
+            _timers.cancel(slot.timer);
+            slot.timer = _timers.arm(remaining, {index, slot.generation});
+        }
+    }
+    _retime.clear();
+}
+
+//! \details Moves the connection's segments to the shared batch, filling in the ports.
+void TCPMultiplexer::_collect(const uint32_t index) {
+    Slot &slot = _slots[index];
+    for (TCPSegment &segment : slot.connection->segments_out()) {
+        segment.header().sport = slot.tuple.local_port;
+        segment.header().dport = slot.tuple.remote_port;
+        _segments_out.push_back({slot.tuple, move(segment)});
+    }
+    slot.connection->segments_out().clear();
+}
+
+void TCPMultiplexer::_reap(const uint32_t index) {
+    Slot &slot = _slots[index];
+    _half_open_done(slot);
+    if (slot.spawned) {
+        const auto listener = _listeners.find(slot.tuple.local_port);
+        if (listener != _listeners.end() and listener->second.queued > 0) {
+            listener->second.queued--;
+        }
+    }
+    _table.erase(slot.tuple);
+    _timers.cancel(slot.timer);
+    slot.connection.reset();
+    slot.generation++;
+    _free_slots.push_back(index);
+}
+
+//! \details A spawned connection joins the accept queue once the peer has acknowledged our SYN
+//! (it may already have sent data, or even its FIN). One that was reset first is left to be reaped.
+void TCPMultiplexer::_promote_if_established(const uint32_t index) {
+    Slot &slot = _slots[index];
+    if (not slot.connection->active()) {
+        return;
+    }
+    const TCPState state = slot.connection->state();
+    if (state == TCPState::State::LISTEN or state == TCPState::State::SYN_RCVD) {
+        return;
+    }
+    _half_open_done(slot);
+    slot.in_accept_queue = true;
+    _accept_queue.push_back({index, slot.generation});
+}
+
+void TCPMultiplexer::_half_open_done(Slot &slot) {
+    if (slot.spawned and not slot.in_accept_queue and _half_open > 0) {
+        _half_open--;
+    }
+}
+
+//! \details Follows [RFC 793](\ref rfc::rfc793), section 3.4: if the offending segment carries an
+//! ACK, the RST takes its sequence number from that ackno; otherwise the RST has sequence number
+//! zero and acknowledges everything the segment occupied. A RST is never answered.
+void TCPMultiplexer::_send_reset(const FourTuple &tuple, const TCPSegment &seg) {
+    const TCPHeader &header = seg.header();
+    if (header.rst) {
+        return;
+    }
+    TCPSegment rst;
+    rst.header().rst = true;
+    rst.header().sport = tuple.local_port;
+    rst.header().dport = tuple.remote_port;
+    if (header.ack) {
+        rst.header().seqno = header.ackno;
+    } else {
+        rst.header().ack = true;
+        rst.header().ackno = header.seqno + seg.length_in_sequence_space();
+    }
+    _segments_out.push_back({tuple, move(rst)});
+}
+
+//! \details Folds the key, the connection's addresses and ports, the peer's ISN and the cookie
+//! counter together with a multiply-xorshift mixer, and keeps the low 24 bits.
+uint32_t TCPMultiplexer::_cookie_hash(const FourTuple &tuple,
+                                      const WrappingInt32 peer_isn,
+                                      const uint32_t counter) const {
+    uint64_t h = _cookie_key[0];
+    for (const uint64_t word : {(uint64_t{tuple.local_address} << 32) | tuple.remote_address,
+                                (uint64_t{tuple.local_port} << 48) | (uint64_t{tuple.remote_port} << 32) |
+                                    peer_isn.raw_value(),
+                                _cookie_key[1] ^ counter}) {
+        h ^= word;
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ull;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebull;
+        h ^= h >> 31;
+    }
+    return h & 0xffffff;
+}
+
+//! \details The cookie (our ISN) holds the low 8 bits of a counter that advances every
+//! COOKIE_PERIOD_MS in its top byte, and a 24-bit keyed hash below that. Linux spends 3 of
+//! these bits on the peer's MSS, but Sponge doesn't negotiate TCP options, so there is no
+//! MSS to remember.
+WrappingInt32 TCPMultiplexer::_make_cookie(const FourTuple &tuple, const WrappingInt32 peer_isn) const {
+    const uint32_t counter = (_time_ms / COOKIE_PERIOD_MS) & 0xff;
+    return WrappingInt32{(counter << 24) | _cookie_hash(tuple, peer_isn, counter)};
+}
+
+//! \returns `true` if `cookie` was made for this connection and peer ISN during the current or the previous period
+bool TCPMultiplexer::_check_cookie(const FourTuple &tuple,
+                                   const WrappingInt32 peer_isn,
+                                   const WrappingInt32 cookie) const {
+    const uint64_t now = _time_ms / COOKIE_PERIOD_MS;
+    const uint32_t counter = cookie.raw_value() >> 24;
+    const bool fresh = counter == (now & 0xff) or (now > 0 and counter == ((now - 1) & 0xff));
+    return fresh and (cookie.raw_value() & 0xffffff) == _cookie_hash(tuple, peer_isn, counter);
+}
+
+//! \details Sends the SYN-ACK a new connection would have sent, with the cookie as its sequence
+//! number, and forgets about it.
+void TCPMultiplexer::_send_cookie(const FourTuple &tuple, const TCPSegment &syn) {
+    TCPSegment syn_ack;
+    syn_ack.header().syn = true;
+    syn_ack.header().ack = true;
+    syn_ack.header().seqno = _make_cookie(tuple, syn.header().seqno);
+    syn_ack.header().ackno = syn.header().seqno + 1;
+    syn_ack.header().win = min(_cfg.recv_capacity, size_t{numeric_limits<uint16_t>::max()});
+    syn_ack.header().sport = tuple.local_port;
+    syn_ack.header().dport = tuple.remote_port;
+    _segments_out.push_back({tuple, move(syn_ack)});
+}
+
+//! \details If the ACK acknowledges a valid cookie, creates the connection with the cookie as its
+//! ISN, replays the peer's SYN into it (dropping the SYN-ACK it answers with, which the peer
+//! already has), and then delivers the ACK, which completes the handshake. The rebuilt SYN-ACK
+//! counts as retransmitted: it was really sent when the cookie was, so the ACK gives no RTT sample
+//! (the cookie only dates it to within COOKIE_PERIOD_MS).
+//! \returns `true` if the ACK was for a valid cookie (even if the backlog had no room for the connection)
+bool TCPMultiplexer::_accept_cookie(const FourTuple &tuple, const TCPSegment &ack) {
+    const WrappingInt32 peer_isn = ack.header().seqno - 1;
+    const WrappingInt32 cookie = ack.header().ackno - 1;
+    if (not _check_cookie(tuple, peer_isn, cookie)) {
+        return false;
+    }
+
+    // no room: drop the ACK, the peer will retransmit
+    Listener &listener = _listeners.at(tuple.local_port);
+    if (listener.queued >= listener.backlog) {
+        return true;
+    }
+    listener.queued++;
+    _half_open++;
+
+    TCPConfig cfg = _cfg;
+    cfg.fixed_isn = cookie;
+    const ConnectionId id = _create(tuple, cfg);
+    Slot &slot = _slots[id.index];
+    slot.spawned = true;
+
+    TCPSegment syn;
+    syn.header().syn = true;
+    syn.header().seqno = peer_isn;
+    syn.header().win = ack.header().win;
+    slot.connection->segment_received(syn);
+    slot.connection->segments_out().clear();
+    slot.connection->mark_in_flight_retransmitted();
+
+    slot.connection->segment_received(ack);
+    _mark_dirty(id.index);
+    _promote_if_established(id.index);
+    return true;
+}
+
+TCPMultiplexer::Slot &TCPMultiplexer::_slot(const ConnectionId id) {
+    if (not alive(id)) {
+        throw runtime_error("TCPMultiplexer: connection is no longer alive");
+    }
+    return _slots[id.index];
+}
+
+const TCPMultiplexer::Slot &TCPMultiplexer::_slot(const ConnectionId id) const {
+    if (not alive(id)) {
+        throw runtime_error("TCPMultiplexer: connection is no longer alive");
+    }
+    return _slots[id.index];
+}
@@ -0,0 +1,214 @@
+#ifndef SPONGE_LIBSPONGE_TCP_MULTIPLEXER_HH
+#define SPONGE_LIBSPONGE_TCP_MULTIPLEXER_HH
+
+#include "connection_table.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_segment.hh"
+#include "timer_wheel.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+
+//! \brief Names a connection owned by a TCPMultiplexer
+//! \details Ids stay safe to use after the connection is gone: TCPMultiplexer::alive() returns `false`.
+struct ConnectionId {
+    uint32_t index{0};       //!< slot in the multiplexer's connection table
+    uint32_t generation{0};  //!< generation of that slot when the connection was created (0 = none)
+
+    bool operator==(const ConnectionId &other) const {
+        return index == other.index and generation == other.generation;
+    }
+    bool operator!=(const ConnectionId &other) const { return not(*this == other); }
+};
+
+//! \brief A TCP segment to be sent, with the addresses and ports it travels between
+struct OutboundSegment {
+    FourTuple tuple{};     //!< the connection, seen from our end
+    TCPSegment segment{};  //!< the segment (its ports are filled in from `tuple`)
+};
+
+//! \brief Runs many TCPConnection objects over one datagram interface
+//!
+//! Incoming segments are handed to segment_received() along with their FourTuple, and are
+//! routed to the matching connection through a ConnectionTable. A SYN for a port that is
+//! listen()ing spawns a new connection, which is queued for accept() once its handshake
+//! completes. Segments for no connection are answered with a RST, as in
+//! [RFC 793](\ref rfc::rfc793), section 3.4.
+//!
+//! The multiplexer does no I/O: the owner reads datagrams (e.g. with
+//! TCPOverIPv4Adapter::unwrap_tcp_in_ip_any), passes their segments in, and sends what
+//! segments_out() collects, so a single adapter and event loop can serve every connection
+//! (as TCPSpongeListener does, over a UDP socket).
+//!
+//! To keep a SYN flood from tying up memory, the number of half-open connections (SYN received,
+//! handshake not complete) is bounded, and past that bound the multiplexer answers SYNs with
+//! SYN cookies: the SYN-ACK's sequence number encodes a keyed hash of the connection and a
+//! coarse timestamp, and nothing is stored until an ACK echoes a valid cookie back.
+class TCPMultiplexer {
+  public:
+    //! Number of connections a listener queues (handshaking or waiting for accept) unless told otherwise
+    static constexpr size_t DEFAULT_BACKLOG = 128;
+
+    //! Number of half-open connections kept, across all listeners, unless told otherwise
+    static constexpr size_t DEFAULT_HALF_OPEN_LIMIT = 256;
+
+    //! When to answer a SYN with a SYN cookie instead of creating a connection
+    enum class SynCookies {
+        Never,     //!< Never; SYNs beyond the half-open limit are dropped
+        WhenFull,  //!< Once the half-open limit (or the listener's backlog) has been reached
+        Always     //!< For every SYN, so no state is kept for any half-open connection
+    };
+
+    //! A SYN cookie stays valid for between COOKIE_PERIOD_MS and 2 * COOKIE_PERIOD_MS milliseconds
+    static constexpr uint64_t COOKIE_PERIOD_MS = 64 * 1000;
+
+  private:
+    //! A connection and its bookkeeping
+    struct Slot {
+        std::unique_ptr<TCPConnection> connection{};  //!< (on the heap, so that growing _slots never moves it)
+        FourTuple tuple{};
+        uint32_t generation{1};
+        bool dirty{false};            //!< may have segments that haven't been collected into _segments_out
+        bool spawned{false};          //!< created by a listener and not yet accepted (counts toward its backlog)
+        bool in_accept_queue{false};  //!< handshake done, waiting for accept()
+        bool handed_out{false};       //!< returned by connect() or accept()
+        bool released{false};         //!< the owner is done with it; reap it once it is no longer active
+        mutable bool retime{false};   //!< may have changed its next deadline since its timer was last set
+        uint64_t last_tick{0};        //!< multiplexer time (_time_ms) up to which the connection has been ticked
+        mutable TimerId timer{};      //!< on _timers, at the connection's next deadline (if it has one)
+    };
+
+    //! A listening port
+    struct Listener {
+        size_t backlog;  //!< most connections that may be handshaking or waiting in the accept queue
+        size_t queued;   //!< connections currently handshaking or waiting in the accept queue
+    };
+
+    TCPConfig _cfg;
+    std::vector<Slot> _slots{};
+    std::vector<uint32_t> _free_slots{};
+    ConnectionTable _table{};
+    std::map<uint16_t, Listener> _listeners{};
+    std::deque<ConnectionId> _accept_queue{};
+    std::vector<uint32_t> _dirty{};
+    std::vector<OutboundSegment> _segments_out{};
+
+    //! \name Timers
+    //! Each connection with a deadline has a timer on the wheel, so tick() only visits the connections that
+    //! are due, and time_until_next_timer() only asks the wheel. A connection is ticked (by the time passed
+    //! since it last was) when its timer fires, and before anything else is done with it. The timers of
+    //! connections touched since they were last set are brought up to date lazily (even by a const query).
+    //!@{
+    mutable TimerWheel<ConnectionId> _timers{};
+    mutable std::vector<uint32_t> _retime{};
+    std::vector<ConnectionId> _due{};  //!< (reused by tick())
+    //!@}
+
+    SynCookies _syn_cookies{SynCookies::WhenFull};
+    size_t _half_open_limit{DEFAULT_HALF_OPEN_LIMIT};
+    size_t _half_open{0};                   //!< spawned connections whose handshake hasn't completed
+    uint64_t _time_ms{0};                   //!< total milliseconds passed to tick(); dates timers and SYN cookies
+    std::array<uint64_t, 2> _cookie_key{};  //!< secret key for the SYN cookie hash
+
+    ConnectionId _create(const FourTuple &tuple, const TCPConfig &cfg);
+    void _mark_dirty(const uint32_t index);
+    void _catch_up(const uint32_t index);
+    void _refresh_timers() const;
+    void _collect(const uint32_t index);
+    void _reap(const uint32_t index);
+    void _promote_if_established(const uint32_t index);
+    void _send_reset(const FourTuple &tuple, const TCPSegment &seg);
+    void _half_open_done(Slot &slot);
+
+    //! \name SYN cookies
+    //!@{
+    uint32_t _cookie_hash(const FourTuple &tuple, const WrappingInt32 peer_isn, const uint32_t counter) const;
+    WrappingInt32 _make_cookie(const FourTuple &tuple, const WrappingInt32 peer_isn) const;
+    bool _check_cookie(const FourTuple &tuple, const WrappingInt32 peer_isn, const WrappingInt32 cookie) const;
+    void _send_cookie(const FourTuple &tuple, const TCPSegment &syn);
+    bool _accept_cookie(const FourTuple &tuple, const TCPSegment &ack);
+    //!@}
+    Slot &_slot(const ConnectionId id);
+    const Slot &_slot(const ConnectionId id) const;
+
+  public:
+    //! \brief Construct with the configuration for every connection
+    explicit TCPMultiplexer(const TCPConfig &cfg);
+
+    //! \name Listening
+    //!@{
+
+    //! \brief Accept connections to a local port
+    void listen(const uint16_t port, const size_t backlog = DEFAULT_BACKLOG);
+
+    //! \brief Stop accepting connections to a local port (connections already made are unaffected)
+    void stop_listening(const uint16_t port) { _listeners.erase(port); }
+
+    //! \brief Take the next established connection made to a listening port, if any
+    std::optional<ConnectionId> accept();
+
+    //! \brief Choose when SYNs are answered with SYN cookies
+    void set_syn_cookies(const SynCookies mode) { _syn_cookies = mode; }
+
+    //! \brief Bound the number of half-open connections (across all listeners)
+    void set_half_open_limit(const size_t limit) { _half_open_limit = limit; }
+
+    //! \brief Number of half-open connections currently held
+    size_t half_open() const { return _half_open; }
+    //!@}
+
+    //! \brief Open a connection (sends a SYN)
+    //! \throws std::runtime_error if the FourTuple is already in use
+    ConnectionId connect(const FourTuple &tuple);
+
+    //! \brief Is the connection still held by the multiplexer?
+    bool alive(const ConnectionId id) const;
+
+    //! \brief Access a connection (any segments it produces are collected by segments_out())
+    //! \throws std::runtime_error if the connection is no longer alive()
+    TCPConnection &connection(const ConnectionId id);
+
+    //! \brief Look at a connection, without catching it up on the time since it was last touched
+    //! \throws std::runtime_error if the connection is no longer alive()
+    const TCPConnection &connection(const ConnectionId id) const { return *_slot(id).connection; }
+
+    //! \brief The addresses and ports of a connection
+    const FourTuple &tuple(const ConnectionId id) const { return _slot(id).tuple; }
+
+    //! \brief Tell the multiplexer the owner is done with a connection
+    //! \details The connection is dropped once it is no longer active (right away if it already
+    //! isn't); until then it keeps running, e.g. to finish a clean shutdown.
+    void release(const ConnectionId id);
+
+    //! \brief Number of connections held (including those still handshaking)
+    size_t size() const { return _table.size(); }
+
+    //! \name Methods for the owner or operating system to call
+    //!@{
+
+    //! \brief Route a segment received from the network
+    //! \param[in] tuple the segment's addresses and ports, seen from our end (local = destination)
+    //! \param[in] seg the segment
+    void segment_received(const FourTuple &tuple, const TCPSegment &seg);
+
+    //! \brief Advance the clock, ticking the connections that have a deadline by then
+    //! \details Takes time proportional to the number of connections due, not the number held.
+    void tick(const size_t ms_since_last_tick);
+
+    //! \brief Milliseconds until tick() next has something to do, or empty if no timer is armed
+    std::optional<uint64_t> time_until_next_timer() const;
+
+    //! \brief Segments all the connections want sent, oldest first
+    //! \note The owner sends each one (moving from it is fine) and then clear()s the batch.
+    std::vector<OutboundSegment> &segments_out();
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_TCP_MULTIPLEXER_HH
@@ -40,6 +40,11 @@ optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram
         return {};
     }
 
+    // a look at the TCP header first, to drop unrelated segments before parsing and checksumming them
+    if (const TCPSegmentView seg_view{ip_dgram.payload()}; seg_view.complete() and not _might_accept(seg_view)) {
+        return {};
+    }
+
     // is the payload a valid TCP segment?
     TCPSegment tcp_seg;
     if (ParseResult::NoError != tcp_seg.parse(ip_dgram.payload(), ip_dgram.header().pseudo_cksum())) {
@@ -70,17 +75,80 @@ optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram
     return tcp_seg;
 }
 
+//! \details Checks the same addresses, protocol and ports as unwrap_tcp_in_ip() (and, while
+//! listening, the SYN and RST flags) by reading them from the raw headers, so that an adapter can
+//! drop unrelated traffic for a few loads instead of a parse and a checksum. It doesn't check that
+//! the datagram is valid, and answers `true` when the headers aren't all there to look at.
+bool TCPOverIPv4Adapter::might_accept(const IPv4View &dgram) const {
+    if (not dgram.complete()) {
+        return true;
+    }
+
+    if (not listening() and (dgram.dst() != config().source.ipv4_numeric() or
+                             dgram.src() != config().destination.ipv4_numeric())) {
+        return false;
+    }
+
+    if (dgram.proto() != IPv4Header::PROTO_TCP) {
+        return false;
+    }
+
+    const TCPSegmentView seg{dgram.payload()};
+    return not seg.complete() or _might_accept(seg);
+}
+
+bool TCPOverIPv4Adapter::_might_accept(const TCPSegmentView &seg) const {
+    if (seg.dport() != config().source.port()) {
+        return false;
+    }
+    if (listening()) {
+        return seg.syn() and not seg.rst();
+    }
+    return seg.sport() == config().destination.port();
+}
+
 //! Takes a TCP segment, sets port numbers as necessary, and wraps it in an IPv4 datagram
 //! \param[in] seg is the TCP segment to convert
 InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip(TCPSegment &seg) {
+    return wrap_tcp_in_ip({config().source.ipv4_numeric(),
+                           config().source.port(),
+                           config().destination.ipv4_numeric(),
+                           config().destination.port()},
+                          seg);
+}
+
+//! \details Unlike unwrap_tcp_in_ip(), this accepts a TCP segment between any addresses and ports;
+//! the caller finds the connection it belongs to from the returned FourTuple, whose local end is
+//! the datagram's destination.
+//! \returns the FourTuple and the segment, or an empty optional if the datagram doesn't hold a valid TCP segment
+optional<pair<FourTuple, TCPSegment>> TCPOverIPv4Adapter::unwrap_tcp_in_ip_any(const InternetDatagram &ip_dgram) {
+    // does the IPv4 datagram claim that its payload is a TCP segment?
+    if (ip_dgram.header().proto != IPv4Header::PROTO_TCP) {
+        return {};
+    }
+
+    // is the payload a valid TCP segment?
+    TCPSegment tcp_seg;
+    if (ParseResult::NoError != tcp_seg.parse(ip_dgram.payload(), ip_dgram.header().pseudo_cksum())) {
+        return {};
+    }
+
+    const FourTuple tuple{
+        ip_dgram.header().dst, tcp_seg.header().dport, ip_dgram.header().src, tcp_seg.header().sport};
+    return make_pair(tuple, move(tcp_seg));
+}
+
+//! \param[in] tuple names the connection: the datagram goes from its local end to its remote end
+//! \param[in] seg is the TCP segment to convert; its port numbers are set from `tuple`
+InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip(const FourTuple &tuple, TCPSegment &seg) {
     // set the port numbers in the TCP segment
-    seg.header().sport = config().source.port();
-    seg.header().dport = config().destination.port();
+    seg.header().sport = tuple.local_port;
+    seg.header().dport = tuple.remote_port;
 
     // create an Internet Datagram and set its addresses and length
     InternetDatagram ip_dgram;
-    ip_dgram.header().src = config().source.ipv4_numeric();
-    ip_dgram.header().dst = config().destination.ipv4_numeric();
+    ip_dgram.header().src = tuple.local_address;
+    ip_dgram.header().dst = tuple.remote_address;
     ip_dgram.header().len = ip_dgram.header().hlen * 4 + seg.header().doff * 4 + seg.payload().size();
 
     // set payload, calculating TCP checksum using information from IP header
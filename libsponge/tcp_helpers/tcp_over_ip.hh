@@ -2,18 +2,38 @@
 #define SPONGE_LIBSPONGE_TCP_OVER_IP_HH
 
 #include "buffer.hh"
+#include "connection_table.hh"
 #include "fd_adapter.hh"
 #include "ipv4_datagram.hh"
+#include "packet_views.hh"
 #include "tcp_segment.hh"
 
 #include <optional>
+#include <utility>
 
 //! \brief A converter from TCP segments to serialized IPv4 datagrams
 class TCPOverIPv4Adapter : public FdAdapterBase {
+  private:
+    //! Could `seg` be for the current connection? (see might_accept())
+    bool _might_accept(const TCPSegmentView &seg) const;
+
   public:
     std::optional<TCPSegment> unwrap_tcp_in_ip(const InternetDatagram &ip_dgram);
 
+    //! \brief Could unwrap_tcp_in_ip() accept the datagram that `dgram` views? (without parsing it)
+    bool might_accept(const IPv4View &dgram) const;
+
     InternetDatagram wrap_tcp_in_ip(TCPSegment &seg);
+
+    //! \name Connection-agnostic versions, for serving many connections (see TCPMultiplexer)
+    //!@{
+
+    //! \brief Parse the TCP segment in any IPv4 datagram, along with its FourTuple (seen from the receiving end)
+    static std::optional<std::pair<FourTuple, TCPSegment>> unwrap_tcp_in_ip_any(const InternetDatagram &ip_dgram);
+
+    //! \brief Wrap a TCP segment in an IPv4 datagram for the connection named by `tuple`
+    static InternetDatagram wrap_tcp_in_ip(const FourTuple &tuple, TCPSegment &seg);
+    //!@}
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_OVER_IP_HH
@@ -3,22 +3,30 @@
 #include "parser.hh"
 #include "util.hh"
 
+#include <stdexcept>
 #include <variant>
 
 using namespace std;
 
-//! \param[in] buffer string/Buffer to be parsed
+//! \param[in] buffer string/Buffer/BufferList to be parsed
 //! \param[in] datagram_layer_checksum pseudo-checksum from the lower-layer protocol
-ParseResult TCPSegment::parse(const Buffer buffer, const uint32_t datagram_layer_checksum) {
+//! \details The payload is a view of the bytes after the header, unless they are split across
+//! Buffers, in which case they are copied into one.
+ParseResult TCPSegment::parse(const BufferList &buffer, const uint32_t datagram_layer_checksum) {
     InternetChecksum check(datagram_layer_checksum);
-    check.add(buffer);
+    for (const auto &buf : buffer.buffers()) {
+        check.add(buf);
+    }
     if (check.value()) {
         return ParseResult::BadChecksum;
     }
 
     NetParser p{buffer};
-    _header.parse(p);
-    _payload = p.buffer();
+    if (const ParseResult header_result = _header.parse(p); header_result != ParseResult::NoError) {
+        return header_result;
+    }
+    const BufferList &rest = p.buffer();
+    _payload = rest.buffers().size() > 1 ? Buffer{rest.concatenate()} : Buffer{rest};
     return p.get_error();
 }
 
@@ -27,19 +35,36 @@ size_t TCPSegment::length_in_sequence_space() const {
 }
 
 //! \param[in] datagram_layer_checksum pseudo-checksum from the lower-layer protocol
+//! \details The header goes in front of the payload, in its Slab's headroom if it has any free
+//! (see PacketBuffer), so the segment is one contiguous Buffer.
 BufferList TCPSegment::serialize(const uint32_t datagram_layer_checksum) const {
     TCPHeader header_out = _header;
     header_out.cksum = 0;
 
-    // calculate checksum -- taken over entire segment
+    BufferList ret{_payload};
+    const size_t header_length = 4 * size_t{header_out.doff};
+    char *const header_bytes = ret.prepend(header_length);
+    ByteSpan header_span{header_bytes, header_length};
+    header_out.serialize(header_span);
+
+    // calculate checksum -- taken over entire segment -- and fill it in
     InternetChecksum check(datagram_layer_checksum);
-    check.add(header_out.serialize());
+    check.add({header_bytes, header_length});
     check.add(_payload);
-    header_out.cksum = check.value();
-
-    BufferList ret;
-    ret.append(header_out.serialize());
-    ret.append(_payload);
+    TCPHeader::Wire::Checksum::store(header_bytes, check.value());
 
     return ret;
 }
+
+void TCPSegment::checkpoint(CheckpointWriter &out) const {
+    out.put_bytes(_header.serialize());
+    out.put_bytes(_payload.str());
+}
+
+void TCPSegment::restore(CheckpointReader &in) {
+    NetParser p{Buffer{in.get_bytes()}};
+    if (_header.parse(p) != ParseResult::NoError) {
+        throw runtime_error("checkpoint holds a malformed TCP header");
+    }
+    _payload = Buffer{in.get_bytes()};
+}
@@ -2,6 +2,7 @@
 #define SPONGE_LIBSPONGE_TCP_SEGMENT_HH
 
 #include "buffer.hh"
+#include "checkpoint.hh"
 #include "tcp_header.hh"
 
 #include <cstdint>
@@ -14,7 +15,7 @@ class TCPSegment {
 
   public:
     //! \brief Parse the segment from a string
-    ParseResult parse(const Buffer buffer, const uint32_t datagram_layer_checksum = 0);
+    ParseResult parse(const BufferList &buffer, const uint32_t datagram_layer_checksum = 0);
 
     //! \brief Serialize the segment to a string
     BufferList serialize(const uint32_t datagram_layer_checksum = 0) const;
@@ -31,6 +32,12 @@ class TCPSegment {
     //! \brief Segment's length in sequence space
     //! \note Equal to payload length plus one byte if SYN is set, plus one byte if FIN is set
     size_t length_in_sequence_space() const;
+
+    //! \brief Append the header (in wire format, checksum as stored) and payload to a checkpoint
+    void checkpoint(CheckpointWriter &out) const;
+
+    //! \brief Replace the segment with one read from a checkpoint
+    void restore(CheckpointReader &in);
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_SEGMENT_HH
@@ -0,0 +1,427 @@
+#include "tcp_sponge_listener.hh"
+
+#include "buffer_pool.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <endian.h>
+#include <exception>
+#include <iostream>
+#include <netinet/in.h>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <unordered_map>
+#include <utility>
+
+using namespace std;
+
+//! Did a read or write fail only because the (non-blocking) fd wasn't ready?
+static bool would_block(const unix_error &e) { return e.code().value() == EAGAIN; }
+
+//! The IPv4 address and port (in host byte order) of `address`, without a trip through getnameinfo()
+static pair<uint32_t, uint16_t> ipv4_endpoint(const Address &address) {
+    sockaddr_in ipv4_addr{};
+    if (address.size() != sizeof(ipv4_addr)) {
+        throw runtime_error("TCPSpongeListener: " + address.to_string() + " is not an IPv4 address");
+    }
+    memcpy(&ipv4_addr, static_cast<const sockaddr *>(address), sizeof(ipv4_addr));
+    return {be32toh(ipv4_addr.sin_addr.s_addr), be16toh(ipv4_addr.sin_port)};
+}
+
+//! \details Every member is touched only on the thread of the shard's loop. The loop's rules and
+//! timer keep the shard alive until it has stopped and the loop has dropped them.
+class TCPSpongeListener::Shard : public enable_shared_from_this<Shard> {
+  private:
+    static constexpr size_t RECV_BATCH = 32;  //!< Most datagrams received with one system call
+
+    //! Most datagrams read per wakeup, so a flood of them can't starve the connections' streams
+    static constexpr size_t MAX_DATAGRAMS_PER_WAKEUP = 64;
+
+    //! An accepted connection, and the loop's end of the owner's LocalStreamSocket
+    struct Session {
+        ConnectionId id;
+        LocalStreamSocket data;
+        bool outbound_shutdown{false};  //!< has the owner's end reached EOF (ending the outbound stream)?
+        bool inbound_shutdown{false};   //!< has the whole inbound stream been passed on to the owner?
+        bool released{false};           //!< has the connection been handed back to the multiplexer?
+    };
+
+    UDPSocket _socket;
+    uint32_t _local_address;  //!< the socket's address, as the local end of every connection's FourTuple
+    uint16_t _local_port;     //!< the socket's port, likewise
+
+    TCPMultiplexer _multiplexer;
+
+    EventLoopGroup &_group;
+    size_t _index;  //!< of the shard's loop in the group
+    EventLoop *_loop{nullptr};
+    shared_ptr<AcceptQueue> _accepted;
+
+    unordered_map<uint32_t, shared_ptr<Session>> _sessions{};  //!< (by connection index)
+
+    //! EventLoop timer set for the multiplexer's next deadline, if any (reset when it fires)
+    optional<EventLoop::TimerId> _deadline{};
+
+    uint64_t _deadline_ms{0};  //!< When the deadline timer is due, in timestamp_ms() time
+    uint64_t _base_time{0};    //!< When the multiplexer was last ticked, in timestamp_ms() time
+
+    //! Slabs to receive datagrams into
+    BufferPool _pool{65536, 2 * RECV_BATCH};
+
+    //! The last batch of datagrams received
+    vector<UDPSocket::received_buffer> _received{RECV_BATCH, {{nullptr, 0}, {}, 0}};
+
+    bool _send_blocked{false};  //!< Did the socket run out of room with segments still to send?
+    bool _stopped{false};
+
+    void _receive_datagrams();
+    void _send_segments();
+    void _hand_out_accepted();
+    void _add_session_rules(const shared_ptr<Session> &session);
+    void _finish_if_done(Session &session);
+    void _schedule_deadline();
+    void _after_event();
+
+  public:
+    Shard(UDPSocket &&socket,
+          const TCPConfig &cfg,
+          const size_t backlog,
+          EventLoopGroup &group,
+          const size_t index,
+          const shared_ptr<AcceptQueue> &accepted);
+
+    //! Add the shard's rules to its loop (on the loop's thread)
+    void start(EventLoop &loop);
+
+    //! Close the socket and the connections, and stop using the loop (on the loop's thread)
+    void stop();
+
+    size_t index() const { return _index; }
+
+    Shard(const Shard &) = delete;
+    Shard &operator=(const Shard &) = delete;
+};
+
+TCPSpongeListener::Shard::Shard(UDPSocket &&socket,
+                                const TCPConfig &cfg,
+                                const size_t backlog,
+                                EventLoopGroup &group,
+                                const size_t index,
+                                const shared_ptr<AcceptQueue> &accepted)
+    : _socket(move(socket))
+    , _local_address(ipv4_endpoint(_socket.local_address()).first)
+    , _local_port(ipv4_endpoint(_socket.local_address()).second)
+    , _multiplexer(cfg)
+    , _group(group)
+    , _index(index)
+    , _accepted(accepted) {
+    _socket.set_blocking(false);
+    _multiplexer.listen(_local_port, backlog);
+}
+
+void TCPSpongeListener::Shard::start(EventLoop &loop) {
+    _loop = &loop;
+    _base_time = timestamp_ms();
+    const auto self = shared_from_this();
+
+    // rule 1: read datagrams, and route their segments to the connections
+    _loop->add_rule(
+        _socket,
+        Direction::In,
+        [self] {
+            if (not self->_stopped) {
+                self->_receive_datagrams();
+                self->_after_event();
+            }
+        },
+        [self] { return not self->_stopped; });
+
+    // rule 2: send the rest of the segments once the socket has room for them
+    _loop->add_rule(
+        _socket,
+        Direction::Out,
+        [self] {
+            if (not self->_stopped) {
+                self->_send_blocked = false;
+                self->_after_event();
+            }
+        },
+        [self] { return not self->_stopped and self->_send_blocked; });
+}
+
+//! \details Connections not yet accept()ed are left in the queue; their owner's ends read EOF.
+void TCPSpongeListener::Shard::stop() {
+    _stopped = true;
+    if (_deadline.has_value()) {
+        _loop->cancel_timer(_deadline.value());
+        _deadline.reset();
+    }
+    for (auto &[index, session] : _sessions) {
+        session->released = true;
+        session->data.close();
+        _group.release(_index);
+    }
+    _sessions.clear();
+    _socket.close();
+
+    lock_guard<mutex> lock(_accepted->mutex);
+    _accepted->running--;
+    _accepted->ready.notify_all();
+}
+
+//! \details Ticks the multiplexer, starts on the connections that became established, sends
+//! what all the connections touched have to send (in one pass), and moves the deadline timer.
+void TCPSpongeListener::Shard::_after_event() {
+    const auto next_time = timestamp_ms();
+    _multiplexer.tick(next_time - _base_time);
+    _base_time = next_time;
+
+    _hand_out_accepted();
+    _send_segments();
+    _schedule_deadline();
+}
+
+//! \details Segments that don't parse are dropped, as TCPOverUDPSocketAdapter::read() drops them.
+void TCPSpongeListener::Shard::_receive_datagrams() {
+    for (size_t taken = 0; taken < MAX_DATAGRAMS_PER_WAKEUP;) {
+        size_t count = 0;
+        try {
+            count = _socket.recv_batch(_pool, _received);
+        } catch (const unix_error &e) {
+            if (not would_block(e)) {
+                throw;
+            }
+            break;
+        }
+        for (size_t i = 0; i < count; i++) {
+            auto &datagram = _received[i];
+            TCPSegment seg;
+            if (seg.parse(move(datagram.payload), 0) != ParseResult::NoError) {
+                continue;
+            }
+            const auto [remote_address, remote_port] = ipv4_endpoint(datagram.source_address);
+            _multiplexer.segment_received({_local_address, _local_port, remote_address, remote_port}, seg);
+        }
+        taken += count;
+    }
+}
+
+//! \details Stops early if the socket can't take any more for now; rule 2 sends the rest once it can.
+void TCPSpongeListener::Shard::_send_segments() {
+    auto &batch = _multiplexer.segments_out();
+    if (_send_blocked) {
+        return;
+    }
+    size_t sent = 0;
+    try {
+        for (; sent < batch.size(); sent++) {
+            const FourTuple &tuple = batch[sent].tuple;
+            _socket.sendto(Address::from_ipv4_numeric(tuple.remote_address, tuple.remote_port),
+                           batch[sent].segment.serialize(0));
+        }
+    } catch (const unix_error &e) {
+        if (not would_block(e)) {
+            throw;
+        }
+        _send_blocked = true;
+    }
+    batch.erase(batch.begin(), batch.begin() + sent);
+}
+
+//! \details Each connection counts toward the loop's load from here until _finish_if_done(). Its
+//! rules are added by a task, as the loop can't take new rules while it runs the callbacks of others.
+void TCPSpongeListener::Shard::_hand_out_accepted() {
+    while (const auto id = _multiplexer.accept()) {
+        int fds[2];
+        SystemCall("socketpair", ::socketpair(AF_UNIX, SOCK_STREAM, 0, static_cast<int *>(fds)));
+        LocalStreamSocket owner_end{FileDescriptor(fds[0])};
+
+        auto session = make_shared<Session>(Session{id.value(), LocalStreamSocket{FileDescriptor(fds[1])}});
+        session->data.set_blocking(false);
+        _group.post(_index, [self = shared_from_this(), session](EventLoop &) {
+            if (not self->_stopped) {
+                self->_add_session_rules(session);
+            }
+        });
+        _sessions.emplace(id->index, session);
+        _group.acquire(_index);
+
+        lock_guard<mutex> lock(_accepted->mutex);
+        _accepted->sockets.push_back(move(owner_end));
+        _accepted->ready.notify_one();
+    }
+}
+
+//! \details The rules keep the Session alive until the loop drops them, which it does once
+//! _finish_if_done() (or stop()) has closed the loop's end of the socket.
+void TCPSpongeListener::Shard::_add_session_rules(const shared_ptr<Session> &session) {
+    const auto self = shared_from_this();
+
+    // read from the owner into the outbound stream
+    _loop->add_rule(
+        session->data,
+        Direction::In,
+        [self, session] {
+            if (session->released) {
+                return;
+            }
+            TCPConnection &connection = self->_multiplexer.connection(session->id);
+            const auto data = session->data.read(connection.remaining_outbound_capacity());
+            if (connection.write(data) != data.size()) {
+                throw runtime_error("TCPConnection::write() accepted less than advertised length");
+            }
+            if (session->data.eof()) {
+                connection.end_input_stream();
+                session->outbound_shutdown = true;
+                self->_finish_if_done(*session);
+            }
+            self->_after_event();
+        },
+        [self, session] {
+            if (session->released or session->outbound_shutdown) {
+                return false;
+            }
+            const TCPConnection &connection = as_const(self->_multiplexer).connection(session->id);
+            return connection.active() and connection.remaining_outbound_capacity() > 0;
+        },
+        [self, session] {
+            if (not session->released and not session->outbound_shutdown) {
+                self->_multiplexer.connection(session->id).end_input_stream();
+                session->outbound_shutdown = true;
+                self->_finish_if_done(*session);
+                self->_after_event();
+            }
+        });
+
+    // write from the inbound stream to the owner
+    _loop->add_rule(
+        session->data,
+        Direction::Out,
+        [self, session] {
+            if (session->released) {
+                return;
+            }
+            ByteStream &inbound = self->_multiplexer.connection(session->id).inbound_stream();
+            const size_t amount_to_write = min(size_t(65536), inbound.buffer_size());
+            inbound.pop_output(session->data.write(inbound.peek_output(amount_to_write), false));
+            if (inbound.eof() or inbound.error()) {
+                session->data.shutdown(SHUT_WR);
+                session->inbound_shutdown = true;
+                self->_finish_if_done(*session);
+            }
+            self->_after_event();
+        },
+        [self, session] {
+            if (session->released or session->inbound_shutdown) {
+                return false;
+            }
+            const ByteStream &inbound = as_const(self->_multiplexer).connection(session->id).inbound_stream();
+            return not inbound.buffer_empty() or inbound.eof() or inbound.error();
+        },
+        [self, session] {
+            // the owner has gone, so nothing more can be passed on
+            if (not session->released) {
+                session->inbound_shutdown = true;
+                self->_finish_if_done(*session);
+                self->_after_event();
+            }
+        });
+}
+
+//! \details Done with means the inbound stream has been passed on (or can't be), and either the
+//! outbound stream has ended or the connection is no longer active. The multiplexer keeps the
+//! connection until it is finished (e.g. still sending the outbound stream, or lingering).
+void TCPSpongeListener::Shard::_finish_if_done(Session &session) {
+    if (session.released or not session.inbound_shutdown) {
+        return;
+    }
+    if (not session.outbound_shutdown and as_const(_multiplexer).connection(session.id).active()) {
+        return;
+    }
+    session.released = true;
+    _multiplexer.release(session.id);
+    session.data.close();
+    _sessions.erase(session.id.index);
+    _group.release(_index);
+}
+
+//! \details Leaves the timer alone if the deadline hasn't moved, as TCPSpongeSocket does.
+void TCPSpongeListener::Shard::_schedule_deadline() {
+    const auto next = _multiplexer.time_until_next_timer();
+    const uint64_t now = timestamp_ms();
+    if (_deadline.has_value() and next.has_value() and now + next.value() == _deadline_ms) {
+        return;
+    }
+    if (_deadline.has_value()) {
+        _loop->cancel_timer(_deadline.value());
+        _deadline.reset();
+    }
+    if (next.has_value()) {
+        _deadline = _loop->add_timer(next.value(), [self = shared_from_this()] {
+            self->_deadline.reset();
+            self->_after_event();
+        });
+        _deadline_ms = now + next.value();
+    }
+}
+
+TCPSpongeListener::TCPSpongeListener(UDPSocket &&socket, const TCPConfig &cfg, const size_t backlog)
+    : _own_group(make_unique<EventLoopGroup>(1, false))
+    , _group(*_own_group)
+    , _accepted(make_shared<AcceptQueue>())
+    , _local_address(socket.local_address()) {
+    vector<UDPSocket> sockets;
+    sockets.push_back(move(socket));
+    _start(move(sockets), cfg, backlog);
+}
+
+//! \details Binds one socket per loop, the first to `address` and the rest to wherever it ended up.
+TCPSpongeListener::TCPSpongeListener(EventLoopGroup &group,
+                                     const Address &address,
+                                     const TCPConfig &cfg,
+                                     const size_t backlog)
+    : _own_group(), _group(group), _accepted(make_shared<AcceptQueue>()), _local_address(address) {
+    vector<UDPSocket> sockets(_group.size());
+    for (auto &socket : sockets) {
+        socket.set_reuseport();
+        socket.bind(_local_address);
+        _local_address = socket.local_address();
+    }
+    _start(move(sockets), cfg, backlog);
+}
+
+void TCPSpongeListener::_start(vector<UDPSocket> &&sockets, const TCPConfig &cfg, const size_t backlog) {
+    _accepted->running = sockets.size();
+    for (size_t index = 0; index < sockets.size(); index++) {
+        _shards.push_back(make_shared<Shard>(move(sockets[index]), cfg, backlog, _group, index, _accepted));
+        _group.post(index, [shard = _shards.back()](EventLoop &loop) { shard->start(loop); });
+    }
+}
+
+//! \details Stops each shard on its loop's thread, and waits until they all have.
+TCPSpongeListener::~TCPSpongeListener() {
+    try {
+        for (const auto &shard : _shards) {
+            _group.post(shard->index(), [shard](EventLoop &) { shard->stop(); });
+        }
+        unique_lock<mutex> lock(_accepted->mutex);
+        _accepted->ready.wait(lock, [&] { return _accepted->running == 0; });
+    } catch (const exception &e) {
+        cerr << "Exception destructing TCPSpongeListener: " << e.what() << endl;
+    }
+}
+
+LocalStreamSocket TCPSpongeListener::accept() {
+    unique_lock<mutex> lock(_accepted->mutex);
+    _accepted->ready.wait(lock, [&] { return not _accepted->sockets.empty() or _accepted->running == 0; });
+    if (_accepted->sockets.empty()) {
+        throw runtime_error("TCPSpongeListener::accept(): the listener has stopped");
+    }
+    LocalStreamSocket socket = move(_accepted->sockets.front());
+    _accepted->sockets.pop_front();
+    return socket;
+}
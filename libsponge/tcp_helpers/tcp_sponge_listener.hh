@@ -0,0 +1,96 @@
+#ifndef SPONGE_LIBSPONGE_TCP_SPONGE_LISTENER_HH
+#define SPONGE_LIBSPONGE_TCP_SPONGE_LISTENER_HH
+
+#include "address.hh"
+#include "eventloop_group.hh"
+#include "socket.hh"
+#include "tcp_config.hh"
+#include "tcp_multiplexer.hh"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//! \brief Serves many TCP connections over UDP, handing each to the owner as a LocalStreamSocket
+//!
+//! A TCPSpongeSocket runs one TCPConnection, with a thread and an adapter of its own. A
+//! TCPSpongeListener runs a TCPMultiplexer on an event loop: it reads the datagrams that arrive at a
+//! UDP socket, routes the segment in each to its connection, and sends every connection's segments
+//! out of the same socket. accept() hands the owner each connection whose handshake has completed,
+//! as a LocalStreamSocket that the loop pumps to and from the connection's streams, as a
+//! TCPSpongeSocket's thread does.
+//!
+//! On its own, a listener runs one socket on a thread of its own. On an EventLoopGroup, it runs a
+//! shard (a socket and a TCPMultiplexer) on each of the group's loops: the sockets share one
+//! address ([SO_REUSEPORT](\ref man7::socket)), so the kernel spreads the connections among them by
+//! their addresses and ports, and each connection is served start to finish by one loop, on one
+//! CPU. The connections a loop is serving count toward its EventLoopGroup::load().
+//!
+//! Segments travel in UDP payloads, as between two TCPOverUDPSocketAdapter peers, so the peers can
+//! be TCPOverUDPSpongeSockets. A connection is named by the UDP addresses and ports at its two ends
+//! (the ports in the TCP header, which such a peer leaves at 0, are not looked at).
+class TCPSpongeListener {
+  private:
+    class Shard;  //!< A socket, its TCPMultiplexer, and the connections on it, served by one loop
+
+    //! Connections established and not yet accept()ed (shared with the shards, which may outlive the listener)
+    struct AcceptQueue {
+        std::mutex mutex{};
+        std::condition_variable ready{};
+        std::deque<LocalStreamSocket> sockets{};
+        size_t running{0};  //!< shards not yet stopped (accept() gives up once there are none)
+    };
+
+    std::unique_ptr<EventLoopGroup> _own_group;  //!< a group of one loop, when not given a group
+    EventLoopGroup &_group;
+    std::shared_ptr<AcceptQueue> _accepted;
+    std::vector<std::shared_ptr<Shard>> _shards{};
+    Address _local_address;
+
+    //! Create a shard for each loop from its bound socket, and start them
+    void _start(std::vector<UDPSocket> &&sockets, const TCPConfig &cfg, const size_t backlog);
+
+  public:
+    //! \brief Serve connections to a bound UDP socket, on a thread of the listener's own, starting right away
+    //! \param[in] socket the bound socket, to receive on and send from
+    //! \param[in] cfg the configuration for every connection
+    //! \param[in] backlog most connections that may be handshaking or waiting for accept() at once
+    TCPSpongeListener(UDPSocket &&socket,
+                      const TCPConfig &cfg,
+                      const size_t backlog = TCPMultiplexer::DEFAULT_BACKLOG);
+
+    //! \brief Serve connections to `address` on every loop of `group`, starting right away
+    //! \param[in] group the loops to serve connections on (it must outlive the listener)
+    //! \param[in] address the address to bind (with port 0, the kernel picks one; see local_address())
+    //! \param[in] cfg the configuration for every connection
+    //! \param[in] backlog most connections that may be handshaking or waiting for accept() at once, per loop
+    TCPSpongeListener(EventLoopGroup &group,
+                      const Address &address,
+                      const TCPConfig &cfg,
+                      const size_t backlog = TCPMultiplexer::DEFAULT_BACKLOG);
+
+    //! \brief Wait for the next connection whose handshake has completed
+    //! \returns the owner's end of the connection, which reads and writes its streams as a TCPSpongeSocket does
+    //! \throws std::runtime_error if the listener has stopped
+    LocalStreamSocket accept();
+
+    //! \brief The address the listener's sockets are bound to
+    const Address &local_address() const { return _local_address; }
+
+    //! \brief Stop serving; connections still open are dropped
+    ~TCPSpongeListener();
+
+    //! \name
+    //! The loops refer to the listener's shards, so it can't be moved or copied
+    //!@{
+    TCPSpongeListener(const TCPSpongeListener &) = delete;
+    TCPSpongeListener &operator=(const TCPSpongeListener &) = delete;
+    TCPSpongeListener(TCPSpongeListener &&) = delete;
+    TCPSpongeListener &operator=(TCPSpongeListener &&) = delete;
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_TCP_SPONGE_LISTENER_HH
@@ -5,11 +5,13 @@
 #include "tun.hh"
 #include "util.hh"
 
+#include <climits>
 #include <cstddef>
 #include <exception>
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
@@ -18,14 +20,73 @@
 
 using namespace std;
 
-static constexpr size_t TCP_TICK_MS = 10;
+//! Most datagrams read from the adapter per wakeup, so a flood of them can't starve the other rules
+static constexpr size_t MAX_DATAGRAMS_PER_WAKEUP = 64;
+
+//! Did a read or write fail only because the (non-blocking) adapter fd wasn't ready?
+static bool would_block(const unix_error &e) { return e.code().value() == EAGAIN; }
+
+//! Can AdaptT write a whole vector of segments at once (e.g. with one system call)?
+template <typename AdaptT, typename = void>
+struct writes_batches : false_type {};
+
+template <typename AdaptT>
+struct writes_batches<AdaptT, void_t<decltype(declval<AdaptT &>().write(declval<vector<TCPSegment> &>()))>>
+    : true_type {};
+
+//! Does AdaptT queue what the fd can't take yet (e.g. Ethernet frames), to send once it can?
+template <typename AdaptT, typename = void>
+struct queues_writes : false_type {};
+
+template <typename AdaptT>
+struct queues_writes<AdaptT, void_t<decltype(declval<const AdaptT &>().frames_pending())>> : true_type {};
+
+//! Can AdaptT queue its writes on an IoUringEventLoop?
+template <typename AdaptT, typename = void>
+struct queues_on_loop : false_type {};
+
+template <typename AdaptT>
+struct queues_on_loop<
+    AdaptT,
+    void_t<decltype(declval<AdaptT &>().queue_write(declval<IoUringEventLoop &>(), declval<TCPSegment &>()))>>
+    : true_type {};
+
+//! Can AdaptT queue a whole vector of segments on an IoUringEventLoop at once (e.g. in GSO runs)?
+template <typename AdaptT, typename = void>
+struct queues_batches_on_loop : false_type {};
+
+template <typename AdaptT>
+struct queues_batches_on_loop<AdaptT,
+                              void_t<decltype(declval<AdaptT &>().queue_write(declval<IoUringEventLoop &>(),
+                                                                              declval<vector<TCPSegment> &>()))>>
+    : true_type {};
+
+//! Can AdaptT have an IoUringEventLoop receive its datagrams, handing over each segment it accepts?
+template <typename AdaptT, typename = void>
+struct receives_on_loop : false_type {};
+
+template <typename AdaptT>
+struct receives_on_loop<AdaptT,
+                        void_t<decltype(declval<AdaptT &>().add_receiver(
+                            declval<IoUringEventLoop &>(), declval<const function<void(TCPSegment &&)> &>()))>>
+    : true_type {};
 
 //! \param[in] condition is a function returning true if loop should continue
 template <typename AdaptT>
 void TCPSpongeSocket<AdaptT>::_tcp_loop(const function<bool()> &condition) {
     auto base_time = timestamp_ms();
     while (condition()) {
-        auto ret = _eventloop.wait_next_event(TCP_TICK_MS);
+        // pick up any socket option the owner changed since the last wakeup
+        const auto send_policy = _send_policy.load();
+        if (_tcp->send_policy() != send_policy) {
+            _tcp->set_send_policy(send_policy);
+        }
+        if (_tcp->rack_tlp() != _rack_tlp.load()) {
+            _tcp->set_rack_tlp(_rack_tlp.load());
+        }
+
+        // sleep until the next TCP or adapter timer is due (or something happens)
+        auto ret = _wait_next_event();
         if (ret == EventLoop::Result::Exit or _abort) {
             break;
         }
@@ -36,7 +97,147 @@ void TCPSpongeSocket<AdaptT>::_tcp_loop(const function<bool()> &condition) {
             _datagram_adapter.tick(next_time - base_time);
             base_time = next_time;
         }
+        _info.store(_tcp->info());
+    }
+    _info.store(_tcp->info());
+}
+
+template <typename AdaptT>
+optional<uint64_t> TCPSpongeSocket<AdaptT>::_time_until_deadline() const {
+    optional<uint64_t> next{};
+    if (_tcp->active()) {
+        for (const auto &timer : {_tcp->time_until_next_timer(), _datagram_adapter.time_until_next_timer()}) {
+            if (timer.has_value()) {
+                next = min(next.value_or(timer.value()), timer.value());
+            }
+        }
     }
+    return next;
+}
+
+//! \details Leaves the timer alone if the deadline hasn't moved, which is the usual case (most
+//! wakeups don't restart a TCP timer).
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::_schedule_deadline() {
+    const optional<uint64_t> next = _time_until_deadline();
+    const uint64_t now = timestamp_ms();
+    if (_deadline.has_value() and next.has_value() and now + next.value() == _deadline_ms) {
+        return;
+    }
+    if (_deadline.has_value()) {
+        _eventloop.cancel_timer(_deadline.value());
+        _deadline.reset();
+    }
+    if (next.has_value()) {
+        // nothing else to do in the callback: the loop ticks the TCPConnection after every wakeup
+        _deadline = _eventloop.add_timer(next.value(), [&] { _deadline.reset(); });
+        _deadline_ms = now + next.value();
+    }
+}
+
+//! \details Stops early if the adapter can't take any more for now; rule 4 sends the rest once it can.
+//! An adapter that queues what its fd can't take is first given the chance to send its queue, and
+//! isn't given more until that's empty.
+//!
+//! On an IoUringEventLoop, an adapter with a queue_write() queues every segment on the loop instead
+//! (and has no rule 4).
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::_send_segments() {
+    auto &segments = _tcp->segments_out();
+    if constexpr (queues_on_loop<AdaptT>::value) {
+        if (_io_uring) {
+            if constexpr (queues_batches_on_loop<AdaptT>::value) {
+                if (not segments.empty()) {
+                    _datagram_adapter.queue_write(_io_uring.value(), segments);
+                }
+            } else {
+                for (auto &segment : segments) {
+                    _datagram_adapter.queue_write(_io_uring.value(), segment);
+                }
+            }
+            segments.clear();
+            return;
+        }
+    }
+    size_t sent = 0;
+    try {
+        if constexpr (queues_writes<AdaptT>::value) {
+            _datagram_adapter.send_pending();
+            for (; sent < segments.size() and not _datagram_adapter.frames_pending(); sent++) {
+                _datagram_adapter.write(segments[sent]);
+            }
+        } else if constexpr (writes_batches<AdaptT>::value) {
+            while (not segments.empty()) {
+                const size_t written = _datagram_adapter.write(segments);
+                segments.erase(segments.begin(), segments.begin() + written);
+            }
+        } else {
+            for (; sent < segments.size(); sent++) {
+                _datagram_adapter.write(segments[sent]);
+            }
+        }
+    } catch (const unix_error &e) {
+        if (not would_block(e)) {
+            throw;
+        }
+    }
+    segments.erase(segments.begin(), segments.begin() + sent);
+}
+
+//! \details An IoUringEventLoop's rules are only enabled or disabled, so the callback is wrapped to
+//! look at every rule's interest once it has run (as an EventLoop does before each wait).
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::_add_rule(const FileDescriptor &fd,
+                                        const EventLoop::Direction direction,
+                                        const function<void()> &callback,
+                                        const function<bool()> &interest,
+                                        const function<void()> &cancel) {
+    if (not _io_uring) {
+        _eventloop.add_rule(fd, direction, callback, interest, cancel);
+        return;
+    }
+    const auto wrapped = [this, callback] {
+        callback();
+        _refresh_io_uring();
+    };
+    _io_uring_interest.emplace_back(_io_uring->add_rule(fd, direction, wrapped, cancel, interest()), interest);
+}
+
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::_refresh_io_uring() {
+    _send_segments();
+    for (const auto &[id, interest] : _io_uring_interest) {
+        _io_uring->set_enabled(id, interest());
+    }
+}
+
+//! \details An EventLoop wakes up for the deadline timer; an IoUringEventLoop has no timers, so it
+//! waits no longer than until the deadline.
+template <typename AdaptT>
+EventLoop::Result TCPSpongeSocket<AdaptT>::_wait_next_event() {
+    if (not _io_uring) {
+        _schedule_deadline();
+        return _eventloop.wait_next_event(-1);
+    }
+    _refresh_io_uring();
+    const optional<uint64_t> next = _time_until_deadline();
+    const int timeout_ms = next.has_value() ? static_cast<int>(min(next.value(), uint64_t{INT_MAX})) : -1;
+    return _io_uring->wait_next_event(timeout_ms);
+}
+
+template <typename AdaptT>
+bool TCPSpongeSocket<AdaptT>::_adapter_backlogged() const {
+    if constexpr (queues_writes<AdaptT>::value) {
+        return _datagram_adapter.frames_pending();
+    } else {
+        return false;
+    }
+}
+
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::_wake_tcp_thread() {
+    const uint64_t one = 1;
+    SystemCall("write", ::write(_wakeup.fd_num(), &one, sizeof(one)));
 }
 
 //! \param[in] data_socket_pair is a pair of connected AF_UNIX SOCK_STREAM sockets
@@ -46,20 +247,43 @@ TCPSpongeSocket<AdaptT>::TCPSpongeSocket(pair<FileDescriptor, FileDescriptor> da
                                          AdaptT &&datagram_interface)
     : LocalStreamSocket(move(data_socket_pair.first))
     , _thread_data(move(data_socket_pair.second))
-    , _datagram_adapter(move(datagram_interface)) {
+    , _datagram_adapter(move(datagram_interface))
+    , _wakeup(SystemCall("eventfd", ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))) {
     _thread_data.set_blocking(false);
+    // the TCPConnection thread drains the adapter until it would block (see rule 1)
+    static_cast<const FileDescriptor &>(_datagram_adapter).duplicate().set_blocking(false);
 }
 
 template <typename AdaptT>
 void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
-    _tcp.emplace(config);
+    {
+        lock_guard<mutex> lock(_socket_options_mutex);
+        TCPConfig overridden = config;
+        if (_send_policy_set) {
+            overridden.send_policy = _send_policy.load();
+        } else {
+            _send_policy.store(config.send_policy);
+            _nodelay = config.send_policy != TCPConfig::SendPolicy::Nagle;
+            _cork = config.send_policy == TCPConfig::SendPolicy::Cork;
+        }
+        if (_rack_tlp_set) {
+            overridden.rack_tlp = _rack_tlp.load();
+        } else {
+            _rack_tlp.store(config.rack_tlp);
+        }
+        _tcp.emplace(overridden);
+    }
 
-    // Set up the event loop
+    // Set up the event loop (an IoUringEventLoop, if the adapter's config asks for one)
+    if (_datagram_adapter.config().loop_backend == FdAdapterConfig::LoopBackend::IoUring) {
+        _io_uring.emplace();
+    }
 
-    // There are four possible events to handle:
+    // There are five possible events to handle:
     //
-    // 1) Incoming datagram received (needs to be given to
-    //    TCPConnection::segment_received method)
+    // 1) Incoming datagrams received (need to be given to
+    //    TCPConnection::segment_received method, a burst at a
+    //    time, and the replies sent)
     //
     // 2) Outbound bytes received from local application via a write()
     //    call (needs to be read from the local stream socket and
@@ -71,95 +295,184 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
     //
     // 4) Outbound segment generated by TCP (needs to be
     //    given to underlying datagram socket)
+    //
+    // 5) Wakeup from the owner (e.g. to abort, or to apply
+    //    a new send policy)
+    //
+    // Between events, the loop sleeps until the next TCP or
+    // adapter deadline (see _wait_next_event).
+    //
+    // On an IoUringEventLoop, rules 1 to 3 post the receive, read
+    // or write itself rather than a poll, where they can.
+
+    const auto report_fully_acked = [this] {
+        // debugging output:
+        if (_outbound_shutdown and _tcp.value().bytes_in_flight() == 0 and not _fully_acked) {
+            cerr << "DEBUG: Outbound stream to " << _datagram_adapter.config().destination.to_string()
+                 << " has been fully acknowledged.\n";
+            _fully_acked = true;
+        }
+    };
 
     // rule 1: read from filtered packet stream and dump into TCPConnection
-    _eventloop.add_rule(_datagram_adapter,
-                        Direction::In,
-                        [&] {
-                            auto seg = _datagram_adapter.read();
-                            if (seg) {
-                                _tcp->segment_received(move(seg.value()));
-                            }
-
-                            // debugging output:
-                            if (_thread_data.eof() and _tcp.value().bytes_in_flight() == 0 and not _fully_acked) {
-                                cerr << "DEBUG: Outbound stream to "
-                                     << _datagram_adapter.config().destination.to_string()
-                                     << " has been fully acknowledged.\n";
-                                _fully_acked = true;
-                            }
-                        },
-                        [&] { return _tcp->active(); });
+    // (on an IoUringEventLoop, the loop receives the datagrams, and what the TCPConnection made of
+    // them goes out before the next wait; see _wait_next_event)
+    bool receiving_on_loop = false;
+    if constexpr (receives_on_loop<AdaptT>::value) {
+        if (_io_uring) {
+            const auto on_segment = [this, report_fully_acked](TCPSegment &&seg) {
+                if (_tcp->active()) {
+                    _tcp->segment_received(move(seg));
+                }
+                report_fully_acked();
+            };
+            _io_uring_interest.emplace_back(_datagram_adapter.add_receiver(_io_uring.value(), on_segment),
+                                            [this] { return _tcp->active(); });
+            receiving_on_loop = true;
+        }
+    }
+    if (not receiving_on_loop) {
+        _add_rule(_datagram_adapter,
+                  Direction::In,
+                  [this, report_fully_acked] {
+                      // take the whole burst of datagrams waiting (up to a limit, but including any
+                      // the adapter has already received, which wouldn't make the fd readable again) ...
+                      for (size_t i = 0;
+                           (i < MAX_DATAGRAMS_PER_WAKEUP or _datagram_adapter.datagrams_buffered() > 0) and
+                           _tcp->active();
+                           i++) {
+                          optional<TCPSegment> seg;
+                          try {
+                              seg = _datagram_adapter.read();
+                          } catch (const unix_error &e) {
+                              if (not would_block(e)) {
+                                  throw;
+                              }
+                              break;
+                          }
+                          if (seg) {
+                              _tcp->segment_received(move(seg.value()));
+                          }
+                      }
+                      // ... and send what the TCPConnection made of it (e.g. ACKs) in one go
+                      _send_segments();
+                      report_fully_acked();
+                  },
+                  [&] { return _tcp->active(); });
+    }
 
     // rule 2: read from pipe into outbound buffer
-    _eventloop.add_rule(
-        _thread_data,
-        Direction::In,
-        [&] {
-            const auto data = _thread_data.read(_tcp->remaining_outbound_capacity());
-            const auto len = data.size();
-            const auto amount_written = _tcp->write(move(data));
-            if (amount_written != len) {
-                throw runtime_error("TCPConnection::write() accepted less than advertised length");
-            }
-
-            if (_thread_data.eof()) {
+    const auto on_outbound = [this](string &&data) {
+        const auto len = data.size();
+        const auto amount_written = _tcp->write(move(data));
+        if (amount_written != len) {
+            throw runtime_error("TCPConnection::write() accepted less than advertised length");
+        }
+    };
+    const auto end_outbound = [this] {
+        _tcp->end_input_stream();
+        _outbound_shutdown = true;
+
+        // debugging output:
+        cerr << "DEBUG: Outbound stream to " << _datagram_adapter.config().destination.to_string() << " finished ("
+             << _tcp.value().bytes_in_flight() << " byte" << (_tcp.value().bytes_in_flight() == 1 ? "" : "s")
+             << " still in flight).\n";
+    };
+    const auto outbound_interest = [this] {
+        return (_tcp->active()) and (not _outbound_shutdown) and (_tcp->remaining_outbound_capacity() > 0);
+    };
+    if (_io_uring) {
+        // (a read never takes more than the TCPConnection has room for, and the loop calls
+        // end_outbound at EOF)
+        const auto id = _io_uring->add_reader(
+            _thread_data,
+            [this] { return _tcp->remaining_outbound_capacity(); },
+            [this, on_outbound](string &&data) {
+                on_outbound(move(data));
+                _refresh_io_uring();
+            },
+            end_outbound,
+            outbound_interest());
+        _io_uring_interest.emplace_back(id, outbound_interest);
+    } else {
+        _add_rule(
+            _thread_data,
+            Direction::In,
+            [this, on_outbound, end_outbound] {
+                on_outbound(_thread_data.read(_tcp->remaining_outbound_capacity()));
+                if (_thread_data.eof()) {
+                    end_outbound();
+                }
+            },
+            outbound_interest,
+            [&] {
                 _tcp->end_input_stream();
                 _outbound_shutdown = true;
-
-                // debugging output:
-                cerr << "DEBUG: Outbound stream to " << _datagram_adapter.config().destination.to_string()
-                     << " finished (" << _tcp.value().bytes_in_flight() << " byte"
-                     << (_tcp.value().bytes_in_flight() == 1 ? "" : "s") << " still in flight).\n";
-            }
-        },
-        [&] { return (_tcp->active()) and (not _outbound_shutdown) and (_tcp->remaining_outbound_capacity() > 0); },
-        [&] {
-            _tcp->end_input_stream();
-            _outbound_shutdown = true;
-        });
+            });
+    }
 
     // rule 3: read from inbound buffer into pipe
-    _eventloop.add_rule(
-        _thread_data,
-        Direction::Out,
-        [&] {
-            ByteStream &inbound = _tcp->inbound_stream();
-            // Write from the inbound_stream into
-            // the pipe, handling the possibility of a partial
-            // write (i.e., only pop what was actually written).
-            const size_t amount_to_write = min(size_t(65536), inbound.buffer_size());
-            const std::string buffer = inbound.peek_output(amount_to_write);
-            const auto bytes_written = _thread_data.write(move(buffer), false);
-            inbound.pop_output(bytes_written);
-
-            if (inbound.eof() or inbound.error()) {
-                _thread_data.shutdown(SHUT_WR);
-                _inbound_shutdown = true;
-
-                // debugging output:
-                cerr << "DEBUG: Inbound stream from " << _datagram_adapter.config().destination.to_string()
-                     << " finished " << (inbound.error() ? "with an error/reset.\n" : "cleanly.\n");
-                if (_tcp.value().state() == TCPState::State::TIME_WAIT) {
-                    cerr << "DEBUG: Waiting for lingering segments (e.g. retransmissions of FIN) from peer...\n";
-                }
+    // Write from the inbound_stream into the pipe, handling the
+    // possibility of a partial write (i.e., only pop what was
+    // actually written).
+    const auto peek_inbound = [this] {
+        ByteStream &inbound = _tcp->inbound_stream();
+        return inbound.peek_output(min(size_t(65536), inbound.buffer_size()));
+    };
+    const auto on_inbound_written = [this](const size_t bytes_written) {
+        ByteStream &inbound = _tcp->inbound_stream();
+        inbound.pop_output(bytes_written);
+
+        if (inbound.eof() or inbound.error()) {
+            _thread_data.shutdown(SHUT_WR);
+            _inbound_shutdown = true;
+
+            // debugging output:
+            cerr << "DEBUG: Inbound stream from " << _datagram_adapter.config().destination.to_string()
+                 << " finished " << (inbound.error() ? "with an error/reset.\n" : "cleanly.\n");
+            if (_tcp.value().state() == TCPState::State::TIME_WAIT) {
+                cerr << "DEBUG: Waiting for lingering segments (e.g. retransmissions of FIN) from peer...\n";
             }
-        },
-        [&] {
-            return (not _tcp->inbound_stream().buffer_empty()) or
-                   ((_tcp->inbound_stream().eof() or _tcp->inbound_stream().error()) and not _inbound_shutdown);
-        });
+        }
+    };
+    const auto inbound_interest = [this] {
+        return (not _tcp->inbound_stream().buffer_empty()) or
+               ((_tcp->inbound_stream().eof() or _tcp->inbound_stream().error()) and not _inbound_shutdown);
+    };
+    if (_io_uring) {
+        // (with nothing left to write but the end of the stream, the loop writes nothing, and the
+        // shutdown follows)
+        const auto id = _io_uring->add_writer(
+            _thread_data,
+            peek_inbound,
+            [this, on_inbound_written](const size_t bytes_written) {
+                on_inbound_written(bytes_written);
+                _refresh_io_uring();
+            },
+            inbound_interest());
+        _io_uring_interest.emplace_back(id, inbound_interest);
+    } else {
+        _add_rule(
+            _thread_data,
+            Direction::Out,
+            [this, peek_inbound, on_inbound_written] {
+                on_inbound_written(_thread_data.write(peek_inbound(), false));
+            },
+            inbound_interest);
+    }
 
     // rule 4: read outbound segments from TCPConnection and send as datagrams
-    _eventloop.add_rule(_datagram_adapter,
-                        Direction::Out,
-                        [&] {
-                            while (not _tcp->segments_out().empty()) {
-                                _datagram_adapter.write(_tcp->segments_out().front());
-                                _tcp->segments_out().pop();
-                            }
-                        },
-                        [&] { return not _tcp->segments_out().empty(); });
+    // (unless the adapter queues them on an IoUringEventLoop as they come; see _send_segments)
+    if (not _io_uring or not queues_on_loop<AdaptT>::value) {
+        _add_rule(_datagram_adapter,
+                  Direction::Out,
+                  [&] { _send_segments(); },
+                  [&] { return not _tcp->segments_out().empty() or _adapter_backlogged(); });
+    }
+
+    // rule 5: wake up when the owner asks (the loop otherwise sleeps until the next event or deadline)
+    _add_rule(
+        _wakeup, Direction::In, [&] { _wakeup.read_counter(); }, [&] { return _tcp->active(); });
 }
 
 //! \brief Call [socketpair](\ref man2::socketpair) and return connected Unix-domain sockets of specified type
@@ -183,6 +496,7 @@ TCPSpongeSocket<AdaptT>::~TCPSpongeSocket() {
             cerr << "Warning: unclean shutdown of TCPSpongeSocket\n";
             // force the other side to exit
             _abort.store(true);
+            _wake_tcp_thread();
             _tcp_thread.join();
         }
     } catch (const exception &e) {
@@ -190,6 +504,39 @@ TCPSpongeSocket<AdaptT>::~TCPSpongeSocket() {
     }
 }
 
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::_publish_send_policy() {
+    using SendPolicy = TCPConfig::SendPolicy;
+    _send_policy.store(_cork ? SendPolicy::Cork : (_nodelay ? SendPolicy::NoDelay : SendPolicy::Nagle));
+    _send_policy_set = true;
+    _wake_tcp_thread();
+}
+
+//! \param[in] nodelay is `true` to send small segments immediately, `false` to use Nagle's algorithm
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::set_nodelay(const bool nodelay) {
+    lock_guard<mutex> lock(_socket_options_mutex);
+    _nodelay = nodelay;
+    _publish_send_policy();
+}
+
+//! \param[in] cork is `true` to hold small segments, `false` to release them (and send any held data)
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::set_cork(const bool cork) {
+    lock_guard<mutex> lock(_socket_options_mutex);
+    _cork = cork;
+    _publish_send_policy();
+}
+
+//! \param[in] enabled is `true` to repair losses with RACK-TLP (RFC 8985), `false` to wait for the RTO
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::set_rack_tlp(const bool enabled) {
+    lock_guard<mutex> lock(_socket_options_mutex);
+    _rack_tlp.store(enabled);
+    _rack_tlp_set = true;
+    _wake_tcp_thread();
+}
+
 template <typename AdaptT>
 void TCPSpongeSocket<AdaptT>::wait_until_closed() {
     shutdown(SHUT_RDWR);
@@ -208,10 +555,10 @@ void TCPSpongeSocket<AdaptT>::connect(const TCPConfig &c_tcp, const FdAdapterCon
         throw runtime_error("connect() with TCPConnection already initialized");
     }
 
-    _initialize_TCP(c_tcp);
-
     _datagram_adapter.config_mut() = c_ad;
 
+    _initialize_TCP(c_tcp);
+
     cerr << "DEBUG: Connecting to " << c_ad.destination.to_string() << "...\n";
     _tcp->connect();
 
@@ -236,11 +583,11 @@ void TCPSpongeSocket<AdaptT>::listen_and_accept(const TCPConfig &c_tcp, const Fd
         throw runtime_error("listen_and_accept() with TCPConnection already initialized");
     }
 
-    _initialize_TCP(c_tcp);
-
     _datagram_adapter.config_mut() = c_ad;
     _datagram_adapter.set_listening(true);
 
+    _initialize_TCP(c_tcp);
+
     cerr << "DEBUG: Listening for incoming connection...\n";
     _tcp_loop([&] {
         const auto s = _tcp->state();
@@ -5,15 +5,20 @@
 #include "eventloop.hh"
 #include "fd_adapter.hh"
 #include "file_descriptor.hh"
+#include "io_uring_eventloop.hh"
 #include "network_interface.hh"
+#include "seqlock.hh"
 #include "tcp_config.hh"
 #include "tcp_connection.hh"
 #include "tuntap_adapter.hh"
 
 #include <atomic>
 #include <cstdint>
+#include <functional>
+#include <mutex>
 #include <optional>
 #include <thread>
+#include <utility>
 #include <vector>
 
 //! Multithreaded wrapper around TCPConnection that approximates the Unix sockets API
@@ -37,6 +42,49 @@ class TCPSpongeSocket : public LocalStreamSocket {
     //! eventloop that handles all the events (new inbound datagram, new outbound bytes, new inbound bytes)
     EventLoop _eventloop{};
 
+    //! Handles the events instead, when the FdAdapterConfig asks for FdAdapterConfig::LoopBackend::IoUring
+    std::optional<IoUringEventLoop> _io_uring{};
+
+    //! The _io_uring rules (polls, and the adapter's receiver and the stream's reader and writer), each
+    //! with the interest that enables it (which that loop doesn't check itself)
+    std::vector<std::pair<EventRuleId, std::function<bool()>>> _io_uring_interest{};
+
+    //! Add a rule (a poll, on an IoUringEventLoop) to whichever loop handles the events
+    void _add_rule(const FileDescriptor &fd,
+                   const EventLoop::Direction direction,
+                   const std::function<void()> &callback,
+                   const std::function<bool()> &interest,
+                   const std::function<void()> &cancel = [] {});
+
+    //! Queue the TCPConnection's outbound segments on _io_uring, and enable the rules that are interested
+    void _refresh_io_uring();
+
+    //! Wait for the next event (or TCPConnection or adapter deadline) and handle it
+    EventLoop::Result _wait_next_event();
+
+    //! [eventfd(2)](\ref man2::eventfd) the owner signals to wake the TCPConnection thread
+    FileDescriptor _wakeup;
+
+    //! Wake the TCPConnection thread (e.g. to abort, or to apply a new send policy)
+    void _wake_tcp_thread();
+
+    //! EventLoop timer set for the next TCPConnection or adapter deadline, if any (reset when it fires)
+    std::optional<EventLoop::TimerId> _deadline{};
+
+    uint64_t _deadline_ms{0};  //!< When the deadline timer is due, in timestamp_ms() time
+
+    //! Milliseconds until the next TCPConnection or adapter deadline, if any
+    std::optional<uint64_t> _time_until_deadline() const;
+
+    //! Move the deadline timer to the next TCPConnection or adapter deadline
+    void _schedule_deadline();
+
+    //! Write the TCPConnection's outbound segments to the adapter
+    void _send_segments();
+
+    //! Does the adapter hold writes its fd couldn't take yet?
+    bool _adapter_backlogged() const;
+
     //! Process events while specified condition is true
     void _tcp_loop(const std::function<bool()> &condition);
 
@@ -57,6 +105,27 @@ class TCPSpongeSocket : public LocalStreamSocket {
 
     bool _fully_acked{false};  //!< Has the outbound data been fully acknowledged by the peer?
 
+    //! Send policy requested by the owner; the TCPConnection thread applies it on its next wakeup
+    std::atomic<TCPConfig::SendPolicy> _send_policy{TCPConfig::SendPolicy::NoDelay};
+
+    //! Guards the socket options below, which any thread may set, and _initialize_TCP() reads
+    std::mutex _socket_options_mutex{};
+
+    bool _send_policy_set{false};  //!< Has the owner chosen a send policy (overriding the TCPConfig)?
+    bool _nodelay{true};           //!< Owner-side TCP_NODELAY setting
+    bool _cork{false};             //!< Owner-side TCP_CORK setting
+
+    //! RACK-TLP setting requested by the owner; the TCPConnection thread applies it on its next wakeup
+    std::atomic_bool _rack_tlp{false};
+    bool _rack_tlp_set{false};  //!< Has the owner chosen whether to use RACK-TLP (overriding the TCPConfig)?
+
+    //! Combine the owner-side socket options into a TCPConfig::SendPolicy and publish it
+    //! (with _socket_options_mutex held)
+    void _publish_send_policy();
+
+    //! Latest TCPConnection::info(), published by the TCPConnection thread after each wakeup
+    SeqLock<TCPInfo> _info{};
+
   public:
     //! Construct from the interface that the TCPConnection thread will use to read and write datagrams
     explicit TCPSpongeSocket(AdaptT &&datagram_interface);
@@ -72,6 +141,27 @@ class TCPSpongeSocket : public LocalStreamSocket {
     //! Listen and accept using the specified configurations; blocks until accept succeeds or fails
     void listen_and_accept(const TCPConfig &c_tcp, const FdAdapterConfig &c_ad);
 
+    //! \name Socket options
+    //! These may be called before or after connecting; a cork takes precedence over no-delay.
+
+    //!@{
+
+    //! Disable (`true`) or enable (`false`) Nagle's algorithm, like [TCP_NODELAY](\ref man7::tcp)
+    void set_nodelay(const bool nodelay);
+
+    //! Hold small segments (`true`) or release them (`false`), like [TCP_CORK](\ref man7::tcp)
+    void set_cork(const bool cork);
+
+    //! Detect losses with RACK-TLP (`true`) or with the retransmission timer alone (`false`), like
+    //! TCPConfig::rack_tlp
+    void set_rack_tlp(const bool enabled);
+    //!@}
+
+    //! \brief Latest snapshot of the connection's state and counters, like [TCP_INFO](\ref man7::tcp)
+    //! \details Taken by the TCPConnection thread each time it wakes up, and read here without
+    //! locking or waiting for that thread.
+    TCPInfo info() const { return _info.load(); }
+
     //! When a connected socket is destructed, it will send a RST
     ~TCPSpongeSocket();
 
@@ -122,6 +212,10 @@ using LossyTCPOverIPv4SpongeSocket = TCPSpongeSocket<LossyTCPOverIPv4OverTunFdAd
 //!   and [accept(2)](\ref man2::accept)
 //! - if TCPSpongeSocket is destructed while a TCP connection is open, the connection is
 //!   immediately terminated with a RST (call `wait_until_closed` to avoid this)
+//!
+//! The TCPConnection thread runs an EventLoop, or an IoUringEventLoop if the FdAdapterConfig's
+//! `loop_backend` asks for one. On the latter, the outbound segments are queued on the loop as they
+//! come, and go out together with the one system call that waits for the next event.
 
 //! Helper class that makes a TCPOverIPv4SpongeSocket behave more like a (kernel) TCPSocket
 class CS144TCPSocket : public TCPOverIPv4SpongeSocket {
@@ -14,6 +14,79 @@ string TCPState::name() const {
            ", linger_after_streams_finish=" + to_string(_linger_after_streams_finish);
 }
 
+optional<TCPState::State> TCPState::official_state() const {
+    for (auto state = static_cast<int>(State::LISTEN); state <= static_cast<int>(State::RESET); state++) {
+        if (*this == TCPState{static_cast<State>(state)}) {
+            return static_cast<State>(state);
+        }
+    }
+    return {};
+}
+
+optional<TCPState::State> TCPState::official_state(const TCPSender &sender,
+                                                   const TCPReceiver &receiver,
+                                                   const bool active,
+                                                   const bool linger) {
+    const SenderState sender_state = state_of(sender);
+    const ReceiverState receiver_state = state_of(receiver);
+
+    // (the same table as the TCPState(State) constructor, read the other way)
+    if (not active) {
+        if (receiver_state == ReceiverState::ERROR and sender_state == SenderState::ERROR) {
+            return State::RESET;
+        }
+        if (receiver_state == ReceiverState::FIN_RECV and sender_state == SenderState::FIN_ACKED) {
+            return State::CLOSED;
+        }
+        return {};
+    }
+
+    switch (receiver_state) {
+        case ReceiverState::LISTEN:
+            if (not linger) {
+                return {};
+            }
+            switch (sender_state) {
+                case SenderState::CLOSED:
+                    return State::LISTEN;
+                case SenderState::SYN_SENT:
+                    return State::SYN_SENT;
+                default:
+                    return {};
+            }
+        case ReceiverState::SYN_RECV:
+            if (not linger) {
+                return {};
+            }
+            switch (sender_state) {
+                case SenderState::SYN_SENT:
+                    return State::SYN_RCVD;
+                case SenderState::SYN_ACKED:
+                    return State::ESTABLISHED;
+                case SenderState::FIN_SENT:
+                    return State::FIN_WAIT_1;
+                case SenderState::FIN_ACKED:
+                    return State::FIN_WAIT_2;
+                default:
+                    return {};
+            }
+        case ReceiverState::FIN_RECV:
+            switch (sender_state) {
+                case SenderState::SYN_ACKED:
+                    return linger ? optional<State>{} : State::CLOSE_WAIT;
+                case SenderState::FIN_SENT:
+                    return linger ? State::CLOSING : State::LAST_ACK;
+                case SenderState::FIN_ACKED:
+                    return linger ? State::TIME_WAIT : optional<State>{};
+                default:
+                    return {};
+            }
+        case ReceiverState::ERROR:
+            return {};
+    }
+    return {};
+}
+
 TCPState::TCPState(const TCPState::State state) {
     switch (state) {
         case TCPState::State::LISTEN:
@@ -80,31 +153,63 @@ TCPState::TCPState(const TCPSender &sender, const TCPReceiver &receiver, const b
     , _linger_after_streams_finish(active ? linger : false) {}
 
 string TCPState::state_summary(const TCPReceiver &receiver) {
+    switch (state_of(receiver)) {
+        case ReceiverState::ERROR:
+            return TCPReceiverStateSummary::ERROR;
+        case ReceiverState::LISTEN:
+            return TCPReceiverStateSummary::LISTEN;
+        case ReceiverState::FIN_RECV:
+            return TCPReceiverStateSummary::FIN_RECV;
+        case ReceiverState::SYN_RECV:
+            break;
+    }
+    return TCPReceiverStateSummary::SYN_RECV;
+}
+
+string TCPState::state_summary(const TCPSender &sender) {
+    switch (state_of(sender)) {
+        case SenderState::ERROR:
+            return TCPSenderStateSummary::ERROR;
+        case SenderState::CLOSED:
+            return TCPSenderStateSummary::CLOSED;
+        case SenderState::SYN_SENT:
+            return TCPSenderStateSummary::SYN_SENT;
+        case SenderState::SYN_ACKED:
+            return TCPSenderStateSummary::SYN_ACKED;
+        case SenderState::FIN_SENT:
+            return TCPSenderStateSummary::FIN_SENT;
+        case SenderState::FIN_ACKED:
+            break;
+    }
+    return TCPSenderStateSummary::FIN_ACKED;
+}
+
+TCPState::ReceiverState TCPState::state_of(const TCPReceiver &receiver) {
     if (receiver.stream_out().error()) {
-        return TCPReceiverStateSummary::ERROR;
+        return ReceiverState::ERROR;
     } else if (not receiver.ackno().has_value()) {
-        return TCPReceiverStateSummary::LISTEN;
+        return ReceiverState::LISTEN;
     } else if (receiver.stream_out().input_ended()) {
-        return TCPReceiverStateSummary::FIN_RECV;
+        return ReceiverState::FIN_RECV;
     } else {
-        return TCPReceiverStateSummary::SYN_RECV;
+        return ReceiverState::SYN_RECV;
     }
 }
 
-string TCPState::state_summary(const TCPSender &sender) {
+TCPState::SenderState TCPState::state_of(const TCPSender &sender) {
     if (sender.stream_in().error()) {
-        return TCPSenderStateSummary::ERROR;
+        return SenderState::ERROR;
     } else if (sender.next_seqno_absolute() == 0) {
-        return TCPSenderStateSummary::CLOSED;
+        return SenderState::CLOSED;
     } else if (sender.next_seqno_absolute() == sender.bytes_in_flight()) {
-        return TCPSenderStateSummary::SYN_SENT;
+        return SenderState::SYN_SENT;
     } else if (not sender.stream_in().eof()) {
-        return TCPSenderStateSummary::SYN_ACKED;
+        return SenderState::SYN_ACKED;
     } else if (sender.next_seqno_absolute() < sender.stream_in().bytes_written() + 2) {
-        return TCPSenderStateSummary::SYN_ACKED;
+        return SenderState::SYN_ACKED;
     } else if (sender.bytes_in_flight()) {
-        return TCPSenderStateSummary::FIN_SENT;
+        return SenderState::FIN_SENT;
     } else {
-        return TCPSenderStateSummary::FIN_ACKED;
+        return SenderState::FIN_ACKED;
     }
 }
@@ -4,6 +4,7 @@
 #include "tcp_receiver.hh"
 #include "tcp_sender.hh"
 
+#include <optional>
 #include <string>
 
 //! \brief Summary of a TCPConnection's internal state
@@ -50,6 +51,23 @@ class TCPState {
     //! \brief Summarize the TCPState in a string
     std::string name() const;
 
+    //! \brief The state a TCPReceiver is in, as summarized by TCPReceiverStateSummary
+    enum class ReceiverState { ERROR, LISTEN, SYN_RECV, FIN_RECV };
+
+    //! \brief The state a TCPSender is in, as summarized by TCPSenderStateSummary
+    enum class SenderState { ERROR, CLOSED, SYN_SENT, SYN_ACKED, FIN_SENT, FIN_ACKED };
+
+    //! \brief The official state this summary corresponds to, if any
+    std::optional<State> official_state() const;
+
+    //! \brief The official state of a connection with this sender, receiver, and active and linger bits, if any
+    //! \details Equal to `TCPState{sender, receiver, active, linger}.official_state()`, but cheap enough to
+    //! call on every wakeup (it builds no strings).
+    static std::optional<State> official_state(const TCPSender &sender,
+                                               const TCPReceiver &receiver,
+                                               const bool active,
+                                               const bool linger);
+
     //! \brief Construct a TCPState given a sender, a receiver, and the TCPConnection's active and linger bits
     TCPState(const TCPSender &sender, const TCPReceiver &receiver, const bool active, const bool linger);
 
@@ -61,6 +79,12 @@ class TCPState {
 
     //! \brief Summarize the state of a TCPSender in a string
     static std::string state_summary(const TCPSender &receiver);
+
+    //! \brief The state of a TCPReceiver
+    static ReceiverState state_of(const TCPReceiver &receiver);
+
+    //! \brief The state of a TCPSender
+    static SenderState state_of(const TCPSender &sender);
 };
 
 namespace TCPReceiverStateSummary {
@@ -1,5 +1,9 @@
 #include "tuntap_adapter.hh"
 
+#include "util.hh"
+
+#include <cerrno>
+
 using namespace std;
 
 //! \param[in] tap Raw network device that will be owned by the adapter
@@ -16,19 +20,24 @@ TCPOverIPv4OverEthernetAdapter::TCPOverIPv4OverEthernetAdapter(TapFD &&tap,
     _tap.write(dummy_frame.serialize());
 }
 
-optional<TCPSegment> TCPOverIPv4OverEthernetAdapter::read() {
-    // Read Ethernet frame from the raw device
+//! \param[in] raw_frame is the Ethernet frame read from the raw device
+optional<TCPSegment> TCPOverIPv4OverEthernetAdapter::_accept(const BufferList &raw_frame) {
+    // Drop IPv4 datagrams that can't be for this connection before parsing anything
+    // (ARP messages and everything else still go to the NetworkInterface)
+    const EthernetFrameView frame_view{raw_frame};
+    if (frame_view.complete() and frame_view.type() == EthernetHeader::TYPE_IPv4 and
+        not might_accept(IPv4View{frame_view.payload()})) {
+        return {};
+    }
+
     EthernetFrame frame;
-    if (frame.parse(_tap.read()) != ParseResult::NoError) {
+    if (frame.parse(raw_frame) != ParseResult::NoError) {
         return {};
     }
 
     // Give the frame to the NetworkInterface. Get back an Internet datagram if frame was carrying one.
     optional<InternetDatagram> ip_dgram = _interface.recv_frame(frame);
 
-    // The incoming frame may have caused the NetworkInterface to send a frame.
-    send_pending();
-
     // Try to interpret IPv4 datagram as TCP
     if (ip_dgram) {
         return unwrap_tcp_in_ip(ip_dgram.value());
@@ -36,6 +45,32 @@ optional<TCPSegment> TCPOverIPv4OverEthernetAdapter::read() {
     return {};
 }
 
+optional<TCPSegment> TCPOverIPv4OverEthernetAdapter::read() {
+    optional<TCPSegment> seg = _accept(_tap.read(_pool));
+
+    // The incoming frame may have caused the NetworkInterface to send a frame.
+    send_pending();
+    return seg;
+}
+
+//! \details Each frame is copied out of the loop's buffer, which goes back to the kernel once
+//! `on_segment` returns.
+//! \param[in] loop is the IoUringEventLoop the TCPConnection thread runs on
+//! \param[in] on_segment is called with each TCP segment read() would have returned
+//! \returns the id of the loop's receiver (see IoUringEventLoop::set_enabled())
+EventRuleId TCPOverIPv4OverEthernetAdapter::add_receiver(IoUringEventLoop &loop,
+                                                         const function<void(TCPSegment &&)> &on_segment) {
+    return loop.add_receiver(_tap, [this, &loop, on_segment](const string_view frame) {
+        optional<TCPSegment> seg = _accept(_pool.copy(frame));
+
+        // The incoming frame may have caused the NetworkInterface to send a frame.
+        _queue_frames(loop);
+        if (seg) {
+            on_segment(move(seg.value()));
+        }
+    });
+}
+
 //! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
 void TCPOverIPv4OverEthernetAdapter::tick(const size_t ms_since_last_tick) {
     _interface.tick(ms_since_last_tick);
@@ -48,12 +83,34 @@ void TCPOverIPv4OverEthernetAdapter::write(TCPSegment &seg) {
     send_pending();
 }
 
-void TCPOverIPv4OverEthernetAdapter::send_pending() {
+//! \param[in] loop is the IoUringEventLoop the TCPConnection thread runs on
+//! \param[in] seg the TCPSegment to send
+void TCPOverIPv4OverEthernetAdapter::queue_write(IoUringEventLoop &loop, TCPSegment &seg) {
+    _interface.send_datagram(wrap_tcp_in_ip(seg), _next_hop);
+    _queue_frames(loop);
+}
+
+//! \param[in] loop is the IoUringEventLoop the TCPConnection thread runs on
+void TCPOverIPv4OverEthernetAdapter::_queue_frames(IoUringEventLoop &loop) {
     while (not _interface.frames_out().empty()) {
-        _tap.write(_interface.frames_out().front().serialize());
+        loop.queue_write(_tap, _interface.frames_out().front().serialize());
         _interface.frames_out().pop();
     }
 }
 
+void TCPOverIPv4OverEthernetAdapter::send_pending() {
+    try {
+        while (not _interface.frames_out().empty()) {
+            _tap.write(_interface.frames_out().front().serialize());
+            _interface.frames_out().pop();
+        }
+    } catch (const unix_error &e) {
+        // the (non-blocking) TAP device is full; the frame that didn't fit goes out next time
+        if (e.code().value() != EAGAIN) {
+            throw;
+        }
+    }
+}
+
 //! Specialize LossyFdAdapter to TCPOverIPv4OverTunFdAdapter
 template class LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>;
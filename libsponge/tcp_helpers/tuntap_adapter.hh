@@ -1,11 +1,14 @@
 #ifndef SPONGE_LIBSPONGE_TUNFD_ADAPTER_HH
 #define SPONGE_LIBSPONGE_TUNFD_ADAPTER_HH
 
+#include "buffer_pool.hh"
 #include "ethernet_header.hh"
 #include "network_interface.hh"
 #include "tun.hh"
 
+#include <functional>
 #include <optional>
+#include <string_view>
 #include <unordered_map>
 #include <utility>
 
@@ -14,22 +17,49 @@ class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter {
   private:
     TunFD _tun;
 
-  public:
-    //! Construct from a TunFD
-    explicit TCPOverIPv4OverTunFdAdapter(TunFD &&tun) : _tun(std::move(tun)) {}
+    //! Slabs to read datagrams into, each big enough for the largest IPv4 datagram
+    BufferPool _pool{UINT16_MAX};
+
+    //! Parses an IPv4 datagram, if it contains a TCP segment related to the current connection
+    std::optional<TCPSegment> _accept(const BufferList &datagram) {
+        if (not might_accept(IPv4View{datagram})) {
+            return {};
+        }
 
-    //! Attempts to read and parse an IPv4 datagram containing a TCP segment related to the current connection
-    std::optional<TCPSegment> read() {
         InternetDatagram ip_dgram;
-        if (ip_dgram.parse(_tun.read()) != ParseResult::NoError) {
+        if (ip_dgram.parse(datagram) != ParseResult::NoError) {
             return {};
         }
         return unwrap_tcp_in_ip(ip_dgram);
     }
 
+  public:
+    //! Construct from a TunFD
+    explicit TCPOverIPv4OverTunFdAdapter(TunFD &&tun) : _tun(std::move(tun)) {}
+
+    //! Attempts to read and parse an IPv4 datagram containing a TCP segment related to the current connection
+    std::optional<TCPSegment> read() { return _accept(_tun.read(_pool)); }
+
+    //! \brief Has `loop` read IPv4 datagrams, calling `on_segment` with each TCP segment related to the
+    //! current connection
+    //! \details Each datagram is copied out of the loop's buffer, which goes back to the kernel once
+    //! `on_segment` returns.
+    EventRuleId add_receiver(IoUringEventLoop &loop, const std::function<void(TCPSegment &&)> &on_segment) {
+        return loop.add_receiver(_tun, [this, on_segment](const std::string_view datagram) {
+            if (auto seg = _accept(_pool.copy(datagram))) {
+                on_segment(std::move(seg.value()));
+            }
+        });
+    }
+
     //! Creates an IPv4 datagram from a TCP segment and writes it to the TUN device
     void write(TCPSegment &seg) { _tun.write(wrap_tcp_in_ip(seg).serialize()); }
 
+    //! Creates an IPv4 datagram from a TCP segment and queues it for `loop` to write to the TUN device
+    void queue_write(IoUringEventLoop &loop, TCPSegment &seg) {
+        loop.queue_write(_tun, wrap_tcp_in_ip(seg).serialize());
+    }
+
     //! Access the underlying TUN device
     operator TunFD &() { return _tun; }
 
@@ -45,11 +75,19 @@ class TCPOverIPv4OverEthernetAdapter : public TCPOverIPv4Adapter {
   private:
     TapFD _tap;  //!< Raw Ethernet connection
 
+    //! Slabs to read frames into, each big enough for an Ethernet header and the largest IPv4 datagram
+    BufferPool _pool{EthernetHeader::LENGTH + UINT16_MAX};
+
     NetworkInterface _interface;  //!< NIC abstraction
 
     Address _next_hop;  //!< IP address of the next hop
 
-    void send_pending();  //!< Sends any pending Ethernet frames
+    //! Gives a frame to the NetworkInterface, returning the TCP segment it carries, if any is related
+    //! to the current connection (the caller sends any frames the NetworkInterface sends in reply)
+    std::optional<TCPSegment> _accept(const BufferList &raw_frame);
+
+    //! Queues the NetworkInterface's pending frames for `loop` to write
+    void _queue_frames(IoUringEventLoop &loop);
 
   public:
     //! Construct from a TapFD
@@ -60,12 +98,32 @@ class TCPOverIPv4OverEthernetAdapter : public TCPOverIPv4Adapter {
     //! Attempts to read and parse an Ethernet frame containing an IPv4 datagram that contains a TCP segment
     std::optional<TCPSegment> read();
 
-    //! Sends a TCP segment (in an IPv4 datagram, in an Ethernet frame).
+    //! \brief Has `loop` read Ethernet frames, calling `on_segment` with each TCP segment related to the
+    //! current connection
+    //! \details Frames the NetworkInterface sends in reply (e.g. to ARP requests) are queued on `loop`.
+    EventRuleId add_receiver(IoUringEventLoop &loop, const std::function<void(TCPSegment &&)> &on_segment);
+
+    //! \brief Sends a TCP segment (in an IPv4 datagram, in an Ethernet frame).
+    //! \details The segment counts as sent once its frame is queued: if the TAP device can't take
+    //! the frame yet, it stays queued (see frames_pending()) rather than the write failing.
     void write(TCPSegment &seg);
 
+    //! \brief Sends a TCP segment, queueing its frame (and any others pending) for `loop` to write
+    //! \details Frames queued this way are never left pending.
+    void queue_write(IoUringEventLoop &loop, TCPSegment &seg);
+
+    //! Sends any pending Ethernet frames, stopping (and keeping the rest) if the TAP device is full
+    void send_pending();
+
+    //! Are there frames the TAP device couldn't take yet?
+    bool frames_pending() const { return not _interface.frames_out().empty(); }
+
     //! Called periodically when time elapses
     void tick(const size_t ms_since_last_tick);
 
+    //! Milliseconds until tick() next has something to do (i.e. an ARP timer expires)
+    std::optional<uint64_t> time_until_next_timer() const { return _interface.time_until_next_timer(); }
+
     //! Access the underlying raw Ethernet connection
     operator TapFD &() { return _tap; }
 
@@ -33,3 +33,17 @@ optional<WrappingInt32> TCPReceiver::ackno() const {
 }
 
 size_t TCPReceiver::window_size() const { return _capacity - _reassembler.stream_out().buffer_size(); }
+
+void TCPReceiver::checkpoint(CheckpointWriter &out) const {
+    out.put(_capacity);
+    out.put(_set_syn_flag);
+    out.put(_isn.raw_value());
+    _reassembler.checkpoint(out);
+}
+
+void TCPReceiver::restore(CheckpointReader &in) {
+    _capacity = in.get<size_t>();
+    _set_syn_flag = in.get<bool>();
+    _isn = WrappingInt32{in.get<uint32_t>()};
+    _reassembler.restore(in);
+}
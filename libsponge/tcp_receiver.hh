@@ -57,6 +57,9 @@ class TCPReceiver {
     //! \brief number of bytes stored but not yet reassembled
     size_t unassembled_bytes() const { return _reassembler.unassembled_bytes(); }
 
+    //! \brief number of separate substrings stored but not yet reassembled
+    size_t unassembled_fragments() const { return _reassembler.unassembled_fragments(); }
+
     //! \brief handle an inbound segment
     void segment_received(const TCPSegment &seg);
 
@@ -65,6 +68,12 @@ class TCPReceiver {
     ByteStream &stream_out() { return _reassembler.stream_out(); }
     const ByteStream &stream_out() const { return _reassembler.stream_out(); }
     //!@}
+
+    //! \brief Append the receiver's state (including its reassembler) to a checkpoint
+    void checkpoint(CheckpointWriter &out) const;
+
+    //! \brief Replace the receiver's state with one read from a checkpoint
+    void restore(CheckpointReader &in);
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_RECEIVER_HH
@@ -29,6 +29,7 @@ uint64_t TCPSender::bytes_in_flight() const { return _bytes_int_flight; }
 void TCPSender::fill_window() {
     // 如果远程窗口大小为 0, 则把其视为 1 进行操作
     size_t window_size = _window_size ? _window_size : 1;
+    bool segment_sent = false;
     // 循环填充窗口
     while (window_size > _bytes_int_flight) {
         // 尝试构造单个数据包
@@ -41,9 +42,15 @@ void TCPSender::fill_window() {
         // 设置 seqno
         segment.header().seqno = next_seqno();
 
+        // 如果发送策略要求暂缓发送不满的数据包，则等待更多数据、ACK 或 flush
+        if (!segment.header().syn && _hold_small_segment())
+            break;
+
         // 装入 payload.
         const size_t payload_size = min(TCPConfig::MAX_PAYLOAD_SIZE, window_size - _bytes_int_flight - segment.header().syn);
-        std::string payload = _stream.read(payload_size);
+        // payload 直接读进带 headroom 的 PacketBuffer，序列化时各层头部可以就地写在它前面
+        PacketBuffer payload{min(payload_size, _stream.buffer_size())};
+        _stream.read(payload, payload_size);
 
         /**
          * 读取好后，如果满足以下条件，则增加 FIN
@@ -54,7 +61,7 @@ void TCPSender::fill_window() {
         if (!_set_fin_flag && _stream.eof() && payload.size() + _bytes_int_flight < window_size)
             _set_fin_flag = segment.header().fin = true;
 
-        segment.payload() = Buffer(std::move(payload));
+        segment.payload() = payload.finish();
 
         // 如果没有任何数据，则停止数据包的发送
         if (segment.length_in_sequence_space() == 0)
@@ -63,27 +70,34 @@ void TCPSender::fill_window() {
         // 如果没有正在等待的数据包，则重设更新时间
         if (_segments_in_flight.empty()) {
             _retransmission_timeout = _initial_retransmission_timeout;
-            _retransmission_timer = 0;
+            _restart_retransmission_timer();
         }
 
-        // 发送
-        _segments_out.push(segment);
+        const size_t length = segment.length_in_sequence_space();
+        const bool fin = segment.header().fin;
 
-        // 追踪这些数据包
-        _bytes_int_flight += segment.length_in_sequence_space();
-        _segments_in_flight.insert(make_pair(_next_seqno, segment));
+        // 追踪这些数据包，并记录发送时间（重传需要保留一份，payload 是共享的）
+        _bytes_int_flight += length;
+        _segments_in_flight.insert(make_pair(_next_seqno, OutstandingSegment{segment, _timers.now(), false}));
         // 更新待发送 abs seqno
-        _next_seqno += segment.length_in_sequence_space();
+        _next_seqno += length;
+
+        // 发送
+        _segments_out.push_back(move(segment));
+        segment_sent = true;
 
         // 如果设置了 fin，则直接退出填充 window 的操作
-        if (segment.header().fin)
+        if (fin)
             break;
     }
+    if (segment_sent)
+        _arm_tlp();
 }
 
 //! \param ackno The remote receiver's ackno (acknowledgment number)
 //! \param window_size The remote receiver's advertised window size
-void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_size) {
+//! \param carries_data Whether the acknowledging segment also carried a payload, SYN or FIN
+void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_size, const bool carries_data) {
     bool has_set_flag = false;
     size_t abs_seqno = unwrap(ackno, _isn, _next_seqno);
     // 如果传入的 ack 是不可靠的，则直接丢弃
@@ -92,14 +106,16 @@ void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_si
     // 遍历数据结构，将已经接收到的数据包丢弃
     for (auto iter = _segments_in_flight.begin(); iter != _segments_in_flight.end();) {
         // 如果一个发送的数据包已经被成功接收
-        const TCPSegment &seg = iter->second;
+        const TCPSegment &seg = iter->second.segment;
         if (iter->first + seg.length_in_sequence_space() <= abs_seqno) {
+            // 未经重传的数据包可以提供 RTT 样本
+            if (!iter->second.retransmitted)
+                _update_rtt(_timers.now() - iter->second.sent_time);
             _bytes_int_flight -= seg.length_in_sequence_space();
             iter = _segments_in_flight.erase(iter);
 
             if (!has_set_flag) {
                 _retransmission_timeout = _initial_retransmission_timeout;
-                _retransmission_timer = 0;
                 _consecutive_retransmissions_count = 0;
                 has_set_flag = true;
             }
@@ -108,31 +124,300 @@ void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_si
         else
             break;
     }
+
+    if (has_set_flag) {
+        // 有新数据被确认则重新计时，全部确认后停止计时
+        if (_segments_in_flight.empty())
+            _timers.cancel(_retransmission_timer);
+        else
+            _restart_retransmission_timer();
+        // 新数据被确认，说明之前的探测已经得到了回应
+        _dup_acks = 0;
+        _timers.cancel(_rack_timer);
+        _tlp_outstanding = false;
+        _timers.cancel(_tlp_timer);
+    } else if (!carries_data && !_segments_in_flight.empty() && abs_seqno == _segments_in_flight.begin()->first &&
+               window_size == _window_size) {
+        // 重复的 ACK 说明对方收到了后面的数据包，第一个数据包可能已经丢失
+        // （携带数据、SYN 或 FIN 的不算，乱序到达的旧 ACK 也不算）
+        _dup_acks++;
+        _dup_ack_total++;
+        _rack_detect_loss();
+    }
+
     _window_size = window_size;
     fill_window();
+    if (has_set_flag)
+        _arm_tlp();
 }
 
 //! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
+//! \details Expired timers are only noted while the clock advances and handled once it has reached the
+//! end of the tick, so at most one retransmission happens per call however long the tick is.
 void TCPSender::tick(const size_t ms_since_last_tick) {
-    _retransmission_timer += ms_since_last_tick;
+    if (_window_size == 0)
+        _zero_window_time += ms_since_last_tick;
+
+    bool retransmission_due = false;
+    bool rack_due = false;
+    bool tlp_due = false;
+    _timers.advance(ms_since_last_tick, [&](const Timer timer) {
+        switch (timer) {
+            case Timer::Retransmission:
+                retransmission_due = true;
+                break;
+            case Timer::RackReorder:
+                rack_due = true;
+                break;
+            case Timer::TailLossProbe:
+                tlp_due = true;
+                break;
+        }
+    });
 
     auto iter = _segments_in_flight.begin();
     // 如果存在发送中的数据包，并且定时器超时
-    if (iter != _segments_in_flight.end() && _retransmission_timer >= _retransmission_timeout) {
-        _segments_out.push(iter->second);
+    if (iter != _segments_in_flight.end() && retransmission_due) {
+        _segments_out.push_back(iter->second.segment);
+        iter->second.sent_time = _timers.now();
+        iter->second.retransmitted = true;
+        _retransmission_total++;
         // 如果窗口大小不为0还超时，则说明网络拥堵
         if (_window_size > 0) {
             _retransmission_timeout *= 2;
             _consecutive_retransmissions_count++;
         }
-        _retransmission_timer = 0;
+        _restart_retransmission_timer();
+        // RTO 已经处理了丢包，之前的 RACK/TLP 计划作废
+        _timers.cancel(_rack_timer);
+        _timers.cancel(_tlp_timer);
+        return;
+    }
+
+    // RACK 的重排序窗口已过，第一个数据包仍未被确认
+    if (rack_due)
+        _rack_detect_loss();
+
+    // 尾部丢包探测：优先发送新数据，否则重传最后一个数据包
+    if (tlp_due && !_segments_in_flight.empty()) {
+        _tlp_outstanding = true;
+        const uint64_t next_seqno_before_probe = _next_seqno;
+        fill_window();
+        if (_next_seqno == next_seqno_before_probe)
+            _retransmit(_segments_in_flight.rbegin()->second);
     }
 }
 
+//! \param[in] enabled whether to detect losses with RACK-TLP, as well as the RTO
+void TCPSender::set_rack_tlp(const bool enabled) {
+    _rack_tlp = enabled;
+    if (!enabled) {
+        // 关闭后只剩 RTO，尚未到期的 RACK/TLP 计划作废
+        _timers.cancel(_rack_timer);
+        _timers.cancel(_tlp_timer);
+        _tlp_outstanding = false;
+    }
+}
+
+void TCPSender::mark_in_flight_retransmitted() {
+    // 按 Karn 算法，重传过的数据包不提供 RTT 样本
+    for (auto &in_flight : _segments_in_flight)
+        in_flight.second.retransmitted = true;
+}
+
+//! \param[in] rtt a round-trip time sample, in milliseconds
+//! \details Follows the estimator of [RFC 6298](\ref rfc::rfc6298), section 2. The samples also
+//! drive RACK, which uses the RTT of the most recently delivered segment.
+void TCPSender::_update_rtt(const uint64_t rtt) {
+    if (!_srtt.has_value()) {
+        _srtt = rtt;
+        _rttvar = rtt / 2;
+        _min_rtt = rtt;
+    } else {
+        const uint64_t srtt = _srtt.value();
+        _rttvar = (3 * _rttvar + (srtt > rtt ? srtt - rtt : rtt - srtt)) / 4;
+        _srtt = (7 * srtt + rtt) / 8;
+        _min_rtt = min(_min_rtt, rtt);
+    }
+    _rack_rtt = rtt;
+}
+
+//! \details TCP options (and so SACK) aren't supported, so the only evidence that a later segment was
+//! delivered is a duplicate ACK. Once one arrives, the first unacknowledged segment is declared lost
+//! when it has been outstanding for longer than the latest RTT plus a reordering window of a quarter
+//! of the minimum RTT (RFC 8985, section 6.2). If that hasn't happened yet,
+//! a timer checks again when it will have.
+void TCPSender::_rack_detect_loss() {
+    _timers.cancel(_rack_timer);
+    if (!_rack_tlp || !_srtt.has_value() || _segments_in_flight.empty() || _dup_acks == 0)
+        return;
+
+    OutstandingSegment &first = _segments_in_flight.begin()->second;
+    const uint64_t deadline = first.sent_time + _rack_rtt + _min_rtt / 4;
+    if (_timers.now() < deadline) {
+        _rack_timer = _timers.arm(deadline - _timers.now(), Timer::RackReorder);
+        return;
+    }
+
+    _retransmit(first);
+    _dup_acks = 0;
+}
+
+//! \details The probe timeout is twice the smoothed RTT (RFC 8985, section 7.2).
+//! Only one probe is sent per flight; the next ACK of new data allows another.
+void TCPSender::_arm_tlp() {
+    _timers.cancel(_tlp_timer);
+    if (!_rack_tlp || !_srtt.has_value() || _segments_in_flight.empty() || _tlp_outstanding)
+        return;
+
+    const uint64_t pto = max(2 * _srtt.value(), TLP_MIN_TIMEOUT);
+    // 如果 RTO 会先超时，则不需要探测
+    const auto rto_remaining = _timers.time_until(_retransmission_timer);
+    if (rto_remaining.has_value() && pto >= rto_remaining.value())
+        return;
+    _tlp_timer = _timers.arm(pto, Timer::TailLossProbe);
+}
+
+//! \param[in] outstanding the segment to send again
+void TCPSender::_retransmit(OutstandingSegment &outstanding) {
+    _segments_out.push_back(outstanding.segment);
+    outstanding.sent_time = _timers.now();
+    outstanding.retransmitted = true;
+    _retransmission_total++;
+    // 重传后重新开始计时，但不加倍 RTO
+    _restart_retransmission_timer();
+}
+
+void TCPSender::_restart_retransmission_timer() {
+    _timers.cancel(_retransmission_timer);
+    _retransmission_timer = _timers.arm(_retransmission_timeout, Timer::Retransmission);
+}
+
+//! \details A segment is "small" if the outbound stream holds less than TCPConfig::MAX_PAYLOAD_SIZE
+//! bytes and the writer hasn't ended its input (so the FIN is never delayed). Under
+//! TCPConfig::SendPolicy::Nagle a small segment waits while any data is unacknowledged;
+//! under TCPConfig::SendPolicy::Cork it waits until flush() is called.
+bool TCPSender::_hold_small_segment() const {
+    if (_send_policy == TCPConfig::SendPolicy::NoDelay || _flush_requested)
+        return false;
+    // 数据足够装满一个数据包，或者已经可以发送 FIN，则不需要等待
+    if (_stream.buffer_size() >= TCPConfig::MAX_PAYLOAD_SIZE || _stream.input_ended())
+        return false;
+    if (_send_policy == TCPConfig::SendPolicy::Nagle)
+        return _bytes_int_flight > 0;
+    return true;
+}
+
+void TCPSender::flush() {
+    _flush_requested = true;
+    fill_window();
+    _flush_requested = false;
+}
+
+uint64_t TCPSender::bytes_acked() const {
+    // 已确认的序号中减去 SYN，以及已确认的 FIN
+    const uint64_t acked = _next_seqno - _bytes_int_flight;
+    if (acked == 0)
+        return 0;
+    return acked - 1 - (_set_fin_flag && _bytes_int_flight == 0);
+}
+
 unsigned int TCPSender::consecutive_retransmissions() const { return _consecutive_retransmissions_count; }
 
 void TCPSender::send_empty_segment() {
     TCPSegment segment;
     segment.header().seqno = next_seqno();
-    _segments_out.push(segment);
-}
\ No newline at end of file
+    _segments_out.push_back(move(segment));
+}
+//! \details Timers are stored as the time left until they fire, along with the clock itself
+//! (which the send times of the segments in flight refer to), so that the restored sender
+//! picks up exactly where this one stopped.
+void TCPSender::checkpoint(CheckpointWriter &out) const {
+    out.put(_isn.raw_value());
+    out.put(_initial_retransmission_timeout);
+    out.put(_retransmission_timeout);
+    out.put(_next_seqno);
+    out.put(_bytes_int_flight);
+    out.put(_window_size);
+    out.put(_set_syn_flag);
+    out.put(_set_fin_flag);
+    out.put(_consecutive_retransmissions_count);
+    out.put(_send_policy);
+    out.put(_rack_tlp);
+    out.put(_srtt);
+    out.put(_rttvar);
+    out.put(_min_rtt);
+    out.put(_rack_rtt);
+    out.put(_dup_acks);
+    out.put(_tlp_outstanding);
+    out.put(_retransmission_total);
+    out.put(_dup_ack_total);
+    out.put(_zero_window_time);
+
+    out.put(_timers.now());
+    out.put(_timers.time_until(_retransmission_timer));
+    out.put(_timers.time_until(_rack_timer));
+    out.put(_timers.time_until(_tlp_timer));
+
+    out.put<uint64_t>(_segments_in_flight.size());
+    for (const auto &[seqno, outstanding] : _segments_in_flight) {
+        out.put(seqno);
+        out.put(outstanding.sent_time);
+        out.put(outstanding.retransmitted);
+        outstanding.segment.checkpoint(out);
+    }
+    out.put<uint64_t>(_segments_out.size());
+    for (const TCPSegment &segment : _segments_out)
+        segment.checkpoint(out);
+
+    _stream.checkpoint(out);
+}
+
+void TCPSender::restore(CheckpointReader &in) {
+    _isn = WrappingInt32{in.get<uint32_t>()};
+    _initial_retransmission_timeout = in.get<unsigned int>();
+    _retransmission_timeout = in.get<unsigned int>();
+    _next_seqno = in.get<uint64_t>();
+    _bytes_int_flight = in.get<size_t>();
+    _window_size = in.get<size_t>();
+    _set_syn_flag = in.get<bool>();
+    _set_fin_flag = in.get<bool>();
+    _consecutive_retransmissions_count = in.get<size_t>();
+    _send_policy = in.get_enum(TCPConfig::SendPolicy::Cork);
+    _rack_tlp = in.get<bool>();
+    _srtt = in.get_optional<uint64_t>();
+    _rttvar = in.get<uint64_t>();
+    _min_rtt = in.get<uint64_t>();
+    _rack_rtt = in.get<uint64_t>();
+    _dup_acks = in.get<size_t>();
+    _tlp_outstanding = in.get<bool>();
+    _retransmission_total = in.get<uint64_t>();
+    _dup_ack_total = in.get<uint64_t>();
+    _zero_window_time = in.get<uint64_t>();
+
+    // 把时钟拨到原来的时间，再按剩余时间重新设置定时器
+    _timers = TimerWheel<Timer>{};
+    _timers.advance(in.get<uint64_t>(), [](const Timer) {});
+    const auto rearm = [&](TimerId &id, const Timer timer) {
+        const auto remaining = in.get_optional<uint64_t>();
+        id = remaining.has_value() ? _timers.arm(remaining.value(), timer) : TimerId{};
+    };
+    rearm(_retransmission_timer, Timer::Retransmission);
+    rearm(_rack_timer, Timer::RackReorder);
+    rearm(_tlp_timer, Timer::TailLossProbe);
+
+    _segments_in_flight.clear();
+    for (uint64_t count = in.get<uint64_t>(); count > 0; count--) {
+        const size_t seqno = in.get<size_t>();
+        OutstandingSegment outstanding{TCPSegment{}, in.get<uint64_t>(), in.get<bool>()};
+        outstanding.segment.restore(in);
+        _segments_in_flight.emplace_hint(_segments_in_flight.end(), seqno, move(outstanding));
+    }
+    _segments_out.clear();
+    for (uint64_t count = in.get<uint64_t>(); count > 0; count--) {
+        _segments_out.emplace_back();
+        _segments_out.back().restore(in);
+    }
+
+    _stream.restore(in);
+}
@@ -2,13 +2,16 @@
 #define SPONGE_LIBSPONGE_TCP_SENDER_HH
 
 #include "byte_stream.hh"
+#include "checkpoint.hh"
 #include "tcp_config.hh"
 #include "tcp_segment.hh"
+#include "timer_wheel.hh"
 #include "wrapping_integers.hh"
 
 #include <functional>
 #include <map>
-#include <queue>
+#include <optional>
+#include <vector>
 
 //! \brief The "sender" part of a TCP implementation.
 
@@ -19,9 +22,23 @@
 class TCPSender {
 private:
     unsigned int _retransmission_timeout{0};
-    unsigned int _retransmission_timer{0};
 
-    std::map<size_t, TCPSegment> _segments_in_flight{};
+    //! The sender's timers
+    enum class Timer { Retransmission, RackReorder, TailLossProbe };
+
+    //! Clock and timers of the sender; the clock is the total of the milliseconds passed to tick()
+    TimerWheel<Timer> _timers{};
+
+    TimerId _retransmission_timer{};  //!< runs while segments are in flight
+
+    //! A segment that has been sent but not yet acknowledged
+    struct OutstandingSegment {
+        TCPSegment segment;  //!< the segment as it was sent
+        uint64_t sent_time;  //!< time (on the _timers clock) when the segment was last (re)transmitted
+        bool retransmitted;  //!< retransmitted segments don't give RTT samples (Karn's algorithm)
+    };
+
+    std::map<size_t, OutstandingSegment> _segments_in_flight{};
     size_t _bytes_int_flight{0};
 
     size_t _window_size{1};
@@ -31,11 +48,55 @@ private:
 
     size_t _consecutive_retransmissions_count{0};
 
+    //! how small writes are coalesced before being sent
+    TCPConfig::SendPolicy _send_policy{TCPConfig::SendPolicy::NoDelay};
+
+    //! set by flush() to release a segment held back by the send policy
+    bool _flush_requested{false};
+
+    //! Should a segment that can't be filled to MAX_PAYLOAD_SIZE be held back for now?
+    bool _hold_small_segment() const;
+
+    //! \name RACK-TLP loss detection (see TCPConfig::rack_tlp)
+    //!@{
+
+    //! Shortest time the sender waits before sending a Tail Loss Probe, in milliseconds
+    static constexpr uint64_t TLP_MIN_TIMEOUT = 10;
+
+    bool _rack_tlp{false};  //!< Is RACK-TLP enabled?
+
+    std::optional<uint64_t> _srtt{};  //!< Smoothed round-trip time (RFC 6298), empty before the first sample
+    uint64_t _rttvar{0};              //!< Round-trip time variation
+    uint64_t _min_rtt{0};             //!< Smallest round-trip time seen, used for the reordering window
+    uint64_t _rack_rtt{0};            //!< RTT of the most recently sent segment that was acknowledged
+
+    size_t _dup_acks{0};  //!< Duplicate ACKs since the last ACK of new data
+
+    TimerId _rack_timer{};         //!< fires when the first unacknowledged segment is deemed lost
+    TimerId _tlp_timer{};          //!< fires when a Tail Loss Probe is due
+    bool _tlp_outstanding{false};  //!< Has a probe been sent that hasn't been answered yet?
+
+    //! Feed a round-trip time sample into the estimator
+    void _update_rtt(const uint64_t rtt);
+
+    //! Declare the first unacknowledged segment lost if it is older than the RACK reordering window
+    void _rack_detect_loss();
+
+    //! Schedule a Tail Loss Probe for the current flight, unless the RTO would fire first
+    void _arm_tlp();
+
+    //! Retransmit an outstanding segment (without backing off the RTO)
+    void _retransmit(OutstandingSegment &outstanding);
+    //!@}
+
+    //! (Re)start the retransmission timer with the current RTO
+    void _restart_retransmission_timer();
+
     //! our initial sequence number, the number for our SYN.
     WrappingInt32 _isn;
 
-    //! outbound queue of segments that the TCPSender wants sent
-    std::queue<TCPSegment> _segments_out{};
+    //! outbound batch of segments that the TCPSender wants sent
+    std::vector<TCPSegment> _segments_out{};
 
     //! retransmission timer for the connection
     unsigned int _initial_retransmission_timeout;
@@ -46,6 +107,13 @@ private:
     //! the (absolute) sequence number for the next byte to be sent
     uint64_t _next_seqno{0};
 
+    //! \name Statistics (see TCPConnection::info())
+    //!@{
+    uint64_t _retransmission_total{0};  //!< segments retransmitted, for any reason
+    uint64_t _dup_ack_total{0};         //!< duplicate ACKs received
+    uint64_t _zero_window_time{0};      //!< milliseconds passed to tick() while the peer's window was zero
+    //!@}
+
 public:
     //! Initialize a TCPSender
     TCPSender(const size_t capacity = TCPConfig::DEFAULT_CAPACITY,
@@ -62,7 +130,9 @@ public:
     //!@{
 
     //! \brief A new acknowledgment was received
-    void ack_received(const WrappingInt32 ackno, const uint16_t window_size);
+    //! \details `carries_data` says whether the segment with the acknowledgment also carried a payload, SYN
+    //! or FIN: such a segment is never a duplicate ACK (RFC 5681, section 2).
+    void ack_received(const WrappingInt32 ackno, const uint16_t window_size, const bool carries_data = false);
 
     //! \brief Generate an empty-payload segment (useful for creating empty ACK segments)
     void send_empty_segment();
@@ -72,8 +142,33 @@ public:
 
     //! \brief Notifies the TCPSender of the passage of time
     void tick(const size_t ms_since_last_tick);
+
+    //! \brief Send everything in the window, including a small segment held back by the send policy
+    void flush();
+    //!@}
+
+    //! \name Send policy
+    //!@{
+
+    //! \brief Choose how small writes are coalesced (see TCPConfig::SendPolicy)
+    void set_send_policy(const TCPConfig::SendPolicy policy) { _send_policy = policy; }
+
+    //! \brief The current send policy
+    TCPConfig::SendPolicy send_policy() const { return _send_policy; }
     //!@}
 
+    //! \brief Enable or disable RACK-TLP loss detection (see TCPConfig::rack_tlp)
+    void set_rack_tlp(const bool enabled);
+
+    //! \brief Is RACK-TLP loss detection enabled?
+    bool rack_tlp() const { return _rack_tlp; }
+
+    //! \brief Count the segments in flight as retransmitted, so that their acknowledgment gives no RTT sample
+    void mark_in_flight_retransmitted();
+
+    //! \brief Milliseconds until the next call to tick() has something to do, or empty if no timer is armed
+    std::optional<uint64_t> time_until_next_timer() const { return _timers.time_until_next(); }
+
     //! \name Accessors
     //!@{
 
@@ -85,11 +180,11 @@ public:
     //! \brief Number of consecutive retransmissions that have occurred in a row
     unsigned int consecutive_retransmissions() const;
 
-    //! \brief TCPSegments that the TCPSender has enqueued for transmission.
-    //! \note These must be dequeued and sent by the TCPConnection,
+    //! \brief TCPSegments that the TCPSender has enqueued for transmission, oldest first.
+    //! \note These must be taken (moved out and the batch cleared) and sent by the TCPConnection,
     //! which will need to fill in the fields that are set by the TCPReceiver
     //! (ackno and window size) before sending.
-    std::queue<TCPSegment> &segments_out() { return _segments_out; }
+    std::vector<TCPSegment> &segments_out() { return _segments_out; }
     //!@}
 
     //! \name What is the next sequence number? (used for testing)
@@ -101,6 +196,48 @@ public:
     //! \brief relative seqno for the next byte to be sent
     WrappingInt32 next_seqno() const { return wrap(_next_seqno, _isn); }
     //!@}
+
+    //! \name Statistics (see TCPConnection::info())
+    //!@{
+
+    //! \brief Smoothed round-trip time, in milliseconds, or empty before the first sample
+    std::optional<uint64_t> smoothed_rtt() const { return _srtt; }
+
+    //! \brief Round-trip time variation, in milliseconds
+    uint64_t rtt_variation() const { return _rttvar; }
+
+    //! \brief Smallest round-trip time seen, in milliseconds
+    uint64_t min_rtt() const { return _min_rtt; }
+
+    //! \brief Current retransmission timeout, in milliseconds
+    unsigned int retransmission_timeout() const { return _retransmission_timeout; }
+
+    //! \brief Window most recently advertised by the peer
+    size_t window_size() const { return _window_size; }
+
+    //! \brief Number of segments retransmitted, by timeout, by RACK or as a Tail Loss Probe
+    uint64_t retransmissions() const { return _retransmission_total; }
+
+    //! \brief Number of duplicate ACKs received
+    uint64_t duplicate_acks() const { return _dup_ack_total; }
+
+    //! \brief Milliseconds spent with a zero window
+    uint64_t zero_window_time() const { return _zero_window_time; }
+
+    //! \brief Number of bytes of the outgoing stream that the peer has acknowledged
+    uint64_t bytes_acked() const;
+    //!@}
+
+    //! \name Checkpointing
+    //!@{
+
+    //! \brief Append the sender's state to a checkpoint: sequence numbers, the outgoing stream,
+    //! segments in flight and not yet taken, RTT estimates, and the time left on each timer
+    void checkpoint(CheckpointWriter &out) const;
+
+    //! \brief Replace the sender's state with one read from a checkpoint
+    void restore(CheckpointReader &in);
+    //!@}
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_SENDER_HH
\ No newline at end of file
@@ -1,17 +1,58 @@
 #include "buffer.hh"
 
+#include "packet_buffer.hh"
+
 using namespace std;
 
+//! \param[in] slab is the Slab, whose bytes from `offset` to `offset + length` have been filled in
+//! \param[in] offset is where the bytes to view start
+//! \param[in] length is the number of bytes to view
+Buffer::Buffer(Slab &slab, const size_t offset, const size_t length)
+    : _slab(&slab), _view(slab.data() + offset, length) {
+    if (offset > slab.capacity() or length > slab.capacity() - offset) {
+        throw out_of_range("Buffer: length exceeds Slab capacity");
+    }
+    if (_slab->_references++ == 0 or offset < _slab->_front) {
+        _slab->_front = offset;
+    }
+}
+
 void Buffer::remove_prefix(const size_t n) {
     if (n > str().size()) {
         throw out_of_range("Buffer::remove_prefix");
     }
-    _starting_offset += n;
-    if (_storage and _starting_offset == _storage->size()) {
-        _storage.reset();
+    _view.remove_prefix(n);
+    if (_view.empty()) {
+        _reset();
     }
 }
 
+void Buffer::remove_suffix(const size_t n) {
+    if (n > str().size()) {
+        throw out_of_range("Buffer::remove_suffix");
+    }
+    _view.remove_suffix(n);
+    if (_view.empty()) {
+        _reset();
+    }
+}
+
+//! \details The bytes in front of the Buffer are free only if no Buffer has ever viewed them, so the
+//! Buffer must start at the first byte of its Slab that any Buffer has viewed. Copies made before
+//! the call (which start there too) can't prepend afterwards, and keep seeing just their own bytes.
+char *Buffer::prepend(const size_t n) {
+    if (not _slab) {
+        return nullptr;
+    }
+    const auto offset = static_cast<size_t>(_view.data() - _slab->data());
+    if (offset != _slab->_front or n > offset) {
+        return nullptr;
+    }
+    _slab->_front -= n;
+    _view = {_view.data() - n, _view.size() + n};
+    return _slab->data() + _slab->_front;
+}
+
 void BufferList::append(const BufferList &other) {
     for (const auto &buf : other._buffers) {
         _buffers.push_back(buf);
@@ -31,6 +72,25 @@ BufferList::operator Buffer() const {
     }
 }
 
+//! \details The bytes go in the headroom of the first Buffer, if it has room for them. Otherwise they
+//! become a new first Buffer, made with a PacketBuffer so that it has headroom of its own for the
+//! headers that may be prepended next.
+char *BufferList::prepend(const size_t n) {
+    if (not _buffers.empty()) {
+        if (char *const ret = _buffers.front().prepend(n)) {
+            return ret;
+        }
+        // (an empty Buffer with no room in front is of no use)
+        if (_buffers.front().size() == 0) {
+            _buffers.pop_front();
+        }
+    }
+    PacketBuffer bytes{n};
+    char *const ret = bytes.append(n);
+    _buffers.push_front(bytes.finish());
+    return ret;
+}
+
 string BufferList::concatenate() const {
     std::string ret;
     ret.reserve(size());
@@ -95,10 +155,15 @@ size_t BufferViewList::size() const {
 }
 
 vector<iovec> BufferViewList::as_iovecs() const {
-    vector<iovec> ret;
-    ret.reserve(_views.size());
-    for (const auto &x : _views) {
-        ret.push_back({const_cast<char *>(x.data()), x.size()});
-    }
+    vector<iovec> ret(_views.size());
+    as_iovecs(ret.data(), ret.size());
     return ret;
 }
+
+size_t BufferViewList::as_iovecs(iovec *iovecs, const size_t capacity) const {
+    const size_t count = min(capacity, _views.size());
+    for (size_t i = 0; i < count; i++) {
+        iovecs[i] = {const_cast<char *>(_views[i].data()), _views[i].size()};
+    }
+    return count;
+}
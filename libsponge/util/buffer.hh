@@ -1,36 +1,118 @@
 #ifndef SPONGE_LIBSPONGE_BUFFER_HH
 #define SPONGE_LIBSPONGE_BUFFER_HH
 
+#include "small_vector.hh"
+
 #include <algorithm>
-#include <deque>
+#include <array>
 #include <memory>
 #include <numeric>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <sys/uio.h>
+#include <utility>
 #include <vector>
 
+struct SlabFreeList;
+
+//! \brief A fixed-size block of memory from a BufferPool or a PacketBuffer, reference-counted by the Buffers that view it
+//! \details The count isn't atomic: a Slab and the Buffers viewing it belong to one thread at a time.
+class Slab {
+  private:
+    friend class Buffer;
+    friend class BufferPool;
+    friend class PacketBuffer;
+
+    std::unique_ptr<char[]> _data;
+    size_t _capacity;
+    size_t _references{0};
+    size_t _front{0};  //!< Where the first byte any Buffer has viewed is (what comes before is free headroom)
+    std::shared_ptr<SlabFreeList> _free_list{};  //!< Where a BufferPool's Slab goes once no Buffer views it
+    void (*_recycle)(Slab *){nullptr};          //!< Called once no Buffer views the Slab (if null, it is freed)
+
+    explicit Slab(const size_t capacity) : _data(std::make_unique<char[]>(capacity)), _capacity(capacity) {}
+
+    //! Recycle `slab` (or free it, if no one recycles it)
+    static void release(Slab *slab) {
+        if (slab->_recycle) {
+            slab->_recycle(slab);
+        } else {
+            delete slab;
+        }
+    }
+
+  public:
+    //! \brief The memory, to fill before making a Buffer of it
+    char *data() { return _data.get(); }
+
+    //! \brief Size of the memory
+    size_t capacity() const { return _capacity; }
+};
+
 //! \brief A reference-counted read-only string that can discard bytes from the front
+//! \details The string is either a std::string the Buffer took ownership of, or part of a Slab.
 class Buffer {
   private:
     std::shared_ptr<std::string> _storage{};
-    size_t _starting_offset{};
+    Slab *_slab{nullptr};
+    std::string_view _view{};  //!< The part of the storage not yet discarded
+
+    //! Let go of the storage
+    void _reset() {
+        _storage.reset();
+        if (_slab and --_slab->_references == 0) {
+            Slab::release(_slab);
+        }
+        _slab = nullptr;
+        _view = {};
+    }
 
   public:
     Buffer() = default;
 
     //! \brief Construct by taking ownership of a string
-    Buffer(std::string &&str) noexcept : _storage(std::make_shared<std::string>(std::move(str))) {}
+    Buffer(std::string &&str) noexcept : _storage(std::make_shared<std::string>(std::move(str))), _view(*_storage) {}
 
-    //! \name Expose contents as a std::string_view
+    //! \brief Construct viewing the first `length` bytes of a Slab (see BufferPool)
+    Buffer(Slab &slab, const size_t length) : Buffer(slab, 0, length) {}
+
+    //! \brief Construct viewing `length` bytes of a Slab, starting `offset` bytes in (see PacketBuffer)
+    Buffer(Slab &slab, const size_t offset, const size_t length);
+
+    //! \name Copy/move constructor/assignment operators
     //!@{
-    std::string_view str() const {
-        if (not _storage) {
-            return {};
+    Buffer(const Buffer &other) : _storage(other._storage), _slab(other._slab), _view(other._view) {
+        if (_slab) {
+            _slab->_references++;
         }
-        return {_storage->data() + _starting_offset, _storage->size() - _starting_offset};
     }
+    Buffer(Buffer &&other) noexcept
+        : _storage(std::move(other._storage)), _slab(std::exchange(other._slab, nullptr)), _view(other._view) {
+        other._view = {};
+    }
+    Buffer &operator=(const Buffer &other) {
+        if (this != &other) {
+            Buffer copy{other};
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+    Buffer &operator=(Buffer &&other) noexcept {
+        if (this != &other) {
+            _reset();
+            _storage = std::move(other._storage);
+            _slab = std::exchange(other._slab, nullptr);
+            _view = std::exchange(other._view, {});
+        }
+        return *this;
+    }
+    ~Buffer() { _reset(); }
+    //!@}
+
+    //! \name Expose contents as a std::string_view
+    //!@{
+    std::string_view str() const { return _view; }
 
     operator std::string_view() const { return str(); }
     //!@}
@@ -47,6 +129,13 @@ class Buffer {
     //! \brief Discard the first `n` bytes of the string (does not require a copy or move)
     //! \note Doesn't free any memory until the whole string has been discarded in all copies of the Buffer.
     void remove_prefix(const size_t n);
+
+    //! \brief Discard the last `n` bytes of the string (does not require a copy or move)
+    void remove_suffix(const size_t n);
+
+    //! \brief Grow the string by `n` bytes at the front, into free headroom of its Slab (see PacketBuffer)
+    //! \returns where to write the new bytes, or `nullptr` if there isn't room for them
+    char *prepend(const size_t n);
 };
 
 //! \brief A reference-counted discontiguous string that can discard bytes from the front
@@ -55,8 +144,12 @@ class Buffer {
 //! encapsulate a TCP payload in a TCPSegment, and then encapsulate
 //! the TCPSegment in an IPv4Datagram) without copying the payload.
 class BufferList {
+  public:
+    //! Buffers held without allocating (e.g. Ethernet, IPv4 and TCP headers and a payload)
+    static constexpr size_t INLINE_CAPACITY = 4;
+
   private:
-    std::deque<Buffer> _buffers{};
+    SmallVector<Buffer, INLINE_CAPACITY> _buffers{};
 
   public:
     //! \name Constructors
@@ -65,7 +158,7 @@ class BufferList {
     BufferList() = default;
 
     //! \brief Construct from a Buffer
-    BufferList(Buffer buffer) : _buffers{buffer} {}
+    BufferList(Buffer buffer) { append(std::move(buffer)); }
 
     //! \brief Construct by taking ownership of a std::string
     BufferList(std::string &&str) noexcept {
@@ -74,12 +167,19 @@ class BufferList {
     }
     //!@}
 
-    //! \brief Access the underlying queue of Buffers
-    const std::deque<Buffer> &buffers() const { return _buffers; }
+    //! \brief Access the underlying sequence of Buffers
+    const SmallVector<Buffer, INLINE_CAPACITY> &buffers() const { return _buffers; }
 
     //! \brief Append a BufferList
     void append(const BufferList &other);
 
+    //! \brief Append a Buffer (without making a BufferList of it first)
+    void append(Buffer buffer) { _buffers.push_back(std::move(buffer)); }
+
+    //! \brief Grow the string by `n` bytes at the front (e.g. to put a header in front of a payload)
+    //! \returns where to write the new bytes
+    char *prepend(const size_t n);
+
     //! \brief Transform to a Buffer
     //! \note Throws an exception unless BufferList is contiguous
     operator Buffer() const;
@@ -96,7 +196,7 @@ class BufferList {
 
 //! \brief A non-owning temporary view (similar to std::string_view) of a discontiguous string
 class BufferViewList {
-    std::deque<std::string_view> _views{};
+    SmallVector<std::string_view, BufferList::INLINE_CAPACITY> _views{};
 
   public:
     //! \name Constructors
@@ -121,10 +221,21 @@ class BufferViewList {
     //! \brief Size of the string
     size_t size() const;
 
+    //! \brief Number of discontiguous pieces
+    size_t pieces() const { return _views.size(); }
+
     //! \brief Convert to a vector of `iovec` structures
     //! \note used for system calls that write discontiguous buffers,
     //! e.g. [writev(2)](\ref man2::writev) and [sendmsg(2)](\ref man2::sendmsg)
     std::vector<iovec> as_iovecs() const;
+
+    //! \brief Fill in up to `capacity` `iovec` structures, one per piece from the front, without allocating
+    //! \returns the number filled in (less than pieces() if they don't all fit)
+    size_t as_iovecs(iovec *iovecs, const size_t capacity) const;
+
+    //! \brief Fill in a fixed array of `iovec` structures (see above)
+    template <size_t N>
+    size_t as_iovecs(std::array<iovec, N> &iovecs) const { return as_iovecs(iovecs.data(), N); }
 };
 
 #endif  // SPONGE_LIBSPONGE_BUFFER_HH
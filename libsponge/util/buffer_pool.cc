@@ -0,0 +1,59 @@
+#include "buffer_pool.hh"
+
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+//! \details Called when the last Buffer viewing one of a BufferPool's Slabs is destroyed.
+void BufferPool::_return(Slab *slab) {
+    // (the Slab lets go of its free list while on it, or the list would own itself)
+    const auto free_list = move(slab->_free_list);
+    if (free_list and not free_list->closed and free_list->slabs.size() < free_list->max_free) {
+        free_list->slabs.emplace_back(slab);
+    } else {
+        delete slab;
+    }
+}
+
+//! \param[in] slab_size is the size of each Slab, i.e. the most that can be read into one
+//! \param[in] max_free is the most Slabs to keep for reuse once they are no longer in use
+BufferPool::BufferPool(const size_t slab_size, const size_t max_free)
+    : _slab_size(slab_size), _free_list(make_shared<SlabFreeList>(SlabFreeList{{}, max_free})) {
+    // so that recycling a Slab never allocates
+    _free_list->slabs.reserve(max_free);
+}
+
+BufferPool::~BufferPool() {
+    // (a moved-from pool has no free list)
+    if (_free_list) {
+        _free_list->closed = true;
+        _free_list->slabs.clear();
+    }
+}
+
+Slab &BufferPool::take() {
+    Slab *slab = nullptr;
+    if (_free_list->slabs.empty()) {
+        slab = new Slab(_slab_size);
+    } else {
+        slab = _free_list->slabs.back().release();
+        _free_list->slabs.pop_back();
+    }
+    slab->_free_list = _free_list;
+    slab->_recycle = _return;
+    return *slab;
+}
+
+//! \details For bytes that have to be copied anyway (e.g. a datagram in one of an IoUringEventLoop's
+//! receive buffers, which goes back to the kernel once it has been handled).
+//! \throws std::length_error if `data` doesn't fit in a Slab
+Buffer BufferPool::copy(const string_view data) {
+    if (data.size() > _slab_size) {
+        throw length_error("BufferPool::copy: data is longer than a Slab");
+    }
+    Slab &slab = take();
+    memcpy(slab.data(), data.data(), data.size());
+    return {slab, data.size()};
+}
@@ -0,0 +1,64 @@
+#ifndef SPONGE_LIBSPONGE_BUFFER_POOL_HH
+#define SPONGE_LIBSPONGE_BUFFER_POOL_HH
+
+#include "buffer.hh"
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+//! Slabs a BufferPool has ready to hand out again
+struct SlabFreeList {
+    std::vector<std::unique_ptr<Slab>> slabs{};
+    size_t max_free;      //!< Slabs beyond this many are freed rather than kept
+    bool closed{false};  //!< Has the BufferPool been destroyed?
+};
+
+//! \brief Recycles fixed-size Slabs of memory to read packets into
+//!
+//! take() hands out a Slab, allocating one only if none is free. A Buffer made from it (see
+//! Buffer(Slab &, size_t)) and the Buffer's copies keep the Slab, which goes back to the pool's
+//! free list when the last of them is destroyed. So once a pool has warmed up, reading a packet
+//! into a Buffer (see FileDescriptor::read(BufferPool &)) and parsing it allocates nothing.
+//!
+//! A BufferPool, its Slabs and the Buffers viewing them belong to one thread. Slabs still in use
+//! when the pool is destroyed are freed when the last Buffer lets go of them.
+class BufferPool {
+  private:
+    size_t _slab_size;
+    std::shared_ptr<SlabFreeList> _free_list;
+
+    //! Put `slab` back on its free list (or free it, if the list is full or its BufferPool is gone)
+    static void _return(Slab *slab);
+
+  public:
+    //! \brief Construct a pool of `slab_size`-byte Slabs, keeping up to `max_free` of them for reuse
+    explicit BufferPool(const size_t slab_size, const size_t max_free = 64);
+
+    //! \brief Free the Slabs not in use
+    ~BufferPool();
+
+    //! \brief Size of each Slab
+    size_t slab_size() const { return _slab_size; }
+
+    //! \brief Slabs ready to be handed out without allocating
+    size_t free_slabs() const { return _free_list->slabs.size(); }
+
+    //! \brief A Slab to fill and make a Buffer of (it returns to the pool once no Buffer views it)
+    Slab &take();
+
+    //! \brief A Buffer of a copy of `data`, in a Slab from the pool
+    Buffer copy(const std::string_view data);
+
+    //! \name
+    //! A BufferPool can be moved, but not copied
+    //!@{
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+    BufferPool(BufferPool &&) = default;
+    BufferPool &operator=(BufferPool &&) = default;
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_BUFFER_POOL_HH
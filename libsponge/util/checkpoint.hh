@@ -0,0 +1,141 @@
+#ifndef SPONGE_LIBSPONGE_CHECKPOINT_HH
+#define SPONGE_LIBSPONGE_CHECKPOINT_HH
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+//! \brief Appends the state of an object to a binary checkpoint
+//! \details Values are stored as their in-memory representation (copied with memcpy, in host
+//! byte order and without padding), and byte strings as a length followed by the bytes, so
+//! writing a checkpoint costs little more than copying the buffers it contains. A checkpoint
+//! can only be read by a build of the same code on a machine with the same byte order.
+class CheckpointWriter {
+  private:
+    std::string _blob{};
+
+  public:
+    //! \brief Construct, reserving room for `size_hint` bytes
+    explicit CheckpointWriter(const size_t size_hint = 0) { _blob.reserve(size_hint); }
+
+    //! \brief Append a value of a trivially copyable type (an integer, `bool`, enum, ...)
+    //! \details A `bool` is stored as one byte, 0 or 1, and an enum as its underlying integer.
+    template <typename T>
+    void put(const T &value) {
+        static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable values can be copied out");
+        if constexpr (std::is_same_v<T, bool>) {
+            put<uint8_t>(value ? 1 : 0);
+        } else if constexpr (std::is_enum_v<T>) {
+            put(static_cast<std::underlying_type_t<T>>(value));
+        } else {
+            const size_t offset = _blob.size();
+            _blob.resize(offset + sizeof(T));
+            std::memcpy(_blob.data() + offset, &value, sizeof(T));
+        }
+    }
+
+    //! \brief Append an optional value, as a presence flag followed by the value if there is one
+    template <typename T>
+    void put(const std::optional<T> &value) {
+        put(value.has_value());
+        if (value.has_value()) {
+            put(value.value());
+        }
+    }
+
+    //! \brief Append a byte string, preceded by its length
+    void put_bytes(const std::string_view bytes) {
+        put<uint64_t>(bytes.size());
+        _blob.append(bytes);
+    }
+
+    //! \brief Number of bytes written so far
+    size_t size() const { return _blob.size(); }
+
+    //! \brief Take the checkpoint, leaving the writer empty
+    std::string release() { return std::move(_blob); }
+};
+
+//! \brief Reads back, in the same order, what a CheckpointWriter wrote
+//! \details Every read is bounds-checked; a checkpoint that ends early throws std::runtime_error
+//! rather than leaving the object half-restored with garbage.
+class CheckpointReader {
+  private:
+    std::string_view _blob;
+
+    void _check_size(const size_t size) const {
+        if (size > _blob.size()) {
+            throw std::runtime_error("checkpoint is truncated");
+        }
+    }
+
+  public:
+    //! \brief Construct from a checkpoint (which must outlive the reader)
+    explicit CheckpointReader(const std::string_view blob) : _blob(blob) {}
+
+    //! \brief Read a value written by CheckpointWriter::put()
+    //! \details A `bool` that isn't 0 or 1 throws std::runtime_error (copying any other byte into
+    //! a `bool` would be undefined behavior). Enums are read with get_enum() instead.
+    template <typename T>
+    T get() {
+        static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable values can be copied in");
+        static_assert(not std::is_enum_v<T>, "read enums with get_enum(), which range-checks them");
+        if constexpr (std::is_same_v<T, bool>) {
+            const uint8_t byte = get<uint8_t>();
+            if (byte > 1) {
+                throw std::runtime_error("checkpoint has a bool that is neither true nor false");
+            }
+            return byte == 1;
+        } else {
+            _check_size(sizeof(T));
+            T value;
+            std::memcpy(&value, _blob.data(), sizeof(T));
+            _blob.remove_prefix(sizeof(T));
+            return value;
+        }
+    }
+
+    //! \brief Read an enum written by CheckpointWriter::put(), whose enumerators run from 0 to `last`
+    //! \details An underlying value outside that range throws std::runtime_error.
+    template <typename T>
+    T get_enum(const T last) {
+        static_assert(std::is_enum_v<T>, "get_enum() reads enums");
+        using Underlying = std::underlying_type_t<T>;
+        const Underlying value = get<Underlying>();
+        bool negative = false;
+        if constexpr (std::is_signed_v<Underlying>) {
+            negative = value < 0;
+        }
+        if (negative or value > static_cast<Underlying>(last)) {
+            throw std::runtime_error("checkpoint has an out-of-range enum value");
+        }
+        return static_cast<T>(value);
+    }
+
+    //! \brief Read an optional value written by CheckpointWriter::put()
+    template <typename T>
+    std::optional<T> get_optional() {
+        if (not get<bool>()) {
+            return std::nullopt;
+        }
+        return get<T>();
+    }
+
+    //! \brief Read a byte string written by CheckpointWriter::put_bytes()
+    std::string get_bytes() {
+        const uint64_t size = get<uint64_t>();
+        _check_size(size);
+        std::string bytes{_blob.substr(0, size)};
+        _blob.remove_prefix(size);
+        return bytes;
+    }
+
+    //! \brief Number of bytes not yet read
+    size_t remaining() const { return _blob.size(); }
+};
+
+#endif  // SPONGE_LIBSPONGE_CHECKPOINT_HH
@@ -0,0 +1,126 @@
+#include "checksum_kernels.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <endian.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+//! One's-complement addition: a carry out of the top bit comes back in at the bottom
+uint64_t add_with_carry(const uint64_t a, const uint64_t b) {
+    const uint64_t sum = a + b;
+    return sum + (sum < a);
+}
+
+//! The most blocks a vector kernel adds up before emptying its 32-bit lanes (each lane takes one
+//! 16-bit word per block, so 65535 of them can't overflow it)
+constexpr size_t MAX_BLOCKS_PER_ROUND = 65535;
+
+}  // namespace
+
+uint64_t checksum_kernels::word64(const char *data, const size_t len) {
+    uint64_t sum = 0;
+    size_t i = 0;
+    // (two sums, so that one add doesn't wait on the other)
+    uint64_t other_sum = 0;
+    for (; len - i >= 16; i += 16) {
+        uint64_t words[2];
+        memcpy(words, data + i, sizeof(words));
+        sum = add_with_carry(sum, words[0]);
+        other_sum = add_with_carry(other_sum, words[1]);
+    }
+    sum = add_with_carry(sum, other_sum);
+    for (; len - i >= 2; i += 2) {
+        uint16_t word = 0;
+        memcpy(&word, data + i, sizeof(word));
+        sum = add_with_carry(sum, word);
+    }
+    return sum;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("sse2"))) uint64_t checksum_kernels::sse2(const char *data, const size_t len) {
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t sum = 0;
+    size_t i = 0;
+    while (len - i >= 16) {
+        const size_t blocks = min((len - i) / 16, MAX_BLOCKS_PER_ROUND);
+        // the low and high four words of each block, widened to 32 bits
+        __m128i low = _mm_setzero_si128();
+        __m128i high = _mm_setzero_si128();
+        for (size_t block = 0; block < blocks; block++, i += 16) {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            low = _mm_add_epi32(low, _mm_unpacklo_epi16(bytes, zero));
+            high = _mm_add_epi32(high, _mm_unpackhi_epi16(bytes, zero));
+        }
+        uint32_t lanes[8];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), low);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes + 4), high);
+        for (const uint32_t lane : lanes) {
+            sum = add_with_carry(sum, lane);
+        }
+    }
+    return add_with_carry(sum, word64(data + i, len - i));
+}
+
+__attribute__((target("avx2"))) uint64_t checksum_kernels::avx2(const char *data, const size_t len) {
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t sum = 0;
+    size_t i = 0;
+    while (len - i >= 32) {
+        const size_t blocks = min((len - i) / 32, MAX_BLOCKS_PER_ROUND);
+        // the low and high four words of each 16-byte half of each block, widened to 32 bits
+        __m256i low = _mm256_setzero_si256();
+        __m256i high = _mm256_setzero_si256();
+        for (size_t block = 0; block < blocks; block++, i += 32) {
+            const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            low = _mm256_add_epi32(low, _mm256_unpacklo_epi16(bytes, zero));
+            high = _mm256_add_epi32(high, _mm256_unpackhi_epi16(bytes, zero));
+        }
+        uint32_t lanes[16];
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), low);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes + 8), high);
+        for (const uint32_t lane : lanes) {
+            sum = add_with_carry(sum, lane);
+        }
+    }
+    return add_with_carry(sum, sse2(data + i, len - i));
+}
+
+bool checksum_kernels::sse2_supported() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+}
+
+bool checksum_kernels::avx2_supported() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+#else
+
+// (no vector kernels on other CPUs: they are never chosen, and fall back to word64() if asked for)
+
+uint64_t checksum_kernels::sse2(const char *data, const size_t len) { return word64(data, len); }
+
+uint64_t checksum_kernels::avx2(const char *data, const size_t len) { return word64(data, len); }
+
+bool checksum_kernels::sse2_supported() { return false; }
+
+bool checksum_kernels::avx2_supported() { return false; }
+
+#endif
+
+uint16_t checksum_kernels::fold_to_network(uint64_t sum) {
+    while (sum > 0xffff) {
+        sum = (sum >> 16) + (sum & 0xffff);
+    }
+    return be16toh(static_cast<uint16_t>(sum));
+}
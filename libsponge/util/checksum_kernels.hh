@@ -0,0 +1,38 @@
+#ifndef SPONGE_LIBSPONGE_CHECKSUM_KERNELS_HH
+#define SPONGE_LIBSPONGE_CHECKSUM_KERNELS_HH
+
+#include <cstddef>
+#include <cstdint>
+
+//! \file
+//! \brief The loops that add up bytes for InternetChecksum
+//!
+//! Each kernel adds up `len` bytes (`len` even) as 16-bit words in *host* byte order, folding
+//! carries back in (one's-complement addition), and returns a sum that is zero only if all the
+//! bytes are. One's-complement addition works the same whichever order the bytes of each word are
+//! in (RFC 1071, section 2(B)), so fold_to_network() turns that sum into the one InternetChecksum
+//! wants: of big-endian words, folded to 16 bits.
+
+namespace checksum_kernels {
+
+//! Eight bytes at a time, in a 64-bit integer
+uint64_t word64(const char *data, const size_t len);
+
+//! Sixteen bytes at a time, with SSE2
+uint64_t sse2(const char *data, const size_t len);
+
+//! Thirty-two bytes at a time, with AVX2
+uint64_t avx2(const char *data, const size_t len);
+
+//! Can this CPU run sse2()?
+bool sse2_supported();
+
+//! Can this CPU run avx2()?
+bool avx2_supported();
+
+//! \brief Fold a kernel's sum to 16 bits, and make it the sum of the words in network byte order
+uint16_t fold_to_network(uint64_t sum);
+
+}  // namespace checksum_kernels
+
+#endif  // SPONGE_LIBSPONGE_CHECKSUM_KERNELS_HH
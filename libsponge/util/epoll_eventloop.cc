@@ -0,0 +1,232 @@
+#include "epoll_eventloop.hh"
+
+#include "util.hh"
+
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+
+using namespace std;
+
+EpollEventLoop::EpollEventLoop() : _epoll(SystemCall("epoll_create1", ::epoll_create1(EPOLL_CLOEXEC))) {}
+
+const EpollEventLoop::Rule *EpollEventLoop::_rule(const EventRuleId id) const {
+    if (id.index >= _rules.size() or not _rules[id.index].used or _rules[id.index].generation != id.generation) {
+        return nullptr;
+    }
+    return &_rules[id.index];
+}
+
+bool EpollEventLoop::active(const EventRuleId id) const { return _rule(id) != nullptr; }
+
+EventRuleId EpollEventLoop::add_rule(const FileDescriptor &fd,
+                                     const Direction direction,
+                                     const CallbackT &callback,
+                                     const CallbackT &cancel,
+                                     const bool enabled) {
+    const int fd_num = fd.fd_num();
+    if (static_cast<size_t>(fd_num) >= _watches.size()) {
+        _watches.resize(fd_num + 1);
+    }
+    // rules left on a closed fd whose number has been reused never fired; cancel them now
+    if (_watches[fd_num].has_value() and _watches[fd_num]->fd.closed()) {
+        for (const uint32_t stale : {_watches[fd_num]->in_rule, _watches[fd_num]->out_rule}) {
+            if (stale != NIL) {
+                _cancel(stale);
+            }
+        }
+    }
+    // (looked up only now: a cancel callback may have added rules, and so moved the watches)
+    auto &watch = _watches[fd_num];
+    if (not watch.has_value()) {
+        watch.emplace(Watch{fd.duplicate()});
+    }
+    uint32_t &slot = direction == Direction::In ? watch->in_rule : watch->out_rule;
+    if (slot != NIL) {
+        throw runtime_error("EpollEventLoop: file descriptor already has a rule in this direction");
+    }
+
+    uint32_t index = 0;
+    if (not _free_rules.empty()) {
+        index = _free_rules.back();
+        _free_rules.pop_back();
+    } else {
+        index = _rules.size();
+        _rules.emplace_back();
+    }
+    Rule &rule = _rules[index];
+    rule.direction = direction;
+    rule.callback = callback;
+    rule.cancel = cancel;
+    rule.fd_num = fd_num;
+    rule.used = true;
+    rule.enabled = enabled;
+    slot = index;
+    _size++;
+    _enabled += enabled;
+
+    _update_events(fd_num);
+    return {index, rule.generation};
+}
+
+void EpollEventLoop::set_enabled(const EventRuleId id, const bool enabled) {
+    if (not active(id) or _rules[id.index].enabled == enabled) {
+        return;
+    }
+    Rule &rule = _rules[id.index];
+    rule.enabled = enabled;
+    if (enabled) {
+        _enabled++;
+    } else {
+        _enabled--;
+    }
+    _update_events(rule.fd_num);
+}
+
+void EpollEventLoop::remove(const EventRuleId id) {
+    if (active(id)) {
+        _remove(id.index);
+    }
+}
+
+//! \details An fd is in the kernel's interest set exactly when it has an enabled rule; the
+//! Watch itself (and the handle on the fd) goes away with the fd's last rule.
+void EpollEventLoop::_update_events(const int fd_num) {
+    auto &watch = _watches[fd_num];
+    uint32_t events = 0;
+    if (watch->in_rule != NIL and _rules[watch->in_rule].enabled) {
+        events |= EPOLLIN;
+    }
+    if (watch->out_rule != NIL and _rules[watch->out_rule].enabled) {
+        events |= EPOLLOUT;
+    }
+
+    if (events != watch->events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd_num;
+        const int op = watch->events == 0 ? EPOLL_CTL_ADD : events == 0 ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+        // the fd may already have been closed, in which case the kernel dropped it from the set itself
+        if (op != EPOLL_CTL_DEL or not watch->fd.closed()) {
+            SystemCall("epoll_ctl", ::epoll_ctl(_epoll.fd_num(), op, fd_num, &event));
+        }
+        watch->events = events;
+    }
+
+    if (watch->in_rule == NIL and watch->out_rule == NIL) {
+        watch.reset();
+    }
+}
+
+void EpollEventLoop::_remove(const uint32_t index) {
+    Rule &rule = _rules[index];
+    auto &watch = _watches[rule.fd_num];
+    (rule.direction == Direction::In ? watch->in_rule : watch->out_rule) = NIL;
+    rule.used = false;
+    rule.generation++;
+    _size--;
+    if (rule.enabled) {
+        rule.enabled = false;
+        _enabled--;
+    }
+    _update_events(rule.fd_num);
+    // a callback may be removing its own rule, so don't reuse the slot until it has returned
+    (_dispatching ? _retired_rules : _free_rules).push_back(index);
+}
+
+void EpollEventLoop::_cancel(const uint32_t index) {
+    _remove(index);
+    _rules[index].cancel();
+}
+
+//! \param[in] fd_num the ready fd
+//! \param[in] direction which of its rules to run
+//! \param[in] revents the events reported by the kernel
+void EpollEventLoop::_dispatch(const int fd_num, const Direction direction, const uint32_t revents) {
+    // an earlier callback in this batch may have removed the fd's rules
+    if (not _watches[fd_num].has_value()) {
+        return;
+    }
+    const Watch &watch = _watches[fd_num].value();
+    const uint32_t index = direction == Direction::In ? watch.in_rule : watch.out_rule;
+    if (index == NIL or not _rules[index].enabled) {
+        return;
+    }
+    if (watch.fd.closed()) {
+        _cancel(index);
+        return;
+    }
+
+    const bool ready = revents & (direction == Direction::In ? EPOLLIN : EPOLLOUT);
+    if (not ready) {
+        // the only condition was a hangup, so this direction of the fd is defunct
+        if (revents & EPOLLHUP) {
+            _cancel(index);
+        }
+        return;
+    }
+
+    const uint32_t generation = _rules[index].generation;
+    const unsigned int count_before = direction == Direction::In ? watch.fd.read_count() : watch.fd.write_count();
+    _rules[index].callback();
+
+    // the callback may have removed its rule, or added rules (so `watch` may have moved)
+    if (not active({index, generation})) {
+        return;
+    }
+    const FileDescriptor &fd = _watches[fd_num]->fd;
+    if (direction == Direction::In and fd.eof()) {
+        _cancel(index);
+        return;
+    }
+    const unsigned int count_after = direction == Direction::In ? fd.read_count() : fd.write_count();
+    if (count_before == count_after and _rules[index].enabled) {
+        throw runtime_error(
+            "EpollEventLoop: busy wait detected: callback did not read/write fd and is still enabled");
+    }
+}
+
+//! \param[in] timeout_ms is the timeout value passed to [epoll_wait(2)](\ref man2::epoll_wait)
+//! \returns EventLoop::Result indicating success, timeout, or no more enabled rules
+//!
+//! If an error is reported on an fd, this function throws a std::runtime_error.
+EpollEventLoop::Result EpollEventLoop::wait_next_event(const int timeout_ms) {
+    if (_enabled == 0) {
+        return Result::Exit;
+    }
+
+    int count = 0;
+    try {
+        count = SystemCall("epoll_wait", ::epoll_wait(_epoll.fd_num(), _ready.data(), MAX_EVENTS, timeout_ms));
+    } catch (const unix_error &e) {
+        if (e.code().value() == EINTR) {
+            return Result::Exit;
+        }
+        throw;
+    }
+    if (count == 0) {
+        return Result::Timeout;
+    }
+
+    _dispatching = true;
+    try {
+        for (int i = 0; i < count; i++) {
+            const epoll_event &event = _ready[i];
+            if (event.events & EPOLLERR) {
+                throw runtime_error("EpollEventLoop: error on polled file descriptor");
+            }
+            _dispatch(event.data.fd, Direction::In, event.events);
+            _dispatch(event.data.fd, Direction::Out, event.events);
+        }
+    } catch (...) {
+        _dispatching = false;
+        _free_rules.insert(_free_rules.end(), _retired_rules.begin(), _retired_rules.end());
+        _retired_rules.clear();
+        throw;
+    }
+    _dispatching = false;
+    _free_rules.insert(_free_rules.end(), _retired_rules.begin(), _retired_rules.end());
+    _retired_rules.clear();
+
+    return Result::Success;
+}
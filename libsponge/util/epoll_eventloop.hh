@@ -0,0 +1,126 @@
+#ifndef SPONGE_LIBSPONGE_EPOLL_EVENTLOOP_HH
+#define SPONGE_LIBSPONGE_EPOLL_EVENTLOOP_HH
+
+#include "eventloop.hh"
+#include "file_descriptor.hh"
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <sys/epoll.h>
+#include <vector>
+
+//! \brief Names a rule added to an EpollEventLoop
+//! \details Ids stay safe to use after their rule is gone: EpollEventLoop::active() returns `false`.
+struct EventRuleId {
+    uint32_t index{0};       //!< slot in the loop's rule table
+    uint32_t generation{0};  //!< generation of that slot when the rule was added (0 = no rule)
+};
+
+//! \brief Waits for events on file descriptors with [epoll(7)](\ref man7::epoll) and executes callbacks
+//!
+//! Unlike EventLoop, which asks every rule whether it is interested and hands the whole set to
+//! [poll(2)](\ref man2::poll) on each call, an EpollEventLoop registers each fd with the kernel
+//! when its first rule is added. The owner says when a rule should or shouldn't fire with enable()
+//! and disable(), which call [epoll_ctl(2)](\ref man2::epoll_ctl) only when the events wanted on
+//! that fd actually change (an fd with no enabled rule leaves the interest set altogether, so a
+//! hangup on it can't wake the loop).
+//! Each call to wait_next_event() then costs time in proportion to the number of ready fds
+//! (dispatched in batches of up to MAX_EVENTS), not to the number of fds being watched.
+//!
+//! Rules otherwise behave as in EventLoop: an fd may have one rule per Direction, a rule is
+//! canceled (its `cancel` callback called, and the rule removed) when its fd reaches EOF, is
+//! closed, or hangs up, and a callback that neither reads nor writes its fd while its rule
+//! stays enabled is reported as a busy wait.
+class EpollEventLoop {
+  public:
+    using Direction = EventLoop::Direction;
+    using Result = EventLoop::Result;
+    using CallbackT = std::function<void(void)>;
+
+    //! Most ready fds handled per call to wait_next_event()
+    static constexpr size_t MAX_EVENTS = 64;
+
+  private:
+    static constexpr uint32_t NIL = std::numeric_limits<uint32_t>::max();
+
+    //! A callback for one Direction on one fd
+    struct Rule {
+        Direction direction{Direction::In};
+        CallbackT callback{};
+        CallbackT cancel{};
+        int fd_num{-1};
+        uint32_t generation{1};
+        bool used{false};
+        bool enabled{false};
+    };
+
+    //! An fd registered with epoll, and its rules (indexed by fd number)
+    struct Watch {
+        FileDescriptor fd;
+        uint32_t in_rule{NIL};
+        uint32_t out_rule{NIL};
+        uint32_t events{0};  //!< events currently requested from the kernel
+    };
+
+    FileDescriptor _epoll;
+    std::deque<Rule> _rules{};  //!< (a deque, so adding a rule never moves a callback that is running)
+    std::vector<uint32_t> _free_rules{};
+    std::vector<uint32_t> _retired_rules{};  //!< removed during dispatch; freed once the batch is done
+    bool _dispatching{false};
+    std::vector<std::optional<Watch>> _watches{};
+    size_t _enabled{0};  //!< number of enabled rules
+    size_t _size{0};     //!< number of rules
+    std::array<epoll_event, MAX_EVENTS> _ready{};
+
+    const Rule *_rule(const EventRuleId id) const;
+    void _update_events(const int fd_num);
+    void _cancel(const uint32_t index);
+    void _remove(const uint32_t index);
+    void _dispatch(const int fd_num, const Direction direction, const uint32_t revents);
+
+  public:
+    //! \brief Create the epoll instance
+    EpollEventLoop();
+
+    //! \brief Add a rule whose callback will be called when `fd` is ready in the specified Direction
+    //! \param[in] fd the file descriptor (the loop keeps a reference-counted handle to it, as EventLoop does)
+    //! \param[in] direction Direction::In to wait for readability, Direction::Out for writability
+    //! \param[in] callback called when the rule is enabled and `fd` is ready
+    //! \param[in] cancel called when the rule is canceled (e.g. on hangup, EOF, or closure)
+    //! \param[in] enabled whether the rule starts out enabled
+    //! \throws std::runtime_error if `fd` already has a rule in this Direction
+    EventRuleId add_rule(const FileDescriptor &fd,
+                         const Direction direction,
+                         const CallbackT &callback,
+                         const CallbackT &cancel = [] {},
+                         const bool enabled = true);
+
+    //! \brief Start calling a rule's callback when its fd is ready
+    void enable(const EventRuleId id) { set_enabled(id, true); }
+
+    //! \brief Stop calling a rule's callback, without removing the rule
+    void disable(const EventRuleId id) { set_enabled(id, false); }
+
+    //! \brief Enable or disable a rule; does nothing if the rule is gone
+    void set_enabled(const EventRuleId id, const bool enabled);
+
+    //! \brief Remove a rule without calling its `cancel` callback; does nothing if the rule is gone
+    void remove(const EventRuleId id);
+
+    //! \brief Does the rule still exist (i.e. was it neither removed nor canceled)?
+    bool active(const EventRuleId id) const;
+
+    //! \brief Number of rules
+    size_t size() const { return _size; }
+
+    //! \brief Calls [epoll_wait(2)](\ref man2::epoll_wait) and then executes the callback of each ready rule
+    //! \returns Result::Exit if no rule is enabled (or a signal interrupted the wait), Result::Timeout
+    //! if nothing became ready within `timeout_ms` milliseconds, and Result::Success otherwise.
+    Result wait_next_event(const int timeout_ms);
+};
+
+#endif  // SPONGE_LIBSPONGE_EPOLL_EVENTLOOP_HH
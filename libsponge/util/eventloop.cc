@@ -2,7 +2,10 @@
 
 #include "util.hh"
 
+#include <algorithm>
 #include <cerrno>
+#include <ctime>
+#include <optional>
 #include <stdexcept>
 #include <system_error>
 #include <utility>
@@ -28,8 +31,44 @@ void EventLoop::add_rule(const FileDescriptor &fd,
     _rules.push_back({fd.duplicate(), direction, callback, interest, cancel});
 }
 
-//! \param[in] timeout_ms is the timeout value passed to [poll(2)](\ref man2::poll); `wait_next_event`
-//!                       returns Result::Timeout if no fd is ready after the timeout expires.
+//! \param[in] delay_ms is how long from now the timer is due
+//! \param[in] callback is called by the first EventLoop::wait_next_event that finds the timer due; it may
+//!                     add or cancel timers itself.
+//! \returns an id that can be passed to EventLoop::cancel_timer
+EventLoop::TimerId EventLoop::add_timer(const uint64_t delay_ms, const CallbackT &callback) {
+    const TimerId id = _next_timer_id++;
+    _timers.push({Clock::now() + chrono::milliseconds(delay_ms), id});
+    _timer_callbacks.emplace(id, callback);
+    return id;
+}
+
+void EventLoop::cancel_timer(const TimerId id) {
+    _timer_callbacks.erase(id);
+    _drop_canceled_timers();
+}
+
+void EventLoop::_drop_canceled_timers() {
+    while (not _timers.empty() and _timer_callbacks.count(_timers.top().id) == 0) {
+        _timers.pop();
+    }
+}
+
+bool EventLoop::_run_due_timers() {
+    const auto now = Clock::now();
+    bool fired = false;
+    for (_drop_canceled_timers(); not _timers.empty() and _timers.top().deadline <= now; _drop_canceled_timers()) {
+        const auto it = _timer_callbacks.find(_timers.top().id);
+        const CallbackT callback = move(it->second);
+        _timer_callbacks.erase(it);
+        _timers.pop();
+        callback();
+        fired = true;
+    }
+    return fired;
+}
+
+//! \param[in] timeout_ms is the longest to wait (negative to wait indefinitely); `wait_next_event`
+//!                       returns Result::Timeout if no fd is ready and no timer is due after the timeout expires.
 //! \returns Eventloop::Result indicating success, timeout, or no more Rule objects to poll.
 //!
 //! For each Rule, this function first calls Rule::interest; if `true`, Rule::fd is added to the
@@ -37,18 +76,20 @@ void EventLoop::add_rule(const FileDescriptor &fd,
 //! writability (if Rule::direction == Direction::Out) unless Rule::fd has reached EOF, in which case
 //! the Rule is canceled (i.e., deleted from EventLoop::_rules).
 //!
-//! Next, this function calls [poll(2)](\ref man2::poll) with timeout value `timeout_ms`.
+//! Next, this function calls [ppoll(2)](\ref man2::poll) with timeout value `timeout_ms`, or until the
+//! earliest timer is due if that is sooner.
 //!
 //! Then, for each ready file descriptor, this function calls Rule::callback. If fd reaches EOF or
 //! if the Rule was registered using EventLoop::add_cancelable_rule and Rule::callback returns true,
-//! this Rule is canceled.
+//! this Rule is canceled. Last, it calls the callback of each timer that is due.
 //!
 //! If an error occurs during polling, this function throws a std::runtime_error.
 //!
-//! If a [signal(7)](\ref man7::signal) was caught during polling or if EventLoop::_rules becomes empty,
-//! this function returns Result::Exit.
+//! If a [signal(7)](\ref man7::signal) was caught during polling or if EventLoop::_rules becomes empty
+//! while no timer is pending, this function returns Result::Exit.
 //!
-//! If a timeout occurred while polling (i.e., no fd became ready), this function returns Result::Timeout.
+//! If a timeout occurred while polling (i.e., no fd became ready and no timer was due), this function
+//! returns Result::Timeout.
 //!
 //! Otherwise, this function returns Result::Success.
 //!
@@ -88,15 +129,34 @@ EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
         ++it;
     }
 
-    // quit if there is nothing left to poll
-    if (not something_to_poll) {
+    // quit if there is nothing left to poll or wait for
+    _drop_canceled_timers();
+    if (not something_to_poll and _timers.empty()) {
         return Result::Exit;
     }
 
-    // call poll -- wait until one of the fds satisfies one of the rules (writeable/readable)
+    // wait no longer than until the next timer is due
+    optional<Clock::duration> wait{};
+    if (timeout_ms >= 0) {
+        wait = chrono::milliseconds(timeout_ms);
+    }
+    if (not _timers.empty()) {
+        const auto until_timer = max(_timers.top().deadline - Clock::now(), Clock::duration::zero());
+        wait = wait.has_value() ? min(wait.value(), until_timer) : until_timer;
+    }
+    timespec wait_ts{};
+    if (wait.has_value()) {
+        const auto seconds = chrono::duration_cast<chrono::seconds>(wait.value());
+        wait_ts.tv_sec = seconds.count();
+        wait_ts.tv_nsec = chrono::duration_cast<chrono::nanoseconds>(wait.value() - seconds).count();
+    }
+
+    // call ppoll -- wait until one of the fds satisfies one of the rules (writeable/readable)
     try {
-        if (0 == SystemCall("poll", ::poll(pollfds.data(), pollfds.size(), timeout_ms))) {
-            return Result::Timeout;
+        const auto ready = SystemCall(
+            "ppoll", ::ppoll(pollfds.data(), pollfds.size(), wait.has_value() ? &wait_ts : nullptr, nullptr));
+        if (ready == 0) {
+            return _run_due_timers() ? Result::Success : Result::Timeout;
         }
     } catch (unix_error const &e) {
         if (e.code().value() == EINTR) {
@@ -141,5 +201,6 @@ EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
         ++it;  // if we got here, it means we didn't call _rules.erase()
     }
 
+    _run_due_timers();
     return Result::Success;
 }
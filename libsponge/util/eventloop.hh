@@ -3,10 +3,15 @@
 
 #include "file_descriptor.hh"
 
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
 #include <functional>
 #include <list>
 #include <poll.h>
+#include <queue>
+#include <unordered_map>
+#include <vector>
 
 //! Waits for events on file descriptors and executes corresponding callbacks.
 class EventLoop {
@@ -17,6 +22,8 @@ class EventLoop {
         Out = POLLOUT  //!< Callback will be triggered when Rule::fd is writable.
     };
 
+    using TimerId = uint64_t;  //!< Names a timer added with EventLoop::add_timer()
+
   private:
     using CallbackT = std::function<void(void)>;  //!< Callback for ready Rule::fd
     using InterestT = std::function<bool(void)>;  //!< `true` return indicates Rule::fd should be polled.
@@ -38,12 +45,33 @@ class EventLoop {
 
     std::list<Rule> _rules{};  //!< All rules that have been added and not canceled.
 
+    using Clock = std::chrono::steady_clock;
+
+    //! A timer's deadline, as kept in the heap
+    struct Timer {
+        Clock::time_point deadline;
+        TimerId id;
+
+        bool operator>(const Timer &other) const { return deadline > other.deadline; }
+    };
+
+    //! Deadlines of pending timers, earliest first (a canceled timer stays until it reaches the top)
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> _timers{};
+    std::unordered_map<TimerId, CallbackT> _timer_callbacks{};  //!< Callbacks of the pending timers
+    TimerId _next_timer_id{1};
+
+    //! Pops canceled timers off the top of the heap, so it starts with a pending one (if any)
+    void _drop_canceled_timers();
+
+    //! Calls the callback of each timer that is due; returns `true` if there were any
+    bool _run_due_timers();
+
   public:
     //! Returned by each call to EventLoop::wait_next_event.
     enum class Result {
-        Success,  //!< At least one Rule was triggered.
+        Success,  //!< At least one Rule was triggered or timer fired.
         Timeout,  //!< No rules were triggered before timeout.
-        Exit  //!< All rules have been canceled or were uninterested; make no further calls to EventLoop::wait_next_event.
+        Exit  //!< All rules have been canceled or were uninterested, and no timer is pending; make no further calls to EventLoop::wait_next_event.
     };
 
     //! Add a rule whose callback will be called when `fd` is ready in the specified Direction.
@@ -53,7 +81,14 @@ class EventLoop {
                   const InterestT &interest = [] { return true; },
                   const CallbackT &cancel = [] {});
 
-    //! Calls [poll(2)](\ref man2::poll) and then executes callback for each ready fd.
+    //! Call `callback` once, `delay_ms` milliseconds from now (from a later wait_next_event()).
+    TimerId add_timer(const uint64_t delay_ms, const CallbackT &callback);
+
+    //! Cancel a timer; does nothing if it has already fired or been canceled.
+    void cancel_timer(const TimerId id);
+
+    //! Calls [ppoll(2)](\ref man2::poll), waiting no longer than until the next timer is due, and then
+    //! executes callback for each ready fd and each timer that is due.
     Result wait_next_event(const int timeout_ms);
 };
 
@@ -72,5 +107,10 @@ using Direction = EventLoop::Direction;
 //! A Rule installed using EventLoop::add_cancelable_rule will be polled and canceled under the
 //! same conditions, with the additional condition that if Rule::callback returns `true`, the
 //! Rule will be canceled.
+//!
+//! Timers added using EventLoop::add_timer are kept in a min-heap ordered by deadline. Each call to
+//! EventLoop::wait_next_event waits no longer than until the earliest deadline (timers are set in
+//! whole milliseconds, like the TCPConnection's own timers), so an owner that keeps a timer at its
+//! next deadline can block until it instead of polling on a fixed tick.
 
 #endif  // SPONGE_LIBSPONGE_EVENTLOOP_HH
@@ -0,0 +1,136 @@
+#include "eventloop_group.hh"
+
+#include "util.hh"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+//! The group and loop index of the calling thread, if it is one of a group's threads
+static thread_local const EventLoopGroup *current_group = nullptr;
+static thread_local size_t current_index = 0;
+
+//! \returns the CPUs this process may run on, in order
+static vector<int> allowed_cpus() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    vector<int> cpus;
+    if (::sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+EventLoopGroup::Worker::Worker() : wakeup(SystemCall("eventfd", ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))) {}
+
+EventLoopGroup::EventLoopGroup(const size_t loop_count, const bool pin) {
+    const vector<int> cpus = allowed_cpus();
+    const size_t count = loop_count > 0 ? loop_count : max(cpus.size(), size_t{1});
+
+    // every Worker exists before any thread starts, so the threads never see _workers change
+    for (size_t i = 0; i < count; i++) {
+        _workers.push_back(make_unique<Worker>());
+    }
+    for (size_t i = 0; i < count; i++) {
+        const int cpu = pin and not cpus.empty() ? cpus[i % cpus.size()] : -1;
+        _workers[i]->thread = thread(&EventLoopGroup::_run, this, i, cpu);
+    }
+}
+
+EventLoopGroup::~EventLoopGroup() {
+    try {
+        for (size_t i = 0; i < _workers.size(); i++) {
+            post(i, [worker = _workers[i].get()](EventLoop &) { worker->stopping = true; });
+        }
+        for (const auto &worker : _workers) {
+            worker->thread.join();
+        }
+    } catch (const exception &e) {
+        cerr << "Exception destructing EventLoopGroup: " << e.what() << endl;
+    }
+}
+
+//! \param[in] index the loop to run
+//! \param[in] cpu the CPU to pin the thread to, or -1 not to pin it
+void EventLoopGroup::_run(const size_t index, const int cpu) {
+    current_group = this;
+    current_index = index;
+    if (cpu >= 0) {
+        // best effort: without the permission (or the CPU), the thread runs wherever the scheduler puts it
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+    }
+
+    Worker &worker = *_workers[index];
+    try {
+        worker.loop.add_rule(worker.wakeup, Direction::In, [&] { worker.wakeup.read_counter(); });
+        // tasks run between waits, never inside the loop's own dispatch, so they may add rules and timers
+        while (not worker.stopping) {
+            worker.loop.wait_next_event(-1);
+            _run_tasks(index);
+        }
+    } catch (const exception &e) {
+        cerr << "Exception in EventLoopGroup thread " << index << ": " << e.what() << "\n";
+        throw;
+    }
+}
+
+void EventLoopGroup::_run_tasks(const size_t index) {
+    Worker &worker = *_workers[index];
+    vector<Task> tasks;
+    {
+        lock_guard<mutex> lock(worker.queue_mutex);
+        swap(tasks, worker.queue);
+    }
+    for (const Task &task : tasks) {
+        task(worker.loop);
+    }
+}
+
+//! \param[in] index the loop to run `task` on
+//! \param[in] task the work to run; tasks posted from one thread to one loop run in the order posted
+void EventLoopGroup::post(const size_t index, Task task) {
+    Worker &worker = *_workers.at(index);
+    bool was_empty = false;
+    {
+        lock_guard<mutex> lock(worker.queue_mutex);
+        was_empty = worker.queue.empty();
+        worker.queue.push_back(move(task));
+    }
+    // a non-empty queue has a wakeup pending already (the loop's thread empties the queue after waking)
+    if (was_empty) {
+        const uint64_t one = 1;
+        SystemCall("write", ::write(worker.wakeup.fd_num(), &one, sizeof(one)));
+    }
+}
+
+//! \param[in] setup run on the chosen loop's thread, e.g. to add the new work's rules to that loop
+size_t EventLoopGroup::place(Task setup) {
+    const size_t start = _next_placement++ % _workers.size();
+    size_t best = start;
+    for (size_t i = 1; i < _workers.size(); i++) {
+        const size_t candidate = (start + i) % _workers.size();
+        if (_workers[candidate]->load < _workers[best]->load) {
+            best = candidate;
+        }
+    }
+    _workers[best]->load++;
+    post(best, move(setup));
+    return best;
+}
+
+size_t EventLoopGroup::current() const { return current_group == this ? current_index : _workers.size(); }
@@ -0,0 +1,99 @@
+#ifndef SPONGE_LIBSPONGE_EVENTLOOP_GROUP_HH
+#define SPONGE_LIBSPONGE_EVENTLOOP_GROUP_HH
+
+#include "eventloop.hh"
+#include "file_descriptor.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//! \brief A fixed set of EventLoops, each run by its own thread (pinned to its own CPU), that
+//! work can be posted to from any thread
+//!
+//! Rules and timers belong to one loop and are only ever touched by that loop's thread: to add
+//! one, post() a Task to the loop, which runs it on the loop's thread with the EventLoop at hand.
+//! Each loop has a task queue that any number of threads may post to. Posting appends to the
+//! queue under a mutex held only for the append, and writes to an [eventfd(2)](\ref man2::eventfd)
+//! only if the queue was empty; the loop's thread takes the whole queue at once when it wakes.
+//!
+//! place() puts new work (e.g. a connection and its rules) on the loop carrying the least of it,
+//! so a few threads can serve thousands of connections, spread evenly across the CPUs. Work
+//! that arrives on a loop of its own accord (e.g. the connections a TCPSpongeListener's socket on
+//! that loop accepts) is counted with acquire(), so that place() steers around it.
+class EventLoopGroup {
+  public:
+    //! Work run on a loop's thread, given that loop
+    using Task = std::function<void(EventLoop &)>;
+
+  private:
+    //! One loop, its thread and its task queue
+    struct Worker {
+        EventLoop loop{};
+        FileDescriptor wakeup;  //!< eventfd written when the queue becomes non-empty
+        std::mutex queue_mutex{};
+        std::vector<Task> queue{};    //!< tasks posted and not yet taken by the loop's thread
+        std::atomic<size_t> load{0};  //!< units of work placed on this loop and not yet released
+        bool stopping{false};         //!< set (by a task, on the loop's thread) to make the loop return
+        std::thread thread{};
+
+        Worker();
+    };
+
+    std::vector<std::unique_ptr<Worker>> _workers{};
+    std::atomic<size_t> _next_placement{0};  //!< where the search for the least-loaded loop starts
+
+    //! Main loop of worker `index`'s thread
+    void _run(const size_t index, const int cpu);
+
+    //! Take worker `index`'s queued tasks and run them
+    void _run_tasks(const size_t index);
+
+  public:
+    //! \brief Start `loop_count` loops; 0 means one per CPU this process may run on
+    //! \param[in] loop_count the number of loops (and threads)
+    //! \param[in] pin whether to pin each loop's thread to a CPU (loop i to the i-th allowed CPU, cycling)
+    explicit EventLoopGroup(const size_t loop_count = 0, const bool pin = true);
+
+    //! \brief Stop every loop (after it has run the tasks already posted to it) and join the threads
+    ~EventLoopGroup();
+
+    //! \brief Number of loops
+    size_t size() const { return _workers.size(); }
+
+    //! \brief Run `task` on loop `index`'s thread (safe to call from any thread, including that one)
+    void post(const size_t index, Task task);
+
+    //! \brief Place one unit of work on the least-loaded loop, running `setup` there
+    //! \details Ties go round-robin. The unit is counted until release() is called for that loop.
+    //! \returns the index of the loop chosen
+    size_t place(Task setup);
+
+    //! \brief Count one unit of work that arrived on loop `index` by other means than place()
+    //! \details E.g. a connection to a socket of the loop's own (see TCPSpongeListener); release() it as usual.
+    void acquire(const size_t index) { _workers.at(index)->load++; }
+
+    //! \brief A unit of work placed on loop `index` is finished
+    void release(const size_t index) { _workers.at(index)->load--; }
+
+    //! \brief Units of work placed on loop `index` and not yet released
+    size_t load(const size_t index) const { return _workers.at(index)->load; }
+
+    //! \brief Index of the loop whose thread is calling, or size() if it is not one of the group's
+    size_t current() const;
+
+    //! \name
+    //! The threads refer to the group, so it can't be moved or copied
+    //!@{
+    EventLoopGroup(const EventLoopGroup &) = delete;
+    EventLoopGroup &operator=(const EventLoopGroup &) = delete;
+    EventLoopGroup(EventLoopGroup &&) = delete;
+    EventLoopGroup &operator=(EventLoopGroup &&) = delete;
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_EVENTLOOP_GROUP_HH
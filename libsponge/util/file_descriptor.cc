@@ -3,6 +3,7 @@
 #include "util.hh"
 
 #include <algorithm>
+#include <array>
 #include <fcntl.h>
 #include <iostream>
 #include <stdexcept>
@@ -73,13 +74,77 @@ string FileDescriptor::read(const size_t limit) {
     return ret;
 }
 
+//! \details Unlike the string versions, this neither allocates nor zero-fills memory for the read,
+//! once `pool` has a Slab free.
+//! \param[in] pool is the BufferPool to take the Slab from
+//! \returns a Buffer of exactly the bytes read (the Slab returns to `pool` when it and its copies are gone)
+Buffer FileDescriptor::read(BufferPool &pool) {
+    Slab &slab = pool.take();
+    const Buffer holder{slab, 0};  // hands the Slab back to the pool if the read fails
+
+    const ssize_t bytes_read = SystemCall("read", ::read(fd_num(), slab.data(), slab.capacity()));
+    if (bytes_read == 0 and slab.capacity() > 0) {
+        _internal_fd->_eof = true;
+    }
+    if (bytes_read > static_cast<ssize_t>(slab.capacity())) {
+        throw runtime_error("read() read more than requested");
+    }
+
+    register_read();
+    return {slab, static_cast<size_t>(bytes_read)};
+}
+
+//! \details Meant for [eventfd(2)](\ref man2::eventfd)s used to wake a loop, which are drained with one
+//! 8-byte read. A non-blocking fd whose counter is already zero reads as 0.
+//! \returns the counter's value before the read
+uint64_t FileDescriptor::read_counter() {
+    uint64_t counter = 0;
+    const ssize_t bytes_read = SystemCall("read", ::read(fd_num(), &counter, sizeof(counter)), EAGAIN);
+    register_read();
+    return bytes_read == sizeof(counter) ? counter : 0;
+}
+
+//! \details Uses [splice(2)](\ref man2::splice), which doesn't block on the pipe (a socket blocks
+//! unless it is non-blocking). If this fd is at EOF, sets the EOF flag and returns 0. If nothing can
+//! be moved without blocking (EAGAIN: this fd has nothing to give, or `out` has no room), returns 0
+//! without setting the EOF flag.
+//! \param[out] out is the fd to move bytes to
+//! \param[in] limit is the most bytes to move
+//! \returns the number of bytes moved
+//! \note Throws a unix_error with EINVAL if neither fd is a pipe, or the other one doesn't support splicing
+size_t FileDescriptor::splice(FileDescriptor &out, const size_t limit) {
+    const ssize_t bytes_moved = SystemCall(
+        "splice",
+        ::splice(fd_num(), nullptr, out.fd_num(), nullptr, limit, SPLICE_F_MOVE | SPLICE_F_NONBLOCK),
+        EAGAIN);
+    if (limit > 0 and bytes_moved == 0) {
+        _internal_fd->_eof = true;
+    }
+    register_read();
+    out.register_write();
+    return bytes_moved < 0 ? 0 : bytes_moved;
+}
+
+//! \details Uses [tee(2)](\ref man2::tee); the bytes stay in this pipe, to be read (or spliced) later.
+//! \param[out] out is the pipe to copy bytes to
+//! \param[in] limit is the most bytes to copy
+//! \returns the number of bytes copied
+size_t FileDescriptor::tee(FileDescriptor &out, const size_t limit) {
+    const ssize_t bytes_copied = SystemCall("tee", ::tee(fd_num(), out.fd_num(), limit, SPLICE_F_NONBLOCK));
+    out.register_write();
+    return bytes_copied;
+}
+
+//! \details Each [writev(2)](\ref man2::writev) is given at most the first 16 pieces of `buffer`, from an
+//! array on the stack.
 size_t FileDescriptor::write(BufferViewList buffer, const bool write_all) {
     size_t total_bytes_written = 0;
 
     do {
-        auto iovecs = buffer.as_iovecs();
+        array<iovec, 16> iovecs{};
+        const size_t iovec_count = buffer.as_iovecs(iovecs);
 
-        const ssize_t bytes_written = SystemCall("writev", ::writev(fd_num(), iovecs.data(), iovecs.size()));
+        const ssize_t bytes_written = SystemCall("writev", ::writev(fd_num(), iovecs.data(), iovec_count));
         if (bytes_written == 0 and buffer.size() != 0) {
             throw runtime_error("write returned 0 given non-empty input buffer");
         }
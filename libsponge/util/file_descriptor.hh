@@ -2,9 +2,11 @@
 #define SPONGE_LIBSPONGE_FILE_DESCRIPTOR_HH
 
 #include "buffer.hh"
+#include "buffer_pool.hh"
 
 #include <array>
 #include <cstddef>
+#include <cstdint>
 #include <limits>
 #include <memory>
 
@@ -61,6 +63,18 @@ class FileDescriptor {
     //! Read up to `limit` bytes into `str` (caller can allocate storage)
     void read(std::string &str, const size_t limit = std::numeric_limits<size_t>::max());
 
+    //! Read up to one Slab's worth of bytes into a Slab from `pool`
+    Buffer read(BufferPool &pool);
+
+    //! Read (and so reset) the 8-byte counter of an eventfd or timerfd, without allocating
+    uint64_t read_counter();
+
+    //! Move up to `limit` bytes to `out` without copying them through user space (this fd or `out` must be a pipe)
+    size_t splice(FileDescriptor &out, const size_t limit);
+
+    //! Copy up to `limit` bytes from this pipe to pipe `out` without consuming them
+    size_t tee(FileDescriptor &out, const size_t limit);
+
     //! Write a string, possibly blocking until all is written
     size_t write(const char *str, const bool write_all = true) { return write(BufferViewList(str), write_all); }
 
@@ -0,0 +1,856 @@
+#include "io_uring_eventloop.hh"
+
+#include "util.hh"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <netinet/udp.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+//! Buffer group id of the receive buffers
+static constexpr uint16_t BUFFER_GROUP = 0;
+
+//! What a completion is for: the top two bits of its user_data (the rest is an index)
+enum class Op : uint64_t {
+    Rule = 0,   //!< a rule's operation
+    Write = 1,  //!< a queued write
+    Other = 2,  //!< nothing to act on (a cancellation)
+    Link = 3    //!< nothing to act on either (the poll linked before a rule's operation)
+};
+
+static uint64_t user_data(const Op op, const uint32_t index) { return (static_cast<uint64_t>(op) << 62) | index; }
+
+//! \name io_uring system calls (glibc has no wrappers for them)
+//!@{
+static int io_uring_setup(const unsigned entries, io_uring_params *params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int io_uring_enter(
+    const int fd, const unsigned to_submit, const unsigned min_complete, const unsigned flags, const void *arg) {
+    return static_cast<int>(
+        syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, sizeof(io_uring_getevents_arg)));
+}
+
+static int io_uring_register(const int fd, const unsigned opcode, const void *arg, const unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+//!@}
+
+//! \details The submission and completion queues are shared with the kernel through memory maps;
+//! the kernel reads entries up to the submission queue's tail and writes completions up to the
+//! completion queue's tail, and each side publishes its indices with release stores.
+class IoUringEventLoop::Ring {
+  private:
+    //! A memory map, unmapped on destruction
+    struct Map {
+        void *addr{MAP_FAILED};
+        size_t size{0};
+
+        Map(const size_t length, const int fd, const off_t offset) : size(length) {
+            const int flags = fd < 0 ? MAP_PRIVATE | MAP_ANONYMOUS : MAP_SHARED | MAP_POPULATE;
+            addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, fd, offset);
+            if (addr == MAP_FAILED) {
+                throw unix_error("mmap");
+            }
+        }
+        ~Map() { ::munmap(addr, size); }
+        Map(const Map &) = delete;
+        Map &operator=(const Map &) = delete;
+
+        template <typename T>
+        T *at(const size_t offset) const {
+            return reinterpret_cast<T *>(static_cast<char *>(addr) + offset);
+        }
+    };
+
+    FileDescriptor _fd;
+    io_uring_params _params{};
+    std::unique_ptr<Map> _rings{};
+    std::unique_ptr<Map> _sqe_map{};
+    std::unique_ptr<Map> _buffer_ring_map{};
+
+    unsigned *_sq_head{}, *_sq_tail{}, *_sq_array{}, *_cq_head{}, *_cq_tail{};
+    unsigned _sq_mask{0}, _cq_mask{0};
+    io_uring_sqe *_sqes{};
+    io_uring_cqe *_cqes{};
+    unsigned _sq_local_tail{0};  //!< tail including entries not yet handed to the kernel
+    unsigned _to_submit{0};      //!< entries in the submission queue not yet consumed by the kernel
+    bool _multishot_receive{false};
+
+    //! The provided-buffer ring. (Its tail is overlaid on the first entry's `resv` field; io_uring_buf_ring
+    //! says so with a flexible array that C++ lays out differently, so the entries are addressed directly.)
+    io_uring_buf *_buffer_ring{};
+    uint16_t _buffer_tail{0};
+    std::vector<char> _buffers;
+
+    explicit Ring(FileDescriptor &&fd) : _fd(std::move(fd)), _buffers(BUFFER_COUNT * BUFFER_SIZE) {}
+
+    //! Check that the kernel has the features and operations the loop uses, and whether it has
+    //! multishot receives
+    //! \details Multishot receives came with Linux 6.0, as did IORING_OP_SEND_ZC, which a probe can
+    //! see (a receive can't be probed for its flags); a kernel that has the one without the other
+    //! turns the first multishot receive down, and the loop goes over to one-shot receives.
+    void _probe(const io_uring_params &params) {
+        _params = params;
+        constexpr unsigned needed = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+        if ((_params.features & needed) != needed) {
+            throw runtime_error("io_uring: kernel is too old");
+        }
+
+        // (io_uring_probe ends in a flexible array, so its entries are addressed directly)
+        vector<char> storage(sizeof(io_uring_probe) + IORING_OP_LAST * sizeof(io_uring_probe_op));
+        SystemCall("io_uring_register",
+                   io_uring_register(_fd.fd_num(), IORING_REGISTER_PROBE, storage.data(), IORING_OP_LAST));
+        const auto *probe = reinterpret_cast<const io_uring_probe *>(storage.data());
+        const auto *ops = reinterpret_cast<const io_uring_probe_op *>(storage.data() + sizeof(io_uring_probe));
+        const auto supported = [&](const unsigned op) {
+            return op <= probe->last_op and (ops[op].flags & IO_URING_OP_SUPPORTED);
+        };
+        for (const unsigned op : {IORING_OP_READ,
+                                  IORING_OP_WRITE,
+                                  IORING_OP_WRITEV,
+                                  IORING_OP_RECV,
+                                  IORING_OP_RECVMSG,
+                                  IORING_OP_SEND,
+                                  IORING_OP_SENDMSG,
+                                  IORING_OP_POLL_ADD,
+                                  IORING_OP_ASYNC_CANCEL}) {
+            if (not supported(op)) {
+                throw runtime_error("io_uring: kernel lacks operation " + to_string(op));
+            }
+        }
+        _multishot_receive = supported(IORING_OP_SEND_ZC);
+    }
+
+    //! Map the queues and provide the receive buffers
+    void _map() {
+        const size_t sq_size = _params.sq_off.array + _params.sq_entries * sizeof(unsigned);
+        const size_t cq_size = _params.cq_off.cqes + _params.cq_entries * sizeof(io_uring_cqe);
+        _rings = make_unique<Map>(max(sq_size, cq_size), _fd.fd_num(), IORING_OFF_SQ_RING);
+        _sqe_map = make_unique<Map>(_params.sq_entries * sizeof(io_uring_sqe), _fd.fd_num(), IORING_OFF_SQES);
+
+        _sq_head = _rings->at<unsigned>(_params.sq_off.head);
+        _sq_tail = _rings->at<unsigned>(_params.sq_off.tail);
+        _sq_mask = *_rings->at<unsigned>(_params.sq_off.ring_mask);
+        _sq_array = _rings->at<unsigned>(_params.sq_off.array);
+        _cq_head = _rings->at<unsigned>(_params.cq_off.head);
+        _cq_tail = _rings->at<unsigned>(_params.cq_off.tail);
+        _cq_mask = *_rings->at<unsigned>(_params.cq_off.ring_mask);
+        _cqes = _rings->at<io_uring_cqe>(_params.cq_off.cqes);
+        _sqes = _sqe_map->at<io_uring_sqe>(0);
+
+        _buffer_ring_map = make_unique<Map>(BUFFER_COUNT * sizeof(io_uring_buf), -1, 0);
+        _buffer_ring = _buffer_ring_map->at<io_uring_buf>(0);
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uint64_t>(_buffer_ring);
+        reg.ring_entries = BUFFER_COUNT;
+        reg.bgid = BUFFER_GROUP;
+        SystemCall("io_uring_register", io_uring_register(_fd.fd_num(), IORING_REGISTER_PBUF_RING, &reg, 1));
+        for (uint16_t id = 0; id < BUFFER_COUNT; id++) {
+            recycle(id);
+        }
+    }
+
+  public:
+    Ring(const Ring &) = delete;
+    Ring &operator=(const Ring &) = delete;
+
+    //! Set up a ring
+    //! \throws unix_error or std::runtime_error if the kernel doesn't support what's needed
+    static std::unique_ptr<Ring> create() {
+        io_uring_params params{};
+        const int fd = io_uring_setup(QUEUE_DEPTH, &params);
+        if (fd < 0) {
+            throw unix_error("io_uring_setup");
+        }
+        auto ring = std::unique_ptr<Ring>(new Ring(FileDescriptor{fd}));
+        ring->_probe(params);
+        ring->_map();
+        return ring;
+    }
+
+    //! Can sockets be read with multishot receives? (see _probe())
+    bool multishot_receive() const { return _multishot_receive; }
+
+    //! The next free submission queue entry, cleared (submits what's queued first if the queue is full)
+    io_uring_sqe &next_sqe() {
+        if (_sq_local_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE) == _params.sq_entries) {
+            enter(0, nullptr);
+        }
+        const unsigned slot = _sq_local_tail & _sq_mask;
+        io_uring_sqe &sqe = _sqes[slot];
+        memset(&sqe, 0, sizeof(sqe));
+        _sq_array[slot] = slot;
+        _sq_local_tail++;
+        _to_submit++;
+        return sqe;
+    }
+
+    //! Submit what's queued, and wait (up to `timeout`, or forever if null) for a completion if asked to
+    //! \returns `false` if the wait was interrupted by a signal
+    bool enter(const unsigned min_complete, const __kernel_timespec *timeout) {
+        // publish the new entries, which the caller has filled in by now
+        __atomic_store_n(_sq_tail, _sq_local_tail, __ATOMIC_RELEASE);
+        io_uring_getevents_arg arg{};
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = reinterpret_cast<uint64_t>(timeout);
+        unsigned flags = IORING_ENTER_EXT_ARG;
+        if (min_complete > 0 or timeout != nullptr) {
+            flags |= IORING_ENTER_GETEVENTS;
+        }
+        const int result = io_uring_enter(_fd.fd_num(), _to_submit, min_complete, flags, &arg);
+        const int error = errno;
+        // whatever the result, the kernel has consumed the entries up to the queue's head
+        _to_submit = _sq_local_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE);
+        if (result < 0 and error != ETIME) {
+            if (error == EINTR) {
+                return false;
+            }
+            throw unix_error("io_uring_enter", error);
+        }
+        return true;
+    }
+
+    //! Call `f(user_data, result, flags)` for each completion that has arrived
+    //! \returns the number of completions
+    template <typename F>
+    size_t for_each_completion(F &&f) {
+        size_t count = 0;
+        unsigned head = *_cq_head;
+        while (head != __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE)) {
+            const io_uring_cqe cqe = _cqes[head & _cq_mask];
+            head++;
+            // release the entry before running the callback, which may queue more work
+            __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+            f(cqe.user_data, cqe.res, cqe.flags);
+            count++;
+        }
+        return count;
+    }
+
+    //! The contents of a receive buffer
+    std::string_view buffer(const uint16_t id, const size_t length) const {
+        return {_buffers.data() + static_cast<size_t>(id) * BUFFER_SIZE, length};
+    }
+
+    //! Give a receive buffer back to the kernel
+    void recycle(const uint16_t id) {
+        io_uring_buf &buf = _buffer_ring[_buffer_tail & (BUFFER_COUNT - 1)];
+        buf.addr = reinterpret_cast<uint64_t>(_buffers.data() + static_cast<size_t>(id) * BUFFER_SIZE);
+        buf.len = BUFFER_SIZE;
+        buf.bid = id;
+        _buffer_tail++;
+        __atomic_store_n(&_buffer_ring[0].resv, _buffer_tail, __ATOMIC_RELEASE);
+    }
+};
+
+//! \param[in] try_io_uring whether to try io_uring at all (`false` always uses the epoll fallback)
+IoUringEventLoop::IoUringEventLoop(const bool try_io_uring) : _ring() {
+    if (try_io_uring) {
+        try {
+            _ring = Ring::create();
+        } catch (const exception &) {
+            _ring.reset();
+        }
+    }
+    if (_ring) {
+        _multishot = _ring->multishot_receive();
+    } else {
+        _fallback.emplace();
+    }
+}
+
+IoUringEventLoop::~IoUringEventLoop() = default;
+
+//! Is `fd` a socket? (Sockets are read with receives, and written with sends.)
+static bool is_socket(const FileDescriptor &fd) {
+    struct stat st {};
+    SystemCall("fstat", ::fstat(fd.fd_num(), &st));
+    return S_ISSOCK(st.st_mode);
+}
+
+//! \details Without a ring, the rule is handed to the EpollEventLoop, which (for a rule that does
+//! more than wait) calls _on_fallback() to do what the ring would.
+EventRuleId IoUringEventLoop::_add(Rule &&rule) {
+    _rules.push_back(move(rule));
+    const uint32_t index = _rules.size() - 1;
+    Rule &added = _rules[index];
+    if (_ring) {
+        if (added.enabled) {
+            _arm(index);
+        }
+        return {index, 1};
+    }
+    const CallbackT cancel = [this, index] {
+        _rules[index].active = false;
+        _rules[index].cancel();
+    };
+    added.fallback_id = _fallback->add_rule(
+        added.fd,
+        added.direction,
+        added.kind == Kind::Poll ? added.callback : [this, index] { _on_fallback(index); },
+        cancel,
+        added.enabled);
+    return {index, 1};
+}
+
+EventRuleId IoUringEventLoop::add_receiver(const FileDescriptor &fd,
+                                           const ReceiveT &on_receive,
+                                           const CallbackT &cancel,
+                                           const bool enabled) {
+    Rule rule{Kind::Receive, fd.duplicate(), Direction::In, is_socket(fd), cancel, enabled};
+    rule.on_receive = on_receive;
+    return _add(move(rule));
+}
+
+EventRuleId IoUringEventLoop::add_receiver_from(UDPSocket &socket, const ReceiveFromT &on_receive, const bool enabled) {
+    Rule rule{Kind::Receive, socket.duplicate(), Direction::In, true, [] {}, enabled};
+    rule.on_receive_from = on_receive;
+    rule.udp = &socket;
+    return _add(move(rule));
+}
+
+EventRuleId IoUringEventLoop::add_reader(const FileDescriptor &fd,
+                                         const LimitT &limit,
+                                         const ReadT &on_read,
+                                         const CallbackT &cancel,
+                                         const bool enabled) {
+    Rule rule{Kind::Read, fd.duplicate(), Direction::In, is_socket(fd), cancel, enabled};
+    rule.limit = limit;
+    rule.on_read = on_read;
+    return _add(move(rule));
+}
+
+EventRuleId IoUringEventLoop::add_writer(const FileDescriptor &fd,
+                                         const FillT &fill,
+                                         const WrittenT &on_written,
+                                         const bool enabled) {
+    Rule rule{Kind::Write, fd.duplicate(), Direction::Out, is_socket(fd), [] {}, enabled};
+    rule.fill = fill;
+    rule.on_written = on_written;
+    return _add(move(rule));
+}
+
+void IoUringEventLoop::queue_write(const FileDescriptor &fd, BufferList &&datagram) {
+    _queue(Write{fd.fd_num(), move(datagram)});
+}
+
+void IoUringEventLoop::queue_sendto(const FileDescriptor &socket,
+                                    const Address &destination,
+                                    BufferList &&datagrams,
+                                    const size_t segment_size) {
+    Write write{socket.fd_num(), move(datagrams), segment_size};
+    memcpy(&write.destination, static_cast<const sockaddr *>(destination), destination.size());
+    write.destination_size = destination.size();
+    if (segment_size != 0 and not _gso) {
+        _queue_split(move(write));
+        return;
+    }
+    _queue(move(write));
+}
+
+//! Does the write go out with a sendmsg (rather than a write, or a writev for several Buffers)?
+static bool sends_message(const size_t destination_size, const size_t segment_size) {
+    return destination_size != 0 or segment_size != 0;
+}
+
+//! \details Without a ring, the datagram is written right away.
+void IoUringEventLoop::_queue(Write &&write) {
+    if (not _ring) {
+        _prepare(write);
+        const ssize_t result = sends_message(write.destination_size, write.segment_size)
+                                   ? ::sendmsg(write.fd_num, &write.message, 0)
+                                   : ::writev(write.fd_num, write.message.msg_iov, write.message.msg_iovlen);
+        _completed(write, result < 0 ? -errno : result);
+        return;
+    }
+    uint32_t index = 0;
+    if (not _free_writes.empty()) {
+        index = _free_writes.back();
+        _free_writes.pop_back();
+    } else {
+        index = _writes.size();
+        _writes.emplace_back();
+    }
+    _writes[index] = move(write);
+    _queued_writes.push_back(index);
+}
+
+//! \details Each datagram views the run's Buffers (no bytes are copied).
+void IoUringEventLoop::_queue_split(Write &&run) {
+    while (run.data.size() > 0) {
+        Write datagram{run.fd_num, {}, 0, run.destination, run.destination_size};
+        size_t remaining = min(run.segment_size, run.data.size());
+        for (const Buffer &buffer : run.data.buffers()) {
+            if (remaining == 0) {
+                break;
+            }
+            Buffer piece = buffer;
+            piece.remove_suffix(piece.size() - min(piece.size(), remaining));
+            remaining -= piece.size();
+            datagram.data.append(move(piece));
+        }
+        run.data.remove_prefix(datagram.data.size());
+        _queue(move(datagram));
+    }
+}
+
+//! \details Points the Write's iovecs at its Buffers and fills in the header of its sendmsg, if it
+//! has one, with the run's segment size in a control message. (The Write must not move again until
+//! the kernel is done with it.)
+void IoUringEventLoop::_prepare(Write &write) {
+    for (const Buffer &buffer : write.data.buffers()) {
+        write.iovecs.push_back({const_cast<char *>(buffer.str().data()), buffer.size()});
+    }
+    write.message.msg_iov = write.iovecs.begin();
+    write.message.msg_iovlen = write.iovecs.size();
+    if (write.destination_size != 0) {
+        write.message.msg_name = &write.destination;
+        write.message.msg_namelen = write.destination_size;
+    }
+    if (write.segment_size != 0) {
+        write.message.msg_control = write.control.data();
+        write.message.msg_controllen = write.control.size();
+        cmsghdr *cmsg = CMSG_FIRSTHDR(&write.message);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        const auto segment_size = static_cast<uint16_t>(write.segment_size);
+        memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+    }
+}
+
+//! \param[in] write the write that finished
+//! \param[in] result what its system call returned (a negated errno on failure)
+void IoUringEventLoop::_completed(Write &write, const ssize_t result) {
+    if (result == -EAGAIN or result == -ENOBUFS) {
+        // (the fd had no room for the datagram, so it is dropped, as a full network queue would)
+        return;
+    }
+    if (result == -EIO and write.segment_size != 0) {
+        // the route's device can't take runs after all, so send this one (and all later ones) a datagram at a time
+        _gso = false;
+        _queue_split(move(write));
+        return;
+    }
+    if (result < 0) {
+        throw unix_error(sends_message(write.destination_size, write.segment_size) ? "sendmsg" : "write",
+                         static_cast<int>(-result));
+    }
+    if (static_cast<size_t>(result) != write.data.size()) {
+        throw runtime_error("IoUringEventLoop: datagram was only partly written");
+    }
+}
+
+EventRuleId IoUringEventLoop::add_rule(const FileDescriptor &fd,
+                                       const Direction direction,
+                                       const CallbackT &callback,
+                                       const CallbackT &cancel,
+                                       const bool enabled) {
+    Rule rule{Kind::Poll, fd.duplicate(), direction, false, cancel, enabled};
+    rule.callback = callback;
+    return _add(move(rule));
+}
+
+void IoUringEventLoop::set_enabled(const EventRuleId id, const bool enabled) {
+    if (id.index >= _rules.size() or id.generation != 1) {
+        return;
+    }
+    Rule &rule = _rules[id.index];
+    if (not _ring) {
+        rule.enabled = enabled;
+        _fallback->set_enabled(rule.fallback_id, enabled);
+        return;
+    }
+    if (not rule.active) {
+        return;
+    }
+    // a disabled rule's poll (or one-shot receive) may still complete; it is ignored and not posted
+    // again. A read or write that can't be canceled in time still delivers what it read or wrote.
+    rule.enabled = enabled;
+    if (enabled and not rule.armed) {
+        _arm(id.index);
+    } else if (not enabled and rule.armed and (rule.multishot or rule.kind == Kind::Read or rule.kind == Kind::Write)) {
+        _cancel(id.index);
+    }
+}
+
+//! \details A poll waits for the fd to be ready. A receive on a socket is a multishot receive,
+//! which keeps completing (one datagram, in one provided buffer, per completion) until the kernel
+//! runs out of buffers, something goes wrong or it is canceled. Other fds, and sockets where the
+//! kernel has no multishot receives, get a one-shot read (or receive) that selects a provided buffer.
+//! A reader posts a read of up to its limit, and a writer a write of what it is to write next.
+//!
+//! An fd that turned down the last read or write (EAGAIN; the kernel waits for it to be ready only
+//! if it isn't non-blocking) gets a poll first, linked to the operation so that it is posted once
+//! the fd is ready.
+void IoUringEventLoop::_arm(const uint32_t index) {
+    Rule &rule = _rules[index];
+    const size_t limit = rule.kind == Kind::Read ? rule.limit() : 0;
+    if (rule.kind == Kind::Read and limit == 0) {
+        return;
+    }
+
+    if (rule.poll_first and rule.kind != Kind::Poll) {
+        io_uring_sqe &poll = _ring->next_sqe();
+        poll.opcode = IORING_OP_POLL_ADD;
+        poll.fd = rule.fd.fd_num();
+        poll.poll32_events = static_cast<uint32_t>(rule.direction);
+        poll.flags = IOSQE_IO_LINK;
+        poll.user_data = user_data(Op::Link, index);
+    }
+    rule.poll_first = false;
+
+    io_uring_sqe &sqe = _ring->next_sqe();
+    sqe.fd = rule.fd.fd_num();
+    if (rule.kind != Kind::Poll and not rule.socket) {
+        sqe.off = ~uint64_t{0};  // (read or write at the current position)
+    }
+    sqe.user_data = user_data(Op::Rule, index);
+    rule.multishot = false;
+    switch (rule.kind) {
+        case Kind::Poll:
+            sqe.opcode = IORING_OP_POLL_ADD;
+            sqe.poll32_events = static_cast<uint32_t>(rule.direction);
+            break;
+        case Kind::Receive:
+            sqe.flags = IOSQE_BUFFER_SELECT;
+            sqe.buf_group = BUFFER_GROUP;
+            rule.multishot = rule.socket and _multishot;
+            if (rule.on_receive_from) {
+                // (the kernel puts the sender's address in the buffer, ahead of the datagram, or for
+                // a one-shot receive, in `source`)
+                rule.message = {};
+                rule.message.msg_name = &rule.source;
+                rule.message.msg_namelen = sizeof(rule.source);
+                sqe.opcode = IORING_OP_RECVMSG;
+                sqe.addr = reinterpret_cast<uint64_t>(&rule.message);
+                sqe.len = 1;
+            } else {
+                sqe.opcode = rule.socket ? IORING_OP_RECV : IORING_OP_READ;
+                sqe.len = rule.multishot ? 0 : BUFFER_SIZE;
+            }
+            if (rule.multishot) {
+                sqe.ioprio = IORING_RECV_MULTISHOT;
+            }
+            break;
+        case Kind::Read:
+            rule.buffer.resize(limit);
+            sqe.opcode = rule.socket ? IORING_OP_RECV : IORING_OP_READ;
+            sqe.addr = reinterpret_cast<uint64_t>(rule.buffer.data());
+            sqe.len = rule.buffer.size();
+            break;
+        case Kind::Write:
+            rule.buffer = rule.fill();
+            sqe.opcode = rule.socket ? IORING_OP_SEND : IORING_OP_WRITE;
+            sqe.addr = reinterpret_cast<uint64_t>(rule.buffer.data());
+            sqe.len = rule.buffer.size();
+            if (rule.socket) {
+                sqe.msg_flags = MSG_NOSIGNAL;
+            }
+            break;
+    }
+    rule.armed = true;
+}
+
+//! \details Only a multishot receive, a read or a write needs canceling (the loop waits for them,
+//! where a poll's completion is just ignored). The last completion (for a multishot receive, the
+//! one without IORING_CQE_F_MORE) says it is done.
+//! A linked poll is canceled too (and with it, the operation waiting for it).
+void IoUringEventLoop::_cancel(const uint32_t index) {
+    for (const Op op : {Op::Link, Op::Rule}) {
+        io_uring_sqe &sqe = _ring->next_sqe();
+        sqe.opcode = IORING_OP_ASYNC_CANCEL;
+        sqe.addr = user_data(op, index);
+        sqe.user_data = user_data(Op::Other, 0);
+    }
+}
+
+//! \details What the ring's operation would have done, with a plain read or write (the
+//! EpollEventLoop calls this once the fd is ready, and cancels the rule at EOF).
+void IoUringEventLoop::_on_fallback(const uint32_t index) {
+    Rule &rule = _rules[index];
+    switch (rule.kind) {
+        case Kind::Poll:
+            rule.callback();
+            break;
+        case Kind::Receive:
+            if (rule.udp != nullptr) {
+                rule.udp->recv(_fallback_datagram);
+                rule.on_receive_from(_fallback_datagram.payload, _fallback_datagram.source_address);
+            } else {
+                rule.fd.read(_fallback_buffer, BUFFER_SIZE);
+                if (not rule.fd.eof()) {
+                    rule.on_receive(_fallback_buffer);
+                }
+            }
+            break;
+        case Kind::Read: {
+            string chunk = rule.fd.read(rule.limit());
+            if (not rule.fd.eof()) {
+                rule.on_read(move(chunk));
+            }
+            break;
+        }
+        case Kind::Write:
+            rule.on_written(rule.fd.write(rule.fill(), false));
+            break;
+    }
+}
+
+//! \details A datagram for queue_sendto() goes out with a sendmsg, whose header (like the iovecs
+//! and the data they point to) stays put in its Write until the send completes. Other datagrams
+//! go out with a write, or a writev if they are in several Buffers.
+void IoUringEventLoop::_submit_writes() {
+    for (const uint32_t index : _queued_writes) {
+        Write &write = _writes[index].value();
+        _prepare(write);
+        io_uring_sqe &sqe = _ring->next_sqe();
+        sqe.fd = write.fd_num;
+        if (sends_message(write.destination_size, write.segment_size)) {
+            sqe.opcode = IORING_OP_SENDMSG;
+            sqe.addr = reinterpret_cast<uint64_t>(&write.message);
+            sqe.len = 1;
+        } else if (write.iovecs.size() == 1) {
+            sqe.opcode = IORING_OP_WRITE;
+            sqe.addr = reinterpret_cast<uint64_t>(write.iovecs.front().iov_base);
+            sqe.len = write.iovecs.front().iov_len;
+            sqe.off = ~uint64_t{0};
+        } else {
+            sqe.opcode = IORING_OP_WRITEV;
+            sqe.addr = reinterpret_cast<uint64_t>(write.iovecs.begin());
+            sqe.len = write.iovecs.size();
+            sqe.off = ~uint64_t{0};
+        }
+        sqe.user_data = user_data(Op::Write, index);
+    }
+    _queued_writes.clear();
+}
+
+//! \details Runs the completion's handler, then posts the rule's operation again if it is still
+//! enabled (and the handler hasn't already).
+void IoUringEventLoop::_on_rule(const uint32_t index, const int32_t result, const uint32_t flags) {
+    Rule &rule = _rules[index];
+    switch (rule.kind) {
+        case Kind::Poll:
+            _on_poll(rule, result);
+            break;
+        case Kind::Receive:
+            _on_receive(rule, result, flags);
+            break;
+        case Kind::Read:
+            _on_read(rule, result);
+            break;
+        case Kind::Write:
+            _on_written(rule, result);
+            break;
+    }
+    if (rule.active and rule.enabled and not rule.armed) {
+        _arm(index);
+    }
+}
+
+void IoUringEventLoop::_on_receive(Rule &rule, const int32_t result, const uint32_t flags) {
+    if (not(flags & IORING_CQE_F_MORE)) {
+        rule.armed = false;
+    }
+
+    // an empty datagram arrives in a buffer; end of file (or of a stream socket) does not
+    const bool has_buffer = flags & IORING_CQE_F_BUFFER;
+    const bool eof = result == 0 and not(rule.socket and has_buffer);
+    if (has_buffer) {
+        const auto id = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+        if (result >= 0 and not eof and rule.active) {
+            const string_view datagram = _ring->buffer(id, result);
+            if (not rule.on_receive_from) {
+                rule.on_receive(datagram);
+            } else if (rule.multishot) {
+                // the buffer holds an io_uring_recvmsg_out, the sender's address (in the room asked
+                // for), and the datagram
+                io_uring_recvmsg_out out{};
+                const size_t header = sizeof(out) + sizeof(rule.source);
+                if (datagram.size() >= header) {
+                    memcpy(&out, datagram.data(), sizeof(out));
+                }
+                if (datagram.size() >= header and not(out.flags & MSG_TRUNC)) {
+                    const Address source{reinterpret_cast<const sockaddr *>(datagram.data() + sizeof(out)),
+                                         min(size_t{out.namelen}, sizeof(rule.source))};
+                    rule.on_receive_from(datagram.substr(header, out.payloadlen), source);
+                }
+            } else if (not(rule.message.msg_flags & MSG_TRUNC)) {
+                rule.on_receive_from(datagram,
+                                     {reinterpret_cast<const sockaddr *>(&rule.source), rule.message.msg_namelen});
+            }
+        }
+        _ring->recycle(id);
+    }
+
+    if (eof and rule.active) {
+        rule.active = false;
+        rule.cancel();
+    } else if (result == -EINVAL and rule.multishot) {
+        // the kernel has no multishot receives after all (see Ring::_probe()), so post one-shot ones
+        _multishot = false;
+    } else if (result == -EAGAIN and not rule.socket) {
+        // (a non-blocking fd with nothing to read)
+        rule.poll_first = true;
+    } else if (result < 0 and result != -ENOBUFS and result != -ECANCELED) {
+        // (-ENOBUFS: every buffer was in use; they have been given back by now, so just post again;
+        // -ECANCELED: the receiver was disabled)
+        throw unix_error(rule.socket ? "recv" : "read", -result);
+    }
+}
+
+void IoUringEventLoop::_on_poll(Rule &rule, const int32_t result) {
+    rule.armed = false;
+    if (not rule.active or not rule.enabled) {
+        return;
+    }
+    if (result < 0) {
+        throw unix_error("poll", -result);
+    }
+    if (result & (POLLERR | POLLNVAL)) {
+        throw runtime_error("IoUringEventLoop: error on polled file descriptor");
+    }
+
+    const bool ready = result & static_cast<int>(rule.direction);
+    if ((not ready and (result & POLLHUP)) or rule.fd.closed()) {
+        // the only condition was a hangup, so this direction of the fd is defunct
+        rule.active = false;
+        rule.cancel();
+        return;
+    }
+    if (not ready) {
+        // (something else, e.g. the peer shutting down its writes, woke the poll; it is posted again)
+        return;
+    }
+
+    const auto service_count = [&] {
+        return rule.direction == Direction::In ? rule.fd.read_count() : rule.fd.write_count();
+    };
+    const unsigned int count_before = service_count();
+    rule.callback();
+    if (rule.direction == Direction::In and rule.fd.eof()) {
+        rule.active = false;
+        rule.cancel();
+        return;
+    }
+    if (rule.enabled and count_before == service_count()) {
+        throw runtime_error(
+            "IoUringEventLoop: busy wait detected: callback did not read/write fd and is still enabled");
+    }
+}
+
+void IoUringEventLoop::_on_read(Rule &rule, const int32_t result) {
+    rule.armed = false;
+    if (result == -EAGAIN) {
+        rule.poll_first = true;
+        return;
+    }
+    if (result == -ECANCELED) {
+        // (the reader was disabled)
+        return;
+    }
+    if (result < 0) {
+        throw unix_error(rule.socket ? "recv" : "read", -result);
+    }
+    if (result == 0) {
+        if (rule.active) {
+            rule.active = false;
+            rule.cancel();
+        }
+        return;
+    }
+    // (the callback may post the next read, into a new buffer)
+    rule.buffer.resize(result);
+    string chunk = move(rule.buffer);
+    rule.buffer = string{};
+    rule.on_read(move(chunk));
+}
+
+void IoUringEventLoop::_on_written(Rule &rule, const int32_t result) {
+    rule.armed = false;
+    if (result == -EAGAIN) {
+        // (what wasn't written is asked for again)
+        rule.poll_first = true;
+        return;
+    }
+    if (result == -ECANCELED) {
+        // (the writer was disabled; it too is asked for again once the writer is enabled)
+        return;
+    }
+    if (result < 0) {
+        throw unix_error(rule.socket ? "send" : "write", -result);
+    }
+    rule.buffer.clear();
+    rule.on_written(result);
+}
+
+void IoUringEventLoop::_on_write(const uint32_t index, const int32_t result) {
+    Write write = move(_writes[index].value());
+    _writes[index].reset();
+    _free_writes.push_back(index);
+    _completed(write, result);
+}
+
+bool IoUringEventLoop::_has_work() const {
+    if (not _queued_writes.empty() or _free_writes.size() != _writes.size()) {
+        return true;
+    }
+    for (const Rule &rule : _rules) {
+        // (a read or write posted before its rule was disabled still has something to deliver)
+        const bool delivering = rule.armed and (rule.kind == Kind::Read or rule.kind == Kind::Write);
+        if (rule.active and (rule.enabled or delivering)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//! \param[in] timeout_ms longest time to wait for a completion (0 to only collect what has already
+//!                       completed, negative to wait indefinitely)
+//! \returns EventLoop::Result indicating success, timeout, or nothing left to wait for
+EventLoop::Result IoUringEventLoop::wait_next_event(const int timeout_ms) {
+    if (not _ring) {
+        return _fallback->wait_next_event(timeout_ms);
+    }
+    if (not _has_work()) {
+        return Result::Exit;
+    }
+
+    _submit_writes();
+    __kernel_timespec timeout{};
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+    if (not _ring->enter(timeout_ms == 0 ? 0 : 1, timeout_ms < 0 ? nullptr : &timeout)) {
+        return Result::Exit;
+    }
+
+    const size_t count = _ring->for_each_completion([&](const uint64_t data, const int32_t result, const uint32_t flags) {
+        const uint32_t index = data & 0xffffffff;
+        switch (static_cast<Op>(data >> 62)) {
+            case Op::Rule:
+                _on_rule(index, result, flags);
+                break;
+            case Op::Write:
+                _on_write(index, result);
+                break;
+            case Op::Other:
+            case Op::Link:
+                break;
+        }
+    });
+    return count == 0 ? Result::Timeout : Result::Success;
+}
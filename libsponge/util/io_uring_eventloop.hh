@@ -0,0 +1,256 @@
+#ifndef SPONGE_LIBSPONGE_IO_URING_EVENTLOOP_HH
+#define SPONGE_LIBSPONGE_IO_URING_EVENTLOOP_HH
+
+#include "address.hh"
+#include "buffer.hh"
+#include "epoll_eventloop.hh"
+#include "eventloop.hh"
+#include "file_descriptor.hh"
+#include "socket.hh"
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <vector>
+
+//! \brief An event loop that does its I/O through io_uring, falling back to epoll where it isn't available
+//!
+//! Built for the TCP thread's pattern of use: a datagram fd (TUN, TAP or UDP socket) that is read
+//! one datagram at a time and written in bursts, plus a stream (the socketpair to the application)
+//! read and written a chunk at a time, and a few fds that are merely watched.
+//!
+//! - add_receiver() reads datagrams from an fd into a ring of buffers provided to the kernel up
+//!   front (and add_receiver_from() receives them from a UDP socket along with their senders'
+//!   addresses). On a socket, one multishot receive keeps producing datagrams without being posted
+//!   again; on other fds (e.g. a TUN device), and on kernels without multishot receives, a read is
+//!   posted again after each datagram, along with the next batch. Each datagram is handed to the
+//!   callback in place, and its buffer goes back to the kernel as soon as the callback returns.
+//! - add_reader() and add_writer() read and write a stream with reads and writes posted to the
+//!   kernel (which waits for the fd to be ready itself), so they need no poll first.
+//! - queue_write() (or queue_sendto(), on an unconnected socket) queues a datagram, or with
+//!   queue_sendto() a run of datagrams for the kernel to split (UDP GSO). The kernel reads the
+//!   datagram from its Buffers in place. Queued writes are submitted together by the next call to
+//!   wait_next_event(), in the same system call that waits for completions.
+//! - add_rule() watches an fd for readability or writability, as EpollEventLoop::add_rule() does.
+//!
+//! Each of these is a rule, which set_enabled() turns off and on.
+//!
+//! A busy loop thus costs one system call per wakeup however many datagrams come and go, where
+//! an EventLoop makes a poll, a read per datagram (or chunk) received and a write per datagram (or
+//! chunk) sent.
+//!
+//! The constructor probes the kernel for the operations and features the loop uses. When io_uring
+//! can't be set up (an old kernel, or one that disables it) or lacks one of them, or when
+//! constructed not to use it, the same interface is served by an EpollEventLoop and plain reads
+//! and writes.
+class IoUringEventLoop {
+  public:
+    using Direction = EventLoop::Direction;
+    using Result = EventLoop::Result;
+    using CallbackT = std::function<void(void)>;
+    using ReceiveT = std::function<void(std::string_view)>;  //!< Called with each datagram received
+    //! Called with each datagram received and the address of its sender
+    using ReceiveFromT = std::function<void(std::string_view, const Address &)>;
+    using LimitT = std::function<size_t(void)>;          //!< Returns the most bytes a reader may read next
+    using ReadT = std::function<void(std::string &&)>;   //!< Called with each chunk a reader reads
+    using FillT = std::function<std::string(void)>;      //!< Returns the bytes a writer is to write next
+    using WrittenT = std::function<void(const size_t)>;  //!< Called with how many of them were written
+
+    static constexpr unsigned QUEUE_DEPTH = 256;   //!< Submission queue entries
+    static constexpr unsigned BUFFER_COUNT = 256;  //!< Receive buffers provided to the kernel
+    static constexpr size_t BUFFER_SIZE = 2048;    //!< Bytes per receive buffer (longer datagrams are truncated)
+
+  private:
+    class Ring;  //!< the io_uring instance and its memory maps
+
+    //! What a rule does with its fd
+    enum class Kind {
+        Poll,     //!< add_rule(): waits for the fd to be ready
+        Receive,  //!< add_receiver() and add_receiver_from(): receives datagrams into provided buffers
+        Read,     //!< add_reader(): reads a stream
+        Write     //!< add_writer(): writes a stream
+    };
+
+    //! An fd watched, read or written by the loop
+    struct Rule {
+        Kind kind;
+        FileDescriptor fd;
+        Direction direction;
+        bool socket;  //!< sockets are received from with (multishot) receives; other fds with reads
+        CallbackT cancel;
+        bool enabled;
+        bool active{true};
+        bool armed{false};       //!< an operation is posted
+        bool multishot{false};   //!< the receive posted is multishot
+        bool poll_first{false};  //!< the fd turned the last read or write down (EAGAIN), so poll before the next
+        EventRuleId fallback_id{};  //!< the EpollEventLoop's rule, when falling back to it
+
+        CallbackT callback{};             //!< Kind::Poll: called when the fd is ready
+        ReceiveT on_receive{};            //!< Kind::Receive: called with each datagram ...
+        ReceiveFromT on_receive_from{};   //!< ... or, from add_receiver_from(), with its sender too
+        UDPSocket *udp{nullptr};          //!< (the socket of add_receiver_from(), read when falling back)
+        LimitT limit{};                   //!< Kind::Read: how much to read next
+        ReadT on_read{};                  //!< Kind::Read: called with what was read
+        FillT fill{};                     //!< Kind::Write: what to write next
+        WrittenT on_written{};            //!< Kind::Write: called with how much was written
+        std::string buffer{};             //!< Kind::Read and Kind::Write: the bytes in flight
+        sockaddr_storage source{};        //!< a one-shot receive from add_receiver_from() puts the sender here
+        msghdr message{};                 //!< (and the kernel reads this while it is in flight)
+    };
+
+    //! Room for the control message of a run of datagrams (a UDP_SEGMENT segment size)
+    using GsoControl = std::array<char, CMSG_SPACE(sizeof(uint16_t))>;
+
+    //! A datagram (or run of datagrams) submitted for writing and not yet completed
+    struct Write {
+        int fd_num;
+        BufferList data;
+        size_t segment_size{0};          //!< for a run, the size of each datagram (0 for one datagram)
+        sockaddr_storage destination{};  //!< where to send it, for queue_sendto()
+        socklen_t destination_size{0};   //!< (0 for queue_write())
+        //! \name
+        //! the kernel reads these (and `data`) while the write is in flight
+        //!@{
+        SmallVector<iovec, BufferList::INLINE_CAPACITY> iovecs{};
+        GsoControl control{};
+        msghdr message{};
+        //!@}
+    };
+
+    std::unique_ptr<Ring> _ring;               //!< empty when falling back to epoll
+    std::optional<EpollEventLoop> _fallback{};  //!< used when there is no ring
+    std::string _fallback_buffer{};             //!< datagrams are read into this when falling back
+    UDPSocket::received_datagram _fallback_datagram{{nullptr, 0}, {}};  //!< (or this, with their senders)
+    bool _multishot{false};                     //!< receive on sockets with multishot receives?
+    bool _gso{true};                            //!< send runs of datagrams as they are (see queue_sendto())?
+
+    std::deque<Rule> _rules{};  //!< (a deque, so callbacks never move while they run)
+    std::deque<std::optional<Write>> _writes{};  //!< (a deque, so writes in flight never move)
+    std::vector<uint32_t> _free_writes{};
+    std::vector<uint32_t> _queued_writes{};  //!< queued since the last wait_next_event()
+
+    EventRuleId _add(Rule &&rule);
+    void _arm(const uint32_t index);
+    void _cancel(const uint32_t index);
+    void _on_fallback(const uint32_t index);
+    void _queue(Write &&write);
+    void _queue_split(Write &&run);
+    static void _prepare(Write &write);
+    void _completed(Write &write, const ssize_t result);
+    void _submit_writes();
+    void _on_rule(const uint32_t index, const int32_t result, const uint32_t flags);
+    void _on_receive(Rule &rule, const int32_t result, const uint32_t flags);
+    void _on_poll(Rule &rule, const int32_t result);
+    void _on_read(Rule &rule, const int32_t result);
+    void _on_written(Rule &rule, const int32_t result);
+    void _on_write(const uint32_t index, const int32_t result);
+    bool _has_work() const;
+
+  public:
+    //! \brief Set up io_uring if `try_io_uring` is `true` and the kernel supports it, or else epoll
+    explicit IoUringEventLoop(const bool try_io_uring = true);
+
+    ~IoUringEventLoop();
+
+    //! \brief Is the loop using io_uring (rather than falling back to epoll)?
+    bool using_io_uring() const { return _ring != nullptr; }
+
+    //! \brief Read datagrams from `fd`, calling `on_receive` with each
+    //! \param[in] fd a datagram fd (e.g. a UDPSocket or TunFd) to read for as long as the loop lives
+    //! \param[in] on_receive called with each datagram, which is valid only until the callback returns
+    //! \param[in] cancel called if `fd` reaches EOF
+    //! \param[in] enabled whether to start receiving right away (see set_enabled())
+    //! \note Datagrams longer than BUFFER_SIZE are truncated.
+    EventRuleId add_receiver(const FileDescriptor &fd,
+                             const ReceiveT &on_receive,
+                             const CallbackT &cancel = [] {},
+                             const bool enabled = true);
+
+    //! \brief Receive datagrams from `socket`, calling `on_receive` with each and the address of its sender
+    //! \param[in] socket a UDP socket (which must outlive the loop)
+    //! \param[in] on_receive called with each datagram and its sender, valid only until the callback returns
+    //! \param[in] enabled whether to start receiving right away (see set_enabled())
+    //! \note Datagrams that don't fit in a buffer (along with the sender's address) are dropped.
+    EventRuleId add_receiver_from(UDPSocket &socket, const ReceiveFromT &on_receive, const bool enabled = true);
+
+    //! \brief Read a stream from `fd`, calling `on_read` with each chunk
+    //! \param[in] fd a stream (e.g. a LocalStreamSocket) to read
+    //! \param[in] limit called before each read for the most bytes to read (which must not be 0 while enabled)
+    //! \param[in] on_read called with each chunk read (a read posted before the reader was disabled
+    //!                    still delivers its chunk)
+    //! \param[in] cancel called at EOF
+    //! \param[in] enabled whether to start reading right away (see set_enabled())
+    EventRuleId add_reader(const FileDescriptor &fd,
+                           const LimitT &limit,
+                           const ReadT &on_read,
+                           const CallbackT &cancel = [] {},
+                           const bool enabled = true);
+
+    //! \brief Write a stream to `fd`, a chunk at a time
+    //! \param[in] fd a stream (e.g. a LocalStreamSocket) to write
+    //! \param[in] fill called for the next chunk to write, once the last one is written (the writer
+    //!                 should be disabled while there is nothing to write)
+    //! \param[in] on_written called with how much of the chunk was written
+    //! \param[in] enabled whether to start writing right away (see set_enabled())
+    EventRuleId add_writer(const FileDescriptor &fd,
+                           const FillT &fill,
+                           const WrittenT &on_written,
+                           const bool enabled = true);
+
+    //! \brief Queue a datagram to be written to `fd` by the next wait_next_event()
+    //! \note Errors on the write are thrown from that call, except that a datagram the fd has no
+    //! room for is dropped, as a full network queue would drop it.
+    void queue_write(const FileDescriptor &fd, BufferList &&datagram);
+
+    //! \brief Queue a datagram to be sent from `socket` to `destination` by the next wait_next_event()
+    //! \param[in] socket a UDP socket
+    //! \param[in] destination where to send the datagram
+    //! \param[in] datagrams the datagram, or with a `segment_size`, a run of datagrams one after another
+    //! \param[in] segment_size the size of each datagram of a run (the last may be shorter), which the
+    //! kernel splits up ([UDP_SEGMENT](\ref man7::udp)), or 0 for a single datagram
+    //! \note Errors are handled as for queue_write(). If the route can't take a run after all (EIO),
+    //! the run is sent again one datagram at a time, and so are all later runs (see sends_runs()).
+    void queue_sendto(const FileDescriptor &socket,
+                      const Address &destination,
+                      BufferList &&datagrams,
+                      const size_t segment_size = 0);
+
+    //! \brief Does queue_sendto() still hand runs of datagrams to the kernel as they are?
+    bool sends_runs() const { return _gso; }
+
+    //! \brief Watch `fd` for readability or writability (see EpollEventLoop::add_rule())
+    EventRuleId add_rule(const FileDescriptor &fd,
+                         const Direction direction,
+                         const CallbackT &callback,
+                         const CallbackT &cancel = [] {},
+                         const bool enabled = true);
+
+    //! \brief Enable or disable a rule (added with add_rule(), add_receiver() etc.)
+    //! \details Disabling a receiver cancels its multishot receive, if it has one posted, and disabling
+    //! a reader or writer cancels its posted read or write (which still delivers what it read or wrote,
+    //! if the kernel got to it first).
+    void set_enabled(const EventRuleId id, const bool enabled);
+
+    //! \brief Submit queued writes, wait for something to happen, and run the callbacks for it
+    //! \returns Result::Exit if there is nothing left to wait for (or a signal interrupted the wait),
+    //! Result::Timeout if nothing happened within `timeout_ms` milliseconds, and Result::Success otherwise.
+    Result wait_next_event(const int timeout_ms);
+
+    //! \name
+    //! The loop hands its own address and buffers to the kernel, so it can't be moved or copied
+    //!@{
+    IoUringEventLoop(const IoUringEventLoop &) = delete;
+    IoUringEventLoop &operator=(const IoUringEventLoop &) = delete;
+    IoUringEventLoop(IoUringEventLoop &&) = delete;
+    IoUringEventLoop &operator=(IoUringEventLoop &&) = delete;
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_IO_URING_EVENTLOOP_HH
@@ -0,0 +1,123 @@
+#include "packet_buffer.hh"
+
+#include <array>
+#include <memory>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+//! Slab sizes: enough for headers alone, for an Ethernet-sized packet, and for the largest IP datagram
+constexpr array<size_t, 3> SIZE_CLASSES{256, 2048, 65536 + 256};
+
+//! How many Slabs of each size a thread keeps for reuse
+constexpr array<size_t, 3> MAX_FREE{256, 64, 8};
+
+//! The Slabs a thread has ready to hand out again, by size class
+struct ThreadFreeLists {
+    array<vector<unique_ptr<Slab>>, SIZE_CLASSES.size()> lists{};
+
+    ThreadFreeLists() {
+        // so that recycling a Slab never allocates
+        for (size_t i = 0; i < lists.size(); i++) {
+            lists[i].reserve(MAX_FREE[i]);
+        }
+    }
+
+    ~ThreadFreeLists();
+
+    ThreadFreeLists(const ThreadFreeLists &) = delete;
+    ThreadFreeLists &operator=(const ThreadFreeLists &) = delete;
+};
+
+//! Set once the thread's free lists are gone, after which Slabs let go of on the thread are freed
+//! (a trivially destructible thread_local outlives every thread_local that has a destructor)
+thread_local bool free_lists_destroyed = false;
+
+ThreadFreeLists::~ThreadFreeLists() { free_lists_destroyed = true; }
+
+ThreadFreeLists &free_lists() {
+    thread_local ThreadFreeLists lists;
+    return lists;
+}
+
+//! The smallest size class that holds `size` bytes, or SIZE_CLASSES.size() if none does
+size_t size_class(const size_t size) {
+    size_t ret = 0;
+    while (ret < SIZE_CLASSES.size() and SIZE_CLASSES[ret] < size) {
+        ret++;
+    }
+    return ret;
+}
+
+}  // namespace
+
+//! \details Called when the last Buffer viewing one of a PacketBuffer's Slabs is destroyed, on
+//! whichever thread that happens.
+void PacketBuffer::_recycle(Slab *slab) {
+    const size_t index = size_class(slab->capacity());
+    if (not free_lists_destroyed and index < SIZE_CLASSES.size()) {
+        auto &list = free_lists().lists[index];
+        if (list.size() < MAX_FREE[index]) {
+            list.emplace_back(slab);
+            return;
+        }
+    }
+    delete slab;
+}
+
+//! \param[in] capacity is how many bytes will be appended
+//! \param[in] headroom is how many bytes may be prepended
+//! \details A Slab of exactly `capacity + headroom` bytes is allocated (and freed once done with)
+//! if that is larger than every size class.
+PacketBuffer::PacketBuffer(const size_t capacity, const size_t headroom)
+    : _slab(nullptr), _begin(headroom), _end(headroom) {
+    const size_t size = capacity + headroom;
+    const size_t index = size_class(size);
+    if (index == SIZE_CLASSES.size()) {
+        _slab = new Slab(size);
+    } else {
+        auto &list = free_lists().lists[index];
+        if (list.empty()) {
+            _slab = new Slab(SIZE_CLASSES[index]);
+        } else {
+            _slab = list.back().release();
+            list.pop_back();
+        }
+        _slab->_recycle = _recycle;
+    }
+}
+
+void PacketBuffer::_reset() {
+    if (_slab) {
+        Slab::release(exchange(_slab, nullptr));
+    }
+    _begin = _end = 0;
+}
+
+//! \details Afterwards, the PacketBuffer has no bytes and no room (it can only be assigned to or destroyed).
+Buffer PacketBuffer::finish() {
+    if (not _slab) {
+        return {};
+    }
+    Buffer ret{*_slab, _begin, size()};
+    // (the Buffer now holds the only reference, so it returns the Slab when it is done with it)
+    _slab = nullptr;
+    _begin = _end = 0;
+    return ret;
+}
+
+PacketBuffer::PacketBuffer(PacketBuffer &&other) noexcept
+    : _slab(exchange(other._slab, nullptr)), _begin(exchange(other._begin, 0)), _end(exchange(other._end, 0)) {}
+
+PacketBuffer &PacketBuffer::operator=(PacketBuffer &&other) noexcept {
+    if (this != &other) {
+        _reset();
+        _slab = exchange(other._slab, nullptr);
+        _begin = exchange(other._begin, 0);
+        _end = exchange(other._end, 0);
+    }
+    return *this;
+}
@@ -0,0 +1,102 @@
+#ifndef SPONGE_LIBSPONGE_PACKET_BUFFER_HH
+#define SPONGE_LIBSPONGE_PACKET_BUFFER_HH
+
+#include "buffer.hh"
+
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+
+//! \brief A packet (or part of one) being written into a recycled Slab, with room left in front for headers
+//!
+//! The Slab comes from a free list kept by the calling thread, one per size class, so that once the
+//! lists have warmed up, building a header (or a whole packet) allocates nothing. The bytes are
+//! appended at the end, or prepended into the headroom, and finish() turns them into a Buffer that
+//! keeps the Slab; it goes back on the free list of whichever thread lets go of the last Buffer
+//! viewing it. Like BufferPool's, these Slabs are reference-counted without atomics, so a Buffer
+//! and its copies must belong to one thread at a time.
+//!
+//! ~~~{.cc}
+//! PacketBuffer header{TCPHeader::LENGTH};
+//! tcp_header.serialize(header);
+//! BufferList segment{header.finish()};
+//! segment.append(payload);
+//! ~~~
+class PacketBuffer {
+  private:
+    Slab *_slab;
+    size_t _begin;  //!< Where the bytes start (what comes before is headroom)
+    size_t _end;    //!< Where the bytes end (what comes after is tailroom)
+
+    //! Put `slab` on the calling thread's free list for its size class (or free it)
+    static void _recycle(Slab *slab);
+
+    //! Let go of the Slab, if it is still held
+    void _reset();
+
+  public:
+    //! Room to leave for an Ethernet header and the longest IPv4 and TCP headers (14 + 60 + 60 bytes, rounded up)
+    static constexpr size_t DEFAULT_HEADROOM = 136;
+
+    //! \brief Take a Slab with room for `headroom` bytes of headers in front of `capacity` bytes
+    explicit PacketBuffer(const size_t capacity, const size_t headroom = DEFAULT_HEADROOM);
+
+    //! \brief Return the Slab, unless finish() has made a Buffer of it
+    ~PacketBuffer() { _reset(); }
+
+    //! \brief The bytes written so far
+    std::string_view str() const { return {_slab ? _slab->data() + _begin : nullptr, size()}; }
+
+    //! \brief The bytes written so far, to change in place (e.g. to fill in a checksum)
+    char *data() { return _slab ? _slab->data() + _begin : nullptr; }
+
+    //! \brief Number of bytes written so far
+    size_t size() const { return _end - _begin; }
+
+    //! \brief Room left in front of the bytes
+    size_t headroom() const { return _begin; }
+
+    //! \brief Room left after the bytes
+    size_t tailroom() const { return _slab ? _slab->capacity() - _end : 0; }
+
+    //! \brief Grow the bytes by `n` at the end
+    //! \returns where to write the new bytes
+    char *append(const size_t n) {
+        if (n > tailroom()) {
+            throw std::length_error("PacketBuffer: out of tailroom");
+        }
+        char *const ret = data() + size();
+        _end += n;
+        return ret;
+    }
+
+    //! \brief Grow the bytes by `n` at the front, taking them from the headroom
+    //! \returns where to write the new bytes
+    char *prepend(const size_t n) {
+        if (n > headroom()) {
+            throw std::length_error("PacketBuffer: out of headroom");
+        }
+        _begin -= n;
+        return data();
+    }
+
+    //! \brief Append a copy of `str`
+    void append(const std::string_view str) { str.copy(append(str.size()), str.size()); }
+
+    //! \brief Append one byte (so that NetUnparser can write into a PacketBuffer as into a std::string)
+    void push_back(const char c) { *append(1) = c; }
+
+    //! \brief Make a Buffer of the bytes, which keeps the Slab (the PacketBuffer is left empty)
+    Buffer finish();
+
+    //! \name
+    //! A PacketBuffer can be moved, but not copied
+    //!@{
+    PacketBuffer(const PacketBuffer &) = delete;
+    PacketBuffer &operator=(const PacketBuffer &) = delete;
+    PacketBuffer(PacketBuffer &&other) noexcept;
+    PacketBuffer &operator=(PacketBuffer &&other) noexcept;
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_PACKET_BUFFER_HH
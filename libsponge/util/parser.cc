@@ -32,9 +32,17 @@ T NetParser::_parse_int() {
     }
 
     T ret = 0;
-    for (size_t i = 0; i < len; i++) {
-        ret <<= 8;
-        ret += uint8_t(_buffer.at(i));
+    size_t parsed = 0;
+    // (nearly always, the whole field is in the first Buffer)
+    for (const auto &buf : _buffer.buffers()) {
+        const string_view bytes = buf.str();
+        for (size_t i = 0; i < bytes.size() and parsed < len; i++, parsed++) {
+            ret <<= 8;
+            ret += uint8_t(bytes[i]);
+        }
+        if (parsed == len) {
+            break;
+        }
     }
 
     _buffer.remove_prefix(len);
@@ -50,8 +58,30 @@ void NetParser::remove_prefix(const size_t n) {
     _buffer.remove_prefix(n);
 }
 
-template <typename T>
-void NetUnparser::_unparse_int(string &s, T val) {
+//! \param[in] n is the number of bytes wanted
+//! \param[out] scratch is where to gather the bytes if they are split across Buffers
+const char *NetParser::peek(const size_t n, char *scratch) {
+    _check_size(n);
+    if (error()) {
+        return nullptr;
+    }
+
+    const auto &buffers = _buffer.buffers();
+    if (not buffers.empty() and buffers.front().size() >= n) {
+        return buffers.front().str().data();
+    }
+    size_t gathered = 0;
+    for (const auto &buf : buffers) {
+        gathered += buf.str().copy(scratch + gathered, n - gathered);
+        if (gathered == n) {
+            break;
+        }
+    }
+    return scratch;
+}
+
+template <typename T, typename Out>
+void NetUnparser::_unparse_int(Out &s, T val) {
     constexpr size_t len = sizeof(T);
     for (size_t i = 0; i < len; ++i) {
         const uint8_t the_byte = (val >> ((len - i - 1) * 8)) & 0xff;
@@ -70,3 +100,15 @@ void NetUnparser::u32(string &s, const uint32_t val) { return _unparse_int<uint3
 void NetUnparser::u16(string &s, const uint16_t val) { return _unparse_int<uint16_t>(s, val); }
 
 void NetUnparser::u8(string &s, const uint8_t val) { return _unparse_int<uint8_t>(s, val); }
+
+void NetUnparser::u32(PacketBuffer &s, const uint32_t val) { return _unparse_int<uint32_t>(s, val); }
+
+void NetUnparser::u16(PacketBuffer &s, const uint16_t val) { return _unparse_int<uint16_t>(s, val); }
+
+void NetUnparser::u8(PacketBuffer &s, const uint8_t val) { return _unparse_int<uint8_t>(s, val); }
+
+void NetUnparser::u32(ByteSpan &s, const uint32_t val) { return _unparse_int<uint32_t>(s, val); }
+
+void NetUnparser::u16(ByteSpan &s, const uint16_t val) { return _unparse_int<uint16_t>(s, val); }
+
+void NetUnparser::u8(ByteSpan &s, const uint8_t val) { return _unparse_int<uint8_t>(s, val); }
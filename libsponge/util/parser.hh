@@ -2,9 +2,12 @@
 #define SPONGE_LIBSPONGE_PARSER_HH
 
 #include "buffer.hh"
+#include "packet_buffer.hh"
 
+#include <array>
 #include <cstdint>
 #include <cstdlib>
+#include <stdexcept>
 #include <string>
 #include <utility>
 
@@ -22,9 +25,13 @@ enum class ParseResult {
 //! Output a string representation of a ParseResult
 std::string as_string(const ParseResult r);
 
+//! \brief Reads the fields of a packet (or a header) in network byte order, from the front
+//! \details The bytes may be split across several Buffers (e.g. a payload received in pieces); a
+//! field is read straight out of the first Buffer when it lies in it, and gathered byte by byte
+//! when it straddles two.
 class NetParser {
   private:
-    Buffer _buffer;
+    BufferList _buffer;
     ParseResult _error = ParseResult::NoError;  //!< Result of parsing so far
 
     //! Check that there is sufficient data to parse the next token
@@ -35,9 +42,10 @@ class NetParser {
     T _parse_int();
 
   public:
-    NetParser(Buffer buffer) : _buffer(buffer) {}
+    NetParser(BufferList buffer) : _buffer(std::move(buffer)) {}
 
-    Buffer buffer() const { return _buffer; }
+    //! The bytes not parsed yet
+    const BufferList &buffer() const { return _buffer; }
 
     //! Get the current value stored in BaseParser::_error
     ParseResult get_error() const { return _error; }
@@ -60,11 +68,57 @@ class NetParser {
 
     //! Remove n bytes from the buffer
     void remove_prefix(const size_t n);
+
+    //! \brief The next `n` bytes in one piece (without removing them), e.g. a header to load fields from
+    //! \details Points into the first Buffer if they lie in it (the usual case), or else at a copy
+    //! gathered into `scratch`, which must have room for `n` bytes.
+    //! \returns `nullptr` (and sets the error to PacketTooShort) if there aren't `n` bytes
+    const char *peek(const size_t n, char *scratch);
+
+    //! \brief The next `N` bytes in one piece, using `scratch` if needed (see above)
+    template <size_t N>
+    const char *peek(std::array<char, N> &scratch) { return peek(N, scratch.data()); }
+};
+
+//! \brief A fixed piece of memory for NetUnparser to write into from the front
+//! \details E.g. the room for a header claimed with BufferList::prepend.
+class ByteSpan {
+  private:
+    char *_data;
+    size_t _capacity;
+    size_t _size{0};
+
+  public:
+    ByteSpan(char *data, const size_t capacity) : _data(data), _capacity(capacity) {}
+
+    //! \brief Number of bytes written so far
+    size_t size() const { return _size; }
+
+    //! \brief Write one byte after the last
+    void push_back(const char c) { *append(1) = c; }
+
+    //! \brief Take the next `n` bytes
+    //! \returns where to write them
+    char *append(const size_t n) {
+        if (n > _capacity - _size) {
+            throw std::length_error("ByteSpan: out of room");
+        }
+        char *const ret = _data + _size;
+        _size += n;
+        return ret;
+    }
+
+    //! \name
+    //! A ByteSpan refers to memory it doesn't own, so it can't be copied
+    //!@{
+    ByteSpan(const ByteSpan &) = delete;
+    ByteSpan &operator=(const ByteSpan &) = delete;
+    //!@}
 };
 
 struct NetUnparser {
-    template <typename T>
-    static void _unparse_int(std::string &s, T val);
+    template <typename T, typename Out>
+    static void _unparse_int(Out &s, T val);
 
     //! Write a 32-bit integer into the data stream in network byte order
     static void u32(std::string &s, const uint32_t val);
@@ -74,6 +128,22 @@ struct NetUnparser {
 
     //! Write an 8-bit integer into the data stream in network byte order
     static void u8(std::string &s, const uint8_t val);
+
+    //! \name
+    //! The same, writing into a PacketBuffer
+    //!@{
+    static void u32(PacketBuffer &s, const uint32_t val);
+    static void u16(PacketBuffer &s, const uint16_t val);
+    static void u8(PacketBuffer &s, const uint8_t val);
+    //!@}
+
+    //! \name
+    //! The same, writing into a ByteSpan
+    //!@{
+    static void u32(ByteSpan &s, const uint32_t val);
+    static void u16(ByteSpan &s, const uint16_t val);
+    static void u8(ByteSpan &s, const uint8_t val);
+    //!@}
 };
 
 #endif  // SPONGE_LIBSPONGE_PARSER_HH
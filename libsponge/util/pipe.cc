@@ -0,0 +1,61 @@
+#include "pipe.hh"
+
+#include "util.hh"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace std;
+
+static pair<FileDescriptor, FileDescriptor> make_pipe() {
+    int fds[2];
+    SystemCall("pipe2", ::pipe2(static_cast<int *>(fds), O_NONBLOCK | O_CLOEXEC));
+    return {FileDescriptor(fds[0]), FileDescriptor(fds[1])};
+}
+
+//! \param[in] capacity is the size to ask for; the kernel may round it up, or refuse it (e.g. if it
+//! is above /proc/sys/fs/pipe-max-size) and keep the default
+Pipe::Pipe(const size_t capacity) : Pipe(make_pipe(), capacity) {}
+
+Pipe::Pipe(pair<FileDescriptor, FileDescriptor> ends, const size_t capacity)
+    : _read_end(move(ends.first)), _write_end(move(ends.second)), _capacity(0) {
+    // (best effort: a smaller pipe still works)
+    ::fcntl(_write_end.fd_num(), F_SETPIPE_SZ, static_cast<int>(capacity));
+    _capacity = SystemCall("fcntl", ::fcntl(_write_end.fd_num(), F_GETPIPE_SZ));
+}
+
+size_t Pipe::fill_from(FileDescriptor &in) {
+    if (remaining_capacity() == 0) {
+        throw runtime_error("Pipe::fill_from: pipe is full");
+    }
+    const size_t moved = in.splice(_write_end, remaining_capacity());
+    // Nothing moved, but not at EOF: an empty pipe has room, so then it's `in` that has nothing
+    // to give. Otherwise, take it that the pipe is out of slots.
+    if (moved == 0 and not in.eof() and _buffered > 0) {
+        _full = true;
+    }
+    _buffered += moved;
+    return moved;
+}
+
+size_t Pipe::drain_to(FileDescriptor &out) {
+    if (_buffered == 0) {
+        return 0;
+    }
+    const size_t moved = _read_end.splice(out, _buffered);
+    _buffered -= moved;
+    _full = _full and moved == 0;
+    return moved;
+}
+
+string Pipe::read(const size_t limit) {
+    if (_buffered == 0 or limit == 0) {
+        return {};
+    }
+    string ret = _read_end.read(min(limit, _buffered));
+    _buffered -= ret.size();
+    _full = _full and ret.empty();
+    return ret;
+}
@@ -0,0 +1,62 @@
+#ifndef SPONGE_LIBSPONGE_PIPE_HH
+#define SPONGE_LIBSPONGE_PIPE_HH
+
+#include "file_descriptor.hh"
+
+#include <cstddef>
+#include <string>
+#include <utility>
+
+//! \brief A [pipe(2)](\ref man2::pipe) used as a buffer inside the kernel, to move bytes between two
+//! fds (e.g. sockets) with FileDescriptor::splice so that they never enter user space
+//!
+//! ~~~{.cc}
+//! Pipe pipe;
+//! pipe.fill_from(socket1);  // bytes go from socket1 into the pipe ...
+//! pipe.drain_to(socket2);   // ... and from the pipe to socket2
+//! ~~~
+class Pipe {
+  private:
+    FileDescriptor _read_end;
+    FileDescriptor _write_end;
+    size_t _capacity;     //!< How much the pipe can hold
+    size_t _buffered{0};  //!< How much it holds now
+    bool _full{false};    //!< Has the pipe run out of slots (before running out of bytes)?
+
+    Pipe(std::pair<FileDescriptor, FileDescriptor> ends, const size_t capacity);
+
+  public:
+    //! \brief Create a (non-blocking) pipe, asking the kernel to let it hold `capacity` bytes
+    explicit Pipe(const size_t capacity = 1024 * 1024);
+
+    //! \brief Move as much as fits (or is available) from `in` into the pipe
+    //! \returns the number of bytes moved (0 if `in` is at EOF or has nothing to give, or if the pipe
+    //! turned out to be full)
+    size_t fill_from(FileDescriptor &in);
+
+    //! \brief Move as much as `out` takes from the pipe to `out`
+    //! \returns the number of bytes moved (0 if `out` has no room)
+    size_t drain_to(FileDescriptor &out);
+
+    //! \brief Read up to `limit` bytes out of the pipe, into user space after all
+    std::string read(const size_t limit);
+
+    //! \brief How much the pipe can hold
+    size_t capacity() const { return _capacity; }
+
+    //! \brief How much the pipe holds
+    size_t buffered() const { return _buffered; }
+
+    //! \brief How much more the pipe can take
+    //! \details A pipe holds a fixed number of pages, each holding what one write or splice put there,
+    //! so it may fill up (and this become 0) before it holds capacity() bytes.
+    size_t remaining_capacity() const { return _full ? 0 : _capacity - _buffered; }
+
+    //! \brief The end to read (or splice) from, e.g. to wait on with an EventLoop
+    const FileDescriptor &read_end() const { return _read_end; }
+
+    //! \brief The end to write (or splice) to
+    const FileDescriptor &write_end() const { return _write_end; }
+};
+
+#endif  // SPONGE_LIBSPONGE_PIPE_HH
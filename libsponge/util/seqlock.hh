@@ -0,0 +1,64 @@
+#ifndef SPONGE_LIBSPONGE_SEQLOCK_HH
+#define SPONGE_LIBSPONGE_SEQLOCK_HH
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+//! \brief Publishes a value from one writer thread to any number of reader threads without locks
+//! \tparam T a trivially copyable type
+//!
+//! A sequence counter is made odd while store() copies the value in and even again afterwards.
+//! load() copies the value out and retries if the counter was odd or changed meanwhile, so
+//! the writer never waits and a reader always sees a whole value from one store(). The value
+//! is kept in relaxed atomic words, so concurrent reads and writes are not data races.
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock copies its value byte by byte");
+
+  private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint64_t> _sequence{0};
+    std::array<std::atomic<uint64_t>, WORDS> _words{};
+
+  public:
+    //! \brief Construct holding a value-initialized T
+    SeqLock() { store(T{}); }
+
+    //! \brief Publish a new value (only one thread may call this)
+    void store(const T &value) {
+        std::array<uint64_t, WORDS> words{};
+        std::memcpy(words.data(), &value, sizeof(T));
+
+        const uint64_t sequence = _sequence.load(std::memory_order_relaxed);
+        _sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; i++) {
+            _words[i].store(words[i], std::memory_order_relaxed);
+        }
+        _sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    //! \brief Read the most recently published value (from any thread)
+    T load() const {
+        std::array<uint64_t, WORDS> words{};
+        uint64_t before = 0, after = 0;
+        do {
+            before = _sequence.load(std::memory_order_acquire);
+            for (size_t i = 0; i < WORDS; i++) {
+                words[i] = _words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = _sequence.load(std::memory_order_relaxed);
+        } while (before != after or (before & 1));
+
+        T value;
+        std::memcpy(static_cast<void *>(&value), words.data(), sizeof(T));
+        return value;
+    }
+};
+
+#endif  // SPONGE_LIBSPONGE_SEQLOCK_HH
@@ -0,0 +1,136 @@
+#ifndef SPONGE_LIBSPONGE_SMALL_VECTOR_HH
+#define SPONGE_LIBSPONGE_SMALL_VECTOR_HH
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//! \brief A sequence that keeps up to `N` elements inline, and only allocates once it grows past them
+//!
+//! Meant for short lists that are built and thrown away per packet (e.g. the pieces of a
+//! BufferList: a header or two and a payload), where a std::deque or std::vector would allocate
+//! every time. Elements are added at either end and removed from the front. Past `N` elements they
+//! all move to a std::vector, and stay there until the SmallVector is empty again.
+//!
+//! The inline slots are default-constructed, so `T` must be default-constructible (and cheaply so).
+template <typename T, size_t N>
+class SmallVector {
+  private:
+    std::array<T, N> _inline{};
+    std::vector<T> _spilled{};  //!< Holds the elements instead, once there have been more than `N`
+    size_t _size{0};
+    bool _is_spilled{false};
+
+    //! Can the moves below throw?
+    static constexpr bool NOTHROW_MOVE =
+        std::is_nothrow_move_constructible_v<T> and std::is_nothrow_move_assignable_v<T> and
+        std::is_nothrow_default_constructible_v<T>;
+
+    //! Empty out the inline slots and the vector, leaving no elements
+    void _reset() noexcept(NOTHROW_MOVE) {
+        for (auto &element : _inline) {
+            element = T{};
+        }
+        _spilled.clear();
+        _size = 0;
+        _is_spilled = false;
+    }
+
+  public:
+    SmallVector() = default;
+    SmallVector(const SmallVector &other) = default;
+    SmallVector &operator=(const SmallVector &other) = default;
+
+    //! \brief Take `other`'s elements, leaving it empty
+    SmallVector(SmallVector &&other) noexcept(NOTHROW_MOVE)
+        : _inline(std::move(other._inline))
+        , _spilled(std::move(other._spilled))
+        , _size(other._size)
+        , _is_spilled(other._is_spilled) {
+        other._reset();
+    }
+
+    //! \brief Take `other`'s elements (dropping this one's), leaving it empty
+    SmallVector &operator=(SmallVector &&other) noexcept(NOTHROW_MOVE) {
+        if (this != &other) {
+            _inline = std::move(other._inline);
+            _spilled = std::move(other._spilled);
+            _size = other._size;
+            _is_spilled = other._is_spilled;
+            other._reset();
+        }
+        return *this;
+    }
+
+    ~SmallVector() = default;
+
+    //! \name Element access
+    //!@{
+    T *begin() { return _is_spilled ? _spilled.data() : _inline.data(); }
+    T *end() { return begin() + _size; }
+    const T *begin() const { return _is_spilled ? _spilled.data() : _inline.data(); }
+    const T *end() const { return begin() + _size; }
+
+    T &operator[](const size_t n) { return begin()[n]; }
+    const T &operator[](const size_t n) const { return begin()[n]; }
+
+    T &front() { return *begin(); }
+    const T &front() const { return *begin(); }
+    T &back() { return end()[-1]; }
+    const T &back() const { return end()[-1]; }
+    //!@}
+
+    //! \brief Number of elements
+    size_t size() const { return _size; }
+
+    //! \brief Are there no elements?
+    bool empty() const { return _size == 0; }
+
+    //! \brief Add an element at the back (allocating only if it is the `N+1`th)
+    void push_back(T value) {
+        if (not _is_spilled and _size == N) {
+            _spilled.reserve(2 * N);
+            for (auto &element : _inline) {
+                _spilled.push_back(std::exchange(element, T{}));
+            }
+            _is_spilled = true;
+        }
+        if (_is_spilled) {
+            _spilled.push_back(std::move(value));
+        } else {
+            _inline[_size] = std::move(value);
+        }
+        _size++;
+    }
+
+    //! \brief Add an element at the front (moving the others back one)
+    void push_front(T value) {
+        push_back(std::move(value));
+        std::rotate(begin(), end() - 1, end());
+    }
+
+    //! \brief Remove the element at the front
+    void pop_front() {
+        if (_size == 0) {
+            throw std::out_of_range("SmallVector::pop_front");
+        }
+        if (_is_spilled) {
+            _spilled.erase(_spilled.begin());
+            if (_spilled.empty()) {
+                _is_spilled = false;
+            }
+        } else {
+            for (size_t i = 1; i < _size; i++) {
+                _inline[i - 1] = std::move(_inline[i]);
+            }
+            _inline[_size - 1] = T{};
+        }
+        _size--;
+    }
+};
+
+#endif  // SPONGE_LIBSPONGE_SMALL_VECTOR_HH
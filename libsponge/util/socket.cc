@@ -2,7 +2,10 @@
 
 #include "util.hh"
 
+#include <array>
 #include <cstddef>
+#include <cstring>
+#include <netinet/udp.h>
 #include <stdexcept>
 #include <unistd.h>
 
@@ -112,17 +115,166 @@ UDPSocket::received_datagram UDPSocket::recv(const size_t mtu) {
     return ret;
 }
 
+//! \details Fills `datagrams` from the front with [recvmmsg(2)](\ref man2::recvmmsg), waiting only for
+//! the first one. Each datagram is received straight into a Slab taken from `pool`, and handed out as a
+//! Buffer viewing it; Slabs left unfilled go back to the pool. The arrays recvmmsg needs are kept in
+//! the UDPSocket, so once it and the pool have warmed up, a batch allocates nothing.
+//! \returns the number of datagrams received (the rest of `datagrams` is left as it was)
+//! \note If a Slab is too small to hold a received datagram, this method throws a std::runtime_error
+size_t UDPSocket::recv_batch(BufferPool &pool, vector<received_buffer> &datagrams) {
+    const size_t batch = datagrams.size();
+    _batch_sources.resize(batch);
+    _batch_iovecs.resize(batch);
+    _batch_controls.resize(batch);
+    _batch_messages.resize(batch);
+    _batch_slabs.resize(batch);
+    _batch_holders.clear();
+    for (size_t i = 0; i < batch; i++) {
+        Slab &slab = pool.take();
+        _batch_slabs[i] = &slab;
+        _batch_holders.emplace_back(slab, 0);
+        _batch_iovecs[i] = {slab.data(), slab.capacity()};
+        msghdr &header = _batch_messages[i].msg_hdr;
+        header = {};
+        header.msg_name = static_cast<sockaddr *>(_batch_sources[i]);
+        header.msg_namelen = sizeof(_batch_sources[i].storage);
+        header.msg_iov = &_batch_iovecs[i];
+        header.msg_iovlen = 1;
+        header.msg_control = _batch_controls[i].data();
+        header.msg_controllen = _batch_controls[i].size();
+    }
+
+    const int received = ::recvmmsg(fd_num(), _batch_messages.data(), batch, MSG_WAITFORONE | MSG_TRUNC, nullptr);
+    register_read();
+    const size_t count = SystemCall("recvmmsg", received);
+
+    for (size_t i = 0; i < count; i++) {
+        mmsghdr &message = _batch_messages[i];
+        if (message.msg_len > _batch_iovecs[i].iov_len) {
+            throw runtime_error("recvmmsg (oversized datagram)");
+        }
+        datagrams[i].source_address = {_batch_sources[i], message.msg_hdr.msg_namelen};
+        datagrams[i].payload = Buffer{*_batch_slabs[i], message.msg_len};
+        datagrams[i].segment_size = 0;
+        for (cmsghdr *cmsg = CMSG_FIRSTHDR(&message.msg_hdr); cmsg != nullptr;
+             cmsg = CMSG_NXTHDR(&message.msg_hdr, cmsg)) {
+            if (cmsg->cmsg_level == SOL_UDP and cmsg->cmsg_type == UDP_GRO) {
+                int segment_size = 0;
+                memcpy(&segment_size, CMSG_DATA(cmsg), sizeof(segment_size));
+                datagrams[i].segment_size = segment_size;
+            }
+        }
+    }
+    _batch_holders.clear();  // (the Slabs that weren't filled go back to the pool)
+    return count;
+}
+
+//! \details Sends with [sendmmsg(2)](\ref man2::sendmmsg), which may stop early, e.g. if the socket is
+//! non-blocking and its send buffer fills up.
+//! \returns the number of datagrams sent (from the front of `payloads`)
+size_t UDPSocket::send_batch(const Address &destination, const vector<BufferViewList> &payloads) {
+    // (one array of iovecs for all the messages, so that it is grown once)
+    size_t pieces = 0;
+    for (const auto &payload : payloads) {
+        pieces += payload.pieces();
+    }
+    _send_iovecs.resize(pieces);
+    _send_messages.resize(payloads.size());
+    for (size_t i = 0, filled = 0; i < payloads.size(); i++) {
+        msghdr &header = _send_messages[i].msg_hdr;
+        header = {};
+        header.msg_name = const_cast<sockaddr *>(static_cast<const sockaddr *>(destination));
+        header.msg_namelen = destination.size();
+        header.msg_iov = _send_iovecs.data() + filled;
+        header.msg_iovlen = payloads[i].as_iovecs(header.msg_iov, payloads[i].pieces());
+        filled += header.msg_iovlen;
+    }
+
+    const size_t count = SystemCall("sendmmsg", ::sendmmsg(fd_num(), _send_messages.data(), payloads.size(), 0));
+    register_write();
+
+    for (size_t i = 0; i < count; i++) {
+        if (_send_messages[i].msg_len != payloads[i].size()) {
+            throw runtime_error("datagram payload too big for sendmmsg()");
+        }
+    }
+    return count;
+}
+
+//! \details Each run goes out as one message with a [UDP_SEGMENT](\ref man7::udp) control message
+//! giving its segment size, so it crosses the kernel's UDP layer once; the kernel (or the NIC) splits
+//! it into datagrams on the way out, or hands it to a receiving socket with UDP_GRO as it is.
+//! A run holds at most 64 datagrams, and no more than fits in one UDP datagram in all.
+//! \returns the number of runs sent (from the front of `payloads`)
+size_t UDPSocket::send_batch(const Address &destination, const vector<segmented_payload> &payloads) {
+    size_t pieces = 0;
+    for (const auto &payload : payloads) {
+        pieces += payload.payload.pieces();
+    }
+    _send_iovecs.resize(pieces);
+    _send_controls.resize(payloads.size());
+    _send_messages.resize(payloads.size());
+    for (size_t i = 0, filled = 0; i < payloads.size(); i++) {
+        msghdr &header = _send_messages[i].msg_hdr;
+        header = {};
+        header.msg_name = const_cast<sockaddr *>(static_cast<const sockaddr *>(destination));
+        header.msg_namelen = destination.size();
+        header.msg_iov = _send_iovecs.data() + filled;
+        header.msg_iovlen = payloads[i].payload.as_iovecs(header.msg_iov, payloads[i].payload.pieces());
+        filled += header.msg_iovlen;
+
+        if (payloads[i].segment_size == 0) {
+            continue;
+        }
+        header.msg_control = _send_controls[i].data();
+        header.msg_controllen = _send_controls[i].size();
+        cmsghdr *cmsg = CMSG_FIRSTHDR(&header);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        const uint16_t segment_size = payloads[i].segment_size;
+        memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+    }
+
+    const size_t count = SystemCall("sendmmsg", ::sendmmsg(fd_num(), _send_messages.data(), payloads.size(), 0));
+    register_write();
+
+    for (size_t i = 0; i < count; i++) {
+        if (_send_messages[i].msg_len != payloads[i].payload.size()) {
+            throw runtime_error("datagram payload too big for sendmmsg()");
+        }
+    }
+    return count;
+}
+
+bool UDPSocket::gso_supported() const {
+    int segment_size = 0;
+    socklen_t length = sizeof(segment_size);
+    return ::getsockopt(fd_num(), SOL_UDP, UDP_SEGMENT, &segment_size, &length) == 0;
+}
+
+//! \param[in] gro is `true` to receive runs of datagrams from the same sender coalesced into one payload
+//! (see received_datagram::segment_size)
+void UDPSocket::set_gro(const bool gro) { setsockopt(SOL_UDP, UDP_GRO, int(gro)); }
+
 void sendmsg_helper(const int fd_num,
                     const sockaddr *destination_address,
                     const socklen_t destination_address_len,
                     const BufferViewList &payload) {
-    auto iovecs = payload.as_iovecs();
-
+    // (a payload in more pieces than fit on the stack is rare enough to allocate for)
+    array<iovec, 16> iovecs{};
+    vector<iovec> more_iovecs{};
     msghdr message{};
+    message.msg_iov = iovecs.data();
+    message.msg_iovlen = payload.as_iovecs(iovecs);
+    if (message.msg_iovlen < payload.pieces()) {
+        more_iovecs = payload.as_iovecs();
+        message.msg_iov = more_iovecs.data();
+        message.msg_iovlen = more_iovecs.size();
+    }
+
     message.msg_name = const_cast<sockaddr *>(destination_address);
     message.msg_namelen = destination_address_len;
-    message.msg_iov = iovecs.data();
-    message.msg_iovlen = iovecs.size();
 
     const ssize_t bytes_sent = SystemCall("sendmsg", ::sendmsg(fd_num, &message, 0));
 
@@ -166,3 +318,6 @@ void Socket::setsockopt(const int level, const int option, const option_type &op
 // allow local address to be reused sooner, at the cost of some robustness
 //! \note Using `SO_REUSEADDR` may reduce the robustness of your application
 void Socket::set_reuseaddr() { setsockopt(SOL_SOCKET, SO_REUSEADDR, int(true)); }
+
+//! \details Every socket of the group must set it before binding (and belong to the same user).
+void Socket::set_reuseport() { setsockopt(SOL_SOCKET, SO_REUSEPORT, int(true)); }
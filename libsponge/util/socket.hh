@@ -4,10 +4,13 @@
 #include "address.hh"
 #include "file_descriptor.hh"
 
+#include <array>
 #include <cstdint>
 #include <functional>
 #include <string>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <vector>
 
 //! \brief Base class for network sockets (TCP, UDP, etc.)
 //! \details Socket is generally used via a subclass. See TCPSocket and UDPSocket for usage examples.
@@ -45,10 +48,39 @@ class Socket : public FileDescriptor {
 
     //! Allow local address to be reused sooner via [SO_REUSEADDR](\ref man7::socket)
     void set_reuseaddr();
+
+    //! Let sockets share an address, the kernel spreading flows among them, via [SO_REUSEPORT](\ref man7::socket)
+    void set_reuseport();
 };
 
 //! A wrapper around [UDP sockets](\ref man7::udp)
 class UDPSocket : public Socket {
+  private:
+    //! Room for the control message recv_batch() looks for (a UDP_GRO segment size)
+    using GroControl = std::array<char, CMSG_SPACE(sizeof(int))>;
+
+    //! Room for the control message send_batch() attaches to a run (a UDP_SEGMENT segment size)
+    using GsoControl = std::array<char, CMSG_SPACE(sizeof(uint16_t))>;
+
+    //! \name
+    //! recv_batch()'s arrays for recvmmsg(2), kept from call to call so that a batch allocates nothing
+    //!@{
+    std::vector<Address::Raw> _batch_sources{};
+    std::vector<iovec> _batch_iovecs{};
+    std::vector<GroControl> _batch_controls{};
+    std::vector<mmsghdr> _batch_messages{};
+    std::vector<Slab *> _batch_slabs{};   //!< The Slab each datagram is received into
+    std::vector<Buffer> _batch_holders{};  //!< Hand the Slabs back to the pool if they go unfilled
+    //!@}
+
+    //! \name
+    //! send_batch()'s arrays for sendmmsg(2), likewise kept from call to call
+    //!@{
+    std::vector<iovec> _send_iovecs{};
+    std::vector<GsoControl> _send_controls{};
+    std::vector<mmsghdr> _send_messages{};
+    //!@}
+
   protected:
     //! \brief Construct from FileDescriptor (used by TCPOverUDPSocketAdapter)
     //! \param[in] fd is the FileDescriptor from which to construct
@@ -62,6 +94,25 @@ class UDPSocket : public Socket {
     struct received_datagram {
         Address source_address;  //!< Address from which this datagram was received
         std::string payload;     //!< UDP datagram payload
+        //! With GRO (see set_gro()), the size of each of the datagrams coalesced into `payload`
+        //! (the last may be shorter), or 0 if `payload` is a single datagram
+        size_t segment_size{0};
+    };
+
+    //! Filled by UDPSocket::recv_batch; a datagram received into a Slab of a BufferPool
+    struct received_buffer {
+        Address source_address;  //!< Address from which this datagram was received
+        Buffer payload;          //!< UDP datagram payload (viewing the Slab it was received into)
+        //! With GRO (see set_gro()), the size of each of the datagrams coalesced into `payload`
+        //! (the last may be shorter), or 0 if `payload` is a single datagram
+        size_t segment_size{0};
+    };
+
+    //! Passed to UDPSocket::send_batch; a buffer that the kernel splits into datagrams
+    struct segmented_payload {
+        BufferViewList payload;  //!< The datagrams' payloads, one after another
+        //! The size of each datagram (the last may be shorter), or 0 to send `payload` as one datagram
+        size_t segment_size;
     };
 
     //! Receive a datagram and the Address of its sender
@@ -75,6 +126,21 @@ class UDPSocket : public Socket {
 
     //! Send datagram to the socket's connected address (must call connect() first)
     void send(const BufferViewList &payload);
+
+    //! Receive up to `datagrams.size()` datagrams with one system call, each into a Slab from `pool`
+    size_t recv_batch(BufferPool &pool, std::vector<received_buffer> &datagrams);
+
+    //! Send several datagrams to specified Address with one system call
+    size_t send_batch(const Address &destination, const std::vector<BufferViewList> &payloads);
+
+    //! Send several runs of datagrams to specified Address with one system call, the kernel splitting each run
+    size_t send_batch(const Address &destination, const std::vector<segmented_payload> &payloads);
+
+    //! Can the kernel split runs of datagrams for this socket ([UDP_SEGMENT](\ref man7::udp))?
+    bool gso_supported() const;
+
+    //! Let the kernel coalesce datagrams received by this socket ([UDP_GRO](\ref man7::udp))
+    void set_gro(const bool gro);
 };
 
 //! \class UDPSocket
@@ -83,6 +149,14 @@ class UDPSocket : public Socket {
 //! Example:
 //!
 //! \include socket_example_1.cc
+//!
+//! Sending and receiving in batches (see [sendmmsg(2)](\ref man2::sendmmsg) and [recvmmsg(2)](\ref man2::recvmmsg)):
+//!
+//! \include socket_example_4.cc
+//!
+//! With segmentation and receive offload, a run of datagrams can also cross the kernel as one buffer:
+//!
+//! \include socket_example_5.cc
 
 //! A wrapper around [TCP sockets](\ref man7::tcp)
 class TCPSocket : public Socket {
@@ -0,0 +1,244 @@
+#ifndef SPONGE_LIBSPONGE_TIMER_WHEEL_HH
+#define SPONGE_LIBSPONGE_TIMER_WHEEL_HH
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+//! \brief Identifies a timer armed on a TimerWheel
+//! \details A default-constructed TimerId never refers to an armed timer. Ids stay safe to use
+//! after their timer has expired or been canceled: the slot they name is reused under a new generation.
+struct TimerId {
+    uint32_t index{0};       //!< slot in the wheel's node table
+    uint32_t generation{0};  //!< generation of that slot when the timer was armed (0 = no timer)
+};
+
+//! \brief A hierarchical timing wheel with millisecond resolution
+//! \tparam T the payload handed back when a timer expires (small and copyable, e.g. an enum)
+//!
+//! Arming, canceling and expiring a timer take constant time, and advancing the clock
+//! skips over stretches of time in which no timer is due, so an owner with many idle timers
+//! (e.g. a NetworkInterface's ARP cache) no longer pays for them on every tick.
+//!
+//! The wheel has LEVELS levels of SLOTS slots each. A timer due within 64 ms of the current time
+//! sits in level 0, one due within 64^2 ms in level 1, and so on; when the clock reaches the start of
+//! a higher-level slot, its timers are cascaded down to the level that matches their remaining time.
+//! Timers further out than the top level covers (about two years) wait in the top level and are
+//! re-filed each time it comes around.
+template <typename T>
+class TimerWheel {
+  public:
+    static constexpr unsigned LEVEL_BITS = 6;                        //!< log2 of the number of slots per level
+    static constexpr unsigned SLOTS = 1u << LEVEL_BITS;              //!< slots per level
+    static constexpr unsigned LEVELS = 6;                            //!< number of levels
+    static constexpr uint64_t SPAN = 1ull << (LEVEL_BITS * LEVELS);  //!< delays the wheel can file exactly
+
+  private:
+    static constexpr uint32_t NIL = std::numeric_limits<uint32_t>::max();
+
+    //! An armed timer, linked into the list of its slot (or, when free, into the free list)
+    struct Node {
+        uint64_t deadline{0};
+        T payload{};
+        uint32_t generation{1};
+        uint32_t prev{NIL};
+        uint32_t next{NIL};
+        uint8_t level{0};
+        uint8_t slot{0};
+        bool armed{false};
+    };
+
+    std::vector<Node> _nodes{};
+    uint32_t _free{NIL};
+    std::array<std::array<uint32_t, SLOTS>, LEVELS> _slots{};
+    std::array<uint64_t, LEVELS> _occupied{};  //!< bit `s` of level `l` is set when slot `s` holds a timer
+    uint64_t _now{0};
+    size_t _size{0};
+
+    //! When the clock next reaches the start of an occupied slot, at the level whose slots are `1 << shift` ms long
+    static uint64_t _next_slot_start(const uint64_t occupied, const uint64_t now, const unsigned shift) {
+        const uint64_t current = now >> shift;
+        // rotate so that bit 0 is the slot after the current one
+        const unsigned offset = (current + 1) % SLOTS;
+        const uint64_t rotated = offset ? (occupied >> offset) | (occupied << (SLOTS - offset)) : occupied;
+        return (current + 1 + __builtin_ctzll(rotated)) << shift;
+    }
+
+    void _link(const uint32_t index) {
+        Node &node = _nodes[index];
+        const uint64_t delta = node.deadline - _now;
+        unsigned level = 0;
+        while (level + 1 < LEVELS and delta >= (1ull << (LEVEL_BITS * (level + 1)))) {
+            ++level;
+        }
+        // a deadline beyond the top level is parked in the top level's last reachable slot
+        const uint64_t filed = delta < SPAN ? node.deadline : _now + SPAN - 1;
+        const unsigned slot = (filed >> (LEVEL_BITS * level)) % SLOTS;
+
+        node.level = level;
+        node.slot = slot;
+        node.prev = NIL;
+        node.next = _slots[level][slot];
+        if (node.next != NIL) {
+            _nodes[node.next].prev = index;
+        }
+        _slots[level][slot] = index;
+        _occupied[level] |= 1ull << slot;
+    }
+
+    void _unlink(const uint32_t index) {
+        Node &node = _nodes[index];
+        if (node.prev != NIL) {
+            _nodes[node.prev].next = node.next;
+        } else {
+            _slots[node.level][node.slot] = node.next;
+            if (node.next == NIL) {
+                _occupied[node.level] &= ~(1ull << node.slot);
+            }
+        }
+        if (node.next != NIL) {
+            _nodes[node.next].prev = node.prev;
+        }
+    }
+
+    void _release(const uint32_t index) {
+        Node &node = _nodes[index];
+        node.armed = false;
+        node.generation++;
+        node.next = _free;
+        _free = index;
+        _size--;
+    }
+
+    //! Move the timers of a higher-level slot down to the levels matching their remaining time
+    void _cascade(const unsigned level, const unsigned slot) {
+        uint32_t index = _slots[level][slot];
+        _slots[level][slot] = NIL;
+        _occupied[level] &= ~(1ull << slot);
+        while (index != NIL) {
+            const uint32_t next = _nodes[index].next;
+            _link(index);
+            index = next;
+        }
+    }
+
+    //! The next time at which something (an expiry or a cascade) happens, if any timer is armed
+    std::optional<uint64_t> _next_event() const {
+        if (_size == 0) {
+            return std::nullopt;
+        }
+        uint64_t next = std::numeric_limits<uint64_t>::max();
+        for (unsigned level = 0; level < LEVELS; level++) {
+            if (_occupied[level]) {
+                next = std::min(next, _next_slot_start(_occupied[level], _now, LEVEL_BITS * level));
+            }
+        }
+        return next;
+    }
+
+  public:
+    TimerWheel() {
+        for (auto &level : _slots) {
+            level.fill(NIL);
+        }
+    }
+
+    //! \brief The wheel's clock: total milliseconds passed to advance()
+    uint64_t now() const { return _now; }
+
+    //! \brief Number of armed timers
+    size_t size() const { return _size; }
+
+    //! \brief Arm a timer that expires `delay` milliseconds from now (at least 1 ms)
+    TimerId arm(const uint64_t delay, const T &payload) {
+        uint32_t index = _free;
+        if (index != NIL) {
+            _free = _nodes[index].next;
+        } else {
+            index = _nodes.size();
+            _nodes.emplace_back();
+        }
+        Node &node = _nodes[index];
+        node.deadline = _now + std::max<uint64_t>(delay, 1);
+        node.payload = payload;
+        node.armed = true;
+        _size++;
+        _link(index);
+        return {index, node.generation};
+    }
+
+    //! \brief Is the timer armed (i.e. neither expired nor canceled)?
+    bool armed(const TimerId id) const {
+        return id.index < _nodes.size() and _nodes[id.index].armed and _nodes[id.index].generation == id.generation;
+    }
+
+    //! \brief Disarm a timer; does nothing if it already expired or was canceled
+    //! \returns `true` if the timer was armed
+    bool cancel(const TimerId id) {
+        if (not armed(id)) {
+            return false;
+        }
+        _unlink(id.index);
+        _release(id.index);
+        return true;
+    }
+
+    //! \brief Milliseconds until an armed timer expires
+    std::optional<uint64_t> time_until(const TimerId id) const {
+        if (not armed(id)) {
+            return std::nullopt;
+        }
+        return _nodes[id.index].deadline - _now;
+    }
+
+    //! \brief Milliseconds until the wheel next needs to be advanced, or empty if no timer is armed
+    //! \note This never overshoots the earliest deadline, but may undershoot it when the next event
+    //! is a cascade of a far-off timer; advancing to it and asking again is cheap.
+    std::optional<uint64_t> time_until_next() const {
+        const auto next = _next_event();
+        if (not next.has_value()) {
+            return std::nullopt;
+        }
+        return next.value() - _now;
+    }
+
+    //! \brief Advance the clock by `ms` milliseconds, calling `on_expire(payload)` for each timer that comes due
+    //! \details Timers expire in deadline order. `on_expire` may arm and cancel timers.
+    template <typename F>
+    void advance(const uint64_t ms, F &&on_expire) {
+        const uint64_t target = _now + ms;
+        while (true) {
+            const auto next = _next_event();
+            if (not next.has_value() or next.value() > target) {
+                break;
+            }
+            _now = next.value();
+
+            // cascade from the top down, so that timers can fall through several levels at once
+            for (unsigned level = LEVELS - 1; level > 0; level--) {
+                const unsigned shift = LEVEL_BITS * level;
+                if (_now % (1ull << shift) == 0) {
+                    const unsigned slot = (_now >> shift) % SLOTS;
+                    if (_occupied[level] & (1ull << slot)) {
+                        _cascade(level, slot);
+                    }
+                }
+            }
+
+            const unsigned slot = _now % SLOTS;
+            while (_slots[0][slot] != NIL) {
+                const uint32_t index = _slots[0][slot];
+                const T payload = _nodes[index].payload;
+                _unlink(index);
+                _release(index);
+                on_expire(payload);
+            }
+        }
+        _now = target;
+    }
+};
+
+#endif  // SPONGE_LIBSPONGE_TIMER_WHEEL_HH
@@ -1,11 +1,14 @@
 #include "util.hh"
 
+#include "checksum_kernels.hh"
+
 #include <array>
 #include <cctype>
 #include <chrono>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 #include <sys/socket.h>
 
 using namespace std;
@@ -86,19 +89,63 @@ mt19937 get_random_generator() {
 //! on the Internet checksum, and consult the [IP](\ref rfc::rfc791) and [TCP](\ref rfc::rfc793) RFCs.
 InternetChecksum::InternetChecksum(const uint32_t initial_sum) : _sum(initial_sum) {}
 
-void InternetChecksum::add(std::string_view data) {
-    for (size_t i = 0; i < data.size(); i++) {
-        uint16_t val = uint8_t(data[i]);
-        if (not _parity) {
-            val <<= 8;
+void InternetChecksum::add(std::string_view data) { _add(data, fastest_kernel()); }
+
+//! \throws std::runtime_error if the CPU can't run `kernel`
+void InternetChecksum::add(std::string_view data, const Kernel kernel) {
+    if (not supported(kernel)) {
+        throw runtime_error("InternetChecksum: this CPU can't run the kernel asked for");
+    }
+    _add(data, kernel);
+}
+
+//! \details The kernels add up whole words, so a byte left over from the last call (or for the
+//! next one) is added here, on its own.
+void InternetChecksum::_add(std::string_view data, const Kernel kernel) {
+    if (kernel == Kernel::Bytewise) {
+        for (size_t i = 0; i < data.size(); i++) {
+            uint16_t val = uint8_t(data[i]);
+            if (not _parity) {
+                val <<= 8;
+            }
+            _sum += val;
+            _parity = !_parity;
         }
-        _sum += val;
-        _parity = !_parity;
+        return;
+    }
+
+    // finish the word the last call started
+    if (_parity and not data.empty()) {
+        _sum += uint8_t(data.front());
+        _parity = false;
+        data.remove_prefix(1);
+    }
+
+    const size_t words_length = data.size() & ~size_t{1};
+    uint64_t words_sum = 0;
+    switch (kernel) {
+        case Kernel::Bytewise:
+        case Kernel::Word64:
+            words_sum = checksum_kernels::word64(data.data(), words_length);
+            break;
+        case Kernel::SSE2:
+            words_sum = checksum_kernels::sse2(data.data(), words_length);
+            break;
+        case Kernel::AVX2:
+            words_sum = checksum_kernels::avx2(data.data(), words_length);
+            break;
+    }
+    _sum += checksum_kernels::fold_to_network(words_sum);
+
+    // and start one with the byte left over, if there is one
+    if (words_length < data.size()) {
+        _sum += uint16_t{uint8_t(data.back())} << 8;
+        _parity = true;
     }
 }
 
 uint16_t InternetChecksum::value() const {
-    uint32_t ret = _sum;
+    uint64_t ret = _sum;
 
     while (ret > 0xffff) {
         ret = (ret >> 16) + (ret & 0xffff);
@@ -107,6 +154,24 @@ uint16_t InternetChecksum::value() const {
     return ~ret;
 }
 
+bool InternetChecksum::supported(const Kernel kernel) {
+    switch (kernel) {
+        case Kernel::SSE2:
+            return checksum_kernels::sse2_supported();
+        case Kernel::AVX2:
+            return checksum_kernels::avx2_supported();
+        default:
+            return true;
+    }
+}
+
+InternetChecksum::Kernel InternetChecksum::fastest_kernel() {
+    static const Kernel fastest = supported(Kernel::AVX2)   ? Kernel::AVX2
+                                  : supported(Kernel::SSE2) ? Kernel::SSE2
+                                                            : Kernel::Word64;
+    return fastest;
+}
+
 //! \param[in] data is a pointer to the bytes to show
 //! \param[in] len is the number of bytes to show
 //! \param[in] indent is the number of spaces to indent
@@ -53,14 +53,33 @@ uint64_t timestamp_ms();
 
 //! The internet checksum algorithm
 class InternetChecksum {
+  public:
+    //! \brief Ways of adding up the bytes, slowest first (see checksum_kernels.hh)
+    //! \details All of them give the same sum; Bytewise is the reference the others are tested against.
+    enum class Kernel { Bytewise, Word64, SSE2, AVX2 };
+
   private:
-    uint32_t _sum;
-    bool _parity{};
+    uint64_t _sum;
+    bool _parity{};  //!< Has an odd number of bytes been added? (the next one is the low byte of a word)
+
+    void _add(std::string_view data, const Kernel kernel);
 
   public:
     InternetChecksum(const uint32_t initial_sum = 0);
+
+    //! \brief Add `data` to the sum, using the fastest kernel the CPU supports
     void add(std::string_view data);
+
+    //! \brief Add `data` to the sum with a particular kernel (e.g. to test or benchmark it)
+    void add(std::string_view data, const Kernel kernel);
+
     uint16_t value() const;
+
+    //! \brief Can the CPU run `kernel`?
+    static bool supported(const Kernel kernel);
+
+    //! \brief The kernel add() uses, chosen once from what the CPU supports
+    static Kernel fastest_kernel();
 };
 
 //! Hexdump the contents of a packet (or any other sequence of bytes)
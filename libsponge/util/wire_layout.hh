@@ -0,0 +1,86 @@
+#ifndef SPONGE_LIBSPONGE_WIRE_LAYOUT_HH
+#define SPONGE_LIBSPONGE_WIRE_LAYOUT_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <endian.h>
+#include <type_traits>
+
+//! \brief Convert an integer between network and host byte order (the conversion is its own inverse)
+template <typename T>
+T network_order(const T value) {
+    if constexpr (sizeof(T) == 1) {
+        return value;
+    } else if constexpr (sizeof(T) == 2) {
+        return be16toh(value);
+    } else {
+        return be32toh(value);
+    }
+}
+
+//! \brief An unsigned integer field of a header: `sizeof(T)` bytes at byte `Offset`, in network byte order
+//!
+//! load() and store() read and write the field at its fixed offset, so code that goes through a
+//! header's fields one after another compiles to a load (or store) and a byte swap for each, with
+//! no bounds checks: those are done once, for the whole header (see WireLayout).
+template <typename T, size_t Offset>
+struct WireField {
+    static_assert(std::is_unsigned_v<T> and (sizeof(T) == 1 or sizeof(T) == 2 or sizeof(T) == 4),
+                  "WireField: only 8-, 16- and 32-bit unsigned fields are supported");
+
+    static constexpr size_t OFFSET = Offset;           //!< Where the field starts
+    static constexpr size_t END = Offset + sizeof(T);  //!< Where the field ends
+
+    //! \brief Read the field from a header's bytes
+    static T load(const char *header) {
+        T value{};
+        memcpy(&value, header + Offset, sizeof(T));
+        return network_order(value);
+    }
+
+    //! \brief Write the field into a header's bytes
+    static void store(char *header, const T value) {
+        const T wire_value = network_order(value);
+        memcpy(header + Offset, &wire_value, sizeof(T));
+    }
+};
+
+//! \brief A field of `N` bytes copied as they are (e.g. an Ethernet address), at byte `Offset`
+template <size_t N, size_t Offset>
+struct WireBytes {
+    static constexpr size_t OFFSET = Offset;   //!< Where the field starts
+    static constexpr size_t END = Offset + N;  //!< Where the field ends
+
+    //! \brief Read the field from a header's bytes
+    static std::array<uint8_t, N> load(const char *header) {
+        std::array<uint8_t, N> value{};
+        memcpy(value.data(), header + Offset, N);
+        return value;
+    }
+
+    //! \brief Write the field into a header's bytes
+    static void store(char *header, const std::array<uint8_t, N> &value) { memcpy(header + Offset, value.data(), N); }
+};
+
+//! Does each of `Fields` start where the one before it ends (with the first at byte 0)?
+template <typename... Fields>
+constexpr bool wire_fields_contiguous() {
+    size_t expected = 0;
+    bool contiguous = true;
+    ((contiguous = contiguous and Fields::OFFSET == expected, expected = Fields::END), ...);
+    return contiguous;
+}
+
+//! \brief The fixed-size part of a header, declared once as its fields in wire order
+//! \details Checks at compile time that the fields leave no gaps and don't overlap. LENGTH is the
+//! number of bytes a parser has to check for before loading any of them.
+template <typename... Fields>
+struct WireLayout {
+    static_assert(wire_fields_contiguous<Fields...>(), "WireLayout: fields must follow one another, without gaps");
+
+    static constexpr size_t LENGTH = (size_t{0} + ... + (Fields::END - Fields::OFFSET));  //!< Length in bytes
+};
+
+#endif  // SPONGE_LIBSPONGE_WIRE_LAYOUT_HH
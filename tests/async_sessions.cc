@@ -0,0 +1,135 @@
+#include "async_fd.hh"
+#include "coroutine_loop.hh"
+#include "eventloop.hh"
+#include "task.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+static pair<FileDescriptor, FileDescriptor> socket_pair() {
+    int fds[2];
+    SystemCall("socketpair", ::socketpair(AF_UNIX, SOCK_STREAM, 0, static_cast<int *>(fds)));
+    return {FileDescriptor(fds[0]), FileDescriptor(fds[1])};
+}
+
+//! Echo everything read back to the peer, until EOF
+static Task<> echo_server(CoroutineLoop &loop, FileDescriptor fd) {
+    AsyncFd conn{loop, move(fd)};
+    string buffer;
+    while (true) {
+        co_await conn.read_some(buffer);
+        if (conn.eof()) {
+            break;
+        }
+        co_await conn.write_all(move(buffer));
+    }
+}
+
+//! Collect everything up to EOF
+static Task<string> read_all(AsyncFd &conn) {
+    string all, buffer;
+    while (true) {
+        co_await conn.read_some(buffer);
+        if (conn.eof()) {
+            co_return all;
+        }
+        all += buffer;
+    }
+}
+
+//! Write a message, then shut down the sending side
+static Task<> send(AsyncFd &conn, string message) {
+    co_await conn.write_all(move(message));
+    SystemCall("shutdown", ::shutdown(conn.fd().fd_num(), SHUT_WR));
+}
+
+//! Send a message through the echo server, and check that it comes back
+static Task<> client(CoroutineLoop &loop, FileDescriptor fd, const size_t id, size_t &done) {
+    AsyncFd conn{loop, move(fd)};
+    // every so often, more than the socket buffers hold, so the echo has to flow while the message is written
+    const size_t size = id % 50 == 0 ? 500000 : 10000;
+    const string message = string(size, static_cast<char>('a' + id % 26)) + to_string(id);
+    co_await loop.sleep_for(id % 5);
+
+    loop.spawn(send(conn, message));
+    const string echoed = co_await read_all(conn);
+    if (echoed != message) {
+        throw runtime_error("client " + to_string(id) + " got back something else");
+    }
+    done++;
+}
+
+static Task<> fail_later(CoroutineLoop &loop) {
+    co_await loop.sleep_for(1);
+    throw runtime_error("failed on purpose");
+}
+
+int main() {
+    try {
+        {
+            // a thousand concurrent sessions, each straight-line code, all on this thread
+            constexpr size_t SESSIONS = 1000;
+            EventLoop events;
+            CoroutineLoop loop{events};
+            size_t done = 0;
+            for (size_t id = 0; id < SESSIONS; id++) {
+                auto [a, b] = socket_pair();
+                loop.spawn(echo_server(loop, move(a)));
+                loop.spawn(client(loop, move(b), id, done));
+            }
+            test_should_be(loop.running() > 0, true);
+            loop.run();
+            test_should_be(done, SESSIONS);
+            test_should_be(loop.running(), size_t{0});
+        }
+
+        {
+            // sleeps end in deadline order, however they were started
+            EventLoop events;
+            CoroutineLoop loop{events};
+            vector<int> woke;
+            for (const int ms : {30, 10, 20, 0}) {
+                loop.spawn([](CoroutineLoop &l, vector<int> &out, const int delay) -> Task<> {
+                    co_await l.sleep_for(delay);
+                    out.push_back(delay);
+                }(loop, woke, ms));
+            }
+            const auto start = chrono::steady_clock::now();
+            loop.run();
+            test_should_be(chrono::steady_clock::now() - start >= chrono::milliseconds(30), true);
+            test_should_be(woke.size(), size_t{4});
+            test_should_be(woke[0], 0);
+            test_should_be(woke[3], 30);
+        }
+
+        {
+            // an exception escaping a spawned task comes out of run()
+            EventLoop events;
+            CoroutineLoop loop{events};
+            loop.spawn(fail_later(loop));
+            bool threw = false;
+            try {
+                loop.run();
+            } catch (const runtime_error &e) {
+                threw = string(e.what()) == "failed on purpose";
+            }
+            test_should_be(threw, true);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+#include "buffer.hh"
+#include "parser.hh"
+#include "test_should_be.hh"
+#include "wire_layout.hh"
+
+#include <array>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <sys/uio.h>
+
+using namespace std;
+
+static string piece(const iovec &v) { return {static_cast<const char *>(v.iov_base), v.iov_len}; }
+
+int main() {
+    try {
+        {
+            // a few Buffers stay inline; more spill over, and come back inline once removed
+            SmallVector<Buffer, 2> buffers;
+            for (const char *s : {"a", "bc", "def"}) {
+                buffers.push_back(Buffer{string(s)});
+            }
+            test_should_be(buffers.size(), size_t{3});
+            test_should_be(buffers.front().copy() == "a" and buffers.back().copy() == "def", true);
+            buffers.pop_front();
+            test_should_be(buffers[0].copy() == "bc", true);
+            buffers.pop_front();
+            buffers.pop_front();
+            test_should_be(buffers.empty(), true);
+            buffers.push_back(Buffer{string("g")});
+            buffers.push_back(Buffer{string("h")});
+            buffers.pop_front();
+            test_should_be(buffers.size() == 1 and buffers.front().copy() == "h", true);
+
+            // a moved-from SmallVector is empty and inline, whether the elements were spilled or not
+            SmallVector<Buffer, 2> moved{std::move(buffers)};
+            test_should_be(buffers.empty() and buffers.begin() == buffers.end(), true);
+            test_should_be(moved.size() == 1 and moved.front().copy() == "h", true);
+            for (const char *s : {"i", "j"}) {
+                moved.push_back(Buffer{string(s)});
+            }
+            buffers = std::move(moved);
+            test_should_be(moved.empty(), true);
+            moved.push_back(Buffer{string("k")});
+            test_should_be(moved.size() == 1 and moved.front().copy() == "k", true);
+            test_should_be(buffers.size() == 3 and buffers.back().copy() == "j", true);
+        }
+
+        {
+            // BufferList keeps its order through appends and removals, inline or not
+            BufferList list{string("head")};
+            for (size_t i = 0; i < 2 * BufferList::INLINE_CAPACITY; i++) {
+                list.append(Buffer{to_string(i)});
+            }
+            test_should_be(list.concatenate() == "head01234567", true);
+            list.remove_prefix(5);
+            test_should_be(list.concatenate() == "1234567", true);
+            test_should_be(list.buffers().size(), size_t{7});
+        }
+
+        {
+            // fields are parsed across Buffers, whether or not they straddle two
+            BufferList list{string("\x01\x02\x03")};
+            list.append(Buffer{string("\x04\x05")});
+            list.append(Buffer{string("\x06")});
+            NetParser p{list};
+            test_should_be(p.u16(), uint16_t{0x0102});
+            test_should_be(p.u32(), uint32_t{0x03040506});
+            test_should_be(p.error(), false);
+            test_should_be(p.buffer().size(), size_t{0});
+            test_should_be(p.u8(), uint8_t{0});
+            test_should_be(p.get_error() == ParseResult::PacketTooShort, true);
+        }
+
+        {
+            // a header is peeked at in place when it lies in one Buffer, and gathered when it doesn't
+            using Layout = WireLayout<WireField<uint16_t, 0>, WireField<uint32_t, 2>, WireBytes<2, 6>>;
+            static_assert(Layout::LENGTH == 8);
+            BufferList list{string("\x01\x02\x03\x04\x05\x06\x07\x08\x09", 9)};
+            array<char, Layout::LENGTH> scratch{};
+            NetParser whole{list};
+            test_should_be(whole.peek(scratch) == list.buffers().front().str().data(), true);
+
+            BufferList pieces{string("\x01\x02\x03")};
+            pieces.append(Buffer{string("\x04\x05\x06\x07\x08")});
+            NetParser split{pieces};
+            const char *const bytes = split.peek(scratch);
+            test_should_be(bytes == scratch.data(), true);
+            test_should_be((WireField<uint16_t, 0>::load(bytes)), uint16_t{0x0102});
+            test_should_be((WireField<uint32_t, 2>::load(bytes)), uint32_t{0x03040506});
+            test_should_be((WireBytes<2, 6>::load(bytes) == array<uint8_t, 2>{7, 8}), true);
+            test_should_be(split.buffer().size(), size_t{8});
+
+            // ... and stores write the same bytes back
+            array<char, Layout::LENGTH> out{};
+            WireField<uint16_t, 0>::store(out.data(), 0x0102);
+            WireField<uint32_t, 2>::store(out.data(), 0x03040506);
+            WireBytes<2, 6>::store(out.data(), {7, 8});
+            test_should_be(string(out.data(), out.size()) == pieces.concatenate(), true);
+
+            pieces.remove_prefix(1);
+            NetParser short_parser{pieces};
+            test_should_be(short_parser.peek(scratch) == nullptr, true);
+            test_should_be(short_parser.get_error() == ParseResult::PacketTooShort, true);
+        }
+
+        {
+            // iovecs fill a caller's array from the front, as many as fit
+            BufferList list{string("one")};
+            list.append(Buffer{string("two")});
+            list.append(Buffer{string("three")});
+            BufferViewList views{list};
+            views.remove_prefix(1);
+            test_should_be(views.pieces(), size_t{3});
+
+            array<iovec, 4> all{};
+            test_should_be(views.as_iovecs(all), size_t{3});
+            test_should_be(piece(all[0]) == "ne" and piece(all[1]) == "two" and piece(all[2]) == "three", true);
+
+            array<iovec, 2> some{};
+            test_should_be(views.as_iovecs(some), size_t{2});
+            test_should_be(piece(some[1]) == "two", true);
+            test_should_be(views.as_iovecs().size(), size_t{3});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
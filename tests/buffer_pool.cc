@@ -0,0 +1,103 @@
+#include "buffer_pool.hh"
+#include "file_descriptor.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+static pair<FileDescriptor, FileDescriptor> make_pipe() {
+    int fds[2];
+    SystemCall("pipe", ::pipe(static_cast<int *>(fds)));
+    return {FileDescriptor(fds[0]), FileDescriptor(fds[1])};
+}
+
+int main() {
+    try {
+        auto [in, out] = make_pipe();
+        BufferPool pool{16, 2};
+
+        {
+            // a read gives a Buffer of exactly the bytes read, at most a Slab's worth
+            out.write("hello");
+            Buffer hello = in.read(pool);
+            test_should_be(hello.copy() == "hello", true);
+            out.write("0123456789abcdefXYZ");
+            Buffer first = in.read(pool);
+            Buffer rest = in.read(pool);
+            test_should_be(first.copy() == "0123456789abcdef", true);
+            test_should_be(rest.copy() == "XYZ", true);
+            test_should_be(pool.free_slabs(), size_t{0});
+
+            // copies (and views with a prefix removed) keep the Slab in use ...
+            Buffer copy = hello;
+            hello = Buffer{};
+            copy.remove_prefix(2);
+            test_should_be(copy.copy() == "llo", true);
+            test_should_be(pool.free_slabs(), size_t{0});
+
+            // ... and the last one to go gives it back
+            copy = Buffer{};
+            test_should_be(pool.free_slabs(), size_t{1});
+            rest.remove_prefix(3);
+            test_should_be(pool.free_slabs(), size_t{2});
+        }
+        // (the pool keeps at most two free Slabs)
+        test_should_be(pool.free_slabs(), size_t{2});
+
+        {
+            // reads reuse the free Slabs
+            vector<const char *> slabs;
+            for (size_t i = 0; i < 4; i++) {
+                out.write("x");
+                const Buffer buffer = in.read(pool);
+                slabs.push_back(buffer.str().data());
+            }
+            test_should_be(slabs[0] == slabs[2] and slabs[1] == slabs[3], true);
+            test_should_be(pool.free_slabs(), size_t{2});
+        }
+
+        {
+            // a failed read gives its Slab back
+            in.set_blocking(false);
+            bool threw = false;
+            try {
+                in.read(pool);
+            } catch (const unix_error &) {
+                threw = true;
+            }
+            test_should_be(threw, true);
+            test_should_be(pool.free_slabs(), size_t{2});
+            in.set_blocking(true);
+
+            // and reading nothing means EOF
+            out.close();
+            test_should_be(in.read(pool).size(), size_t{0});
+            test_should_be(in.eof(), true);
+            test_should_be(pool.free_slabs(), size_t{2});
+        }
+
+        {
+            // Buffers may outlive their pool
+            auto [in2, out2] = make_pipe();
+            optional<BufferPool> short_lived{in_place, 8};
+            out2.write("outlive");
+            const Buffer survivor = in2.read(short_lived.value());
+            short_lived.reset();
+            test_should_be(survivor.copy() == "outlive", true);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
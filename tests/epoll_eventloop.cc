@@ -0,0 +1,172 @@
+#include "epoll_eventloop.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+static pair<FileDescriptor, FileDescriptor> socket_pair() {
+    int fds[2];
+    SystemCall("socketpair", ::socketpair(AF_UNIX, SOCK_STREAM, 0, static_cast<int *>(fds)));
+    return {FileDescriptor(fds[0]), FileDescriptor(fds[1])};
+}
+
+int main() {
+    try {
+        constexpr size_t N = 200;
+        EpollEventLoop loop;
+        vector<pair<FileDescriptor, FileDescriptor>> pairs;
+        vector<EventRuleId> rules;
+        vector<size_t> reads(N, 0);
+        size_t canceled = 0;
+        for (size_t i = 0; i < N; i++) {
+            pairs.push_back(socket_pair());
+            FileDescriptor &fd = pairs.back().first;
+            rules.push_back(loop.add_rule(
+                fd,
+                Direction::In,
+                [&, i] {
+                    pairs[i].first.read();
+                    reads[i]++;
+                },
+                [&] { canceled++; }));
+        }
+        test_should_be(loop.size(), N);
+        test_should_be(loop.wait_next_event(0) == EventLoop::Result::Timeout, true);
+
+        {
+            // only the ready fds' callbacks run
+            for (const size_t i : {3, 77, 150}) {
+                pairs[i].second.write("x");
+            }
+            test_should_be(loop.wait_next_event(0) == EventLoop::Result::Success, true);
+            size_t total = 0;
+            for (size_t i = 0; i < N; i++) {
+                total += reads[i];
+            }
+            test_should_be(total, size_t{3});
+            test_should_be(reads[77], size_t{1});
+        }
+
+        {
+            // a disabled rule doesn't fire until it is enabled again
+            loop.disable(rules[10]);
+            pairs[10].second.write("x");
+            test_should_be(loop.wait_next_event(0) == EventLoop::Result::Timeout, true);
+            test_should_be(reads[10], size_t{0});
+            loop.enable(rules[10]);
+            test_should_be(loop.wait_next_event(0) == EventLoop::Result::Success, true);
+            test_should_be(reads[10], size_t{1});
+        }
+
+        {
+            // more ready fds than one batch holds are handled over several calls
+            for (size_t i = 0; i < 150; i++) {
+                pairs[i].second.write("x");
+            }
+            size_t calls = 0;
+            while (loop.wait_next_event(0) == EventLoop::Result::Success) {
+                calls++;
+            }
+            size_t total = 0;
+            for (size_t i = 0; i < N; i++) {
+                total += reads[i];
+            }
+            test_should_be(total, size_t{4 + 150});
+            test_should_be(calls, size_t{3});
+        }
+
+        {
+            // EOF cancels a rule; remove() drops one without calling `cancel`
+            pairs[20].second.close();
+            test_should_be(loop.wait_next_event(0) == EventLoop::Result::Success, true);
+            test_should_be(loop.active(rules[20]), false);
+            test_should_be(canceled, size_t{1});
+
+            loop.remove(rules[21]);
+            test_should_be(loop.active(rules[21]), false);
+            pairs[21].second.write("x");
+            test_should_be(loop.wait_next_event(0) == EventLoop::Result::Timeout, true);
+            test_should_be(canceled, size_t{1});
+            test_should_be(loop.size(), N - 2);
+        }
+
+        {
+            // an fd can have a rule in each direction, enabled independently
+            size_t writes = 0;
+            const EventRuleId out = loop.add_rule(pairs[30].first, Direction::Out, [&] {
+                pairs[30].first.write("y");
+                writes++;
+            });
+            test_should_be(loop.wait_next_event(0) == EventLoop::Result::Success, true);
+            test_should_be(writes, size_t{1});
+            loop.disable(out);
+            test_should_be(loop.wait_next_event(0) == EventLoop::Result::Timeout, true);
+            test_should_be(pairs[30].second.read() == "y", true);
+
+            bool threw = false;
+            try {
+                loop.add_rule(pairs[30].first, Direction::Out, [] {});
+            } catch (const runtime_error &) {
+                threw = true;
+            }
+            test_should_be(threw, true);
+        }
+
+        {
+            // a callback that neither reads nor disables its rule is a busy wait
+            EpollEventLoop busy;
+            auto [a, b] = socket_pair();
+            busy.add_rule(a, Direction::In, [] {});
+            b.write("x");
+            bool threw = false;
+            try {
+                busy.wait_next_event(0);
+            } catch (const runtime_error &) {
+                threw = true;
+            }
+            test_should_be(threw, true);
+        }
+
+        {
+            // a cancel callback run by add_rule (for a closed fd whose number is reused) may add rules itself
+            EpollEventLoop reuse;
+            auto [a, b] = socket_pair();
+            FileDescriptor high{SystemCall("fcntl", ::fcntl(b.fd_num(), F_DUPFD_CLOEXEC, 900))};
+            bool high_added = false;
+            reuse.add_rule(
+                a, Direction::In, [&] { a.read(); }, [&] {
+                    reuse.add_rule(high, Direction::Out, [] {});
+                    high_added = true;
+                });
+            const int number = a.fd_num();
+            a.close();
+            auto [c, d] = socket_pair();
+            test_should_be(c.fd_num(), number);
+            reuse.add_rule(c, Direction::In, [&] { c.read(); });
+            test_should_be(high_added, true);
+            test_should_be(reuse.size(), size_t{2});
+        }
+
+        {
+            // with nothing enabled there is nothing to wait for
+            for (const EventRuleId id : rules) {
+                loop.disable(id);
+            }
+            test_should_be(loop.wait_next_event(-1) == EventLoop::Result::Exit, true);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
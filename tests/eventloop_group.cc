@@ -0,0 +1,145 @@
+#include "eventloop_group.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <sys/socket.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+static pair<FileDescriptor, FileDescriptor> socket_pair() {
+    int fds[2];
+    SystemCall("socketpair", ::socketpair(AF_UNIX, SOCK_STREAM, 0, static_cast<int *>(fds)));
+    return {FileDescriptor(fds[0]), FileDescriptor(fds[1])};
+}
+
+//! Counts down to zero, waking a waiter when it gets there
+class Latch {
+    mutex _mutex{};
+    condition_variable _zero{};
+    size_t _count;
+
+  public:
+    explicit Latch(const size_t count) : _count(count) {}
+
+    void count_down() {
+        lock_guard<mutex> lock(_mutex);
+        if (--_count == 0) {
+            _zero.notify_all();
+        }
+    }
+
+    void wait() {
+        unique_lock<mutex> lock(_mutex);
+        _zero.wait(lock, [&] { return _count == 0; });
+    }
+};
+
+int main() {
+    try {
+        constexpr size_t LOOPS = 4;
+        auto [a, b] = socket_pair();  // (outlives the group, whose loops may use it)
+        EventLoopGroup group{LOOPS};
+        test_should_be(group.size(), LOOPS);
+        test_should_be(group.current(), LOOPS);
+
+        {
+            // tasks posted from several threads at once all run, each on its own loop's thread and in order
+            constexpr size_t THREADS = 4, TASKS = 2000;
+            vector<vector<size_t>> ran(LOOPS);
+            vector<char> right_thread(LOOPS, true);
+            Latch done{THREADS * TASKS};
+            vector<thread> posters;
+            for (size_t t = 0; t < THREADS; t++) {
+                posters.emplace_back([&, t] {
+                    for (size_t i = 0; i < TASKS; i++) {
+                        const size_t index = (t + i) % LOOPS;
+                        group.post(index, [&, index, t, i](EventLoop &) {
+                            right_thread[index] = right_thread[index] and group.current() == index;
+                            ran[index].push_back(t * TASKS + i);
+                            done.count_down();
+                        });
+                    }
+                });
+            }
+            for (auto &poster : posters) {
+                poster.join();
+            }
+            done.wait();
+
+            size_t total = 0;
+            for (size_t index = 0; index < LOOPS; index++) {
+                test_should_be(right_thread[index] != 0, true);
+                total += ran[index].size();
+                // tasks from one poster to one loop keep their order
+                vector<size_t> last(THREADS, 0);
+                bool ordered = true;
+                for (const size_t id : ran[index]) {
+                    const size_t t = id / TASKS, i = id % TASKS + 1;
+                    ordered = ordered and i > last[t];
+                    last[t] = i;
+                }
+                test_should_be(ordered, true);
+            }
+            test_should_be(total, THREADS * TASKS);
+        }
+
+        {
+            // placement fills the least-loaded loop first, round-robin among equals
+            vector<size_t> placed;
+            for (size_t i = 0; i < 2 * LOOPS; i++) {
+                placed.push_back(group.place([](EventLoop &) {}));
+            }
+            for (size_t index = 0; index < LOOPS; index++) {
+                test_should_be(group.load(index), size_t{2});
+            }
+            test_should_be(set<size_t>(placed.begin(), placed.begin() + LOOPS).size(), LOOPS);
+
+            group.release(placed[0]);
+            group.release(placed[0]);
+            test_should_be(group.place([](EventLoop &) {}), placed[0]);
+        }
+
+        {
+            // a placed task can set up rules on its loop, which then serve the fd on that loop's thread
+            Latch read{1};
+            atomic<size_t> served_on{LOOPS};
+            const size_t index = group.place([&, fd = &a](EventLoop &loop) {
+                loop.add_rule(*fd, Direction::In, [&, fd] {
+                    fd->read();
+                    served_on = group.current();
+                    read.count_down();
+                });
+            });
+            b.write("x");
+            read.wait();
+            test_should_be(served_on.load(), index);
+
+            // ... and timers
+            Latch fired{1};
+            atomic<size_t> fired_on{LOOPS};
+            group.post(index, [&](EventLoop &loop) {
+                loop.add_timer(1, [&] {
+                    fired_on = group.current();
+                    fired.count_down();
+                });
+            });
+            fired.wait();
+            test_should_be(fired_on.load(), index);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+#include "eventloop.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+static pair<FileDescriptor, FileDescriptor> socket_pair() {
+    int fds[2];
+    SystemCall("socketpair", ::socketpair(AF_UNIX, SOCK_STREAM, 0, static_cast<int *>(fds)));
+    return {FileDescriptor(fds[0]), FileDescriptor(fds[1])};
+}
+
+int main() {
+    try {
+        {
+            // timers fire in deadline order, not in the order they were added; canceled ones never fire
+            EventLoop loop;
+            vector<int> fired;
+            loop.add_timer(30, [&] { fired.push_back(30); });
+            loop.add_timer(10, [&] { fired.push_back(10); });
+            const auto canceled = loop.add_timer(5, [&] { fired.push_back(5); });
+            loop.add_timer(20, [&] { fired.push_back(20); });
+            loop.cancel_timer(canceled);
+
+            const auto start = steady_clock::now();
+            while (loop.wait_next_event(-1) != EventLoop::Result::Exit) {
+            }
+            const auto elapsed = steady_clock::now() - start;
+            test_should_be(fired.size(), size_t{3});
+            test_should_be(fired[0], 10);
+            test_should_be(fired[1], 20);
+            test_should_be(fired[2], 30);
+            // with no fds to poll, the loop sleeps until each deadline rather than returning early
+            test_should_be(elapsed >= milliseconds(30), true);
+        }
+
+        {
+            // a wait ends at the next deadline, not at the (longer) timeout
+            EventLoop loop;
+            auto [a, b] = socket_pair();
+            loop.add_rule(a, Direction::In, [&, fd = &a] { fd->read(); });
+            steady_clock::time_point fired_at{};
+            loop.add_timer(5, [&] { fired_at = steady_clock::now(); });
+            const auto start = steady_clock::now();
+            test_should_be(loop.wait_next_event(1000) == EventLoop::Result::Success, true);
+            test_should_be(fired_at >= start + milliseconds(5), true);
+            test_should_be(fired_at < start + milliseconds(500), true);
+
+            // ... and with no timer pending, a wait times out as before
+            test_should_be(loop.wait_next_event(1) == EventLoop::Result::Timeout, true);
+
+            // a timer added by a callback fires on a later wait
+            size_t fired = 0;
+            loop.add_timer(0, [&] {
+                fired++;
+                loop.add_timer(1, [&] { fired++; });
+            });
+            test_should_be(loop.wait_next_event(1000) == EventLoop::Result::Success, true);
+            test_should_be(fired, size_t{1});
+            test_should_be(loop.wait_next_event(1000) == EventLoop::Result::Success, true);
+            test_should_be(fired, size_t{2});
+
+            // fds and timers are handled by the same wait
+            b.write("x");
+            loop.add_timer(0, [&] { fired++; });
+            test_should_be(loop.wait_next_event(1000) == EventLoop::Result::Success, true);
+            test_should_be(fired, size_t{3});
+            test_should_be(a.read_count(), 1u);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
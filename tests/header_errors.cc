@@ -0,0 +1,106 @@
+#include "ipv4_datagram.hh"
+#include "tcp_segment.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+//! Recompute the TCP checksum (bytes 16 and 17) of a serialized segment
+static void fix_tcp_checksum(string &segment, const uint32_t pseudo_cksum) {
+    segment[16] = segment[17] = 0;
+    InternetChecksum check{pseudo_cksum};
+    check.add(segment);
+    TCPHeader::Wire::Checksum::store(segment.data(), check.value());
+}
+
+//! Recompute the IPv4 header checksum (bytes 10 and 11) of a serialized datagram
+static void fix_ip_checksum(string &datagram, const size_t header_length) {
+    datagram[10] = datagram[11] = 0;
+    InternetChecksum check;
+    check.add(string_view{datagram}.substr(0, header_length));
+    IPv4Header::Wire::Checksum::store(datagram.data(), check.value());
+}
+
+int main() {
+    try {
+        TCPSegment seg;
+        seg.header().sport = 1234;
+        seg.header().dport = 80;
+        seg.header().ack = true;
+        seg.payload() = Buffer{string("payload bytes")};
+
+        InternetDatagram dgram;
+        dgram.header().src = 0x0a000001;
+        dgram.header().dst = 0x0a000002;
+        dgram.header().len = IPv4Header::LENGTH + TCPHeader::LENGTH + seg.payload().size();
+        const uint32_t pseudo = dgram.header().pseudo_cksum();
+        dgram.payload() = seg.serialize(pseudo);
+
+        const string good_segment = dgram.payload().concatenate();
+        const string good_datagram = dgram.serialize().concatenate();
+
+        {
+            // the well-formed ones parse
+            TCPSegment parsed;
+            test_should_be(parsed.parse(string(good_segment), pseudo) == ParseResult::NoError, true);
+            test_should_be(parsed.payload().copy() == "payload bytes", true);
+            InternetDatagram parsed_dgram;
+            test_should_be(parsed_dgram.parse(string(good_datagram)) == ParseResult::NoError, true);
+        }
+
+        {
+            // a data offset under 5 words is an error, not a header read as payload
+            string bad = good_segment;
+            bad[12] = 0x40;
+            fix_tcp_checksum(bad, pseudo);
+            TCPSegment parsed;
+            test_should_be(parsed.parse(string(bad), pseudo) == ParseResult::HeaderTooShort, true);
+
+            // as is one longer than the segment
+            bad = good_segment.substr(0, TCPHeader::LENGTH);
+            bad[12] = 0x60;
+            fix_tcp_checksum(bad, pseudo);
+            test_should_be(parsed.parse(string(bad), pseudo) == ParseResult::PacketTooShort, true);
+        }
+
+        {
+            // a segment whose checksum is wrong
+            string bad = good_segment;
+            bad[17] ^= 1;
+            TCPSegment parsed;
+            test_should_be(parsed.parse(string(bad), pseudo) == ParseResult::BadChecksum, true);
+        }
+
+        {
+            // an IPv4 header length under 5 words
+            string bad = good_datagram;
+            bad[0] = 0x44;
+            fix_ip_checksum(bad, IPv4Header::LENGTH);
+            InternetDatagram parsed;
+            test_should_be(parsed.parse(string(bad)) == ParseResult::HeaderTooShort, true);
+        }
+
+        {
+            // an IPv4 header whose checksum is wrong
+            string bad = good_datagram;
+            bad[11] ^= 1;
+            InternetDatagram parsed;
+            test_should_be(parsed.parse(string(bad)) == ParseResult::BadChecksum, true);
+
+            // and one whose length doesn't match the datagram's
+            bad = good_datagram + "x";
+            InternetDatagram longer;
+            test_should_be(longer.parse(string(bad)) == ParseResult::TruncatedPacket, true);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
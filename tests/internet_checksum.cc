@@ -0,0 +1,104 @@
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+using Kernel = InternetChecksum::Kernel;
+
+//! The checksum of `data`, added in pieces of the given sizes (the last one takes the rest)
+static uint16_t checksum(const string &data,
+                         const vector<size_t> &pieces,
+                         const Kernel kernel,
+                         const uint32_t initial) {
+    InternetChecksum check{initial};
+    string_view rest = data;
+    for (const size_t piece : pieces) {
+        const size_t n = min(piece, rest.size());
+        check.add(rest.substr(0, n), kernel);
+        rest.remove_prefix(n);
+    }
+    check.add(rest, kernel);
+    return check.value();
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        vector<Kernel> kernels;
+        for (const Kernel kernel : {Kernel::Word64, Kernel::SSE2, Kernel::AVX2}) {
+            if (InternetChecksum::supported(kernel)) {
+                kernels.push_back(kernel);
+            }
+        }
+        test_should_be(InternetChecksum::supported(InternetChecksum::fastest_kernel()), true);
+
+        {
+            // the example in RFC 1071, section 3
+            const string data{"\x00\x01\xf2\x03\xf4\xf5\xf6\xf7", 8};
+            test_should_be(checksum(data, {}, Kernel::Bytewise, 0), uint16_t{0x220d});
+            for (const Kernel kernel : kernels) {
+                test_should_be(checksum(data, {}, kernel, 0), uint16_t{0x220d});
+                test_should_be(checksum(data, {3, 1}, kernel, 0), uint16_t{0x220d});
+            }
+        }
+
+        {
+            // all zeros (nothing to add) and all ones (every add carries)
+            for (const size_t size : {0, 1, 2, 31, 64, 1000, 70001}) {
+                for (const char byte : {'\x00', '\xff'}) {
+                    const string data(size, byte);
+                    const uint16_t expected = checksum(data, {}, Kernel::Bytewise, 0);
+                    for (const Kernel kernel : kernels) {
+                        test_should_be(checksum(data, {}, kernel, 0), expected);
+                    }
+                }
+            }
+        }
+
+        {
+            // random data, random pieces (so of odd lengths, at odd addresses), random initial sums
+            for (size_t round = 0; round < 2000; round++) {
+                const size_t size = round < 1900 ? rd() % 3000 : rd() % (1 << 20);
+                string data(size + 1, 0);
+                for (auto &ch : data) {
+                    ch = static_cast<char>(rd());
+                }
+                data.erase(0, rd() % 2);  // (and sometimes starting at an odd address)
+
+                vector<size_t> pieces(rd() % 8);
+                for (auto &piece : pieces) {
+                    piece = rd() % 100;
+                }
+                const uint32_t initial = rd() % 2 ? rd() : 0;
+
+                const uint16_t expected = checksum(data, pieces, Kernel::Bytewise, initial);
+                for (const Kernel kernel : kernels) {
+                    test_should_be(checksum(data, pieces, kernel, initial), expected);
+                }
+
+                // the kernel may change from one piece to the next
+                InternetChecksum mixed{initial};
+                string_view rest = data;
+                for (size_t i = 0; not rest.empty(); i++) {
+                    const size_t n = min(size_t{rd() % 200}, rest.size());
+                    mixed.add(rest.substr(0, n), i % 2 ? Kernel::Bytewise : InternetChecksum::fastest_kernel());
+                    rest.remove_prefix(n);
+                }
+                test_should_be(mixed.value(), checksum(data, {}, Kernel::Bytewise, initial));
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
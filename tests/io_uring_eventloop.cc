@@ -0,0 +1,257 @@
+#include "io_uring_eventloop.hh"
+#include "socket.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+static pair<FileDescriptor, FileDescriptor> socket_pair(const int type) {
+    int fds[2];
+    SystemCall("socketpair", ::socketpair(AF_UNIX, type, 0, static_cast<int *>(fds)));
+    return {FileDescriptor(fds[0]), FileDescriptor(fds[1])};
+}
+
+// the same checks, whether the loop uses io_uring or falls back to epoll
+static void check(IoUringEventLoop &loop) {
+    auto [a, b] = socket_pair(SOCK_DGRAM);
+    vector<string> received;
+    loop.add_receiver(a, [&](const string_view datagram) { received.emplace_back(datagram); });
+    test_should_be(loop.wait_next_event(0) == EventLoop::Result::Timeout, true);
+
+    {
+        // datagrams arrive one per callback, in order, and buffers are reused (there are more
+        // datagrams than buffers; they are sent in batches that fit in the socket's queue)
+        constexpr size_t N = IoUringEventLoop::BUFFER_COUNT + 50;
+        for (size_t i = 0; i < N; i++) {
+            b.write(to_string(i));
+            if (i % 32 == 31 or i == N - 1) {
+                while (received.size() <= i) {
+                    test_should_be(loop.wait_next_event(1000) == EventLoop::Result::Success, true);
+                }
+            }
+        }
+        test_should_be(received.size(), N);
+        for (size_t i = 0; i < N; i++) {
+            test_should_be(received[i] == to_string(i), true);
+        }
+        test_should_be(loop.wait_next_event(0) == EventLoop::Result::Timeout, true);
+    }
+
+    {
+        // queued writes go out together, each as its own datagram
+        received.clear();
+        for (const string datagram : {"one", "two", "three"}) {
+            loop.queue_write(b, string{datagram});
+        }
+        while (received.size() < 3) {
+            test_should_be(loop.wait_next_event(1000) == EventLoop::Result::Success, true);
+        }
+        test_should_be(received.size(), size_t{3});
+        test_should_be(received[2] == "three", true);
+
+        loop.queue_write(a, string(100, 'x'));
+        test_should_be(loop.wait_next_event(0) != EventLoop::Result::Exit, true);
+        test_should_be(b.read().size(), size_t{100});
+    }
+
+    {
+        // an unconnected socket sends each datagram to the address it was queued with
+        UDPSocket sender, first, second;
+        first.bind(Address("127.0.0.1", 0));
+        second.bind(Address("127.0.0.1", 0));
+        loop.queue_sendto(sender, first.local_address(), string{"to first"});
+        loop.queue_sendto(sender, second.local_address(), string{"to second"});
+        test_should_be(loop.wait_next_event(0) != EventLoop::Result::Exit, true);
+        test_should_be(first.recv().payload == "to first", true);
+        test_should_be(second.recv().payload == "to second", true);
+
+        // a datagram in several Buffers goes out whole, and a run is split into datagrams
+        BufferList pieces{string{"head"}};
+        pieces.append(Buffer{string{"er"}});
+        pieces.append(Buffer{string{"-payload"}});
+        loop.queue_write(b, move(pieces));
+        BufferList run{string{"aaaabbbb"}};
+        run.append(Buffer{string{"cc"}});
+        loop.queue_sendto(sender, first.local_address(), move(run), 4);
+        while (received.size() < 4) {
+            test_should_be(loop.wait_next_event(1000) == EventLoop::Result::Success, true);
+        }
+        test_should_be(received.back() == "header-payload", true);
+        for (const string datagram : {"aaaa", "bbbb", "cc"}) {
+            test_should_be(first.recv().payload == datagram, true);
+        }
+    }
+
+    {
+        // a receiver on a UDP socket hands over each sender's address, and stops while disabled
+        UDPSocket server, first, second;
+        server.bind(Address("127.0.0.1", 0));
+        first.bind(Address("127.0.0.1", 0));
+        second.bind(Address("127.0.0.1", 0));
+        vector<pair<string, Address>> from;
+        const EventRuleId id = loop.add_receiver_from(
+            server, [&](const string_view datagram, const Address &source) { from.emplace_back(datagram, source); });
+        first.sendto(server.local_address(), "from first");
+        second.sendto(server.local_address(), "from second");
+        while (from.size() < 2) {
+            test_should_be(loop.wait_next_event(1000) == EventLoop::Result::Success, true);
+        }
+        test_should_be(from[0].first == "from first" and from[0].second == first.local_address(), true);
+        test_should_be(from[1].first == "from second" and from[1].second == second.local_address(), true);
+
+        loop.set_enabled(id, false);
+        loop.wait_next_event(0);
+        first.sendto(server.local_address(), "later");
+        loop.wait_next_event(100);
+        test_should_be(from.size(), size_t{2});
+        loop.set_enabled(id, true);
+        while (from.size() < 3) {
+            test_should_be(loop.wait_next_event(1000) == EventLoop::Result::Success, true);
+        }
+        test_should_be(from[2].first == "later", true);
+        loop.set_enabled(id, false);
+    }
+
+    {
+        // a writer writes what it is given, and a reader reads no more than its limit at a time, until EOF
+        auto stream = socket_pair(SOCK_STREAM);
+        FileDescriptor &c = stream.first, &d = stream.second;
+        c.set_blocking(false);
+        d.set_blocking(false);
+        string to_write = "hello, world";
+        string read;
+        size_t largest_chunk = 0;
+        bool ended = false;
+        EventRuleId writer{};
+        writer = loop.add_writer(
+            c,
+            [&] { return to_write; },
+            [&](const size_t written) {
+                to_write.erase(0, written);
+                if (to_write.empty()) {
+                    loop.set_enabled(writer, false);
+                    SystemCall("shutdown", ::shutdown(c.fd_num(), SHUT_WR));
+                }
+            });
+        loop.add_reader(
+            d,
+            [] { return 5; },
+            [&](string &&chunk) {
+                largest_chunk = max(largest_chunk, chunk.size());
+                read += chunk;
+            },
+            [&] { ended = true; });
+        while (not ended) {
+            test_should_be(loop.wait_next_event(1000) == EventLoop::Result::Success, true);
+        }
+        test_should_be(read == "hello, world", true);
+        test_should_be(largest_chunk, size_t{5});
+    }
+
+    {
+        // disabling a reader takes back the read it has posted, so nothing is read until it is enabled again
+        auto stream = socket_pair(SOCK_STREAM);
+        FileDescriptor &c = stream.first, &d = stream.second;
+        string read;
+        const EventRuleId reader = loop.add_reader(
+            d, [] { return 100; }, [&](string &&chunk) { read += chunk; });
+        loop.wait_next_event(0);
+        loop.set_enabled(reader, false);
+        loop.wait_next_event(0);
+        c.write("later");
+        loop.wait_next_event(50);
+        test_should_be(read.empty(), true);
+        loop.set_enabled(reader, true);
+        while (read.empty()) {
+            test_should_be(loop.wait_next_event(1000) == EventLoop::Result::Success, true);
+        }
+        test_should_be(read == "later", true);
+        loop.set_enabled(reader, false);
+    }
+
+    {
+        // rules fire when their fd is ready, and not while disabled
+        auto stream = socket_pair(SOCK_STREAM);
+        FileDescriptor &c = stream.first, &d = stream.second;
+        size_t reads = 0;
+        bool canceled = false;
+        const EventRuleId id = loop.add_rule(
+            c,
+            Direction::In,
+            [&] {
+                c.read();
+                reads++;
+            },
+            [&] { canceled = true; });
+        d.write("x");
+        while (reads == 0) {
+            test_should_be(loop.wait_next_event(1000) == EventLoop::Result::Success, true);
+        }
+        test_should_be(reads, size_t{1});
+
+        loop.set_enabled(id, false);
+        d.write("y");
+        loop.wait_next_event(0);
+        test_should_be(reads, size_t{1});
+        loop.set_enabled(id, true);
+        while (reads == 1) {
+            test_should_be(loop.wait_next_event(1000) == EventLoop::Result::Success, true);
+        }
+
+        // EOF cancels the rule
+        d.close();
+        while (not canceled) {
+            test_should_be(loop.wait_next_event(1000) == EventLoop::Result::Success, true);
+        }
+    }
+
+    {
+        // a callback that neither reads nor disables its rule is a busy wait
+        auto [c, d] = socket_pair(SOCK_STREAM);
+        const EventRuleId id = loop.add_rule(c, Direction::In, [] {});
+        d.write("x");
+        bool threw = false;
+        try {
+            for (int i = 0; i < 10 and not threw; i++) {
+                loop.wait_next_event(100);
+            }
+        } catch (const runtime_error &) {
+            threw = true;
+        }
+        test_should_be(threw, true);
+        loop.set_enabled(id, false);
+    }
+}
+
+int main() {
+    try {
+        {
+            IoUringEventLoop loop{false};
+            test_should_be(loop.using_io_uring(), false);
+            check(loop);
+        }
+        {
+            // where io_uring isn't available, this checks the fallback again
+            IoUringEventLoop loop;
+            if (not loop.using_io_uring()) {
+                cerr << "Note: io_uring is not available; testing the epoll fallback only\n";
+            }
+            check(loop);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,263 @@
+#include "ethernet_frame.hh"
+#include "ipv4_datagram.hh"
+#include "packet_buffer.hh"
+#include "packet_views.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_segment.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+int main() {
+    try {
+        {
+            // bytes are appended at the end and prepended into the headroom
+            PacketBuffer packet{8, 4};
+            test_should_be(packet.headroom(), size_t{4});
+            test_should_be(packet.tailroom() >= 8, true);
+            packet.append("body");
+            NetUnparser::u16(packet, 0x0102);
+            string_view("head").copy(packet.prepend(4), 4);
+            test_should_be(packet.str() == "headbody\x01\x02", true);
+            test_should_be(packet.headroom(), size_t{0});
+
+            bool threw = false;
+            try {
+                packet.prepend(1);
+            } catch (const length_error &) {
+                threw = true;
+            }
+            test_should_be(threw, true);
+
+            // finishing makes a Buffer of just the bytes, and leaves the PacketBuffer empty
+            const Buffer buffer = packet.finish();
+            test_should_be(buffer.copy() == "headbody\x01\x02", true);
+            test_should_be(packet.size(), size_t{0});
+            test_should_be(packet.finish().size(), size_t{0});
+        }
+
+        {
+            // a Slab goes back to the thread's free list once the last Buffer viewing it is gone ...
+            const char *first = nullptr;
+            {
+                PacketBuffer packet{20};
+                packet.append("x");
+                Buffer buffer = packet.finish();
+                const Buffer copy = buffer;
+                first = copy.str().data();
+            }
+            PacketBuffer again{20};
+            test_should_be(again.data() == first, true);
+
+            // ... and while it is in use, isn't handed out again
+            again.append("y");
+            const Buffer held = again.finish();
+            PacketBuffer other{20};
+            test_should_be(other.data() != held.str().data(), true);
+
+            // a Slab too large for every size class is freed instead
+            PacketBuffer huge{1 << 20};
+            huge.append(string(1 << 20, 'z'));
+            test_should_be(huge.finish().size(), size_t{1 << 20});
+        }
+
+        {
+            // a Buffer may be let go of on another thread (or outlive the thread that made it)
+            Buffer made_elsewhere;
+            thread maker{[&] {
+                PacketBuffer packet{16};
+                packet.append("elsewhere");
+                made_elsewhere = packet.finish();
+            }};
+            maker.join();
+            test_should_be(made_elsewhere.copy() == "elsewhere", true);
+            thread releaser{[buffer = move(made_elsewhere)]() mutable { buffer = Buffer{}; }};
+            releaser.join();
+        }
+
+        {
+            // headers serialized into a ByteSpan match the ones serialized to a string
+            TCPSegment seg;
+            seg.header().sport = 1234;
+            seg.header().dport = 80;
+            seg.header().seqno = WrappingInt32{0xdeadbeef};
+            seg.header().ack = true;
+            seg.header().ackno = WrappingInt32{42};
+            seg.header().win = 1000;
+            seg.header().doff = 6;
+            seg.payload() = Buffer{string("payload")};
+
+            string header_bytes(4 * seg.header().doff, 'x');
+            ByteSpan header_span{header_bytes.data(), header_bytes.size()};
+            seg.header().serialize(header_span);
+            test_should_be(header_bytes == seg.header().serialize(), true);
+
+            // and a serialized segment (and the datagram around it) parses back to the same thing
+            IPv4Datagram dgram;
+            dgram.header().src = 0x0a000001;
+            dgram.header().dst = 0x0a000002;
+            dgram.header().len = IPv4Header::LENGTH + 4 * seg.header().doff + seg.payload().size();
+            dgram.payload() = seg.serialize(dgram.header().pseudo_cksum());
+
+            IPv4Datagram parsed_dgram;
+            test_should_be(parsed_dgram.parse(dgram.serialize().concatenate()) == ParseResult::NoError, true);
+            TCPSegment parsed_seg;
+            test_should_be(parsed_seg.parse(parsed_dgram.payload().concatenate(),
+                                            parsed_dgram.header().pseudo_cksum()) == ParseResult::NoError,
+                           true);
+            seg.header().cksum = parsed_seg.header().cksum;
+            test_should_be(parsed_seg.header() == seg.header(), true);
+            test_should_be(parsed_seg.payload().copy() == "payload", true);
+
+            EthernetFrame frame;
+            frame.header().dst = ETHERNET_BROADCAST;
+            frame.header().type = EthernetHeader::TYPE_IPv4;
+            frame.payload() = dgram.serialize();
+            const string bytes = frame.serialize().concatenate();
+            test_should_be(bytes.substr(0, EthernetHeader::LENGTH) == frame.header().serialize(), true);
+
+            // serializing again reuses the Slab the last header was in
+            const char *header_slab = nullptr;
+            {
+                const BufferList serialized = seg.serialize();
+                header_slab = serialized.buffers().front().str().data();
+            }
+            const BufferList serialized = seg.serialize();
+            test_should_be(serialized.buffers().front().str().data() == header_slab, true);
+        }
+
+        {
+            // a payload with headroom gets each layer's header written in front of it, in place
+            PacketBuffer payload_bytes{7};
+            payload_bytes.append("payload");
+            TCPSegment seg;
+            seg.header().sport = 1234;
+            seg.header().dport = 80;
+            seg.payload() = payload_bytes.finish();
+            const char *payload_start = seg.payload().str().data();
+
+            IPv4Datagram dgram;
+            dgram.header().len = IPv4Header::LENGTH + TCPHeader::LENGTH + seg.payload().size();
+            dgram.payload() = seg.serialize(dgram.header().pseudo_cksum());
+            test_should_be(dgram.payload().buffers().size(), size_t{1});
+
+            EthernetFrame frame;
+            frame.header().type = EthernetHeader::TYPE_IPv4;
+            frame.payload() = dgram.serialize();
+            const BufferList frame_bytes = frame.serialize();
+            test_should_be(frame_bytes.buffers().size(), size_t{1});
+            const size_t headers = EthernetHeader::LENGTH + IPv4Header::LENGTH + TCPHeader::LENGTH;
+            test_should_be(frame_bytes.buffers().front().str().data() + headers == payload_start, true);
+
+            // ... and it parses back to the same thing
+            EthernetFrame parsed_frame;
+            test_should_be(parsed_frame.parse(frame_bytes.concatenate()) == ParseResult::NoError, true);
+            IPv4Datagram parsed_dgram;
+            test_should_be(parsed_dgram.parse(parsed_frame.payload()) == ParseResult::NoError, true);
+            TCPSegment parsed_seg;
+            test_should_be(
+                parsed_seg.parse(parsed_dgram.payload(), parsed_dgram.header().pseudo_cksum()) == ParseResult::NoError,
+                true);
+            test_should_be(parsed_seg.payload().copy() == "payload", true);
+
+            // the headroom is used once: serializing the segment again (e.g. to retransmit it) puts the
+            // headers in a Buffer of their own, leaving the first frame's bytes alone
+            const string first_frame = frame_bytes.concatenate();
+            seg.header().seqno = WrappingInt32{1};
+            const BufferList again = seg.serialize(dgram.header().pseudo_cksum());
+            test_should_be(again.buffers().size(), size_t{2});
+            test_should_be(again.buffers().back().str().data() == payload_start, true);
+            test_should_be(frame_bytes.concatenate() == first_frame, true);
+            TCPSegment parsed_again;
+            test_should_be(parsed_again.parse(again.concatenate(), dgram.header().pseudo_cksum()) ==
+                               ParseResult::NoError,
+                           true);
+            test_should_be(parsed_again.header().seqno == WrappingInt32{1}, true);
+
+            // a frame in pieces parses without being concatenated, and the payloads inside it stay views
+            dgram.payload() = again;
+            frame.payload() = dgram.serialize();
+            const BufferList pieces = frame.serialize();
+            test_should_be(pieces.buffers().size(), size_t{2});
+            EthernetFrame parsed_pieces;
+            test_should_be(parsed_pieces.parse(pieces) == ParseResult::NoError, true);
+            IPv4Datagram dgram_in_pieces;
+            test_should_be(dgram_in_pieces.parse(parsed_pieces.payload()) == ParseResult::NoError, true);
+            TCPSegment seg_in_pieces;
+            test_should_be(seg_in_pieces.parse(dgram_in_pieces.payload(), dgram_in_pieces.header().pseudo_cksum()) ==
+                               ParseResult::NoError,
+                           true);
+            test_should_be(seg_in_pieces.header().seqno == WrappingInt32{1}, true);
+            test_should_be(seg_in_pieces.payload().str().data() == payload_start, true);
+        }
+
+        {
+            // views read the same fields as a parse would, straight from a serialized frame
+            TCPSegment seg;
+            seg.header().syn = true;
+            seg.header().seqno = WrappingInt32{7};
+            seg.header().win = 500;
+            seg.payload() = Buffer{string("data")};
+            TCPOverIPv4Adapter adapter;
+            adapter.config_mut().source = {"10.0.0.1", 80};
+            adapter.config_mut().destination = {"10.0.0.2", 5555};
+            // (from the adapter's peer, to the adapter's address and port `dport`)
+            const auto to_adapter = [&](const uint16_t dport) {
+                return TCPOverIPv4Adapter::wrap_tcp_in_ip(
+                    {adapter.config().destination.ipv4_numeric(), 5555, adapter.config().source.ipv4_numeric(), dport},
+                    seg);
+            };
+            const InternetDatagram dgram = to_adapter(80);
+            EthernetFrame frame;
+            frame.header().type = EthernetHeader::TYPE_IPv4;
+            frame.payload() = dgram.serialize();
+            const BufferList frame_bytes = frame.serialize();
+
+            const EthernetFrameView frame_view{frame_bytes};
+            test_should_be(frame_view.complete(), true);
+            test_should_be(frame_view.type(), EthernetHeader::TYPE_IPv4);
+            const IPv4View dgram_view{frame_view.payload()};
+            test_should_be(dgram_view.complete() and dgram_view.ver() == 4 and dgram_view.hlen() == 5, true);
+            test_should_be(dgram_view.len(), dgram.header().len);
+            test_should_be(dgram_view.src(), dgram.header().src);
+            test_should_be(dgram_view.proto(), IPv4Header::PROTO_TCP);
+            const TCPSegmentView seg_view{dgram_view.payload()};
+            test_should_be(seg_view.sport(), uint16_t{5555});
+            test_should_be(seg_view.dport(), uint16_t{80});
+            test_should_be(seg_view.seqno() == WrappingInt32{7}, true);
+            test_should_be(seg_view.syn() and not seg_view.ack() and not seg_view.rst(), true);
+            test_should_be(seg_view.win(), uint16_t{500});
+
+            // an adapter decides from the views whether a datagram could be for it
+            test_should_be(adapter.might_accept(dgram_view), true);
+            adapter.set_listening(true);
+            test_should_be(adapter.might_accept(dgram_view), true);
+            seg.header().syn = false;
+            const BufferList not_syn = to_adapter(80).serialize();
+            test_should_be(adapter.might_accept(IPv4View{not_syn}), false);
+            adapter.set_listening(false);
+            test_should_be(adapter.might_accept(IPv4View{not_syn}), true);
+            const BufferList other_port = to_adapter(81).serialize();
+            test_should_be(adapter.might_accept(IPv4View{other_port}), false);
+
+            // a header split across Buffers makes an incomplete view, which can't rule anything out
+            BufferList split{string(other_port.concatenate().substr(0, 10))};
+            split.append(Buffer{other_port.concatenate().substr(10)});
+            test_should_be(IPv4View{split}.complete(), false);
+            test_should_be(adapter.might_accept(IPv4View{split}), true);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
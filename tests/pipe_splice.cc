@@ -0,0 +1,120 @@
+#include "pipe.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <cerrno>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+static pair<FileDescriptor, FileDescriptor> socket_pair() {
+    int fds[2];
+    SystemCall("socketpair", ::socketpair(AF_UNIX, SOCK_STREAM, 0, static_cast<int *>(fds)));
+    return {FileDescriptor(fds[0]), FileDescriptor(fds[1])};
+}
+
+int main() {
+    try {
+        auto [a1, a2] = socket_pair();
+        auto [b1, b2] = socket_pair();
+        for (auto *fd : {&a1, &a2, &b1, &b2}) {
+            fd->set_blocking(false);
+        }
+
+        {
+            // bytes go from one socket to another through the pipe
+            Pipe pipe{65536};
+            test_should_be(pipe.capacity() >= 65536, true);
+            string sent;
+            for (size_t i = 0; i < 1000; i++) {
+                sent += to_string(i) + ",";
+            }
+            a1.write(sent);
+            string received;
+            while (received.size() < sent.size()) {
+                if (pipe.remaining_capacity() > 0) {
+                    pipe.fill_from(a2);
+                }
+                pipe.drain_to(b1);
+                received += b2.read();
+            }
+            test_should_be(received == sent, true);
+            test_should_be(pipe.buffered(), size_t{0});
+            test_should_be(a2.read_count() > 0 and b1.write_count() > 0, true);
+
+            // bytes left in the pipe can still be read out of it
+            a1.write("leftover");
+            test_should_be(pipe.fill_from(a2), size_t{8});
+            test_should_be(pipe.read(4) == "left", true);
+            test_should_be(pipe.read(100) == "over", true);
+            test_should_be(pipe.buffered(), size_t{0});
+
+            // EOF
+            SystemCall("shutdown", ::shutdown(a1.fd_num(), SHUT_WR));
+            test_should_be(pipe.fill_from(a2), size_t{0});
+            test_should_be(a2.eof(), true);
+        }
+
+        {
+            // a socket with nothing to give, or no room, moves nothing (rather than throwing EAGAIN)
+            auto [c1, c2] = socket_pair();
+            c1.set_blocking(false);
+            c2.set_blocking(false);
+            Pipe pipe{65536};
+            test_should_be(pipe.fill_from(c2), size_t{0});
+            test_should_be(c2.eof(), false);
+            test_should_be(pipe.remaining_capacity() > 0, true);
+
+            const string chunk(4096, 'x');
+            size_t stuffed = 0;
+            while (SystemCall("write", ::write(b1.fd_num(), chunk.data(), chunk.size()), EAGAIN) > 0) {
+                stuffed += chunk.size();
+            }
+            test_should_be(stuffed > 0, true);
+            c1.write("more");
+            test_should_be(pipe.fill_from(c2), size_t{4});
+            test_should_be(pipe.drain_to(b1), size_t{0});
+            test_should_be(pipe.buffered(), size_t{4});
+            for (size_t drained = 0; drained < stuffed;) {
+                drained += b2.read().size();
+            }
+            test_should_be(pipe.drain_to(b1), size_t{4});
+            test_should_be(b2.read() == "more", true);
+        }
+
+        {
+            // splicing needs a pipe at one end or the other
+            bool refused = false;
+            b2.write("x");
+            try {
+                b1.splice(a1, 1);
+            } catch (const unix_error &e) {
+                refused = e.code().value() == EINVAL;
+            }
+            test_should_be(refused, true);
+        }
+
+        {
+            // tee copies from one pipe to another, leaving the bytes in the first
+            int fds[4];
+            SystemCall("pipe", ::pipe(static_cast<int *>(fds)));
+            SystemCall("pipe", ::pipe(static_cast<int *>(fds) + 2));
+            FileDescriptor read1{fds[0]}, write1{fds[1]}, read2{fds[2]}, write2{fds[3]};
+            write1.write("tee time");
+            test_should_be(read1.tee(write2, 100), size_t{8});
+            test_should_be(read1.read() == "tee time", true);
+            test_should_be(read2.read() == "tee time", true);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,101 @@
+#include "fd_adapter.hh"
+#include "socket.hh"
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//! A UDP adapter bound to a loopback port of its own, sending to `peer`
+static TCPOverUDPSocketAdapter make_adapter(const Address &self, const Address &peer) {
+    UDPSocket sock;
+    sock.bind(self);
+    TCPOverUDPSocketAdapter adapter{move(sock)};
+    adapter.config_mut().source = self;
+    adapter.config_mut().destination = peer;
+    return adapter;
+}
+
+//! Segments of payload sizes `sizes`, numbered by seqno
+static vector<TCPSegment> make_segments(const vector<size_t> &sizes) {
+    vector<TCPSegment> segments;
+    for (size_t i = 0; i < sizes.size(); i++) {
+        TCPSegment seg;
+        seg.header().seqno = WrappingInt32(i);
+        seg.payload() = Buffer(string(sizes[i], char('a' + i % 26)));
+        segments.push_back(seg);
+    }
+    return segments;
+}
+
+//! Write `segments` from one adapter and read them back with another; were they all delivered intact?
+static bool round_trip(TCPOverUDPSocketAdapter &sender, TCPOverUDPSocketAdapter &receiver, const vector<size_t> &sizes) {
+    auto segments = make_segments(sizes);
+    const auto expected = segments;
+    while (not segments.empty()) {
+        const size_t written = sender.write(segments);
+        segments.erase(segments.begin(), segments.begin() + written);
+    }
+
+    for (size_t i = 0; i < expected.size(); i++) {
+        const auto seg = receiver.read();
+        if (not seg.has_value() or seg->header().seqno != expected[i].header().seqno or
+            seg->payload().str() != expected[i].payload().str()) {
+            return false;
+        }
+    }
+    return receiver.datagrams_buffered() == 0;
+}
+
+int main() {
+    try {
+        const uint16_t portnum = ((random_device()()) % 50000) + 1025;
+        const Address a{"127.0.0.1", portnum}, b{"127.0.0.1", uint16_t(portnum + 1)};
+        auto sender = make_adapter(a, b);
+        auto receiver = make_adapter(b, a);
+        const bool gso = static_cast<UDPSocket &>(sender).gso_supported();
+
+        // a run cut at 64 segments, then one ended by shorter segments (and an empty one) ...
+        vector<size_t> first(66, 1000);
+        first.insert(first.end(), {10, 0, 500});
+        // ... and runs cut where they would outgrow a UDP datagram, with one longer segment in between
+        vector<size_t> second(60, 1200);
+        second.insert(second.end(), {1300, 1200, 7});
+        // (each batch is small enough for the receiver's socket buffer to hold, even uncoalesced)
+
+        const unsigned reads_before = static_cast<UDPSocket &>(receiver).read_count();
+        test_should_be(round_trip(sender, receiver, first), true);
+        test_should_be(round_trip(sender, receiver, second), true);
+        if (gso) {
+            // the receiver gets runs coalesced (on loopback, the kernel hands them over unsplit)
+            const unsigned reads = static_cast<UDPSocket &>(receiver).read_count() - reads_before;
+            test_should_be(reads <= 10, true);
+        }
+
+        // a receiver without GRO gets the runs split into ordinary datagrams
+        static_cast<UDPSocket &>(receiver).set_gro(false);
+        test_should_be(round_trip(sender, receiver, first), true);
+        test_should_be(round_trip(sender, receiver, second), true);
+
+        // segments written one at a time go out as ordinary datagrams
+        static_cast<UDPSocket &>(receiver).set_gro(true);
+        for (auto &seg : make_segments(first)) {
+            sender.write(seg);
+        }
+        for (size_t i = 0; i < first.size(); i++) {
+            const auto seg = receiver.read();
+            test_should_be(seg.has_value() and seg->payload().size() == first[i], true);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+#include "sender_harness.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.send_policy = TCPConfig::SendPolicy::Nagle;
+
+            TCPSenderTestHarness test{"Nagle sends the first small write immediately", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(4000));
+            test.execute(WriteBytes{"a"});
+            test.execute(ExpectSegment{}.with_data("a").with_seqno(isn + 1));
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.send_policy = TCPConfig::SendPolicy::Nagle;
+
+            TCPSenderTestHarness test{"Nagle coalesces small writes while data is in flight", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(4000));
+            test.execute(WriteBytes{"a"});
+            test.execute(ExpectSegment{}.with_data("a").with_seqno(isn + 1));
+            test.execute(WriteBytes{"b"});
+            test.execute(WriteBytes{"c"});
+            test.execute(WriteBytes{"d"});
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectBytesInFlight{1});
+            test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(4000));
+            test.execute(ExpectSegment{}.with_data("bcd").with_seqno(isn + 2));
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.send_policy = TCPConfig::SendPolicy::Nagle;
+
+            TCPSenderTestHarness test{"Nagle sends full segments and the FIN without waiting", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(4000));
+            test.execute(WriteBytes{"a"});
+            test.execute(ExpectSegment{}.with_data("a").with_seqno(isn + 1));
+            test.execute(WriteBytes{string(TCPConfig::MAX_PAYLOAD_SIZE + 5, 'x')});
+            test.execute(ExpectSegment{}.with_payload_size(TCPConfig::MAX_PAYLOAD_SIZE).with_seqno(isn + 2));
+            test.execute(ExpectNoSegment{});
+            test.execute(Close{});
+            test.execute(ExpectSegment{}.with_payload_size(5).with_fin(true));
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.send_policy = TCPConfig::SendPolicy::Cork;
+
+            TCPSenderTestHarness test{"Cork holds small writes until flushed", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(4000));
+            test.execute(WriteBytes{"abc"});
+            test.execute(WriteBytes{"def"});
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectBytesInFlight{0});
+            test.execute(Flush{});
+            test.execute(ExpectSegment{}.with_data("abcdef").with_seqno(isn + 1));
+            test.execute(ExpectNoSegment{});
+            test.execute(WriteBytes{"ghi"});
+            test.execute(AckReceived{WrappingInt32{isn + 7}}.with_win(4000));
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.send_policy = TCPConfig::SendPolicy::Cork;
+
+            TCPSenderTestHarness test{"Cork sends full segments and leaves the remainder", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(4000));
+            test.execute(WriteBytes{string(2 * TCPConfig::MAX_PAYLOAD_SIZE + 10, 'x')});
+            test.execute(ExpectSegment{}.with_payload_size(TCPConfig::MAX_PAYLOAD_SIZE).with_seqno(isn + 1));
+            test.execute(ExpectSegment{}.with_payload_size(TCPConfig::MAX_PAYLOAD_SIZE));
+            test.execute(ExpectNoSegment{});
+            test.execute(Close{});
+            test.execute(ExpectSegment{}.with_payload_size(10).with_fin(true));
+            test.execute(ExpectNoSegment{});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
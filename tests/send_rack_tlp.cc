@@ -0,0 +1,111 @@
+#include "sender_harness.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rack_tlp = true;
+
+            TCPSenderTestHarness test{"Tail loss probe retransmits the last segment after 2*SRTT", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(Tick{20});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(4000));
+            test.execute(WriteBytes{"abc"});
+            test.execute(WriteBytes{"def"});
+            test.execute(ExpectSegment{}.with_data("abc").with_seqno(isn + 1));
+            test.execute(ExpectSegment{}.with_data("def").with_seqno(isn + 4));
+            test.execute(Tick{39});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_data("def").with_seqno(isn + 4));
+            test.execute(Tick{200});
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectBytesInFlight{6});
+            test.execute(AckReceived{WrappingInt32{isn + 7}}.with_win(4000));
+            test.execute(ExpectBytesInFlight{0});
+            test.execute(Tick{2 * TCPConfig::TIMEOUT_DFLT});
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rack_tlp = true;
+
+            TCPSenderTestHarness test{"Tail loss probe prefers new data", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(Tick{20});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(3));
+            test.execute(WriteBytes{"abcdef"});
+            test.execute(ExpectSegment{}.with_data("abc").with_seqno(isn + 1));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(6));
+            test.execute(ExpectSegment{}.with_data("def").with_seqno(isn + 4));
+            test.execute(Tick{40});
+            test.execute(ExpectSegment{}.with_data("def").with_seqno(isn + 4));
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rack_tlp = true;
+
+            TCPSenderTestHarness test{"RACK retransmits after the reordering window on a duplicate ACK", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(Tick{20});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(4000));
+            test.execute(WriteBytes{string(3 * TCPConfig::MAX_PAYLOAD_SIZE, 'x')});
+            test.execute(ExpectSegment{}.with_payload_size(TCPConfig::MAX_PAYLOAD_SIZE).with_seqno(isn + 1));
+            test.execute(ExpectSegment{}.with_payload_size(TCPConfig::MAX_PAYLOAD_SIZE));
+            test.execute(ExpectSegment{}.with_payload_size(TCPConfig::MAX_PAYLOAD_SIZE));
+            test.execute(Tick{5});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(4000));
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{19});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_payload_size(TCPConfig::MAX_PAYLOAD_SIZE).with_seqno(isn + 1));
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"Without RACK-TLP only the RTO repairs a tail loss", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(Tick{20});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(4000));
+            test.execute(WriteBytes{"abc"});
+            test.execute(ExpectSegment{}.with_data("abc").with_seqno(isn + 1));
+            test.execute(Tick{TCPConfig::TIMEOUT_DFLT - 1});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_data("abc").with_seqno(isn + 1));
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -13,6 +13,7 @@
 #include <exception>
 #include <iostream>
 #include <optional>
+#include <queue>
 #include <sstream>
 #include <string>
 
@@ -220,6 +221,13 @@ struct Close : public SenderAction {
     }
 };
 
+struct Flush : public SenderAction {
+    Flush() {}
+    std::string description() const { return "flush"; }
+
+    void execute(TCPSender &sender, std::queue<TCPSegment> &) const { sender.flush(); }
+};
+
 struct ExpectSegment : public SenderExpectation {
     std::optional<bool> ack{};
     std::optional<bool> rst{};
@@ -385,10 +393,10 @@ class TCPSenderTestHarness {
     std::string name;
 
     void collect_output() {
-        while (not sender.segments_out().empty()) {
-            outbound_segments.push(std::move(sender.segments_out().front()));
-            sender.segments_out().pop();
+        for (auto &segment : sender.segments_out()) {
+            outbound_segments.push(std::move(segment));
         }
+        sender.segments_out().clear();
     }
 
   public:
@@ -397,6 +405,8 @@ class TCPSenderTestHarness {
         , sender(config.send_capacity, config.rt_timeout, config.fixed_isn)
         , steps_executed()
         , name(name_) {
+        sender.set_send_policy(config.send_policy);
+        sender.set_rack_tlp(config.rack_tlp);
         sender.fill_window();
         collect_output();
         std::ostringstream ss;
@@ -0,0 +1,173 @@
+#include "checkpoint.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_state.hh"
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+//! Hand everything `from` has queued to `to`, skipping the `skip`th segment (counting from 0) if asked
+static size_t deliver(TCPConnection &from, TCPConnection &to, const size_t skip = SIZE_MAX) {
+    auto &batch = from.segments_out();
+    const size_t count = batch.size();
+    for (size_t i = 0; i < count; i++) {
+        if (i != skip) {
+            to.segment_received(batch[i]);
+        }
+    }
+    batch.clear();
+    return count;
+}
+
+static void exchange(TCPConnection &a, TCPConnection &b) {
+    while (deliver(a, b) + deliver(b, a) > 0) {
+    }
+}
+
+//! Replace a connection with one restored from its checkpoint, as a restarted process would
+static void migrate(unique_ptr<TCPConnection> &connection) {
+    const string blob = connection->checkpoint();
+    const optional<uint64_t> next_timer = connection->time_until_next_timer();
+    const string state = connection->state().name();
+
+    auto restored = make_unique<TCPConnection>(blob);
+    test_should_be(restored->checkpoint() == blob, true);
+    test_should_be(restored->time_until_next_timer() == next_timer, true);
+    test_should_be(restored->state().name() == state, true);
+
+    // the old connection is dropped without sending anything
+    connection->segments_out().clear();
+    connection = move(restored);
+}
+
+static string message(const size_t size) {
+    string data(size, 0);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = static_cast<char>('a' + i % 26);
+    }
+    return data;
+}
+
+int main() {
+    try {
+        {
+            // move both ends in the middle of a transfer, with a segment lost and data unassembled
+            TCPConfig cfg;
+            cfg.rack_tlp = true;
+            auto client = make_unique<TCPConnection>(cfg);
+            auto server = make_unique<TCPConnection>(cfg);
+            client->connect();
+            exchange(*client, *server);
+            test_should_be(client->state() == TCPState::State::ESTABLISHED, true);
+
+            const string data = message(5 * TCPConfig::MAX_PAYLOAD_SIZE + 123);
+            test_should_be(client->write(data), data.size());
+            deliver(*client, *server, 1);
+            test_should_be(server->unassembled_bytes() > 0, true);
+            deliver(*server, *client);
+            test_should_be(client->bytes_in_flight() > 0, true);
+
+            migrate(client);
+            migrate(server);
+            test_should_be(server->unassembled_bytes() > 0, true);
+            test_should_be(server->inbound_stream().buffer_size(), TCPConfig::MAX_PAYLOAD_SIZE);
+
+            // the restored sender's timers still fire, and the lost segment is repaired
+            for (size_t i = 0; i < 4 and server->inbound_stream().bytes_written() < data.size(); i++) {
+                client->tick(client->time_until_next_timer().value());
+                exchange(*client, *server);
+            }
+            test_should_be(server->inbound_stream().read(data.size()) == data, true);
+            test_should_be(server->unassembled_bytes(), size_t{0});
+
+            // and the connection closes cleanly from there
+            client->end_input_stream();
+            exchange(*client, *server);
+            server->end_input_stream();
+            exchange(*client, *server);
+            migrate(client);
+            test_should_be(client->state() == TCPState::State::TIME_WAIT, true);
+            test_should_be(server->state() == TCPState::State::CLOSED, true);
+            client->tick(10 * cfg.rt_timeout);
+            test_should_be(client->state() == TCPState::State::CLOSED, true);
+        }
+
+        {
+            // segments not yet taken from segments_out() travel with the connection
+            TCPConfig cfg;
+            cfg.send_policy = TCPConfig::SendPolicy::Nagle;
+            auto client = make_unique<TCPConnection>(cfg);
+            auto server = make_unique<TCPConnection>(cfg);
+            client->connect();
+            exchange(*client, *server);
+            client->write("hello");
+            client->write(", world");
+            const size_t queued = client->segments_out().size();
+            auto restored = make_unique<TCPConnection>(client->checkpoint());
+            test_should_be(restored->segments_out().size(), queued);
+            test_should_be(restored->send_policy() == TCPConfig::SendPolicy::Nagle, true);
+            client->segments_out().clear();
+            client = move(restored);
+            exchange(*client, *server);
+            test_should_be(server->inbound_stream().read(100) == "hello, world", true);
+        }
+
+        {
+            // damaged checkpoints are refused
+            TCPConfig cfg;
+            TCPConnection connection{cfg};
+            connection.connect();
+            const string blob = connection.checkpoint();
+            connection.segments_out().clear();
+
+            size_t refused = 0;
+            for (const string &bad : {blob.substr(0, blob.size() / 2), blob + "x", "x" + blob.substr(1), string{}}) {
+                try {
+                    TCPConnection restored{bad};
+                } catch (const runtime_error &) {
+                    refused++;
+                }
+            }
+            test_should_be(refused, size_t{4});
+        }
+
+        {
+            // bools and enums are range-checked, not copied in
+            CheckpointWriter out;
+            out.put(true);
+            out.put(TCPConfig::SendPolicy::Cork);
+            out.put<uint8_t>(2);
+            out.put(static_cast<int>(TCPConfig::SendPolicy::Cork) + 1);
+            const string blob = out.release();
+
+            CheckpointReader in{blob};
+            test_should_be(in.get<bool>(), true);
+            test_should_be(in.get_enum(TCPConfig::SendPolicy::Cork) == TCPConfig::SendPolicy::Cork, true);
+            size_t refused = 0;
+            try {
+                in.get<bool>();
+            } catch (const runtime_error &) {
+                refused++;
+            }
+            try {
+                in.get_enum(TCPConfig::SendPolicy::Cork);
+            } catch (const runtime_error &) {
+                refused++;
+            }
+            test_should_be(refused, size_t{2});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
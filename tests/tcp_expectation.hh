@@ -302,6 +302,10 @@ struct ExpectState : public TCPExpectation {
         if (actual_state != state) {
             throw StateExpectationViolation{state, actual_state};
         }
+        // info() names the state without building a TCPState, and should come to the same answer
+        if (harness._fsm.info().state != actual_state.official_state()) {
+            throw TCPPropertyViolation{"TCPConnection::info() disagrees with state() about the official state"};
+        }
     }
 };
 
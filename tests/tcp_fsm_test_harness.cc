@@ -144,10 +144,10 @@ void TCPTestHarness::send_data(const WrappingInt32 seqno, const WrappingInt32 ac
 void TCPTestHarness::execute(const TCPTestStep &step, std::string note) {
     try {
         step.execute(*this);
-        while (not _fsm.segments_out().empty()) {
-            _flt.write(_fsm.segments_out().front());
-            _fsm.segments_out().pop();
+        for (auto &segment : _fsm.segments_out()) {
+            _flt.write(segment);
         }
+        _fsm.segments_out().clear();
         _steps_executed.emplace_back(step.to_string());
     } catch (const TCPExpectationViolation &e) {
         cerr << "Test Failure on expectation:\n\t" << step.to_string();
@@ -0,0 +1,164 @@
+#include "seqlock.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_info.hh"
+#include "test_should_be.hh"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+//! Hand everything `from` has queued to `to`, dropping the `skip`th segment (counting from 0) if asked
+static size_t deliver(TCPConnection &from, TCPConnection &to, const size_t skip = SIZE_MAX) {
+    auto &batch = from.segments_out();
+    const size_t count = batch.size();
+    for (size_t i = 0; i < count; i++) {
+        if (i != skip) {
+            to.segment_received(batch[i]);
+        }
+    }
+    batch.clear();
+    return count;
+}
+
+static void exchange(TCPConnection &a, TCPConnection &b) {
+    while (deliver(a, b) + deliver(b, a) > 0) {
+    }
+}
+
+int main() {
+    try {
+        {
+            // counters through a handshake, a lost segment, and a full receive window
+            TCPConfig cfg;
+            cfg.recv_capacity = 4 * TCPConfig::MAX_PAYLOAD_SIZE;
+            TCPConnection client{cfg}, server{cfg};
+
+            TCPInfo info = client.info();
+            test_should_be(info.state == TCPState::State::LISTEN, true);
+            test_should_be(info.segments_sent, uint64_t{0});
+
+            client.connect();
+            exchange(client, server);
+            info = client.info();
+            test_should_be(info.state == TCPState::State::ESTABLISHED, true);
+            test_should_be(info.segments_sent, server.info().segments_received);
+            test_should_be(info.segments_received, server.info().segments_sent);
+            test_should_be(info.send_window, cfg.recv_capacity);
+            test_should_be(info.rto, uint64_t{cfg.rt_timeout});
+
+            const string data(3 * TCPConfig::MAX_PAYLOAD_SIZE, 'x');
+            client.write(data);
+            deliver(client, server, 0);
+            info = server.info();
+            test_should_be(info.unassembled_fragments, size_t{2});
+            test_should_be(info.unassembled_bytes, 2 * TCPConfig::MAX_PAYLOAD_SIZE);
+            test_should_be(info.bytes_received, uint64_t{0});
+            deliver(server, client);
+            info = client.info();
+            test_should_be(info.bytes_sent, uint64_t{data.size()});
+            test_should_be(info.bytes_acked, uint64_t{0});
+            test_should_be(info.bytes_in_flight, data.size());
+            test_should_be(info.duplicate_acks, uint64_t{2});
+
+            // a segment carrying data isn't a duplicate ACK, even if it acknowledges nothing new
+            server.write("z");
+            deliver(server, client);
+            test_should_be(client.info().duplicate_acks, uint64_t{2});
+
+            client.tick(cfg.rt_timeout);
+            info = client.info();
+            test_should_be(info.retransmissions, uint64_t{1});
+            test_should_be(info.consecutive_retransmissions, 1u);
+            test_should_be(info.rto, uint64_t{2u * cfg.rt_timeout});
+            exchange(client, server);
+            info = client.info();
+            test_should_be(info.bytes_acked, uint64_t{data.size()});
+            test_should_be(info.bytes_in_flight, size_t{0});
+            test_should_be(info.consecutive_retransmissions, 0u);
+            test_should_be(server.info().bytes_received, uint64_t{data.size()});
+            test_should_be(server.info().receive_window, cfg.recv_capacity - data.size());
+
+            // fill the server's window; the client then counts time spent with nothing to send
+            client.write(string(2 * TCPConfig::MAX_PAYLOAD_SIZE, 'y'));
+            exchange(client, server);
+            test_should_be(client.info().send_window, size_t{0});
+            client.tick(300);
+            exchange(client, server);
+            client.tick(200);
+            test_should_be(client.info().zero_window_time, uint64_t{500});
+            test_should_be(client.info().consecutive_retransmissions, 0u);
+        }
+
+        {
+            // an ACK older than the last one (reordered on the way) isn't a duplicate ACK either
+            TCPConfig cfg;
+            TCPConnection client{cfg}, server{cfg};
+            client.connect();
+            exchange(client, server);
+
+            client.write(string(100, 'a'));
+            deliver(client, server);
+            const TCPSegment stale = server.segments_out().front();
+            deliver(server, client);
+            server.inbound_stream().pop_output(100);  // (so the next ACK advertises the same window)
+            client.write(string(100, 'b'));
+            deliver(client, server);
+            const TCPSegment latest = server.segments_out().front();
+            deliver(server, client);
+
+            client.write("c");
+            client.segment_received(stale);
+            test_should_be(client.info().duplicate_acks, uint64_t{0});
+            client.segment_received(latest);
+            test_should_be(client.info().duplicate_acks, uint64_t{1});
+        }
+
+        {
+            // readers of a SeqLock never see a torn value
+            struct Value {
+                array<uint64_t, 16> words{};
+            };
+            SeqLock<Value> lock;
+            atomic<bool> done{false};
+            atomic<uint64_t> torn{0};
+
+            thread reader([&] {
+                uint64_t last = 0;
+                while (not done) {
+                    const Value value = lock.load();
+                    for (const uint64_t word : value.words) {
+                        if (word != value.words[0]) {
+                            torn++;
+                        }
+                    }
+                    if (value.words[0] < last) {
+                        torn++;
+                    }
+                    last = value.words[0];
+                }
+            });
+            for (uint64_t i = 1; i <= 200000; i++) {
+                Value value;
+                value.words.fill(i);
+                lock.store(value);
+            }
+            done = true;
+            reader.join();
+            test_should_be(torn.load(), uint64_t{0});
+            test_should_be(lock.load().words[15], uint64_t{200000});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
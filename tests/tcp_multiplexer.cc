@@ -0,0 +1,303 @@
+#include "connection_table.hh"
+#include "ipv4_datagram.hh"
+#include "tcp_multiplexer.hh"
+#include "tcp_over_ip.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+
+static const uint32_t CLIENT_IP = 0x0a000001;
+static const uint32_t SERVER_IP = 0x0a000002;
+static const uint16_t SERVER_PORT = 80;
+
+//! Send everything `from` has queued to `to`, through a serialized IPv4 datagram
+static size_t deliver(TCPMultiplexer &from, TCPMultiplexer &to) {
+    auto &batch = from.segments_out();
+    const size_t count = batch.size();
+    for (auto &out : batch) {
+        const InternetDatagram dgram = TCPOverIPv4Adapter::wrap_tcp_in_ip(out.tuple, out.segment);
+        InternetDatagram received;
+        if (received.parse(Buffer(dgram.serialize().concatenate())) != ParseResult::NoError) {
+            throw runtime_error("couldn't parse a datagram");
+        }
+        auto unwrapped = TCPOverIPv4Adapter::unwrap_tcp_in_ip_any(received);
+        if (not unwrapped.has_value()) {
+            throw runtime_error("couldn't unwrap a segment");
+        }
+        test_should_be(unwrapped->first == out.tuple.reversed(), true);
+        to.segment_received(unwrapped->first, unwrapped->second);
+    }
+    batch.clear();
+    return count;
+}
+
+static void exchange(TCPMultiplexer &a, TCPMultiplexer &b) {
+    while (deliver(a, b) + deliver(b, a) > 0) {
+    }
+}
+
+static FourTuple client_tuple(const uint16_t port) { return {CLIENT_IP, port, SERVER_IP, SERVER_PORT}; }
+
+int main() {
+    try {
+        {
+            // the table against std::map, through growth and heavy erasure
+            auto rd = get_random_generator();
+            ConnectionTable table;
+            map<tuple<uint32_t, uint16_t, uint32_t, uint16_t>, size_t> reference;
+            for (size_t i = 0; i < 20000; i++) {
+                const FourTuple key{static_cast<uint32_t>(rd() % 4),
+                                    static_cast<uint16_t>(rd() % 64),
+                                    static_cast<uint32_t>(rd() % 4),
+                                    static_cast<uint16_t>(rd() % 64)};
+                const auto ref_key = make_tuple(key.local_address, key.local_port, key.remote_address, key.remote_port);
+                if (rd() % 3) {
+                    test_should_be(table.insert(key, i), reference.emplace(ref_key, i).second);
+                } else {
+                    test_should_be(table.erase(key), reference.erase(ref_key) == 1);
+                }
+                test_should_be(table.size(), reference.size());
+            }
+            for (const auto &[ref_key, value] : reference) {
+                const FourTuple key{get<0>(ref_key), get<1>(ref_key), get<2>(ref_key), get<3>(ref_key)};
+                test_should_be(table.find(key).value(), value);
+            }
+            test_should_be(table.find({9, 9, 9, 9}).has_value(), false);
+        }
+
+        {
+            // many connections to one listening port, each echoing a message and closing cleanly
+            constexpr size_t N = 1000;
+            TCPConfig cfg;
+            TCPMultiplexer server{cfg}, client{cfg};
+            server.listen(SERVER_PORT, N);
+
+            vector<ConnectionId> clients;
+            for (size_t i = 0; i < N; i++) {
+                clients.push_back(client.connect(client_tuple(10000 + i)));
+            }
+            test_should_be(server.accept().has_value(), false);
+            exchange(client, server);
+
+            vector<ConnectionId> accepted;
+            while (const auto id = server.accept()) {
+                accepted.push_back(id.value());
+            }
+            test_should_be(accepted.size(), N);
+            test_should_be(server.size(), N);
+
+            for (size_t i = 0; i < N; i++) {
+                client.connection(clients[i]).write("hello " + std::to_string(i));
+            }
+            exchange(client, server);
+
+            for (const ConnectionId id : accepted) {
+                const uint16_t port = server.tuple(id).remote_port;
+                test_should_be(server.connection(id).inbound_stream().read(100) == "hello " + std::to_string(port - 10000), true);
+                server.connection(id).write("bye");
+                server.connection(id).end_input_stream();
+                server.release(id);
+            }
+            exchange(client, server);
+
+            for (const ConnectionId id : clients) {
+                test_should_be(client.connection(id).inbound_stream().read(100) == "bye", true);
+                test_should_be(client.connection(id).inbound_stream().eof(), true);
+                client.connection(id).end_input_stream();
+            }
+            exchange(client, server);
+
+            // the clients closed passively, so they are done; the server's released connections linger
+            for (const ConnectionId id : clients) {
+                test_should_be(client.connection(id).active(), false);
+                client.release(id);
+            }
+            test_should_be(client.size(), size_t{0});
+            test_should_be(server.size(), N);
+            server.tick(10 * cfg.rt_timeout);
+            exchange(client, server);
+            test_should_be(server.size(), size_t{0});
+            test_should_be(server.alive(accepted.front()), false);
+        }
+
+        {
+            // the backlog bounds connections waiting for accept(); without SYN cookies later SYNs are dropped
+            TCPConfig cfg;
+            TCPMultiplexer server{cfg}, client{cfg};
+            server.set_syn_cookies(TCPMultiplexer::SynCookies::Never);
+            server.listen(SERVER_PORT, 2);
+            for (uint16_t port = 1; port <= 3; port++) {
+                client.connect(client_tuple(port));
+            }
+            exchange(client, server);
+            test_should_be(server.size(), size_t{2});
+            test_should_be(server.accept().has_value(), true);
+
+            // with a slot free again, the third client's retransmitted SYN gets through
+            client.tick(cfg.rt_timeout);
+            exchange(client, server);
+            test_should_be(server.size(), size_t{3});
+            test_should_be(server.accept().has_value(), true);
+            test_should_be(server.accept().has_value(), true);
+            test_should_be(server.accept().has_value(), false);
+        }
+
+        {
+            // only the connections that are due are ticked, and each sees all the time that has passed
+            TCPConfig cfg;
+            TCPMultiplexer client{cfg};
+            const uint64_t rto = cfg.rt_timeout;
+            test_should_be(client.time_until_next_timer().has_value(), false);
+            const ConnectionId first = client.connect(client_tuple(1));
+            client.segments_out().clear();
+            test_should_be(client.time_until_next_timer().value() <= rto, true);
+
+            client.tick(rto / 2);
+            const ConnectionId second = client.connect(client_tuple(2));
+            client.segments_out().clear();
+            test_should_be(client.time_until_next_timer().value() <= rto - rto / 2, true);
+
+            // the first SYN is retransmitted, and the second isn't yet
+            client.tick(rto - rto / 2);
+            auto &batch = client.segments_out();
+            test_should_be(batch.size(), size_t{1});
+            test_should_be(batch.front().tuple == client_tuple(1), true);
+            test_should_be(batch.front().segment.header().syn, true);
+            batch.clear();
+            test_should_be(client.connection(first).info().consecutive_retransmissions, 1u);
+
+            // the second, looked at before its timer fires, has still been told how long it has waited
+            client.tick(rto / 2 - 1);
+            test_should_be(client.segments_out().empty(), true);
+            test_should_be(client.connection(second).time_until_next_timer().value(), uint64_t{1});
+            client.tick(1);
+            test_should_be(client.segments_out().size(), size_t{1});
+            test_should_be(client.connection(second).info().consecutive_retransmissions, 1u);
+        }
+
+        {
+            // with SYN cookies always on, no state is kept until the handshake completes
+            constexpr size_t N = 100;
+            TCPConfig cfg;
+            TCPMultiplexer server{cfg}, client{cfg};
+            server.set_syn_cookies(TCPMultiplexer::SynCookies::Always);
+            server.listen(SERVER_PORT, N);
+
+            vector<ConnectionId> clients;
+            for (size_t i = 0; i < N; i++) {
+                clients.push_back(client.connect(client_tuple(20000 + i)));
+            }
+            deliver(client, server);
+            test_should_be(server.size(), size_t{0});
+            test_should_be(server.half_open(), size_t{0});
+            test_should_be(server.segments_out().size(), N);
+
+            exchange(client, server);
+            test_should_be(server.size(), N);
+            vector<ConnectionId> accepted;
+            while (const auto id = server.accept()) {
+                accepted.push_back(id.value());
+            }
+            test_should_be(accepted.size(), N);
+
+            // the connections work as usual in both directions
+            client.connection(clients.front()).write("ping");
+            exchange(client, server);
+            const auto from_first = find_if(accepted.begin(), accepted.end(), [&](const ConnectionId id) {
+                return server.tuple(id).remote_port == 20000;
+            });
+            test_should_be(server.connection(*from_first).inbound_stream().read(100) == "ping", true);
+            server.connection(*from_first).write("pong");
+            exchange(client, server);
+            test_should_be(client.connection(clients.front()).inbound_stream().read(100) == "pong", true);
+        }
+
+        {
+            // the handshake replayed from a cookie gives no RTT sample (it would be 0 ms, and make
+            // RACK-TLP probe after its 10 ms floor)
+            TCPConfig cfg;
+            cfg.rack_tlp = true;
+            TCPMultiplexer server{cfg}, client{cfg};
+            server.set_syn_cookies(TCPMultiplexer::SynCookies::Always);
+            server.listen(SERVER_PORT);
+            client.connect(client_tuple(20000));
+            exchange(client, server);
+            const ConnectionId accepted = server.accept().value();
+            test_should_be(server.connection(accepted).info().srtt, uint64_t{0});
+
+            server.connection(accepted).write("unanswered");
+            test_should_be(server.segments_out().size(), size_t{1});
+            server.segments_out().clear();
+            server.tick(100);
+            test_should_be(server.segments_out().size(), size_t{0});
+        }
+
+        {
+            // by default cookies take over once the half-open limit is reached
+            TCPConfig cfg;
+            TCPMultiplexer server{cfg}, client{cfg};
+            server.set_half_open_limit(2);
+            server.listen(SERVER_PORT);
+            for (uint16_t port = 1; port <= 5; port++) {
+                client.connect(client_tuple(port));
+            }
+            deliver(client, server);
+            test_should_be(server.half_open(), size_t{2});
+            test_should_be(server.size(), size_t{2});
+            exchange(client, server);
+            test_should_be(server.half_open(), size_t{0});
+            test_should_be(server.size(), size_t{5});
+        }
+
+        {
+            // forged and stale cookies are dropped without a reply
+            TCPConfig cfg;
+            TCPMultiplexer server{cfg}, client{cfg};
+            server.set_syn_cookies(TCPMultiplexer::SynCookies::Always);
+            server.listen(SERVER_PORT);
+
+            TCPSegment forged;
+            forged.header().ack = true;
+            forged.header().seqno = WrappingInt32{1000};
+            forged.header().ackno = WrappingInt32{0x12345678};
+            server.segment_received(client_tuple(1).reversed(), forged);
+            test_should_be(server.size(), size_t{0});
+            test_should_be(server.segments_out().size(), size_t{0});
+
+            client.connect(client_tuple(2));
+            deliver(client, server);
+            deliver(server, client);
+            server.tick(2 * TCPMultiplexer::COOKIE_PERIOD_MS);
+            deliver(client, server);
+            test_should_be(server.size(), size_t{0});
+            test_should_be(server.segments_out().size(), size_t{0});
+        }
+
+        {
+            // a segment for a port nobody listens on is answered with a RST
+            TCPConfig cfg;
+            TCPMultiplexer server{cfg}, client{cfg};
+            const ConnectionId id = client.connect({CLIENT_IP, 1234, SERVER_IP, 81});
+            exchange(client, server);
+            test_should_be(server.size(), size_t{0});
+            test_should_be(client.connection(id).state() == TCPState::State::RESET, true);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,126 @@
+#include "eventloop_group.hh"
+#include "tcp_sponge_listener.hh"
+#include "tcp_sponge_socket.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+static constexpr size_t SIZE = 64 * 1024;
+
+//! Read from `socket` until EOF
+static string read_all(FileDescriptor &socket) {
+    string data;
+    while (not socket.eof()) {
+        data += socket.read();
+    }
+    return data;
+}
+
+//! Connect `count` TCPOverUDPSpongeSockets to the listener, each sending data of its own, and have
+//! the server's end of each connection echo it back; `all_accepted` is called once each has been accepted
+static void echo(TCPSpongeListener &listener,
+                 const TCPConfig &cfg,
+                 const size_t count,
+                 const function<void()> &all_accepted = [] {}) {
+    auto rd = get_random_generator();
+    vector<string> sent(count);
+    vector<unique_ptr<TCPOverUDPSpongeSocket>> clients;
+    for (size_t i = 0; i < count; i++) {
+        sent[i] = to_string(i) + ":";
+        while (sent[i].size() < SIZE) {
+            sent[i].push_back(static_cast<char>(rd()));
+        }
+        FdAdapterConfig adapter_cfg;
+        adapter_cfg.destination = listener.local_address();
+        // (half the clients do their I/O through io_uring, or its epoll fallback)
+        adapter_cfg.loop_backend = i % 2 ? FdAdapterConfig::LoopBackend::IoUring : FdAdapterConfig::LoopBackend::Poll;
+        clients.push_back(make_unique<TCPOverUDPSpongeSocket>(TCPOverUDPSocketAdapter(UDPSocket{})));
+        clients.back()->connect(cfg, adapter_cfg);
+        clients.back()->write(sent[i]);
+        clients.back()->shutdown(SHUT_WR);
+    }
+
+    vector<LocalStreamSocket> accepted;
+    for (size_t i = 0; i < count; i++) {
+        accepted.push_back(listener.accept());
+    }
+    all_accepted();
+
+    // each connection is accepted once, with its own client's data, and echoes it back
+    vector<bool> seen(count, false);
+    for (auto &connection : accepted) {
+        const string received = read_all(connection);
+        const size_t i = stoul(received.substr(0, received.find(':')));
+        test_should_be(i < count and not seen[i], true);
+        seen[i] = true;
+        test_should_be(received == sent[i], true);
+        connection.write(received);
+        connection.close();
+    }
+
+    // the server's ends were closed once they had echoed, so each client's inbound stream ends cleanly
+    for (size_t i = 0; i < count; i++) {
+        test_should_be(read_all(*clients[i]) == sent[i], true);
+        clients[i]->wait_until_closed();
+    }
+}
+
+int main() {
+    try {
+        TCPConfig cfg;
+        cfg.rt_timeout = 100;
+
+        {
+            // several clients connect to the one socket, served on the listener's own thread
+            UDPSocket server_socket;
+            server_socket.bind(Address("127.0.0.1", 0));
+            TCPSpongeListener listener{move(server_socket), cfg};
+            echo(listener, cfg, 4);
+        }
+
+        {
+            // on an EventLoopGroup, the connections are spread over the loops, and count toward their load
+            constexpr size_t LOOPS = 4, CLIENTS = 16;
+            EventLoopGroup group{LOOPS, false};
+            TCPSpongeListener listener{group, Address("127.0.0.1", 0), cfg};
+            echo(listener, cfg, CLIENTS, [&] {
+                size_t total = 0, loops_used = 0;
+                for (size_t index = 0; index < LOOPS; index++) {
+                    total += group.load(index);
+                    loops_used += group.load(index) > 0;
+                }
+                test_should_be(total, CLIENTS);
+                test_should_be(loops_used > 1, true);
+            });
+
+            // each loop lets go of its connections once they are done with
+            size_t total = CLIENTS;
+            for (size_t tries = 0; total > 0 and tries < 200; tries++) {
+                this_thread::sleep_for(chrono::milliseconds(10));
+                total = 0;
+                for (size_t index = 0; index < LOOPS; index++) {
+                    total += group.load(index);
+                }
+            }
+            test_should_be(total, size_t{0});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
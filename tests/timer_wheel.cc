@@ -0,0 +1,123 @@
+#include "test_should_be.hh"
+#include "timer_wheel.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+int main() {
+    try {
+        {
+            TimerWheel<int> wheel;
+            test_should_be(wheel.time_until_next().has_value(), false);
+
+            const TimerId a = wheel.arm(5, 1);
+            const TimerId b = wheel.arm(100, 2);
+            const TimerId c = wheel.arm(5000, 3);
+            test_should_be(wheel.size(), size_t{3});
+            test_should_be(wheel.time_until(b).value(), uint64_t{100});
+
+            vector<int> fired;
+            wheel.advance(4, [&](const int x) { fired.push_back(x); });
+            test_should_be(fired.size(), size_t{0});
+            wheel.advance(1, [&](const int x) { fired.push_back(x); });
+            test_should_be(fired.size(), size_t{1});
+            test_should_be(fired.at(0), 1);
+            test_should_be(wheel.armed(a), false);
+            test_should_be(wheel.cancel(a), false);
+
+            test_should_be(wheel.cancel(b), true);
+            test_should_be(wheel.armed(b), false);
+            wheel.advance(1000, [&](const int x) { fired.push_back(x); });
+            test_should_be(fired.size(), size_t{1});
+            test_should_be(wheel.time_until(c).value(), uint64_t{3995});
+
+            // the slot of a canceled timer is reused, but the old id stays dead
+            const TimerId d = wheel.arm(1, 4);
+            test_should_be(d.index, b.index);
+            test_should_be(wheel.armed(b), false);
+            test_should_be(wheel.armed(d), true);
+
+            wheel.advance(10000, [&](const int x) { fired.push_back(x); });
+            test_should_be(fired.size(), size_t{3});
+            test_should_be(fired.at(1), 4);
+            test_should_be(fired.at(2), 3);
+            test_should_be(wheel.size(), size_t{0});
+            test_should_be(wheel.now(), uint64_t{11005});
+        }
+
+        {
+            // a handler may re-arm timers, and a zero delay means the next millisecond
+            TimerWheel<int> wheel;
+            wheel.arm(0, 0);
+            int count = 0;
+            wheel.advance(10, [&](const int) {
+                if (++count < 5) {
+                    wheel.arm(2, 0);
+                }
+            });
+            test_should_be(count, 5);
+            test_should_be(wheel.size(), size_t{0});
+        }
+
+        {
+            // compare expiry times against a plain map over a long run of random arms and cancels
+            auto rd = get_random_generator();
+            TimerWheel<uint64_t> wheel;
+            multimap<uint64_t, TimerId> expected;
+            vector<TimerId> ids;
+            uniform_int_distribution<uint64_t> delay_exp{0, 28};
+
+            for (unsigned round = 0; round < 2000; round++) {
+                for (unsigned i = 0; i < 8; i++) {
+                    const uint64_t delay = (uint64_t{1} << delay_exp(rd)) + rd() % 1000;
+                    const uint64_t deadline = wheel.now() + delay;
+                    const TimerId id = wheel.arm(delay, deadline);
+                    expected.emplace(deadline, id);
+                    ids.push_back(id);
+                }
+                if (!ids.empty() and rd() % 2) {
+                    const TimerId victim = ids.at(rd() % ids.size());
+                    if (wheel.cancel(victim)) {
+                        for (auto it = expected.begin(); it != expected.end(); ++it) {
+                            if (it->second.index == victim.index and it->second.generation == victim.generation) {
+                                expected.erase(it);
+                                break;
+                            }
+                        }
+                    }
+                }
+
+                test_should_be(wheel.size(), expected.size());
+                const uint64_t step = wheel.time_until_next().value();
+                test_should_be(wheel.now() + step <= expected.begin()->first, true);
+
+                const uint64_t advance_by = (uint64_t{1} << delay_exp(rd)) + rd() % 100;
+                const uint64_t end = wheel.now() + advance_by;
+                uint64_t last_deadline = 0;
+                wheel.advance(advance_by, [&](const uint64_t deadline) {
+                    test_should_be(deadline, wheel.now());
+                    test_should_be(deadline >= last_deadline, true);
+                    last_deadline = deadline;
+                    test_should_be(expected.begin()->first, deadline);
+                    expected.erase(expected.begin());
+                });
+                test_should_be(wheel.now(), end);
+                test_should_be(expected.empty() or expected.begin()->first > end, true);
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}